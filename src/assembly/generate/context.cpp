@@ -38,7 +38,8 @@ string Context::rename(string name) {
     return "__Var__" + to_string(name.size() - 1) + name.substr(1);
 }
 
-int Context::resolve_stack_offset(string name) {
+int Context::resolve_stack_offset(int var) {
+  const auto& name = ir::OpName::name_of(var);
   if (name.substr(0, 4) == "$arg") {
     auto id = stoi(name.substr(4));
     if (id < 4) {
@@ -50,7 +51,19 @@ int Context::resolve_stack_offset(string name) {
   } else if (name == "$ra") {
     return stack_size[1] + stack_size[2] + stack_size[3] - 4;
   }
-  return stack_offset_map[name] + stack_size[3];
+  return stack_offset_map[var] + stack_size[3];
+}
+
+int Context::fixed_reg_var_at(int reg, int time) {
+  int var = ir::OpName::intern("$arg:" + to_string(reg) + ":" + to_string(time));
+  fixed_reg_var.insert({var, reg});
+  return var;
+}
+
+int Context::phi_block_timestamp(const ir::IR& cur) {
+  if (cur.phi_block == ir::IRList::iterator()) return 0;
+  auto it = ir_to_time.find(&*cur.phi_block);
+  return it == ir_to_time.end() ? 0 : it->second;
 }
 
 void Context::set_ir_timestamp(ir::IR& cur) {
@@ -60,28 +73,27 @@ void Context::set_var_latest_use_timestamp(ir::IR& cur) {
   if (cur.op_code != ir::OpCode::MALLOC_IN_STACK) {
     cur.forEachOp([&, this](ir::OpName op) {
       if (op.is_var()) {
-        if (!var_latest_use_timestamp.count(op.name)) {
-          var_latest_use_timestamp.insert({op.name, ir_to_time[&cur]});
-          var_latest_use_timestamp_heap.insert({ir_to_time[&cur], op.name});
+        if (!var_latest_use_timestamp.count(op.id)) {
+          var_latest_use_timestamp.insert({op.id, ir_to_time[&cur]});
+          var_latest_use_timestamp_heap.insert({ir_to_time[&cur], op.id});
         }
       }
     });
   }
   if (cur.op_code == ir::OpCode::SET_ARG && cur.dest.value < 4) {
-    string name = "$arg:" + to_string(cur.dest.value) + ":" +
-                  to_string(ir_to_time[&*cur.phi_block]);
-    var_latest_use_timestamp.insert({name, ir_to_time[&*cur.phi_block]});
-    var_latest_use_timestamp_heap.insert(
-        make_pair(ir_to_time[&*cur.phi_block], name));
+    int time = phi_block_timestamp(cur);
+    int name = fixed_reg_var_at(cur.dest.value, time);
+    var_latest_use_timestamp.insert({name, time});
+    var_latest_use_timestamp_heap.insert(make_pair(time, name));
   }
   if (cur.op_code == ir::OpCode::IMUL && cur.op1.is_var()) {
-    var_latest_use_timestamp[cur.op1.name]++;
+    var_latest_use_timestamp[cur.op1.id]++;
   }
   // 易失寄存器
   if (cur.op_code == ir::OpCode::CALL || cur.op_code == ir::OpCode::IDIV ||
       cur.op_code == ir::OpCode::MOD) {
     for (int i = 0; i < 4; i++) {
-      string name = "$arg:" + to_string(i) + ":" + to_string(ir_to_time[&cur]);
+      int name = fixed_reg_var_at(i, ir_to_time[&cur]);
       var_latest_use_timestamp.insert({name, ir_to_time[&cur]});
       var_latest_use_timestamp_heap.insert(make_pair(ir_to_time[&cur], name));
     }
@@ -92,38 +104,74 @@ void Context::set_var_define_timestamp(ir::IR& cur) {
   if (cur.op_code != ir::OpCode::MALLOC_IN_STACK &&
       cur.op_code != ir::OpCode::PHI_MOV) {
     if (cur.dest.is_var()) {
-      if (!var_define_timestamp.count(cur.dest.name)) {
-        var_define_timestamp.insert({cur.dest.name, ir_to_time[&cur]});
+      if (!var_define_timestamp.count(cur.dest.id)) {
+        var_define_timestamp.insert({cur.dest.id, ir_to_time[&cur]});
         var_define_timestamp_heap.insert(
-            make_pair(ir_to_time[&cur], cur.dest.name));
+            make_pair(ir_to_time[&cur], cur.dest.id));
       }
     }
   } else if (cur.op_code == ir::OpCode::PHI_MOV) {
     if (cur.dest.is_var()) {
-      if (!var_define_timestamp.count(cur.dest.name)) {
-        int time = min(ir_to_time[&*cur.phi_block], ir_to_time[&cur]);
-        var_define_timestamp.insert({cur.dest.name, time});
-        var_define_timestamp_heap.insert(make_pair(time, cur.dest.name));
+      if (!var_define_timestamp.count(cur.dest.id)) {
+        int time = min(phi_block_timestamp(cur), ir_to_time[&cur]);
+        var_define_timestamp.insert({cur.dest.id, time});
+        var_define_timestamp_heap.insert(make_pair(time, cur.dest.id));
       }
     }
   }
   if (cur.op_code == ir::OpCode::SET_ARG && cur.dest.value < 4) {
-    string name = "$arg:" + to_string(cur.dest.value) + ":" +
-                  to_string(ir_to_time[&*cur.phi_block]);
+    int name = fixed_reg_var_at(cur.dest.value, phi_block_timestamp(cur));
     var_define_timestamp.insert({name, ir_to_time[&cur]});
     var_define_timestamp_heap.insert(make_pair(ir_to_time[&cur], name));
   }
   if (cur.op_code == ir::OpCode::CALL || cur.op_code == ir::OpCode::IDIV ||
       cur.op_code == ir::OpCode::MOD) {
     for (int i = 0; i < 4; i++) {
-      string name = "$arg:" + to_string(i) + ":" + to_string(ir_to_time[&cur]);
+      int name = fixed_reg_var_at(i, ir_to_time[&cur]);
       var_define_timestamp.insert({name, ir_to_time[&cur]});
       var_define_timestamp_heap.insert(make_pair(ir_to_time[&cur], name));
     }
   }
 }
 
+void Context::compute_live_intervals(ir::IRList::iterator begin,
+                                     ir::IRList::iterator end) {
+  using namespace ir::analysis;
+  Function function(begin, end);
+  Liveness liveness(function, [](const ir::OpName& op) {
+    return op.kind == ir::OpName::Kind::Local ||
+           op.kind == ir::OpName::Kind::LocalArray;
+  });
+  live_intervals = build_live_intervals(function, liveness, ir_to_time);
+  // MUL 的目的寄存器不能与第一个操作数相同
+  for (auto it = begin; it != end; it++) {
+    if (it->op_code == ir::OpCode::IMUL && live_intervals.count(it->op1.id)) {
+      int time = ir_to_time[&*it];
+      live_intervals[it->op1.id].add(time, time + 1);
+    }
+  }
+
+  // 按新的起点重建定义时间的堆，起点相同时保持原有顺序
+  std::vector<std::pair<int, int>> defines(var_define_timestamp_heap.begin(),
+                                           var_define_timestamp_heap.end());
+  for (auto& [time, var] : defines) {
+    auto it = live_intervals.find(var);
+    if (it == live_intervals.end()) continue;
+    time = it->second.start();
+    var_define_timestamp[var] = time;
+    var_latest_use_timestamp[var] = it->second.end();
+  }
+  std::stable_sort(defines.begin(), defines.end(),
+                   [](const auto& a, const auto& b) { return a.first < b.first; });
+  var_define_timestamp_heap = {defines.begin(), defines.end()};
+
+  var_latest_use_timestamp_heap.clear();
+  for (const auto& [var, time] : var_latest_use_timestamp)
+    var_latest_use_timestamp_heap.insert({time, var});
+}
+
 void Context::expire_old_intervals(int cur_time) {
+  current_time = cur_time;
   for (int i = 0; i < reg_count; i++) {
     if (used_reg[i])
       if (reg_to_var.find(i) == reg_to_var.end() ||
@@ -131,33 +179,33 @@ void Context::expire_old_intervals(int cur_time) {
               var_latest_use_timestamp.end() ||
           cur_time >= var_latest_use_timestamp[reg_to_var[i]]) {
         used_reg[i] = 0;
-        log_out << "# [log] " << cur_time << " expire " << reg_to_var[i] << " r"
-                << i << endl;
+        log_out << "# [log] " << cur_time << " expire "
+                << ir::OpName::name_of(reg_to_var[i]) << " r" << i << endl;
         reg_to_var.erase(i);
       }
   }
 }
 
-bool Context::var_in_reg(string name) { return var_to_reg.count(name); }
+bool Context::var_in_reg(int var) { return var_to_reg.count(var); }
 
-void Context::move_reg(string name, int reg_dest) {
+void Context::move_reg(int var, int reg_dest) {
   assert(used_reg[reg_dest] == 0);
-  int old_reg = var_to_reg[name];
+  int old_reg = var_to_reg[var];
   used_reg[old_reg] = 0;
   get_specified_reg(reg_dest);
   reg_to_var.erase(old_reg);
-  var_to_reg[name] = reg_dest;
-  reg_to_var.insert({reg_dest, name});
+  var_to_reg[var] = reg_dest;
+  reg_to_var.insert({reg_dest, var});
 }
 
-void Context::overflow_var(string name) {
-  if (var_to_reg.count(name)) {
-    const int reg_id = var_to_reg[name];
+void Context::overflow_var(int var) {
+  if (var_to_reg.count(var)) {
+    const int reg_id = var_to_reg[var];
     used_reg[reg_id] = 0;
-    var_to_reg.erase(name);
+    var_to_reg.erase(var);
     reg_to_var.erase(reg_id);
   }
-  stack_offset_map[name] = stack_size[2];
+  stack_offset_map[var] = stack_size[2];
   stack_size[2] += 4;
 }
 
@@ -166,11 +214,31 @@ void Context::overflow_reg(int reg_id) {
   overflow_var(reg_to_var[reg_id]);
 }
 
-string Context::select_var_to_overflow(int begin) {
-  string var = "";
+void Context::overflow_hole_vars(int reg_id) {
+  auto owner = reg_to_var.find(reg_id);
+  std::vector<int> vars;
+  for (const auto& [var, reg] : var_to_reg) {
+    if (reg != reg_id || (owner != reg_to_var.end() && owner->second == var))
+      continue;
+    // 已结束的变量不受影响
+    if (var_latest_use_timestamp[var] > current_time) vars.push_back(var);
+  }
+  for (int var : vars) {
+    var_to_reg.erase(var);
+    stack_offset_map[var] = stack_size[2];
+    stack_size[2] += 4;
+  }
+  hole_vars[reg_id].clear();
+  reg_busy_until[reg_id] = 0;
+}
+
+int Context::select_var_to_overflow(int begin) {
+  int var = 0;
   int end = -1;
   for (const auto& i : reg_to_var) {
     if (i.first < begin) continue;
+    // 空洞中还有变量时不能溢出
+    if (reg_busy_until[i.first] > current_time) continue;
     if (var_latest_use_timestamp[i.second] > end) {
       var = i.second;
       end = var_latest_use_timestamp[i.second];
@@ -182,41 +250,72 @@ string Context::select_var_to_overflow(int begin) {
 int Context::find_free_reg(int begin) {
   // 检测可直接使用的
   for (int i = begin; i < reg_count; i++)
-    if ((savable_reg | used_reg)[i] == 0) {
+    if ((savable_reg | used_reg)[i] == 0 && reg_busy_until[i] <= current_time) {
       return i;
     }
   // 保护现场后可用的
   for (int i = begin; i < reg_count; i++)
-    if (used_reg[i] == 0 && savable_reg[i] == 1) {
+    if (used_reg[i] == 0 && savable_reg[i] == 1 &&
+        reg_busy_until[i] <= current_time) {
       return i;
     }
   return -1;
 }
 
-int Context::get_new_reg(int begin) {
-  // 检测可直接使用的
-  for (int i = begin; i < reg_count; i++)
-    if ((savable_reg | used_reg)[i] == 0) {
-      used_reg[i] = 1;
-      return i;
+int Context::find_hole_reg(int var) {
+  auto it = live_intervals.find(var);
+  if (it == live_intervals.end()) return -1;
+  int start = it->second.start(), end = it->second.end();
+  // r0-r3 会被调用等处固定占用，不参与
+  for (int i = 4; i < reg_count; i++) {
+    if (!used_reg[i] || !reg_to_var.count(i)) continue;
+    auto owner = live_intervals.find(reg_to_var[i]);
+    if (owner == live_intervals.end() || owner->second.overlaps(start, end))
+      continue;
+    bool conflict = false;
+    for (const auto& [s, e] : hole_vars[i]) {
+      if (s < end && start < e) {
+        conflict = true;
+        break;
+      }
     }
-  // 保护现场后可用的
-  for (int i = begin; i < reg_count; i++)
-    if (used_reg[i] == 0 && savable_reg[i] == 1) {
-      used_reg[i] = 1;
-      stack_size[1] += 4;
-      savable_reg[i] = 0;
-      return i;
+    if (!conflict) return i;
+  }
+  return -1;
+}
+
+void Context::bind_var_to_hole(int var, int reg_id) {
+  const auto& interval = live_intervals.at(var);
+  hole_vars[reg_id].push_back({interval.start(), interval.end()});
+  reg_busy_until[reg_id] = max(reg_busy_until[reg_id], interval.end());
+  var_to_reg.insert({var, reg_id});
+  log_out << "# [log] " << current_time << " hole "
+          << ir::OpName::name_of(var) << " r" << reg_id << " "
+          << ir::OpName::name_of(reg_to_var[reg_id]) << endl;
+}
+
+int Context::get_new_reg(int begin) {
+  int id = find_free_reg(begin);
+  if (id == -1) {
+    // 选最晚使用的变量溢出，空洞中还有变量的寄存器不选
+    int end = -1;
+    for (const auto& [reg, var] : reg_to_var) {
+      if (reg < begin || reg_busy_until[reg] > current_time) continue;
+      if (var_latest_use_timestamp[var] > end) {
+        id = reg;
+        end = var_latest_use_timestamp[var];
+      }
     }
-  // 选一个溢出
-  int id = begin;
-  for (int i = begin; i < reg_count; i++) {
-    if (var_latest_use_timestamp[reg_to_var[i]] >
-        var_latest_use_timestamp[reg_to_var[id]])
-      id = i;
+  }
+  if (id == -1) {
+    // 各寄存器的空洞中都还有变量，选最早空出的连同这些变量一起溢出
+    id = begin;
+    for (int i = begin; i < reg_count; i++)
+      if (reg_busy_until[i] < reg_busy_until[id]) id = i;
+    overflow_hole_vars(id);
   }
   overflow_reg(id);
-  used_reg[id] = 1;
+  get_specified_reg(id);
   return id;
 }
 
@@ -229,131 +328,132 @@ void Context::get_specified_reg(int reg_id) {
   used_reg[reg_id] = 1;
 }
 
-void Context::bind_var_to_reg(string name, int reg_id) {
-  if (name.empty()) {
+void Context::bind_var_to_reg(int var, int reg_id) {
+  if (ir::OpName::name_of(var).empty()) {
     throw runtime_error("Var name is empty.");
   }
   assert(used_reg[reg_id] == 1);
   if (reg_to_var.find(reg_id) != reg_to_var.end())
     var_to_reg.erase(reg_to_var[reg_id]);
-  reg_to_var.insert({reg_id, name});
-  var_to_reg.insert({name, reg_id});
+  reg_to_var.insert({reg_id, var});
+  var_to_reg.insert({var, reg_id});
 }
 
-int Context::get_new_reg_for(string name) {
-  if (var_to_reg.find(name) != var_to_reg.end()) {
-    return var_to_reg[name];
+int Context::get_new_reg_for(int var) {
+  if (var_to_reg.find(var) != var_to_reg.end()) {
+    return var_to_reg[var];
   }
   int reg_id = get_new_reg();
-  bind_var_to_reg(name, reg_id);
+  bind_var_to_reg(var, reg_id);
   return reg_id;
 }
 
-int Context::get_specified_reg_for(string name, int reg_id) {
-  if (var_to_reg.find(name) != var_to_reg.end()) {
-    if (var_to_reg[name] == reg_id) {
-      return var_to_reg[name];
+int Context::get_specified_reg_for(int var, int reg_id) {
+  if (var_to_reg.find(var) != var_to_reg.end()) {
+    if (var_to_reg[var] == reg_id) {
+      return var_to_reg[var];
     }
   }
   if (used_reg[reg_id] == 1) {
     overflow_reg(reg_id);
   }
   get_specified_reg(reg_id);
-  bind_var_to_reg(name, reg_id);
+  bind_var_to_reg(var, reg_id);
   return reg_id;
 }
 
-void Context::load_imm(string reg, int value, ostream& out) {
+void Context::load_imm(int reg, int value, MachineCode& out) {
   if (value >= 0 && value < 65536)
-    out << "    MOV " << reg << ", #" << value << endl;
+    out.emit(MachineOpCode::MOV, {Operand::reg(reg), Operand::imm(value)});
   else
-    out << "    MOV32 " << reg << ", " << value << endl;
+    out.emit(MachineOpCode::MOV32, {Operand::reg(reg), Operand::imm(value)});
 };
 
-void Context::load(string reg, ir::OpName op, ostream& out) {
+void Context::load(int reg, ir::OpName op, MachineCode& out) {
+  using Op = MachineOpCode;
   if (op.is_imm()) {
     load_imm(reg, op.value, out);
   } else if (op.is_var()) {
-    if (var_to_reg.find(op.name) != var_to_reg.end()) {
-      if (stoi(reg.substr(1)) != var_to_reg[op.name])
-        out << "    MOV " << reg << ", r" << var_to_reg[op.name] << endl;
+    if (var_to_reg.find(op.id) != var_to_reg.end()) {
+      if (reg != var_to_reg[op.id])
+        out.emit(Op::MOV, {Operand::reg(reg), Operand::reg(var_to_reg[op.id])});
     } else {
-      if (op.name[0] == '%') {
-        if (op.name[1] == '&') {
-          int offset = resolve_stack_offset(op.name);
-          if (offset >= 0 && offset < 256) {
-            out << "    ADD " << reg << ", sp, #" << offset << endl;
-          } else {
-            load_imm(reg, resolve_stack_offset(op.name), out);
-            out << "    ADD " << reg << ", sp, " << reg << endl;
-          }
+      if (op.kind == ir::OpName::Kind::LocalArray) {
+        int offset = resolve_stack_offset(op.id);
+        if (offset >= 0 && offset < 256) {
+          out.emit(Op::ADD,
+                   {Operand::reg(reg), Operand::reg(sp), Operand::imm(offset)});
+        } else {
+          load_imm(reg, resolve_stack_offset(op.id), out);
+          out.emit(Op::ADD,
+                   {Operand::reg(reg), Operand::reg(sp), Operand::reg(reg)});
+        }
+      } else if (op.kind == ir::OpName::Kind::Local) {
+        if (var_in_reg(op.id)) {
+          out.emit(Op::MOV,
+                   {Operand::reg(reg), Operand::reg(var_to_reg[op.id])});
         } else {
-          if (var_in_reg(op.name)) {
-            out << "    MOV " << reg << ", r" << var_to_reg[op.name] << endl;
+          int offset = resolve_stack_offset(op.id);
+          if (offset > -4096 && offset < 4096) {
+            out.emit(Op::LDR, {Operand::reg(reg), Operand::mem(sp, offset)});
           } else {
-            int offset = resolve_stack_offset(op.name);
-            if (offset > -4096 && offset < 4096) {
-              out << "    LDR " << reg << ", [sp,#" << offset << ']' << endl;
-            } else {
-              out << "    MOV32 " << reg << ", " << offset << endl;
-              out << "    LDR " << reg << ", [sp, " << reg << "]" << endl;
-            }
+            out.emit(Op::MOV32, {Operand::reg(reg), Operand::imm(offset)});
+            out.emit(Op::LDR, {Operand::reg(reg), Operand::mem_index(sp, reg)});
           }
         }
-      } else if (op.name[0] == '@') {
-        if (op.name[1] != '&') {
-          out << "    MOV32 " << reg << ", " << rename(op.name) << endl;
-          out << "    LDR " << reg << ", [" << reg << ",#0]" << endl;
+      } else if (op.is_global_var()) {
+        if (op.kind != ir::OpName::Kind::GlobalArray) {
+          out.emit(Op::MOV32, {Operand::reg(reg)}, rename(op.name()));
+          out.emit(Op::LDR, {Operand::reg(reg), Operand::mem(reg, 0)});
         } else {
-          out << "    MOV32 " << reg << ", " << rename(op.name) << endl;
+          out.emit(Op::MOV32, {Operand::reg(reg)}, rename(op.name()));
         }
-      } else if (op.name[0] == '$') {
-        int offset = resolve_stack_offset(op.name);
+      } else if (op.name()[0] == '$') {
+        int offset = resolve_stack_offset(op.id);
         if (offset > -4096 && offset < 4096) {
-          out << "    LDR " << reg << ", [sp,#" << offset << ']' << endl;
+          out.emit(Op::LDR, {Operand::reg(reg), Operand::mem(sp, offset)});
         } else {
-          out << "    MOV32 " << reg << ", " << offset << endl;
-          out << "    LDR " << reg << ", [sp," << reg << "]" << endl;
+          out.emit(Op::MOV32, {Operand::reg(reg), Operand::imm(offset)});
+          out.emit(Op::LDR, {Operand::reg(reg), Operand::mem_index(sp, reg)});
         }
       }
     }
   }
 }
 
-void Context::store_to_stack_offset(string reg, int offset, ostream& out,
-                                    string op) {
+void Context::store_to_stack_offset(int reg, int offset, MachineCode& out,
+                                    MachineOpCode op) {
   if (!(offset > -4096 && offset < 4096)) {
-    string tmp_reg = reg == "r14" ? "r12" : "r14";
+    int tmp_reg = reg == 14 ? 12 : 14;
     load_imm(tmp_reg, offset, out);
-    out << "    " << op << " " << reg << ", [sp," << tmp_reg << "]" << endl;
+    out.emit(op, {Operand::reg(reg), Operand::mem_index(sp, tmp_reg)});
   } else {
-    out << "    " << op << " " << reg << ", [sp,#" << offset << "]" << endl;
+    out.emit(op, {Operand::reg(reg), Operand::mem(sp, offset)});
   }
 }
 
-void Context::load_from_stack_offset(string reg, int offset, ostream& out,
-                                     string op) {
+void Context::load_from_stack_offset(int reg, int offset, MachineCode& out,
+                                     MachineOpCode op) {
   if (offset > -4096 && offset < 4096) {
-    out << "    " << op << " " << reg << ", [sp,#" << offset << "]" << endl;
+    out.emit(op, {Operand::reg(reg), Operand::mem(sp, offset)});
   } else {
     load_imm(reg, offset, out);
-    out << "    " << op << " " << reg << ", [sp," << reg << "]" << endl;
+    out.emit(op, {Operand::reg(reg), Operand::mem_index(sp, reg)});
   }
 }
 
-void Context::store_to_stack(string reg, ir::OpName op, ostream& out,
-                             string op_code) {
+void Context::store_to_stack(int reg, ir::OpName op, MachineCode& out,
+                             MachineOpCode op_code) {
   if (!op.is_var()) throw runtime_error("WTF");
-  if (op.name[1] == '&') return;
-  if (op.name[0] == '%') {
-    store_to_stack_offset(reg, resolve_stack_offset(op.name), out, op_code);
-  } else if (op.name[0] == '@') {
-    string tmp_reg = reg == "r14" ? "r12" : "r14";
-    out << "    MOV32 " << tmp_reg << ", " << rename(op.name) << endl;
-    out << "    " << op_code << " " << reg << ", [" << tmp_reg << ",#0]"
-        << endl;
-  } else if (op.name[0] == '$') {
-    int offset = resolve_stack_offset(op.name);
+  if (op.is_array()) return;
+  if (op.kind == ir::OpName::Kind::Local) {
+    store_to_stack_offset(reg, resolve_stack_offset(op.id), out, op_code);
+  } else if (op.is_global_var()) {
+    int tmp_reg = reg == 14 ? 12 : 14;
+    out.emit(MachineOpCode::MOV32, {Operand::reg(tmp_reg)}, rename(op.name()));
+    out.emit(op_code, {Operand::reg(reg), Operand::mem(tmp_reg, 0)});
+  } else if (op.name()[0] == '$') {
+    int offset = resolve_stack_offset(op.id);
     store_to_stack_offset(reg, offset, out, op_code);
   }
 }
@@ -21,11 +21,15 @@
 #include <ostream>
 #include <string>
 #include <unordered_map>
+#include <utility>
+#include <vector>
 
+#include "assembly/machine.h"
 #include "ast/node.h"
 #include "config.h"
 #include "ir/generate/context.h"
 #include "ir/ir.h"
+#include "ir/optimize/analysis/liveness.h"
 
 namespace syc::assembly {
 class Context {
@@ -44,15 +48,25 @@ class Context {
   // stack_size[4]: 函数调用
   std::array<int, 4> stack_size{0, 4, 0, 0};
   ir::IRList::iterator function_begin_it;
-  std::unordered_map<std::string, int> stack_offset_map;
+  std::unordered_map<int, int> stack_offset_map;
   // 获取每一条it对应时间戳
   std::unordered_map<ir::IR*, int> ir_to_time;
   // var定义的时间戳
-  std::unordered_map<std::string, int> var_define_timestamp;
-  std::multimap<int, std::string> var_define_timestamp_heap;
+  std::unordered_map<int, int> var_define_timestamp;
+  std::multimap<int, int> var_define_timestamp_heap;
   // var最后使用的时间戳
-  std::unordered_map<std::string, int> var_latest_use_timestamp;
-  std::multimap<int, std::string> var_latest_use_timestamp_heap;
+  std::unordered_map<int, int> var_latest_use_timestamp;
+  std::multimap<int, int> var_latest_use_timestamp_heap;
+  // 调用等处固定占用 r0-r3 的伪变量及其寄存器号
+  std::unordered_map<int, int> fixed_reg_var;
+  // 局部变量由活跃变量分析得到的活跃区间
+  std::unordered_map<int, ir::analysis::LiveInterval> live_intervals;
+  // 放在其他变量活跃区间空洞中的变量：寄存器号 -> [起点, 终点]
+  std::array<std::vector<std::pair<int, int>>, reg_count> hole_vars;
+  // 寄存器被空洞中的变量占用到该时刻，此前不能分配给其他变量
+  std::array<int, reg_count> reg_busy_until{};
+  // 寄存器分配当前处理到的时刻
+  int current_time = 0;
 
   // 保护现场后可用的寄存器
   std::bitset<reg_count> savable_reg = 0b111111110000;
@@ -60,9 +74,11 @@ class Context {
   std::bitset<reg_count> used_reg = 0b000000000000;
 
   // 当前在寄存器中的变量极其寄存器号(active)
-  std::unordered_map<std::string, int> var_to_reg = {
-      {"$arg0", 0}, {"$arg1", 1}, {"$arg2", 2}, {"$arg3", 3}};
-  std::unordered_map<int, std::string> reg_to_var;
+  std::unordered_map<int, int> var_to_reg = {{ir::OpName("$arg0").id, 0},
+                                             {ir::OpName("$arg1").id, 1},
+                                             {ir::OpName("$arg2").id, 2},
+                                             {ir::OpName("$arg3").id, 3}};
+  std::unordered_map<int, int> reg_to_var;
 
   bool has_function_call = false;
 
@@ -71,31 +87,50 @@ class Context {
 
   static std::string rename(std::string name);
 
-  int resolve_stack_offset(std::string name);
+  int resolve_stack_offset(int var);
+
+  // 时间戳 time 处固定占用寄存器 reg 的伪变量
+  int fixed_reg_var_at(int reg, int time);
+
+  // phi_block 所指指令的时间戳，未设置（如 SET_ARG）或不在本函数中时为 0
+  int phi_block_timestamp(const ir::IR& cur);
 
   void set_ir_timestamp(ir::IR& cur);
   void set_var_latest_use_timestamp(ir::IR& cur);
   void set_var_define_timestamp(ir::IR& cur);
+  // 用活跃变量分析求出的区间替换局部变量按线性时间戳求出的定义与最后使用时间，
+  // 需在上面三个函数之后调用
+  void compute_live_intervals(ir::IRList::iterator begin,
+                              ir::IRList::iterator end);
 
   void expire_old_intervals(int cur_time);
 
-  bool var_in_reg(std::string name);
+  bool var_in_reg(int var);
 
   // 将变量的寄存器分配移动至 dest
-  void move_reg(std::string name, int reg_dest);
+  void move_reg(int var, int reg_dest);
 
-  void overflow_var(std::string name);
+  void overflow_var(int var);
 
   void overflow_reg(int reg_id);
 
+  // 溢出 reg 的空洞中仍活跃的变量，reg 的所属变量不变
+  void overflow_hole_vars(int reg_id);
+
   // 选择最晚使用的变量，以准备进行淘汰
   // 注意：该函数并未真正进行溢出，请调用 overflow_var
-  std::string select_var_to_overflow(int begin = 0);
+  int select_var_to_overflow(int begin = 0);
 
   // 寻找可使用的寄存器，但不获取它
   int find_free_reg(int begin = 0);
 
-  // 获取一个可用寄存器，如 mark=true，设置 used_reg[i] = 1
+  // 寻找当前变量在 var 的整个区间内都不活跃的寄存器（r4 起），找不到返回 -1
+  int find_hole_reg(int var);
+  // 将 var 放入 reg 所属变量的空洞中，reg 的所属变量不变
+  void bind_var_to_hole(int var, int reg_id);
+
+  // 获取一个可用寄存器，设置 used_reg[i] = 1。空洞中还有变量的寄存器
+  // 不会被分配，必要时连同其中的变量一起溢出
   // 警告：该寄存器尚未与变量绑定，考虑配合bind_var_to_reg或使用get_new_reg_for
   int get_new_reg(int begin = 0);
 
@@ -105,26 +140,26 @@ class Context {
   // 将一个变量绑定到寄存器
   // 警告：需要先获取可用寄存器，即 used_reg[i] = 1
   // 考虑配合 get_new_reg 或使用 get_new_reg_for
-  void bind_var_to_reg(std::string name, int reg_id);
+  void bind_var_to_reg(int var, int reg_id);
 
   // 推荐使用
-  int get_new_reg_for(std::string name);
+  int get_new_reg_for(int var);
 
   // 推荐使用
-  int get_specified_reg_for(std::string name, int reg_id);
+  int get_specified_reg_for(int var, int reg_id);
 
   // 加载操作
-  void load_imm(std::string reg, int value, std::ostream& out);
+  void load_imm(int reg, int value, MachineCode& out);
 
-  void load(std::string reg, ir::OpName op, std::ostream& out);
+  void load(int reg, ir::OpName op, MachineCode& out);
 
-  void store_to_stack_offset(std::string reg, int offset, std::ostream& out,
-                             std::string op = "STR");
+  void store_to_stack_offset(int reg, int offset, MachineCode& out,
+                             MachineOpCode op = MachineOpCode::STR);
 
-  void load_from_stack_offset(std::string reg, int offset, std::ostream& out,
-                              std::string op = "LDR");
+  void load_from_stack_offset(int reg, int offset, MachineCode& out,
+                              MachineOpCode op = MachineOpCode::LDR);
 
-  void store_to_stack(std::string reg, ir::OpName op, std::ostream& out,
-                      std::string op_code = "STR");
+  void store_to_stack(int reg, ir::OpName op, MachineCode& out,
+                      MachineOpCode op_code = MachineOpCode::STR);
 };
 }  // namespace syc::assembly
\ No newline at end of file
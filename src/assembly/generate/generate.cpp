@@ -20,27 +20,98 @@
 #include <cassert>
 #include <cmath>
 #include <string>
+#include <utility>
+#include <vector>
 
 #include "assembly/generate/context.h"
 #include "ast/node.h"
 #include "config.h"
 #include "ir/ir.h"
+#include "thread_pool.h"
 
 using namespace std;
 
 namespace syc::assembly {
 namespace {
-void write_dwarf2(ir::IR ir, ostream& out) {
+void write_dwarf2(const ir::IR& ir, MachineCode& out) {
   if (config::enable_dwarf2) {
-    out << ".loc 1 " << ir.line << " " << ir.column << endl;
+    out.directive(".loc 1 " + to_string(ir.line) + " " + to_string(ir.column));
   }
 }
 
+Operand R(int reg) { return Operand::reg(reg); }
+Operand Imm(int value) { return Operand::imm(value); }
+Operand Q(int reg) { return Operand::qreg(reg); }
+
 constexpr bitset<Context::reg_count> non_volatile_reg = 0b111111110000;
 
+// 把 VLOAD/VSTORE 访问的地址 op1 + op2 放到 r12
+void load_vector_address(Context& ctx, const ir::IR& ir, MachineCode& out) {
+  using Op = MachineOpCode;
+  bool op1_in_reg = ir.op1.is_var() && ctx.var_in_reg(ir.op1.id);
+  int op1 = op1_in_reg ? ctx.var_to_reg[ir.op1.id] : 12;
+  if (!op1_in_reg) ctx.load(op1, ir.op1, out);
+  if (ir.op2.is_imm() && ir.op2.value >= 0 && ir.op2.value < 256) {
+    out.emit(Op::ADD, {R(12), R(op1), Imm(ir.op2.value)});
+  } else {
+    bool op2_in_reg = ir.op2.is_var() && ctx.var_in_reg(ir.op2.id);
+    int op2 = op2_in_reg ? ctx.var_to_reg[ir.op2.id] : 14;
+    if (!op2_in_reg) ctx.load(op2, ir.op2, out);
+    out.emit(Op::ADD, {R(12), R(op1), R(op2)});
+  }
+}
+
+// 恢复 lr 与保护的寄存器并释放栈帧
+void restore_frame(Context& ctx, MachineCode& out) {
+  using Op = MachineOpCode;
+  auto& stack_size = ctx.stack_size;
+  ctx.load(lr, ir::OpName("$ra"), out);
+
+  // 恢复现场
+  int offset = 0;
+  for (int i = 0; i < Context::reg_count; i++) {
+    if (non_volatile_reg[i] != ctx.savable_reg[i]) {
+      ctx.load_from_stack_offset(i, stack_size[2] + stack_size[3] + offset,
+                                 out);
+      offset += 4;
+    }
+  }
+
+  if (stack_size[0] + stack_size[1] + stack_size[2] + stack_size[3] > 127) {
+    ctx.load(12, stack_size[0] + stack_size[1] + stack_size[2] + stack_size[3],
+             out);
+    out.emit(Op::ADD, {R(sp), R(sp), R(12)});
+  } else {
+    out.emit(Op::ADD, {R(sp), R(sp),
+                       Imm(stack_size[0] + stack_size[1] + stack_size[2] +
+                           stack_size[3])});
+  }
+}
+
+// CALL 后紧跟返回其结果的 RET 时，返回 CALL 通过栈传递的参数个数，
+// 否则返回 -1。栈上数组的地址可能作为实参，有栈上数组的函数不做尾调用
+int tail_call_stack_args(ir::IRList::iterator begin, ir::IRList::iterator call,
+                         bool has_stack_array) {
+  if (config::optimize_level == 0 || has_stack_array) return -1;
+  auto ret = std::next(call);
+  if (ret->op_code != ir::OpCode::RET ||
+      !(ret->op1.is_null() || (call->dest.is_var() && ret->op1 == call->dest)))
+    return -1;
+  int count = 0;
+  for (auto it = std::prev(call);
+       it != begin && it->op_code != ir::OpCode::CALL; it--) {
+    if (it->op_code == ir::OpCode::SET_ARG)
+      count = std::max(count, it->dest.value - 3);
+  }
+  // 只能放进调用者为本函数留出的参数区
+  if (count > std::max(begin->op1.value - 4, 0)) return -1;
+  return count;
+}
+
 void generate_function_asm(ir::IRList& irs, ir::IRList::iterator begin,
-                           ir::IRList::iterator end, ostream& out,
-                           ostream& log_out) {
+                           ir::IRList::iterator end, MachineCode& out) {
+  using Op = MachineOpCode;
+  auto& log_out = out.log();
   assert(begin->op_code == ir::OpCode::FUNCTION_BEGIN);
   Context ctx(&irs, begin, log_out);
 
@@ -57,6 +128,8 @@ void generate_function_asm(ir::IRList& irs, ir::IRList::iterator begin,
     ctx.set_var_latest_use_timestamp(*it);
   }
 
+  ctx.compute_live_intervals(begin, end);
+
   for (auto it = begin; it != end; it++) {
     if (it->op_code == ir::OpCode::CALL || it->op_code == ir::OpCode::IDIV ||
         it->op_code == ir::OpCode::MOD) {
@@ -70,11 +143,13 @@ void generate_function_asm(ir::IRList& irs, ir::IRList::iterator begin,
     it->print(log_out);
   }
 
+  bool has_stack_array = false;
   for (auto it = begin; it != end; it++) {
     auto& ir = *it;
     ///////////////////////////////////// 计算栈大小 (数组分配)
     if (ir.op_code == ir::OpCode::MALLOC_IN_STACK) {
-      ctx.stack_offset_map[ir.dest.name] = ctx.stack_size[2];
+      has_stack_array = true;
+      ctx.stack_offset_map[ir.dest.id] = ctx.stack_size[2];
       ctx.stack_size[2] += ir.op1.value;
     } else if (ir.op_code == ir::OpCode::SET_ARG) {
       ctx.stack_size[3] = std::max(ctx.stack_size[3], (ir.dest.value - 3) * 4);
@@ -84,21 +159,21 @@ void generate_function_asm(ir::IRList& irs, ir::IRList::iterator begin,
   // 寄存器分配
   for (const auto& i : ctx.var_define_timestamp_heap) {
     int cur_time = i.first;
-    auto var_name = i.second;
+    int var = i.second;
     ctx.expire_old_intervals(cur_time);
 
-    if (ctx.var_in_reg(var_name)) {
+    if (ctx.var_in_reg(var)) {
       // TODO: 有这种情况吗????
       continue;
     } else {
-      if (var_name.substr(0, 5) == "$arg:") {
-        int reg = stoi(var_name.substr(5));
+      if (ctx.fixed_reg_var.count(var)) {
+        int reg = ctx.fixed_reg_var[var];
         if (ctx.used_reg[reg]) {
-          string cur_var = ctx.reg_to_var[reg];
+          int cur_var = ctx.reg_to_var[reg];
           if (ctx.find_free_reg(4) != -1) {
             ctx.move_reg(cur_var, ctx.find_free_reg(4));
           } else {
-            string overflow_var = ctx.select_var_to_overflow(4);
+            int overflow_var = ctx.select_var_to_overflow(4);
             if (ctx.var_latest_use_timestamp[cur_var] >=
                 ctx.var_latest_use_timestamp[overflow_var]) {
               overflow_var = cur_var;
@@ -109,31 +184,34 @@ void generate_function_asm(ir::IRList& irs, ir::IRList::iterator begin,
             }
           }
         }
-        ctx.get_specified_reg_for(var_name, reg);
+        ctx.get_specified_reg_for(var, reg);
       } else {
-        if (var_name[0] != '%') continue;
+        if (ir::OpName::kind_of(var) != ir::OpName::Kind::Local &&
+            ir::OpName::kind_of(var) != ir::OpName::Kind::LocalArray)
+          continue;
         // 与期间内固定分配寄存器冲突
         bool conflict = false;
-        int latest = ctx.var_latest_use_timestamp[var_name];
+        int latest = ctx.var_latest_use_timestamp[var];
         for (const auto& j : ctx.var_define_timestamp_heap) {
           if (j.first <= cur_time) continue;
           if (j.first > latest) break;
-          if (j.second.substr(0, 5) == "$arg:") {
+          if (ctx.fixed_reg_var.count(j.second)) {
             conflict = true;
             break;
           }
         }
 
         if (ctx.find_free_reg(conflict ? 4 : 0) != -1) {
-          ctx.get_specified_reg_for(var_name,
-                                    ctx.find_free_reg(conflict ? 4 : 0));
+          ctx.get_specified_reg_for(var, ctx.find_free_reg(conflict ? 4 : 0));
+        } else if (ctx.find_hole_reg(var) != -1) {
+          ctx.bind_var_to_hole(var, ctx.find_hole_reg(var));
         } else {
-          string cur_max = ctx.select_var_to_overflow(conflict ? 4 : 0);
-          if (ctx.var_latest_use_timestamp[var_name] <
+          int cur_max = ctx.select_var_to_overflow(conflict ? 4 : 0);
+          if (ctx.var_latest_use_timestamp[var] <
               ctx.var_latest_use_timestamp[cur_max]) {
-            ctx.get_specified_reg_for(var_name, ctx.var_to_reg[cur_max]);
+            ctx.get_specified_reg_for(var, ctx.var_to_reg[cur_max]);
           } else {
-            ctx.overflow_var(var_name);
+            ctx.overflow_var(var);
           }
         }
       }
@@ -149,146 +227,140 @@ void generate_function_asm(ir::IRList& irs, ir::IRList::iterator begin,
     ir.print(log_out);
 
     if (ir.op_code == ir::OpCode::FUNCTION_BEGIN) {
-      out << ".text" << endl;
-      out << ".global " << ir.label << endl;
-      out << ".type	" << ir.label << ", %function" << endl;
-      out << ir.label << ":" << endl;
+      out.directive(".text");
+      out.directive(".global " + ir.label);
+      out.directive(".type	" + ir.label + ", %function");
+      out.label(ir.label);
       if (stack_size[0] + stack_size[1] + stack_size[2] + stack_size[3] > 256) {
-        ctx.load("r12",
+        ctx.load(12,
                  stack_size[0] + stack_size[1] + stack_size[2] + stack_size[3],
                  out);
-        out << "    SUB sp, sp, r12" << endl;
+        out.emit(Op::SUB, {R(sp), R(sp), R(12)});
       } else {
-        out << "    SUB sp, sp, #"
-            << stack_size[0] + stack_size[1] + stack_size[2] + stack_size[3]
-            << endl;
+        out.emit(Op::SUB, {R(sp), R(sp),
+                           Imm(stack_size[0] + stack_size[1] + stack_size[2] +
+                               stack_size[3])});
       }
-      ctx.store_to_stack("r14", ir::OpName("$ra"), out);
+      ctx.store_to_stack(lr, ir::OpName("$ra"), out);
 
       // 保护现场
       int offset = 0;
       for (int i = 0; i < Context::reg_count; i++) {
         if (non_volatile_reg[i] != ctx.savable_reg[i]) {
-          ctx.store_to_stack_offset(
-              "r" + to_string(i), stack_size[2] + stack_size[3] + offset, out);
+          ctx.store_to_stack_offset(i, stack_size[2] + stack_size[3] + offset,
+                                    out);
           offset += 4;
         }
       }
     } else if (ir.op_code == ir::OpCode::MOV ||
                ir.op_code == ir::OpCode::PHI_MOV) {
       if (ir.dest == ir.op1) continue;
-      bool dest_in_reg = ctx.var_in_reg(ir.dest.name);
+      bool dest_in_reg = ctx.var_in_reg(ir.dest.id);
       if (ir.op1.is_imm()) {
         if (dest_in_reg) {
-          ctx.load_imm("r" + to_string(ctx.var_to_reg[ir.dest.name]),
-                       ir.op1.value, out);
+          ctx.load_imm(ctx.var_to_reg[ir.dest.id], ir.op1.value, out);
         } else {
-          ctx.load_imm("r12", ir.op1.value, out);
-          ctx.store_to_stack("r12", ir.dest, out);
+          ctx.load_imm(12, ir.op1.value, out);
+          ctx.store_to_stack(12, ir.dest, out);
         }
       } else if (ir.op1.is_var()) {
-        bool op1_in_reg = ir.op1.is_var() && ctx.var_in_reg(ir.op1.name);
-        int op1 = op1_in_reg ? ctx.var_to_reg[ir.op1.name] : 12;
-        int dest = dest_in_reg ? ctx.var_to_reg[ir.dest.name] : 12;
+        bool op1_in_reg = ir.op1.is_var() && ctx.var_in_reg(ir.op1.id);
+        int op1 = op1_in_reg ? ctx.var_to_reg[ir.op1.id] : 12;
+        int dest = dest_in_reg ? ctx.var_to_reg[ir.dest.id] : 12;
         if (!op1_in_reg) {
-          ctx.load("r" + to_string(op1), ir.op1, out);
+          ctx.load(op1, ir.op1, out);
         }
         if (dest_in_reg && op1 != dest)
-          out << "    MOV r" << dest << ", r" << op1 << endl;
+          out.emit(Op::MOV, {R(dest), R(op1)});
         else if (!dest_in_reg) {
-          ctx.store_to_stack("r" + to_string(op1), ir.dest, out);
+          ctx.store_to_stack(op1, ir.dest, out);
         }
       }
     }
 #define F(OP_NAME, OP)                                                \
   else if (ir.op_code == ir::OpCode::OP_NAME) {                       \
-    bool dest_in_reg = ctx.var_in_reg(ir.dest.name);                  \
-    bool op1_in_reg = ir.op1.is_var() && ctx.var_in_reg(ir.op1.name); \
-    bool op2_in_reg = ir.op2.is_var() && ctx.var_in_reg(ir.op2.name); \
+    bool dest_in_reg = ctx.var_in_reg(ir.dest.id);                    \
+    bool op1_in_reg = ir.op1.is_var() && ctx.var_in_reg(ir.op1.id);   \
+    bool op2_in_reg = ir.op2.is_var() && ctx.var_in_reg(ir.op2.id);   \
     bool op2_is_imm =                                                 \
         ir.op2.is_imm() && (ir.op2.value >= 0 && ir.op2.value < 256); \
-    int op1 = op1_in_reg ? ctx.var_to_reg[ir.op1.name] : 14;          \
-    int op2 = op2_in_reg ? ctx.var_to_reg[ir.op2.name] : 12;          \
-    int dest = dest_in_reg ? ctx.var_to_reg[ir.dest.name] : 12;       \
+    int op1 = op1_in_reg ? ctx.var_to_reg[ir.op1.id] : 14;            \
+    int op2 = op2_in_reg ? ctx.var_to_reg[ir.op2.id] : 12;            \
+    int dest = dest_in_reg ? ctx.var_to_reg[ir.dest.id] : 12;         \
     if (!op2_in_reg && !op2_is_imm) {                                 \
-      ctx.load("r" + to_string(op2), ir.op2, out);                    \
+      ctx.load(op2, ir.op2, out);                                     \
     }                                                                 \
     if (!op1_in_reg) {                                                \
-      ctx.load("r" + to_string(op1), ir.op1, out);                    \
-    }                                                                 \
-    out << "    " OP " r" << dest << ", r" << op1 << ", ";            \
-    if (op2_is_imm) {                                                 \
-      out << "#" << ir.op2.value << endl;                             \
-    } else {                                                          \
-      out << "r" << op2 << endl;                                      \
+      ctx.load(op1, ir.op1, out);                                     \
     }                                                                 \
+    out.emit(Op::OP, {R(dest), R(op1),                                \
+                      op2_is_imm ? Imm(ir.op2.value) : R(op2)});      \
     if (!dest_in_reg) {                                               \
-      ctx.store_to_stack("r" + to_string(dest), ir.dest, out);        \
+      ctx.store_to_stack(dest, ir.dest, out);                         \
     }                                                                 \
   }
-    F(ADD, "ADD")
-    F(SUB, "SUB")
+    F(ADD, ADD)
+    F(SUB, SUB)
 #undef F
     else if (ir.op_code == ir::OpCode::IMUL) {
-      bool dest_in_reg = ctx.var_in_reg(ir.dest.name);
-      bool op1_in_reg = ir.op1.is_var() && ctx.var_in_reg(ir.op1.name);
-      bool op2_in_reg = ir.op2.is_var() && ctx.var_in_reg(ir.op2.name);
-      int op1 = op1_in_reg ? ctx.var_to_reg[ir.op1.name] : 14;
-      int op2 = op2_in_reg ? ctx.var_to_reg[ir.op2.name] : 12;
-      int dest = dest_in_reg ? ctx.var_to_reg[ir.dest.name] : 12;
+      bool dest_in_reg = ctx.var_in_reg(ir.dest.id);
+      bool op1_in_reg = ir.op1.is_var() && ctx.var_in_reg(ir.op1.id);
+      bool op2_in_reg = ir.op2.is_var() && ctx.var_in_reg(ir.op2.id);
+      int op1 = op1_in_reg ? ctx.var_to_reg[ir.op1.id] : 14;
+      int op2 = op2_in_reg ? ctx.var_to_reg[ir.op2.id] : 12;
+      int dest = dest_in_reg ? ctx.var_to_reg[ir.dest.id] : 12;
       if (!op2_in_reg) {
-        ctx.load("r" + to_string(op2), ir.op2, out);
+        ctx.load(op2, ir.op2, out);
       }
       if (!op1_in_reg) {
-        ctx.load("r" + to_string(op1), ir.op1, out);
+        ctx.load(op1, ir.op1, out);
       }
       if (dest == op1) {
-        out << "    MUL r12, r" << op1 << ", r" << op2 << endl;
-        out << "    MOV r" << dest << ", r12" << endl;
+        out.emit(Op::MUL, {R(12), R(op1), R(op2)});
+        out.emit(Op::MOV, {R(dest), R(12)});
       } else {
-        out << "    MUL r" << dest << ", r" << op1 << ", r" << op2 << endl;
+        out.emit(Op::MUL, {R(dest), R(op1), R(op2)});
       }
       if (!dest_in_reg) {
-        ctx.store_to_stack("r" + to_string(dest), ir.dest, out);
+        ctx.store_to_stack(dest, ir.dest, out);
       }
     }
-#define F(OP_NAME, OP)                                                     \
-  else if (ir.op_code == ir::OpCode::OP_NAME) {                            \
-    assert(ir.op2.is_imm());                                               \
-    bool dest_in_reg = ctx.var_in_reg(ir.dest.name);                       \
-    bool op1_in_reg = ir.op1.is_var() && ctx.var_in_reg(ir.op1.name);      \
-    int op1 = op1_in_reg ? ctx.var_to_reg[ir.op1.name] : 14;               \
-    int dest = dest_in_reg ? ctx.var_to_reg[ir.dest.name] : 12;            \
-    if (!op1_in_reg) {                                                     \
-      ctx.load("r" + to_string(op1), ir.op1, out);                         \
-    }                                                                      \
-    out << "    " OP " r" << dest << ", r" << op1 << ", #" << ir.op2.value \
-        << endl;                                                           \
-    if (!dest_in_reg) {                                                    \
-      ctx.store_to_stack("r" + to_string(dest), ir.dest, out);             \
-    }                                                                      \
+#define F(OP_NAME, OP)                                                 \
+  else if (ir.op_code == ir::OpCode::OP_NAME) {                        \
+    assert(ir.op2.is_imm());                                           \
+    bool dest_in_reg = ctx.var_in_reg(ir.dest.id);                     \
+    bool op1_in_reg = ir.op1.is_var() && ctx.var_in_reg(ir.op1.id);    \
+    int op1 = op1_in_reg ? ctx.var_to_reg[ir.op1.id] : 14;             \
+    int dest = dest_in_reg ? ctx.var_to_reg[ir.dest.id] : 12;          \
+    if (!op1_in_reg) {                                                 \
+      ctx.load(op1, ir.op1, out);                                      \
+    }                                                                  \
+    out.emit(Op::OP, {R(dest), R(op1), Imm(ir.op2.value)});            \
+    if (!dest_in_reg) {                                                \
+      ctx.store_to_stack(dest, ir.dest, out);                          \
+    }                                                                  \
   }
-    F(SAL, "LSL")
-    F(SAR, "ASR")
+    F(SAL, LSL)
+    F(SAR, ASR)
 #undef F
     else if (ir.op_code == ir::OpCode::IDIV) {
       if (config::optimize_level > 0 && ir.op2.is_imm()) {
-        bool dest_in_reg = ctx.var_in_reg(ir.dest.name);
-        int dest = dest_in_reg ? ctx.var_to_reg[ir.dest.name] : 14;
-        bool op1_in_reg = ir.op1.is_var() && ctx.var_in_reg(ir.op1.name);
-        int op1 = op1_in_reg ? ctx.var_to_reg[ir.op1.name] : 0;
+        bool dest_in_reg = ctx.var_in_reg(ir.dest.id);
+        int dest = dest_in_reg ? ctx.var_to_reg[ir.dest.id] : 14;
+        bool op1_in_reg = ir.op1.is_var() && ctx.var_in_reg(ir.op1.id);
+        int op1 = op1_in_reg ? ctx.var_to_reg[ir.op1.id] : 0;
         if (!op1_in_reg) {
-          ctx.load("r" + to_string(op1), ir.op1, out);
+          ctx.load(op1, ir.op1, out);
         }
 
         int c = ir.op2.value;
         if (c < 0) {
           c = -c;
-          out << "    MOV r3, #0" << endl;
-          out << "    SUBS r3, r3, r" << op1 << endl;  // op1 = -op1;
+          out.emit(Op::MOV, {R(3), Imm(0)});
+          out.emit(Op::SUBS, {R(3), R(3), R(op1)});  // op1 = -op1;
           op1 = 3;
         } else {
-          out << "    CMP r" << op1 << ", #0" << endl;
+          out.emit(Op::CMP, {R(op1), Imm(0)});
         }
         int k = 0;
         int g = c;
@@ -297,8 +369,8 @@ void generate_function_asm(ir::IRList& irs, ir::IRList::iterator begin,
           k += 1;
         }
         if ((c & (c - 1)) ? false : true) {
-          out << "    ASR r" << dest << ", r" << op1 << ", #" << k << endl;
-          out << "    ADDLT r" << dest << ", r" << dest << ", #1" << endl;
+          out.emit(Op::ASR, {R(dest), R(op1), Imm(k)});
+          out.emit(Op::ADDLT, {R(dest), R(dest), Imm(1)});
         } else {
           // E = 2^k/c
           double E = (double)((int64_t)1 << k) / c;
@@ -311,267 +383,335 @@ void generate_function_asm(ir::IRList& irs, ir::IRList::iterator begin,
             s = floor(f);
           }
           s = ceil(f);
-          ctx.load_imm("r1", s, out);
-          out << "    SMULL r12, r2, r" << op1 << ", r1" << endl;
-          out << "    ASR r" << dest << ", r2, #" << k - 1 << endl;
-          out << "    ADDLT r" << dest << ", r" << dest << ", #1" << endl;
+          ctx.load_imm(1, s, out);
+          out.emit(Op::SMULL, {R(12), R(2), R(op1), R(1)});
+          out.emit(Op::ASR, {R(dest), R(2), Imm(k - 1)});
+          out.emit(Op::ADDLT, {R(dest), R(dest), Imm(1)});
         }
 
         if (!dest_in_reg) {
-          ctx.store_to_stack("r" + to_string(dest), ir.dest, out);
+          ctx.store_to_stack(dest, ir.dest, out);
         }
       } else {
-        ctx.load("r0", ir.op1, out);
-        ctx.load("r1", ir.op2, out);
-        out << "    BL __aeabi_idiv" << endl;
-        if (ctx.var_in_reg(ir.dest.name)) {
-          out << "    MOV r" << ctx.var_to_reg[ir.dest.name] << ", r0" << endl;
+        ctx.load(0, ir.op1, out);
+        ctx.load(1, ir.op2, out);
+        out.emit(Op::BL, "__aeabi_idiv");
+        if (ctx.var_in_reg(ir.dest.id)) {
+          out.emit(Op::MOV, {R(ctx.var_to_reg[ir.dest.id]), R(0)});
         } else {
-          ctx.store_to_stack("r0", ir.dest, out);
+          ctx.store_to_stack(0, ir.dest, out);
         }
       }
     }
     else if (ir.op_code == ir::OpCode::MOD) {
-      ctx.load("r0", ir.op1, out);
-      ctx.load("r1", ir.op2, out);
-      out << "    BL __aeabi_idivmod" << endl;
-      if (ctx.var_in_reg(ir.dest.name)) {
-        out << "    MOV r" << ctx.var_to_reg[ir.dest.name] << ", r1" << endl;
+      ctx.load(0, ir.op1, out);
+      ctx.load(1, ir.op2, out);
+      out.emit(Op::BL, "__aeabi_idivmod");
+      if (ctx.var_in_reg(ir.dest.id)) {
+        out.emit(Op::MOV, {R(ctx.var_to_reg[ir.dest.id]), R(1)});
       } else {
-        ctx.store_to_stack("r1", ir.dest, out);
+        ctx.store_to_stack(1, ir.dest, out);
       }
     }
     else if (ir.op_code == ir::OpCode::CALL) {
-      out << "    BL " << ir.label << endl;
+      int stack_args = tail_call_stack_args(begin, it, has_stack_array);
+      if (stack_args >= 0) {
+        // 尾调用：把栈上的实参移到本函数的参数区，释放栈帧后直接跳转，
+        // 被调函数返回到本函数的调用者
+        int frame_size =
+            stack_size[0] + stack_size[1] + stack_size[2] + stack_size[3];
+        for (int i = 0; i < stack_args; i++) {
+          ctx.load_from_stack_offset(12, i * 4, out);
+          ctx.store_to_stack_offset(12, frame_size + i * 4, out);
+        }
+        restore_frame(ctx, out);
+        out.emit(Op::B, ir.label);
+        it++;
+        continue;
+      }
+      out.emit(Op::BL, ir.label);
       if (ir.dest.is_var()) {
-        if (ctx.var_in_reg(ir.dest.name)) {
-          out << "    MOV r" << ctx.var_to_reg[ir.dest.name] << ", r0" << endl;
+        if (ctx.var_in_reg(ir.dest.id)) {
+          out.emit(Op::MOV, {R(ctx.var_to_reg[ir.dest.id]), R(0)});
         } else {
-          ctx.store_to_stack("r0", ir.dest, out);
+          ctx.store_to_stack(0, ir.dest, out);
         }
       }
     }
     else if (ir.op_code == ir::OpCode::SET_ARG) {
       if (ir.dest.value < 4) {
-        ctx.load("r" + to_string(ir.dest.value), ir.op1, out);
+        ctx.load(ir.dest.value, ir.op1, out);
       } else {
-        ctx.load("r12", ir.op1, out);
-        ctx.store_to_stack_offset("r12", (ir.dest.value - 4) * 4, out);
+        ctx.load(12, ir.op1, out);
+        ctx.store_to_stack_offset(12, (ir.dest.value - 4) * 4, out);
       }
     }
     else if (ir.op_code == ir::OpCode::CMP) {
-      bool op1_in_reg = ir.op1.is_var() && ctx.var_in_reg(ir.op1.name);
-      bool op2_in_reg = ir.op2.is_var() && ctx.var_in_reg(ir.op2.name);
-      int op1 = op1_in_reg ? ctx.var_to_reg[ir.op1.name] : 12;
-      int op2 = op2_in_reg ? ctx.var_to_reg[ir.op2.name] : 14;
+      bool op1_in_reg = ir.op1.is_var() && ctx.var_in_reg(ir.op1.id);
+      bool op2_in_reg = ir.op2.is_var() && ctx.var_in_reg(ir.op2.id);
+      int op1 = op1_in_reg ? ctx.var_to_reg[ir.op1.id] : 12;
+      int op2 = op2_in_reg ? ctx.var_to_reg[ir.op2.id] : 14;
       if (!op1_in_reg) {
-        ctx.load("r" + to_string(op1), ir.op1, out);
+        ctx.load(op1, ir.op1, out);
       }
       if (!op2_in_reg) {
-        ctx.load("r" + to_string(op2), ir.op2, out);
+        ctx.load(op2, ir.op2, out);
       }
-      out << "    CMP r" << op1 << ", r" << op2 << endl;
+      out.emit(Op::CMP, {R(op1), R(op2)});
     }
 #define F(OP_NAME, OP)                          \
   else if (ir.op_code == ir::OpCode::OP_NAME) { \
-    out << "    " OP " " << ir.label << endl;   \
+    out.emit(Op::OP, ir.label);                 \
   }
-    F(JMP, "B")
-    F(JEQ, "BEQ")
-    F(JNE, "BNE")
-    F(JLE, "BLE")
-    F(JLT, "BLT")
-    F(JGE, "BGE")
-    F(JGT, "BGT")
+    F(JMP, B)
+    F(JEQ, BEQ)
+    F(JNE, BNE)
+    F(JLE, BLE)
+    F(JLT, BLT)
+    F(JGE, BGE)
+    F(JGT, BGT)
 #undef F
-#define F(OP_NAME, OP_THEN, OP_ELSE)                                       \
-  else if (ir.op_code == ir::OpCode::OP_NAME) {                            \
-    bool dest_in_reg = ctx.var_in_reg(ir.dest.name);                       \
-    int dest = dest_in_reg ? ctx.var_to_reg[ir.dest.name] : 12;            \
-    if (ir.op1.is_imm() && ir.op1.value >= 0 && ir.op1.value < 256 &&      \
-        ir.op2.is_imm() && ir.op2.value >= 0 && ir.op2.value < 256) {      \
-      out << "    " OP_THEN " r" << dest << ", #" << ir.op1.value << endl; \
-      out << "    " OP_ELSE " r" << dest << ", #" << ir.op2.value << endl; \
-      if (!dest_in_reg) {                                                  \
-        ctx.store_to_stack("r" + to_string(dest), ir.dest, out);           \
-      }                                                                    \
-    } else { /* TODO */                                                    \
-    }                                                                      \
+// 载入操作数不改变条件标志，两条条件 MOV 中只有一条执行
+#define F(OP_NAME, OP_THEN, OP_ELSE)                                  \
+  else if (ir.op_code == ir::OpCode::OP_NAME) {                       \
+    bool dest_in_reg = ctx.var_in_reg(ir.dest.id);                    \
+    int dest = dest_in_reg ? ctx.var_to_reg[ir.dest.id] : 12;         \
+    if (ir.op1.is_imm() && ir.op1.value >= 0 && ir.op1.value < 256 && \
+        ir.op2.is_imm() && ir.op2.value >= 0 && ir.op2.value < 256) { \
+      out.emit(Op::OP_THEN, {R(dest), Imm(ir.op1.value)});            \
+      out.emit(Op::OP_ELSE, {R(dest), Imm(ir.op2.value)});            \
+      if (!dest_in_reg) {                                             \
+        ctx.store_to_stack(dest, ir.dest, out);                       \
+      }                                                               \
+    } else {                                                          \
+      bool op1_in_reg = ir.op1.is_var() && ctx.var_in_reg(ir.op1.id); \
+      bool op2_in_reg = ir.op2.is_var() && ctx.var_in_reg(ir.op2.id); \
+      int op1 = op1_in_reg ? ctx.var_to_reg[ir.op1.id] : 14;          \
+      int op2 = op2_in_reg ? ctx.var_to_reg[ir.op2.id] : 12;          \
+      if (!op1_in_reg) {                                              \
+        ctx.load(op1, ir.op1, out);                                   \
+      }                                                               \
+      if (!op2_in_reg) {                                              \
+        ctx.load(op2, ir.op2, out);                                   \
+      }                                                               \
+      out.emit(Op::OP_THEN, {R(dest), R(op1)});                       \
+      out.emit(Op::OP_ELSE, {R(dest), R(op2)});                       \
+      if (!dest_in_reg) {                                             \
+        ctx.store_to_stack(dest, ir.dest, out);                       \
+      }                                                               \
+    }                                                                 \
   }
-    F(MOVEQ, "MOVEQ", "MOVNE")
-    F(MOVNE, "MOVNE", "MOVEQ")
-    F(MOVLE, "MOVLE", "MOVGT")
-    F(MOVGT, "MOVGT", "MOVLE")
-    F(MOVLT, "MOVLT", "MOVGE")
-    F(MOVGE, "MOVGE", "MOVLT")
+    F(MOVEQ, MOVEQ, MOVNE)
+    F(MOVNE, MOVNE, MOVEQ)
+    F(MOVLE, MOVLE, MOVGT)
+    F(MOVGT, MOVGT, MOVLE)
+    F(MOVLT, MOVLT, MOVGE)
+    F(MOVGE, MOVGE, MOVLT)
 #undef F
     else if (ir.op_code == ir::OpCode::AND) {
-      bool dest_in_reg = ctx.var_in_reg(ir.dest.name);
-      bool op1_in_reg = ir.op1.is_var() && ctx.var_in_reg(ir.op1.name);
-      bool op2_in_reg = ir.op2.is_var() && ctx.var_in_reg(ir.op2.name);
-      int op1 = op1_in_reg ? ctx.var_to_reg[ir.op1.name] : 12;
-      int op2 = op2_in_reg ? ctx.var_to_reg[ir.op2.name] : 14;
-      int dest = dest_in_reg ? ctx.var_to_reg[ir.dest.name] : 12;
+      bool dest_in_reg = ctx.var_in_reg(ir.dest.id);
+      bool op1_in_reg = ir.op1.is_var() && ctx.var_in_reg(ir.op1.id);
+      bool op2_in_reg = ir.op2.is_var() && ctx.var_in_reg(ir.op2.id);
+      int op1 = op1_in_reg ? ctx.var_to_reg[ir.op1.id] : 12;
+      int op2 = op2_in_reg ? ctx.var_to_reg[ir.op2.id] : 14;
+      int dest = dest_in_reg ? ctx.var_to_reg[ir.dest.id] : 12;
       if (!op1_in_reg) {
-        ctx.load("r" + to_string(op1), ir.op1, out);
+        ctx.load(op1, ir.op1, out);
       }
       if (!op2_in_reg) {
-        ctx.load("r" + to_string(op2), ir.op2, out);
+        ctx.load(op2, ir.op2, out);
       }
-      out << "    TST r" << op1 << ", r" << op2 << endl;
-      out << "    MOVEQ r" << dest << ", #0" << endl;
-      out << "    MOVNE r" << dest << ", #1" << endl;
+      out.emit(Op::TST, {R(op1), R(op2)});
+      out.emit(Op::MOVEQ, {R(dest), Imm(0)});
+      out.emit(Op::MOVNE, {R(dest), Imm(1)});
       if (!dest_in_reg) {
-        ctx.store_to_stack("r" + to_string(dest), ir.dest, out);
+        ctx.store_to_stack(dest, ir.dest, out);
       }
     }
     else if (ir.op_code == ir::OpCode::OR) {
-      bool dest_in_reg = ctx.var_in_reg(ir.dest.name);
-      bool op1_in_reg = ir.op1.is_var() && ctx.var_in_reg(ir.op1.name);
-      bool op2_in_reg = ir.op2.is_var() && ctx.var_in_reg(ir.op2.name);
-      int op1 = op1_in_reg ? ctx.var_to_reg[ir.op1.name] : 12;
-      int op2 = op2_in_reg ? ctx.var_to_reg[ir.op2.name] : 14;
-      int dest = dest_in_reg ? ctx.var_to_reg[ir.dest.name] : 12;
+      bool dest_in_reg = ctx.var_in_reg(ir.dest.id);
+      bool op1_in_reg = ir.op1.is_var() && ctx.var_in_reg(ir.op1.id);
+      bool op2_in_reg = ir.op2.is_var() && ctx.var_in_reg(ir.op2.id);
+      int op1 = op1_in_reg ? ctx.var_to_reg[ir.op1.id] : 12;
+      int op2 = op2_in_reg ? ctx.var_to_reg[ir.op2.id] : 14;
+      int dest = dest_in_reg ? ctx.var_to_reg[ir.dest.id] : 12;
       if (!op1_in_reg) {
-        ctx.load("r" + to_string(op1), ir.op1, out);
+        ctx.load(op1, ir.op1, out);
       }
       if (!op2_in_reg) {
-        ctx.load("r" + to_string(op2), ir.op2, out);
+        ctx.load(op2, ir.op2, out);
       }
-      out << "    ORRS r12, r" << op1 << ", r" << op2 << endl;
-      out << "    MOVEQ r" << dest << ", #0" << endl;
-      out << "    MOVNE r" << dest << ", #1" << endl;
+      out.emit(Op::ORRS, {R(12), R(op1), R(op2)});
+      out.emit(Op::MOVEQ, {R(dest), Imm(0)});
+      out.emit(Op::MOVNE, {R(dest), Imm(1)});
       if (!dest_in_reg) {
-        ctx.store_to_stack("r" + to_string(dest), ir.dest, out);
+        ctx.store_to_stack(dest, ir.dest, out);
       }
     }
     else if (ir.op_code == ir::OpCode::STORE) {
       // op1 基地址
-      bool op3_in_reg = ir.op3.is_var() && ctx.var_in_reg(ir.op3.name);
-      int op3 = op3_in_reg ? ctx.var_to_reg[ir.op3.name] : 14;
-      if (ir.op1.is_var() && ir.op1.name.substr(0, 2) == "%&" &&
+      bool op3_in_reg = ir.op3.is_var() && ctx.var_in_reg(ir.op3.id);
+      int op3 = op3_in_reg ? ctx.var_to_reg[ir.op3.id] : 14;
+      if (ir.op1.kind == ir::OpName::Kind::LocalArray &&
           ir.op2.is_imm()) {
-        if (!op3_in_reg) ctx.load("r" + to_string(op3), ir.op3, out);
-        int offset = ctx.resolve_stack_offset(ir.op1.name) + ir.op2.value;
-        ctx.store_to_stack_offset("r" + to_string(op3), offset, out);
+        if (!op3_in_reg) ctx.load(op3, ir.op3, out);
+        int offset = ctx.resolve_stack_offset(ir.op1.id) + ir.op2.value;
+        ctx.store_to_stack_offset(op3, offset, out);
       } else {
-        bool op2_in_reg = ir.op2.is_var() && ctx.var_in_reg(ir.op2.name);
+        bool op2_in_reg = ir.op2.is_var() && ctx.var_in_reg(ir.op2.id);
         int op1 = 12;
-        int op2 = op2_in_reg ? ctx.var_to_reg[ir.op2.name] : 14;
+        int op2 = op2_in_reg ? ctx.var_to_reg[ir.op2.id] : 14;
         bool offset_is_small =
             ir.op2.is_imm() && ir.op2.value >= -4096 && ir.op2.value < 4096;
 
-        if (!op2_in_reg && !offset_is_small)
-          ctx.load("r" + to_string(op2), ir.op2, out);
-        ctx.load("r" + to_string(op1), ir.op1, out);
-        if (!op3_in_reg) ctx.load("r" + to_string(op3), ir.op3, out);
-        out << "    STR r" << op3 << ", [r" << op1 << ','
-            << (offset_is_small ? '#' : 'r')
-            << (offset_is_small ? ir.op2.value : op2) << "]" << endl;
+        if (!op2_in_reg && !offset_is_small) ctx.load(op2, ir.op2, out);
+        ctx.load(op1, ir.op1, out);
+        if (!op3_in_reg) ctx.load(op3, ir.op3, out);
+        out.emit(Op::STR, {R(op3), offset_is_small
+                                       ? Operand::mem(op1, ir.op2.value)
+                                       : Operand::mem_index(op1, op2)});
       }
     }
     else if (ir.op_code == ir::OpCode::LOAD) {
-      bool dest_in_reg = ctx.var_in_reg(ir.dest.name);
-      int dest = dest_in_reg ? ctx.var_to_reg[ir.dest.name] : 12;
+      bool dest_in_reg = ctx.var_in_reg(ir.dest.id);
+      int dest = dest_in_reg ? ctx.var_to_reg[ir.dest.id] : 12;
       // op1 基地址
-      if (ir.op1.is_var() && ir.op1.name.substr(0, 2) == "%&" &&
+      if (ir.op1.kind == ir::OpName::Kind::LocalArray &&
           ir.op2.is_imm()) {
-        int offset = ctx.resolve_stack_offset(ir.op1.name) + ir.op2.value;
-        ctx.load_from_stack_offset("r" + to_string(dest), offset, out);
+        int offset = ctx.resolve_stack_offset(ir.op1.id) + ir.op2.value;
+        ctx.load_from_stack_offset(dest, offset, out);
         if (!dest_in_reg) {
-          ctx.store_to_stack("r" + to_string(dest), ir.dest, out);
+          ctx.store_to_stack(dest, ir.dest, out);
         }
       } else {
-        bool op2_in_reg = ir.op2.is_var() && ctx.var_in_reg(ir.op2.name);
+        bool op2_in_reg = ir.op2.is_var() && ctx.var_in_reg(ir.op2.id);
         int op1 = 12;
-        int op2 = op2_in_reg ? ctx.var_to_reg[ir.op2.name] : 14;
+        int op2 = op2_in_reg ? ctx.var_to_reg[ir.op2.id] : 14;
         bool offset_is_small =
             ir.op2.is_imm() && ir.op2.value >= -4096 && ir.op2.value < 4096;
 
-        if (!op2_in_reg && !offset_is_small)
-          ctx.load("r" + to_string(op2), ir.op2, out);
-        ctx.load("r" + to_string(op1), ir.op1, out);
-        out << "    LDR r" << dest << ", [r" << op1 << ","
-            << (offset_is_small ? '#' : 'r')
-            << (offset_is_small ? ir.op2.value : op2) << "]" << endl;
+        if (!op2_in_reg && !offset_is_small) ctx.load(op2, ir.op2, out);
+        ctx.load(op1, ir.op1, out);
+        out.emit(Op::LDR, {R(dest), offset_is_small
+                                        ? Operand::mem(op1, ir.op2.value)
+                                        : Operand::mem_index(op1, op2)});
         if (!dest_in_reg) {
-          ctx.store_to_stack("r" + to_string(dest), ir.dest, out);
+          ctx.store_to_stack(dest, ir.dest, out);
         }
       }
     }
+    else if (ir.op_code == ir::OpCode::VLOAD ||
+             ir.op_code == ir::OpCode::VSTORE) {
+      load_vector_address(ctx, ir, out);
+      if (ir.op_code == ir::OpCode::VLOAD)
+        out.emit(Op::VLD1, {Q(ir.dest.value), Operand::mem(12, 0)});
+      else
+        out.emit(Op::VST1, {Q(ir.op3.value), Operand::mem(12, 0)});
+    }
+    else if (ir.op_code == ir::OpCode::VDUP) {
+      bool op1_in_reg = ir.op1.is_var() && ctx.var_in_reg(ir.op1.id);
+      int op1 = op1_in_reg ? ctx.var_to_reg[ir.op1.id] : 12;
+      if (!op1_in_reg) ctx.load(op1, ir.op1, out);
+      out.emit(Op::VDUP, {Q(ir.dest.value), R(op1)});
+    }
+#define F(OP_NAME, OP)                                              \
+  else if (ir.op_code == ir::OpCode::OP_NAME) {                     \
+    out.emit(Op::OP,                                                \
+             {Q(ir.dest.value), Q(ir.op1.value), Q(ir.op2.value)}); \
+  }
+    F(VADD, VADD)
+    F(VSUB, VSUB)
+    F(VMUL, VMUL)
+    F(VMLA, VMLA)
+#undef F
+    else if (ir.op_code == ir::OpCode::VREDUCE) {
+      // q(n) 由 d(2n) 与 d(2n+1) 组成，两次成对相加后和在 d(2n) 的元素 0
+      bool dest_in_reg = ctx.var_in_reg(ir.dest.id);
+      int dest = dest_in_reg ? ctx.var_to_reg[ir.dest.id] : 12;
+      auto d = ir.op1.value * 2;
+      out.emit(Op::VPADD,
+               {Operand::dreg(d), Operand::dreg(d), Operand::dreg(d + 1)});
+      out.emit(Op::VPADD,
+               {Operand::dreg(d), Operand::dreg(d), Operand::dreg(d)});
+      out.emit(Op::VMOV, {R(dest), Operand::dlane(d, 0)});
+      if (!dest_in_reg) {
+        ctx.store_to_stack(dest, ir.dest, out);
+      }
+    }
     else if (ir.op_code == ir::OpCode::RET) {
       if (!ir.op1.is_null()) {
-        ctx.load("r0", ir.op1, out);
+        ctx.load(0, ir.op1, out);
       }
-      ctx.load("r14", ir::OpName("$ra"), out);
-
-      // 恢复现场
-      int offset = 0;
-      for (int i = 0; i < Context::reg_count; i++) {
-        if (non_volatile_reg[i] != ctx.savable_reg[i]) {
-          ctx.load_from_stack_offset(
-              "r" + to_string(i), stack_size[2] + stack_size[3] + offset, out);
-          offset += 4;
-        }
-      }
-
-      if (stack_size[0] + stack_size[1] + stack_size[2] + stack_size[3] > 127) {
-        ctx.load("r12",
-                 stack_size[0] + stack_size[1] + stack_size[2] + stack_size[3],
-                 out);
-        out << "    ADD sp, sp, r12" << endl;
-      } else {
-        out << "    ADD sp, sp, #"
-            << stack_size[0] + stack_size[1] + stack_size[2] + stack_size[3]
-            << endl;
-      }
-      out << "    MOV pc, r14" << endl;
+      restore_frame(ctx, out);
+      out.emit(Op::MOV, {R(pc), R(lr)});
     }
 
     else if (ir.op_code == ir::OpCode::LABEL) {
-      out << ir.label << ':' << endl;
+      out.label(ir.label);
     }
   }
-}  // namespace
-}  // namespace
+}
 
-void generate(ir::IRList& irs, ostream& out, ostream& log_out) {
-  out << R"(
-.macro mov32, reg, val
-    movw \reg, #:lower16:\val
-    movt \reg, #:upper16:\val
-.endm
-)" << endl;
-  if (config::enable_dwarf2) {
-    out << ".file 1 \"" << config::input_filename << "\"" << endl;
-  }
-  ir::IRList::iterator function_begin_it;
-  for (auto outter_it = irs.begin(); outter_it != irs.end(); outter_it++) {
-    auto& ir = *outter_it;
+void generate_data(ir::IRList::iterator begin, ir::IRList::iterator end,
+                   MachineCode& out) {
+  for (auto it = begin; it != end; it++) {
+    auto& ir = *it;
     if (ir.op_code == ir::OpCode::DATA_BEGIN) {
       write_dwarf2(ir, out);
-      out << ".data" << endl;
-      out << ".global " << Context::rename(ir.label) << endl;
-      out << Context::rename(ir.label) << ":" << endl;
+      out.directive(".data");
+      out.directive(".global " + Context::rename(ir.label));
+      out.label(Context::rename(ir.label));
     } else if (ir.op_code == ir::OpCode::DATA_WORD) {
       write_dwarf2(ir, out);
-      out << ".word " << ir.dest.value << endl;
+      out.directive(".word " + to_string(ir.dest.value));
     } else if (ir.op_code == ir::OpCode::DATA_SPACE) {
       write_dwarf2(ir, out);
-      out << ".space " << ir.dest.value << endl;
-    } else if (ir.op_code == ir::OpCode::DATA_END) {
-      // do nothing
-    } else if (ir.op_code == ir::OpCode::FUNCTION_BEGIN) {
-      function_begin_it = outter_it;
-    } else if (ir.op_code == ir::OpCode::FUNCTION_END) {
-      generate_function_asm(irs, function_begin_it, outter_it, out, log_out);
+      out.directive(".space " + to_string(ir.dest.value));
     }
   }
 }
+}  // namespace
+
+void generate(ir::IRList& irs, std::vector<MachineCode>& out) {
+  auto& header = out.emplace_back(config::print_log);
+  header.directive("");
+  header.directive(".macro mov32, reg, val");
+  header.directive("    movw \\reg, #:lower16:\\val");
+  header.directive("    movt \\reg, #:upper16:\\val");
+  header.directive(".endm");
+  header.directive("");
+  if (config::neon) header.directive(".fpu neon");
+  if (config::enable_dwarf2) {
+    header.directive(".file 1 \"" + config::input_filename + "\"");
+  }
 
-void generate(ir::IRList& irs, ostream& out) {
-  ofstream null;
-  null.setstate(std::ios_base::badbit);
-  generate(irs, out, null);
+  // 按源码顺序划分单元：每个函数一个单元，相邻的数据定义合为一个单元
+  std::vector<std::pair<ir::IRList::iterator, ir::IRList::iterator>> units;
+  for (auto it = irs.begin(); it != irs.end();) {
+    auto begin = it;
+    if (it->op_code == ir::OpCode::FUNCTION_BEGIN) {
+      while (it->op_code != ir::OpCode::FUNCTION_END) it++;
+      it++;
+    } else {
+      while (it != irs.end() && it->op_code != ir::OpCode::FUNCTION_BEGIN)
+        it++;
+    }
+    units.push_back({begin, it});
+  }
+  auto first = out.size();
+  for (std::size_t i = 0; i < units.size(); i++)
+    out.emplace_back(config::print_log);
+
+  // 各单元互不依赖，在线程池上并行生成
+  parallel_for(units.size(), [&](std::size_t i) {
+    auto [begin, end] = units[i];
+    auto& code = out[first + i];
+    if (begin->op_code == ir::OpCode::FUNCTION_BEGIN) {
+      generate_function_asm(irs, begin, std::prev(end), code);
+    } else {
+      generate_data(begin, end, code);
+    }
+    code.flush_log();
+  });
 }
 }  // namespace syc::assembly
@@ -16,11 +16,13 @@
  * along with this program.  If not, see <https://www.gnu.org/licenses/>.
  */
 #pragma once
-#include <ostream>
+#include <vector>
 
+#include "assembly/machine.h"
 #include "ir/ir.h"
 
 namespace syc::assembly {
-void generate(ir::IRList& irs, std::ostream& out);
-void generate(ir::IRList& irs, std::ostream& out, std::ostream& log_out);
+// 生成的机器指令按源码顺序追加到 out 中：文件头、每个函数以及函数之间的数据
+// 各占一个 MachineCode，依次输出即为完整的汇编文件
+void generate(ir::IRList& irs, std::vector<MachineCode>& out);
 }  // namespace syc::assembly
@@ -0,0 +1,358 @@
+/*
+ * syc, a compiler for SysY
+ * Copyright (C) 2020-2021  nzh63, skywf21
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#include "assembly/machine.h"
+
+#include <utility>
+
+namespace syc::assembly {
+namespace {
+void print_reg(int reg_id, std::ostream& out) {
+  if (reg_id == sp) {
+    out << "sp";
+  } else if (reg_id == pc) {
+    out << "pc";
+  } else {
+    out << 'r' << reg_id;
+  }
+}
+}  // namespace
+
+Operand Operand::reg(int reg_id) {
+  Operand op;
+  op.type = Type::Reg;
+  op.reg_id = reg_id;
+  return op;
+}
+Operand Operand::imm(int value) {
+  Operand op;
+  op.type = Type::Imm;
+  op.value = value;
+  return op;
+}
+Operand Operand::mem(int base, int offset) {
+  Operand op;
+  op.type = Type::Mem;
+  op.reg_id = base;
+  op.value = offset;
+  return op;
+}
+Operand Operand::mem_index(int base, int index_reg) {
+  Operand op;
+  op.type = Type::Mem;
+  op.reg_id = base;
+  op.index_reg = index_reg;
+  return op;
+}
+Operand Operand::qreg(int reg_id) {
+  Operand op;
+  op.type = Type::QReg;
+  op.reg_id = reg_id;
+  return op;
+}
+Operand Operand::dreg(int reg_id) {
+  Operand op;
+  op.type = Type::DReg;
+  op.reg_id = reg_id;
+  return op;
+}
+Operand Operand::dlane(int reg_id, int lane) {
+  Operand op;
+  op.type = Type::DLane;
+  op.reg_id = reg_id;
+  op.value = lane;
+  return op;
+}
+
+bool Operand::uses_reg(int reg_id) const {
+  if (this->is_reg()) return this->reg_id == reg_id;
+  if (this->is_mem()) {
+    return this->reg_id == reg_id || this->index_reg == reg_id;
+  }
+  return false;
+}
+
+bool Operand::operator==(const Operand& other) const {
+  switch (this->type) {
+    case Type::None:
+      return other.is_none();
+    case Type::Reg:
+      return other.is_reg() && this->reg_id == other.reg_id;
+    case Type::Imm:
+      return other.is_imm() && this->value == other.value;
+    case Type::QReg:
+    case Type::DReg:
+      return other.type == this->type && this->reg_id == other.reg_id;
+    case Type::DLane:
+      return other.type == this->type && this->reg_id == other.reg_id &&
+             this->value == other.value;
+    case Type::Mem:
+      return other.is_mem() && this->reg_id == other.reg_id &&
+             this->index_reg == other.index_reg &&
+             (this->index_reg >= 0 || this->value == other.value);
+  }
+  return false;
+}
+
+void Operand::print(std::ostream& out) const {
+  switch (this->type) {
+    case Type::None:
+      break;
+    case Type::Reg:
+      print_reg(this->reg_id, out);
+      break;
+    case Type::Imm:
+      out << '#' << this->value;
+      break;
+    case Type::Mem:
+      out << '[';
+      print_reg(this->reg_id, out);
+      out << ',';
+      if (this->index_reg >= 0) {
+        print_reg(this->index_reg, out);
+      } else {
+        out << '#' << this->value;
+      }
+      out << ']';
+      break;
+    case Type::QReg:
+      out << 'q' << this->reg_id;
+      break;
+    case Type::DReg:
+      out << 'd' << this->reg_id;
+      break;
+    case Type::DLane:
+      out << 'd' << this->reg_id << '[' << this->value << ']';
+      break;
+  }
+}
+
+MachineInstr::MachineInstr(MachineOpCode op_code,
+                           std::initializer_list<Operand> operands,
+                           std::string label)
+    : op_code(op_code), label(std::move(label)) {
+  std::size_t i = 0;
+  for (const auto& op : operands) this->operands[i++] = op;
+}
+MachineInstr::MachineInstr(MachineOpCode op_code, std::string label)
+    : op_code(op_code), label(std::move(label)) {}
+
+int MachineInstr::operand_count() const {
+  std::size_t n = 0;
+  while (n < this->operands.size() && !this->operands[n].is_none()) n++;
+  return n;
+}
+
+bool MachineInstr::is_branch() const {
+  switch (this->op_code) {
+    case MachineOpCode::B:
+    case MachineOpCode::BEQ:
+    case MachineOpCode::BNE:
+    case MachineOpCode::BLE:
+    case MachineOpCode::BLT:
+    case MachineOpCode::BGE:
+    case MachineOpCode::BGT:
+    case MachineOpCode::BL:
+      return true;
+    default:
+      return false;
+  }
+}
+
+bool MachineInstr::is_neon() const {
+  switch (this->op_code) {
+    case MachineOpCode::VLD1:
+    case MachineOpCode::VST1:
+    case MachineOpCode::VDUP:
+    case MachineOpCode::VADD:
+    case MachineOpCode::VSUB:
+    case MachineOpCode::VMUL:
+    case MachineOpCode::VMLA:
+    case MachineOpCode::VPADD:
+    case MachineOpCode::VMOV:
+      return true;
+    default:
+      return false;
+  }
+}
+
+void MachineInstr::print(std::ostream& out) const {
+  if (this->op_code == MachineOpCode::LABEL) {
+    out << this->label << ':';
+    return;
+  }
+  if (this->is_text()) {
+    out << this->label;
+    return;
+  }
+  out << "    " << name_of(this->op_code);
+  // VLD1/VST1 的寄存器列表带花括号，基址不带偏移
+  if (this->op_code == MachineOpCode::VLD1 ||
+      this->op_code == MachineOpCode::VST1) {
+    out << " {";
+    this->operands[0].print(out);
+    out << "}, [";
+    print_reg(this->operands[1].reg_id, out);
+    out << ']';
+    return;
+  }
+  int n = this->operand_count();
+  for (int i = 0; i < n; i++) {
+    out << (i == 0 ? " " : ", ");
+    // MOV32 为宏，其参数不带 #
+    if (this->op_code == MachineOpCode::MOV32 && this->operands[i].is_imm()) {
+      out << this->operands[i].value;
+    } else {
+      this->operands[i].print(out);
+    }
+  }
+  if (!this->label.empty()) out << (n == 0 ? " " : ", ") << this->label;
+}
+
+const char* name_of(MachineOpCode op_code) {
+  switch (op_code) {
+    case MachineOpCode::MOV:
+      return "MOV";
+    case MachineOpCode::MOV32:
+      return "MOV32";
+    case MachineOpCode::MOVEQ:
+      return "MOVEQ";
+    case MachineOpCode::MOVNE:
+      return "MOVNE";
+    case MachineOpCode::MOVLE:
+      return "MOVLE";
+    case MachineOpCode::MOVGT:
+      return "MOVGT";
+    case MachineOpCode::MOVLT:
+      return "MOVLT";
+    case MachineOpCode::MOVGE:
+      return "MOVGE";
+    case MachineOpCode::ADD:
+      return "ADD";
+    case MachineOpCode::ADDLT:
+      return "ADDLT";
+    case MachineOpCode::SUB:
+      return "SUB";
+    case MachineOpCode::SUBS:
+      return "SUBS";
+    case MachineOpCode::MUL:
+      return "MUL";
+    case MachineOpCode::SMULL:
+      return "SMULL";
+    case MachineOpCode::LSL:
+      return "LSL";
+    case MachineOpCode::ASR:
+      return "ASR";
+    case MachineOpCode::ORRS:
+      return "ORRS";
+    case MachineOpCode::TST:
+      return "TST";
+    case MachineOpCode::CMP:
+      return "CMP";
+    case MachineOpCode::LDR:
+      return "LDR";
+    case MachineOpCode::STR:
+      return "STR";
+    case MachineOpCode::B:
+      return "B";
+    case MachineOpCode::BEQ:
+      return "BEQ";
+    case MachineOpCode::BNE:
+      return "BNE";
+    case MachineOpCode::BLE:
+      return "BLE";
+    case MachineOpCode::BLT:
+      return "BLT";
+    case MachineOpCode::BGE:
+      return "BGE";
+    case MachineOpCode::BGT:
+      return "BGT";
+    case MachineOpCode::BL:
+      return "BL";
+    case MachineOpCode::VLD1:
+      return "VLD1.32";
+    case MachineOpCode::VST1:
+      return "VST1.32";
+    case MachineOpCode::VDUP:
+      return "VDUP.32";
+    case MachineOpCode::VADD:
+      return "VADD.I32";
+    case MachineOpCode::VSUB:
+      return "VSUB.I32";
+    case MachineOpCode::VMUL:
+      return "VMUL.I32";
+    case MachineOpCode::VMLA:
+      return "VMLA.I32";
+    case MachineOpCode::VPADD:
+      return "VPADD.I32";
+    case MachineOpCode::VMOV:
+      return "VMOV.32";
+    case MachineOpCode::LABEL:
+      return "LABEL";
+    case MachineOpCode::DIRECTIVE:
+      return "DIRECTIVE";
+    case MachineOpCode::COMMENT:
+      return "COMMENT";
+  }
+  return "";
+}
+
+MachineCode::MachineCode(bool keep_log) : keep_log(keep_log) {
+  if (!keep_log) this->log_buffer.setstate(std::ios_base::badbit);
+}
+
+void MachineCode::emit(MachineOpCode op_code,
+                       std::initializer_list<Operand> operands,
+                       std::string label) {
+  this->flush_log();
+  this->instrs.emplace_back(op_code, operands, std::move(label));
+}
+void MachineCode::emit(MachineOpCode op_code, std::string label) {
+  this->flush_log();
+  this->instrs.emplace_back(op_code, std::move(label));
+}
+void MachineCode::label(std::string name) {
+  this->emit(MachineOpCode::LABEL, std::move(name));
+}
+void MachineCode::directive(std::string text) {
+  this->emit(MachineOpCode::DIRECTIVE, std::move(text));
+}
+
+void MachineCode::flush_log() {
+  if (!this->keep_log) return;
+  auto text = this->log_buffer.str();
+  auto end = text.rfind('\n');
+  if (end == std::string::npos) return;
+  std::size_t begin = 0;
+  while (begin <= end) {
+    auto eol = text.find('\n', begin);
+    this->instrs.emplace_back(MachineOpCode::COMMENT,
+                              text.substr(begin, eol - begin));
+    begin = eol + 1;
+  }
+  this->log_buffer.str(text.substr(end + 1));
+  this->log_buffer.seekp(0, std::ios_base::end);
+}
+
+void MachineCode::print(std::ostream& out) {
+  this->flush_log();
+  for (const auto& i : this->instrs) {
+    i.print(out);
+    out << '\n';
+  }
+}
+}  // namespace syc::assembly
@@ -0,0 +1,166 @@
+/*
+ * syc, a compiler for SysY
+ * Copyright (C) 2020-2021  nzh63, skywf21
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#pragma once
+#include <array>
+#include <cstdint>
+#include <initializer_list>
+#include <ostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace syc::assembly {
+// 特殊用途的寄存器号
+constexpr int sp = 13;
+constexpr int lr = 14;
+constexpr int pc = 15;
+
+enum class MachineOpCode : std::uint8_t {
+  MOV,
+  MOV32,  // 宏，加载 32 位立即数或符号地址
+  MOVEQ,
+  MOVNE,
+  MOVLE,
+  MOVGT,
+  MOVLT,
+  MOVGE,
+  ADD,
+  ADDLT,
+  SUB,
+  SUBS,
+  MUL,
+  SMULL,
+  LSL,
+  ASR,
+  ORRS,
+  TST,
+  CMP,
+  LDR,
+  STR,
+  B,
+  BEQ,
+  BNE,
+  BLE,
+  BLT,
+  BGE,
+  BGT,
+  BL,
+  // NEON 指令，向量按 32 位整数元素运算
+  VLD1,
+  VST1,
+  VDUP,
+  VADD,
+  VSUB,
+  VMUL,
+  VMLA,
+  VPADD,
+  VMOV,       // 把 d 寄存器的一个元素读到通用寄存器
+  LABEL,      // label:
+  DIRECTIVE,  // 原样输出的伪指令行，如 .text
+  COMMENT,    // 原样输出的注释行（日志）
+};
+
+// 机器指令操作数
+class Operand {
+ public:
+  enum class Type : std::uint8_t {
+    None,
+    Reg,    // r0
+    Imm,    // #0
+    Mem,    // [r0,#0] 或 [r0,r1]
+    QReg,   // q0
+    DReg,   // d0
+    DLane,  // d0[0]
+  };
+
+  Type type = Type::None;
+  int reg_id = 0;      // Reg/QReg/DReg/DLane: 寄存器号; Mem: 基址寄存器号
+  int value = 0;       // Imm: 立即数; Mem: 偏移量（index_reg < 0 时）; DLane: 元素
+  int index_reg = -1;  // Mem: 偏移寄存器号
+
+  static Operand reg(int reg_id);
+  static Operand imm(int value);
+  static Operand mem(int base, int offset);
+  static Operand mem_index(int base, int index_reg);
+  static Operand qreg(int reg_id);
+  static Operand dreg(int reg_id);
+  static Operand dlane(int reg_id, int lane);
+
+  bool is_none() const { return this->type == Type::None; }
+  bool is_reg() const { return this->type == Type::Reg; }
+  bool is_imm() const { return this->type == Type::Imm; }
+  bool is_mem() const { return this->type == Type::Mem; }
+  // 是否读取寄存器 reg_id（包括作为内存操作数的基址或偏移）
+  bool uses_reg(int reg_id) const;
+  bool operator==(const Operand& other) const;
+
+  void print(std::ostream& out) const;
+};
+
+class MachineInstr {
+ public:
+  MachineOpCode op_code;
+  // 按汇编语法的顺序排列，未使用的为 None
+  std::array<Operand, 4> operands;
+  // 跳转目标、MOV32 的符号、标号名或原样输出的文本
+  std::string label;
+
+  MachineInstr(MachineOpCode op_code, std::initializer_list<Operand> operands,
+               std::string label = "");
+  MachineInstr(MachineOpCode op_code, std::string label = "");
+
+  int operand_count() const;
+  bool is_branch() const;
+  bool is_neon() const;
+  bool is_text() const {
+    return this->op_code == MachineOpCode::DIRECTIVE ||
+           this->op_code == MachineOpCode::COMMENT;
+  }
+  bool operator==(const MachineInstr& other) const = default;
+
+  void print(std::ostream& out) const;
+};
+
+const char* name_of(MachineOpCode op_code);
+
+// 一个编译单元的全部机器指令，由代码生成填充，经汇编级优化后统一输出
+class MachineCode {
+ public:
+  std::vector<MachineInstr> instrs;
+
+  // keep_log 为 true 时，写入 log() 的日志按写入顺序作为注释插入指令流
+  explicit MachineCode(bool keep_log = false);
+
+  std::ostream& log() { return this->log_buffer; }
+
+  void emit(MachineOpCode op_code, std::initializer_list<Operand> operands,
+            std::string label = "");
+  void emit(MachineOpCode op_code, std::string label);
+  void label(std::string name);
+  // 每行一条伪指令
+  void directive(std::string text);
+  // 将尚未插入的日志写入指令流
+  void flush_log();
+
+  void print(std::ostream& out);
+
+ private:
+  bool keep_log;
+  std::stringstream log_buffer;
+};
+}  // namespace syc::assembly
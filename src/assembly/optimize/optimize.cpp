@@ -17,31 +17,72 @@
  */
 #include "assembly/optimize/optimize.h"
 
-#include <istream>
-#include <ostream>
-#include <sstream>
+#include <algorithm>
+#include <iterator>
 
 #include "assembly/optimize/passes.h"
+#include "config.h"
+#include "stats.h"
+#include "thread_pool.h"
 
-using namespace std;
-
+namespace syc::assembly {
 namespace {
-void _optimize(istream& in, ostream& out) {
-  using namespace syc::assembly::passes;
-  std::stringstream buffer;
-  peephole(in, buffer);
-  reorder(buffer, out);
+using namespace syc::assembly::passes;
+
+struct Pass {
+  const char* name;
+  bool (*run)(MachineCode&);
+};
+
+const Pass all_passes[] = {
+    {"peephole", peephole},
+    {"reorder", reorder},
+};
+
+const Pass* find_pass(std::string_view name) {
+  for (auto& pass : all_passes) {
+    if (pass.name == name) return &pass;
+  }
+  return nullptr;
+}
+
+std::vector<const Pass*> pipeline() {
+  std::vector<const Pass*> ret;
+  if (!config::passes.empty()) {
+    for (auto& name : config::passes) {
+      if (auto* pass = find_pass(name)) ret.push_back(pass);
+    }
+  } else if (config::optimize_level > 0) {
+    for (auto& pass : all_passes) ret.push_back(&pass);
+  }
+  return ret;
 }
 }  // namespace
 
-namespace syc::assembly {
-void optimize(istream& in, ostream& out) {
-  constexpr auto N = 3;
-  std::stringstream buffer[N];
-  _optimize(in, buffer[0]);
-  for (int i = 0; i < N - 1; i++) {
-    _optimize(buffer[i], buffer[i + 1]);
+bool is_pass(std::string_view name) { return find_pass(name) != nullptr; }
+
+void optimize(std::vector<MachineCode>& code) {
+  // 一轮没有修改即停止，max_iterations 防止 pass 之间来回改写
+  constexpr int max_iterations = 5;
+  auto passes = pipeline();
+  // 各单元之间没有跨越边界的窥孔模式，可以独立优化
+  auto count = [&] {
+    std::size_t ret = 0;
+    for (auto& i : code) ret += i.instrs.size();
+    return ret;
+  };
+  std::vector<char> dirty(code.size(), true);
+  for (int round = 0; round < max_iterations; round++) {
+    if (std::find(dirty.begin(), dirty.end(), true) == dirty.end()) break;
+    std::vector<char> changed(code.size());
+    for (auto* pass : passes) {
+      stats::Phase phase(pass->name, count);
+      parallel_for(code.size(), [&](std::size_t i) {
+        if (!dirty[i] && !changed[i]) return;
+        if (pass->run(code[i])) changed[i] = true;
+      });
+    }
+    dirty = std::move(changed);
   }
-  _optimize(buffer[N - 1], out);
 }
 }  // namespace syc::assembly
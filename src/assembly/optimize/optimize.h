@@ -16,9 +16,15 @@
  * along with this program.  If not, see <https://www.gnu.org/licenses/>.
  */
 #pragma once
-#include <istream>
-#include <ostream>
+#include <string_view>
+#include <vector>
+
+#include "assembly/machine.h"
 
 namespace syc::assembly {
-void optimize(std::istream& in, std::ostream& out);
+// 名称是否为汇编上的 pass
+bool is_pass(std::string_view name);
+
+// 对 generate 生成的各单元并行优化
+void optimize(std::vector<MachineCode>& code);
 }  // namespace syc::assembly
@@ -17,134 +17,98 @@
  */
 #include "assembly/optimize/passes/peephole.h"
 
-#include <istream>
-#include <ostream>
-#include <sstream>
-#include <string>
+#include <optional>
+#include <utility>
 #include <vector>
 
-#include "config.h"
 
-using namespace std;
+namespace syc::assembly::passes {
 namespace {
-std::string opt_asm1(std::string line1) {
-  std::vector<string> temp1;
-  std::string tar_line;
-  stringstream s0(line1);
-  string token;
-  while (s0 >> token) {
-    if (token[token.length() - 1] == ',') token.pop_back();
+bool is_blank(const MachineInstr& inst) {
+  return inst.is_text() &&
+         inst.label.find_first_not_of(" \t") == std::string::npos;
+}
 
-    temp1.emplace_back(token);
-  }
+// 窗口为 1 的优化，返回 false 表示删除该指令
+bool opt_asm1(MachineInstr& inst) {
   // ADD R0,R1,#0  => MOV R0,R1
-  if (temp1[0] == "ADD" && temp1[3].compare("#0") == 0) {
-    tar_line.append("    MOV ");
-    tar_line.append(temp1[1]);
-    tar_line.append(", ");
-    tar_line.append(temp1[2]);
-    // out << "tar_line is "<< tar_line <<std::endl;
-    return tar_line;
+  if (inst.op_code == MachineOpCode::ADD && inst.operands[2].is_imm() &&
+      inst.operands[2].value == 0) {
+    inst = MachineInstr(MachineOpCode::MOV, {inst.operands[0], inst.operands[1]});
+    return true;
   }
-  // MOV r0, r0 => <empty-string>
-  if (temp1[0] == "MOV" && temp1[1] == temp1[2]) {
-    return "";
+  // MOV r0, r0 => <empty>
+  if (inst.op_code == MachineOpCode::MOV &&
+      inst.operands[0] == inst.operands[1]) {
+    return false;
   }
-  return line1;
+  return true;
 }
 
 /*
-传入的Line1，line2 产出tar_line，若匹配成功，返回优化后结果，并置length=0
+传入 inst1，inst2，若匹配成功，将优化后结果写入 out 并返回 true
 若匹配失败，则按兵不动
 */
-bool opt_asm2(std::string line1, std::string line2, std::string& tar_line,
-              int& length) {
-  // out<< "--------------调用函数" <<std::endl;
-  // out<< "line1:"<<line1 <<std::endl;
-  // out<< "line2:"<<line2 <<std::endl;
-  // out<< "--------------" <<std::endl;
-
-  std::vector<string> temp1;
-  std::vector<string> temp2;
-  stringstream s0(line1);
-  stringstream s1(line2);
-  string token;
-  while (s0 >> token) {
-    if (token[token.length() - 1] == ',')
-      token = token.substr(0, token.length() - 1);
-    temp1.emplace_back(token);
-  }
-  while (s1 >> token) {
-    if (token[token.length() - 1] == ',')
-      token = token.substr(0, token.length() - 1);
-    temp2.emplace_back(token);
-  }
+bool opt_asm2(const MachineInstr& inst1, const MachineInstr& inst2,
+              std::vector<MachineInstr>& out) {
   // case1  ld r0,a / st a,r0  => ld r0,a
-  if (temp1[0].compare("LDR") == 0 && (temp2[0].compare("STR") == 0) &&
-      (temp1[1].compare(temp2[1]) == 0) && (temp1[2].compare(temp2[2]) == 0)) {
-    length = 0;
-    tar_line = line1;
+  if (inst1.op_code == MachineOpCode::LDR &&
+      inst2.op_code == MachineOpCode::STR &&
+      inst1.operands[0] == inst2.operands[0] &&
+      inst1.operands[1] == inst2.operands[1] &&
+      !inst1.operands[1].uses_reg(inst1.operands[0].reg_id)) {
+    out.push_back(inst1);
     return true;
   }
   // case2 STR R0,[SP,#0] , LDR R1,[SP,#0] => STR R0,[SP,#0], MOV R1,R0
-  else if (temp1[0].compare("STR") == 0 && (temp2[0].compare("LDR") == 0) &&
-           (temp1[2].compare(temp2[2]) == 0)) {
-    length = 0;
-    tar_line = line1;
-    tar_line.append("\n    MOV ");
-    tar_line.append(temp2[1]);
-    tar_line.append(", ");
-    tar_line.append(temp1[1]);
-
+  else if (inst1.op_code == MachineOpCode::STR &&
+           inst2.op_code == MachineOpCode::LDR &&
+           inst1.operands[1] == inst2.operands[1]) {
+    out.push_back(inst1);
+    out.emplace_back(MachineOpCode::MOV,
+                     std::initializer_list<Operand>{inst2.operands[0],
+                                                    inst1.operands[0]});
     return true;
   }
-
   return false;
 }
 }  // namespace
 
-namespace syc::assembly::passes {
-void peephole(std::istream& in, std::ostream& out) {
-  string line1;
-  string line1_orin;
-  string line0;
-  string line_target;
-  bool isfirst = true;
-
-  int length = 0;
-  while (getline(in, line1)) {
+bool peephole(MachineCode& code) {
+  std::vector<MachineInstr> out;
+  out.reserve(code.instrs.size());
+  std::optional<MachineInstr> inst0;
+  bool changed = false;
+  for (auto& inst1 : code.instrs) {
+    if (is_blank(inst1)) {
+      changed = true;
+      continue;
+    }
     //如果是注释，直接输出
-    stringstream ss(line1);
-    string token;
-    if (ss >> token) {
-      if (token[0] == ('#')) {
-        out << line1 << std::endl;
-        continue;
-      } else {
-        //先窗口为1优化下
-        line1 = opt_asm1(line1);
-        if (line1.empty()) continue;
-        // out << line1 << std::endl;
-        //然后是窗口2
-        if (length == 0) {
-          length++;
-          line0 = line1;
-          continue;
-        } else {
-          if (opt_asm2(line0, line1, line_target, length)) {
-            out << line_target << std::endl;
-            continue;
-          } else {
-            out << line0 << std::endl;
-            line0 = line1;
-          }
-        }
-      }
+    if (inst1.op_code == MachineOpCode::COMMENT) {
+      out.push_back(std::move(inst1));
+      continue;
+    }
+    //先窗口为1优化下
+    auto op_code = inst1.op_code;
+    if (!opt_asm1(inst1)) {
+      changed = true;
+      continue;
+    }
+    changed |= inst1.op_code != op_code;
+    //然后是窗口2
+    if (!inst0) {
+      inst0 = std::move(inst1);
+    } else if (opt_asm2(*inst0, inst1, out)) {
+      inst0.reset();
+      changed = true;
+    } else {
+      out.push_back(std::move(*inst0));
+      inst0 = std::move(inst1);
     }
   }
-  if (length == 1) {
-    length = 0;
-    out << line0 << std::endl;
-  }
+  if (inst0) out.push_back(std::move(*inst0));
+  code.instrs = std::move(out);
+  return changed;
 }
 }  // namespace syc::assembly::passes
@@ -17,9 +17,9 @@
  */
 #pragma once
 
-#include <istream>
-#include <ostream>
+#include "assembly/machine.h"
 
 namespace syc::assembly::passes {
-void peephole(std::istream& in, std::ostream& out);
+// 返回是否修改了指令
+bool peephole(MachineCode& code);
 }  // namespace syc::assembly::passes
@@ -18,91 +18,31 @@
 #include "assembly/optimize/passes/reorder.h"
 
 #include <cassert>
+#include <cstdio>
 #include <cstring>
-#include <istream>
 #include <list>
-#include <ostream>
-#include <sstream>
 #include <string>
 #include <vector>
 
-#include "config.h"
-
 using namespace std;
 namespace {
-class AsmOpName {
- protected:
-  enum Type {
-    Var,     // 寄存器变量，例如r0
-    MemVar,  // 内存变量,例如[sp,#48]
-    Imm,     // 立即数，例如#0
-    Null,    // 啥都没有
-  };
-  Type type;
-
- public:
-  std::string name;
-  int value;
-  std::string offset_reg;
-  int offset_imm;
-  AsmOpName();
-  AsmOpName(std::string name);
-  AsmOpName(int value);
-  // 产生内存变量
-  AsmOpName(std::string name, int offset);
-  AsmOpName(std::string name, std::string offset);
-  bool operator==(AsmOpName const& p1) {
-    if (this->name == p1.name)
-      return true;
-    else
-      return false;
-  }
-  bool is_var() const { return this->type == AsmOpName::Type::Var; }
-  bool is_mem_var() const { return this->type == AsmOpName::Type::MemVar; }
-  bool is_stack_var() const {
-    return this->is_mem_var() && this->name == "sp" && this->offset_reg.empty();
-  }
-  bool is_imm() const { return this->type == AsmOpName::Type::Imm; }
-  bool is_null() const { return this->type == AsmOpName::Type::Null; }
-};
+using syc::assembly::MachineInstr;
+using syc::assembly::MachineOpCode;
+using syc::assembly::Operand;
 
+// 指令的读写视图：STR 的内存操作数视为目的操作数，其余指令第一个操作数为目的
 class AsmInst {
  public:
   bool isjump;  // 是否为跳转指令,默认不是
-  std::string op_code;
-  std::string label;
-  AsmOpName op1, op2, op3, dest;
-  AsmInst(std::string op_code, AsmOpName dest, AsmOpName op1, AsmOpName op2,
-          AsmOpName op3, std::string label = "", bool isjump = false);
-  AsmInst(std::string op_code, AsmOpName dest, AsmOpName op1, AsmOpName op2,
-          std::string label = "", bool isjump = false);
-  AsmInst(std::string op_code, AsmOpName dest, AsmOpName op1,
-          std::string label = "", bool isjump = false);
-  AsmInst(std::string op_code, AsmOpName dest, std::string label = "",
-          bool isjump = false);
-  AsmInst(std::string op_code, std::string label = "", bool isjump = false);
-  bool use(const AsmOpName& op) const {
-    assert(op.is_var() || op.is_mem_var());
-#define F(op1)                                                \
-  if (this->op1.is_var()) {                                   \
-    if (this->op1.name == op.name) {                          \
-      return true;                                            \
-    }                                                         \
-  } else if (this->op1.is_mem_var()) {                        \
-    if (this->op1.name.find(op.name) != string::npos) {       \
-      return true;                                            \
-    }                                                         \
-    if (this->op1.offset_reg.find(op.name) != string::npos) { \
-      return true;                                            \
-    }                                                         \
-  }
-    F(op1);
-    F(op2);
-    F(op3);
-#undef F
-    if (this->dest.offset_reg.find(op.name) != string::npos) {
-      return true;
-    }
+  MachineOpCode op_code;
+  Operand op1, op2, op3, dest;
+  explicit AsmInst(const MachineInstr& inst);
+  bool use(const Operand& op) const {
+    assert(op.is_reg() || op.is_mem());
+    if (this->op1.uses_reg(op.reg_id)) return true;
+    if (this->op2.uses_reg(op.reg_id)) return true;
+    if (this->op3.uses_reg(op.reg_id)) return true;
+    if (this->dest.is_mem() && this->dest.index_reg == op.reg_id) return true;
     return false;
   }
 };
@@ -117,166 +57,37 @@ class AsmInst {
 // 这里有个问题，如果遇到跳转指令怎么办？ => 返回的AsmInst中带有特殊值，外面
 // 接收到了就对当前指令矩阵进行重排，然后输出前面的指令，再输出本条指令
 
-AsmOpName::AsmOpName() : type(AsmOpName::Type::Null) {}
-AsmOpName::AsmOpName(std::string name)
-    : type(AsmOpName::Type::Var), name(name) {}
-AsmOpName::AsmOpName(int value) : type(AsmOpName::Type::Imm), value(value) {}
-AsmOpName::AsmOpName(std::string name, int offset)
-    : type(AsmOpName::Type::MemVar), name(name), offset_imm(offset) {}
-AsmOpName::AsmOpName(std::string name, std::string offset)
-    : type(AsmOpName::Type::MemVar), name(name), offset_reg(offset) {}
-
-AsmInst::AsmInst(std::string op_code, AsmOpName dest, AsmOpName op1,
-                 AsmOpName op2, AsmOpName op3, std::string label, bool isjump)
-    : op_code(op_code),
-      dest(dest),
-      op1(op1),
-      op2(op2),
-      op3(op3),
-      isjump(isjump),
-      label(label) {}
-AsmInst::AsmInst(std::string op_code, AsmOpName dest, AsmOpName op1,
-                 AsmOpName op2, std::string label, bool isjump)
-    : op_code(op_code),
-      dest(dest),
-      op1(op1),
-      op2(op2),
-      op3(AsmOpName()),
-      isjump(isjump),
-      label(label) {}
-AsmInst::AsmInst(std::string op_code, AsmOpName dest, AsmOpName op1,
-                 std::string label, bool isjump)
-    : op_code(op_code),
-      dest(dest),
-      op1(op1),
-      op2(AsmOpName()),
-      op3(AsmOpName()),
-      isjump(isjump),
-      label(label) {}
-AsmInst::AsmInst(std::string op_code, AsmOpName dest, std::string label,
-                 bool isjump)
-    : op_code(op_code),
-      dest(dest),
-      op1(AsmOpName()),
-      op2(AsmOpName()),
-      op3(AsmOpName()),
-      isjump(isjump),
-      label(label) {}
-AsmInst::AsmInst(std::string op_code, std::string label, bool isjump)
-    : op_code(op_code),
-      dest(AsmOpName()),
-      op1(AsmOpName()),
-      op2(AsmOpName()),
-      op3(AsmOpName()),
-      isjump(isjump),
-      label(label) {}
-
-AsmInst Create_AsmInst(std::string line1) {
-  stringstream ss(line1);
-  std::string token;
-  std::vector<AsmOpName> cisu;
-  int isop = 1;
-  int count = 0;
-  bool isbreak = false;
-  bool isstr = false;
-  std::string opcode;
-  while (ss >> token) {
-    // out << token << "\t";
-    // 第一步，先把最后面那个逗号去了
-    // 请注意，这里没有处理 smull
-    // （因为两个dest不好搞定，正好有4个op所以够用，放在模板里搞）
-    if (token[token.size() - 1] == ',')
-      token = token.substr(0, token.size() - 1);
-    if (isop) {  // 如果是操作符
-      if (token.starts_with("B") || token == "SMULL") {
-        // 如果是跳转
-        isbreak = true;
-        opcode = token;
-        isop = 0;
-
-      } else if (token == "STR") {
-        // 如果是STR
-        isstr = true;
-        opcode = token;
-        isop = 0;
-
-      } else {
-        // 如果不是跳转
-        opcode = token;
-        isop = 0;
-      }
-    } else {                  // 不是操作符
-      if (token[0] == '[') {  // 内存变量
-        if (token.find(',') == token.npos) {
-          token.pop_back();
-          token.append(",#0]");
-        }
-        // [sp,#1] => sp,#1
-        // [sp,r1] => sp,r1
-        auto comma = token.find(',');
-        auto square = token.find(']');
-        auto offset = token.substr(comma + 1);
-        offset.pop_back();
-        if (offset.front() == '#') {
-          cisu.emplace_back(token.substr(1, comma - 1), stoi(offset.substr(1)));
-        } else {
-          cisu.emplace_back(token.substr(1, comma - 1), offset);
-        }
-
-      } else if (token[0] == '#') {  // 立即数
-        token = token.substr(1, token.length() - 1);
-        istringstream is(token);
-        int i;
-        is >> i;
-        cisu.emplace_back(i);
-
-      } else {  // 正常寄存器
-        cisu.emplace_back(token);
-      }
-    }
-    count++;  // 包括操作符一共几个操作数
-  }
-  // 构造AsmInst
-  if (isbreak) {  // 如果是跳转语句,token应该是标号
-    return AsmInst(opcode, token, true);
-  } else if (isstr) {  // 如果是str 则第一个是op1,第二个是dest
-    return AsmInst(opcode, cisu[1], cisu[0]);
-
-  } else if (opcode.starts_with("#")) {  // 注释
-    return AsmInst(opcode, AsmOpName());
+AsmInst::AsmInst(const MachineInstr& inst)
+    : op_code(inst.op_code), isjump(false) {
+  // 请注意，这里没有处理 smull 与 NEON 指令
+  // （因为两个dest不好搞定，与跳转一样只保留操作码）
+  if (inst.is_branch() || inst.op_code == MachineOpCode::SMULL ||
+      inst.is_neon()) {
+    this->isjump = true;
+  } else if (inst.op_code == MachineOpCode::STR) {
+    // 如果是str 则第一个是op1,第二个是dest
+    this->dest = inst.operands[1];
+    this->op1 = inst.operands[0];
   } else {
-    switch (count) {
-      case 2:
-        return AsmInst(opcode, cisu[0]);
-        break;
-      case 3:
-        return AsmInst(opcode, cisu[0], cisu[1]);
-        break;
-      case 4:
-        return AsmInst(opcode, cisu[0], cisu[1], cisu[2]);
-        break;
-      case 5:
-        return AsmInst(opcode, cisu[0], cisu[1], cisu[2], cisu[3]);
-        break;
-      default:
-        throw std::runtime_error("too many argument");
-        break;
-    }
+    this->dest = inst.operands[0];
+    this->op1 = inst.operands[1];
+    this->op2 = inst.operands[2];
+    this->op3 = inst.operands[3];
   }
 }
 
 // 输出两个指令的相关性，如果不相关输出-1
-int Calcu_Correlation(AsmInst inst1, AsmInst inst2) {
+int Calcu_Correlation(const AsmInst& inst1, const AsmInst& inst2) {
+  auto writes = [](const Operand& op) { return op.is_reg() || op.is_mem(); };
   // 写后读相关
-  if ((inst1.dest.is_mem_var() || inst1.dest.is_var()) &&
-      inst2.use(inst1.dest)) {
+  if (writes(inst1.dest) && inst2.use(inst1.dest)) {
     // 相关情况1.2：写后读相关(1.3合并成功)
     // LDR r1, [r2,#4]
     // ADD r0, r0, r1
     // 相关情况1.3：写后读相关
     // LDR r1, [r2,#4]
     // MOV r0, r1
-    if (inst1.op_code.starts_with("LDR")) {
+    if (inst1.op_code == MachineOpCode::LDR) {
       return 4;
     }
     // 相关情况1.1：写后读相关
@@ -289,9 +100,10 @@ int Calcu_Correlation(AsmInst inst1, AsmInst inst2) {
     // 相关情况1.5：写后读相关
     // ADD r6, r11, r12 (不一定是ADD，其他的也有可能)
     // CMP r6, r12
-    else if (inst1.op_code == "ADD" || inst1.op_code == "SUB") {
+    else if (inst1.op_code == MachineOpCode::ADD ||
+             inst1.op_code == MachineOpCode::SUB) {
       return 1;
-    } else if (inst1.op_code == "MUL") {
+    } else if (inst1.op_code == MachineOpCode::MUL) {
       return 1;
     }
     // 相关情况9.9：写后读相关
@@ -304,46 +116,52 @@ int Calcu_Correlation(AsmInst inst1, AsmInst inst2) {
   }
   // 读后写相关
   // 指令2写寄存器之前指令1必须完成读操作
-  if ((inst2.dest.is_var() || inst2.dest.is_mem_var()) &&
-      inst1.use(inst2.dest)) {
+  if (writes(inst2.dest) && inst1.use(inst2.dest)) {
     return 0;
   }
   // 写后写相关
-  if ((inst1.dest.is_var() || inst1.dest.is_mem_var()) &&
-      (inst2.dest.is_var() || inst2.dest.is_mem_var()) &&
-      inst1.dest.name == inst2.dest.name) {
+  if (writes(inst1.dest) && writes(inst2.dest) &&
+      inst1.dest.reg_id == inst2.dest.reg_id) {
     return 0;
   }
   // 访存相同指针
-  auto maybe_same = [](AsmOpName a, AsmOpName b) {
-    if (a.is_stack_var() && b.is_stack_var()) {
-      return a.offset_imm == b.offset_imm;
+  auto maybe_same = [](const Operand& a, const Operand& b) {
+    auto is_stack_var = [](const Operand& op) {
+      return op.is_mem() && op.reg_id == syc::assembly::sp &&
+             op.index_reg < 0;
+    };
+    if (is_stack_var(a) && is_stack_var(b)) {
+      return a.value == b.value;
     }
     return true;
   };
-  if (inst1.op_code.starts_with("STR") && inst2.op_code.starts_with("STR")) {
-    assert(inst1.dest.is_mem_var());
-    assert(inst2.dest.is_mem_var());
+  if (inst1.op_code == MachineOpCode::STR &&
+      inst2.op_code == MachineOpCode::STR) {
+    assert(inst1.dest.is_mem());
+    assert(inst2.dest.is_mem());
     if (maybe_same(inst1.dest, inst2.dest)) {
       return 0;
     }
   }
-  if (inst1.op_code.starts_with("LDR") && inst2.op_code.starts_with("STR")) {
-    assert(inst1.op1.is_mem_var());
-    assert(inst2.dest.is_mem_var());
+  if (inst1.op_code == MachineOpCode::LDR &&
+      inst2.op_code == MachineOpCode::STR) {
+    assert(inst1.op1.is_mem());
+    assert(inst2.dest.is_mem());
     if (maybe_same(inst1.op1, inst2.dest)) {
       return 0;
     }
   }
-  if (inst1.op_code.starts_with("STR") && inst2.op_code.starts_with("LDR")) {
-    assert(inst1.dest.is_mem_var());
-    assert(inst2.op1.is_mem_var());
+  if (inst1.op_code == MachineOpCode::STR &&
+      inst2.op_code == MachineOpCode::LDR) {
+    assert(inst1.dest.is_mem());
+    assert(inst2.op1.is_mem());
     if (maybe_same(inst1.op1, inst2.op1)) {
       return 0;
     }
   }
   // CMP会影响标志位
-  if (inst1.op_code == "CMP" || inst2.op_code == "CMP") {
+  if (inst1.op_code == MachineOpCode::CMP ||
+      inst2.op_code == MachineOpCode::CMP) {
     return 0;
   }
   return -1;
@@ -639,12 +457,13 @@ bool IfBlockAllNR(int** array, int length) {
   return true;
 }
 
-// 根据二维数组和指令的字符串集，输出优化以后的指令集
+// 根据二维数组和指令集，输出优化以后的指令集
 // 2个问题：
 //  1. 还有没有没有提到的跳转块？除了下面这群B开头的
 //  2. 还有哪些可能的相关
 void Opt_Asm_blk_print(int** array, int block_size,
-                       std::vector<std::string> InstBlk, ostream& out) {
+                       std::vector<std::vector<MachineInstr>>& InstBlk,
+                       std::vector<MachineInstr>& out) {
   bool debug_print = false;
   int count = 0;
   int tttt = 0;
@@ -685,7 +504,7 @@ void Opt_Asm_blk_print(int** array, int block_size,
 
   std::list<int>::iterator itList;
   for (itList = l0.begin(); itList != l0.end();) {
-    out << InstBlk[*itList] << endl;
+    for (auto& inst : InstBlk[*itList]) out.push_back(std::move(inst));
     *itList++;
   }
 
@@ -701,35 +520,29 @@ void Opt_Asm_blk_print(int** array, int block_size,
 }  // namespace
 
 namespace syc::assembly::passes {
-void reorder(std::istream& in, std::ostream& out) {
-  string line1;
-  string line1_orin;
-  std::stringstream in2;
-  bool isfirst = true;
+bool reorder(MachineCode& code) {
+  const auto& in = code.instrs;
   std::vector<int> blk_linenum;
   // optblk_linenum用于表示潜在代码可重排的界限(3,8,15,26,......)
   std::vector<int> optblk_linenum;
   // 存储AsmInst
   std::vector<AsmInst> AsmBlock;
-  // 用于储存潜在可优化代码块的原本字符串，方便后续输出，以免重新根据AsmInst去构造
-  std::vector<std::string> LineBlock;
-  int length = 0;
+  // 用于储存潜在可优化代码块的原本指令（含其前的注释），方便后续输出
+  std::vector<std::vector<MachineInstr>> LineBlock;
   int linenum = 0;
-  while (getline(in, line1)) {
-    in2 << line1 << endl;
+  for (const auto& inst : in) {
     // 第一遍扫描，直接记录块的号数
-    stringstream ss(line1);
-    string token;
-    if (ss >> token) {
-      if (token.ends_with(":") ||
-          (token.starts_with(".") || !token.starts_with(".loc")) ||
-          token.starts_with("B") || token == "SMULL" ||
-          (token == "MOV" && line1.find("pc") != string::npos)) {
-        blk_linenum.emplace_back(linenum);
-        linenum++;
-      } else if (!line1.starts_with("#")) {
-        linenum++;
-      }
+    bool is_loc = inst.op_code == MachineOpCode::DIRECTIVE &&
+                  inst.label.starts_with(".loc");
+    if (inst.op_code == MachineOpCode::LABEL ||
+        (inst.op_code == MachineOpCode::DIRECTIVE || !is_loc) ||
+        inst.is_branch() || inst.op_code == MachineOpCode::SMULL ||
+        inst.is_neon() ||
+        (inst.op_code == MachineOpCode::MOV && inst.operands[0].reg_id == pc)) {
+      blk_linenum.emplace_back(linenum);
+      linenum++;
+    } else if (inst.op_code != MachineOpCode::COMMENT) {
+      linenum++;
     }
   }
   // 确认潜在opt的linenum
@@ -739,114 +552,105 @@ void reorder(std::istream& in, std::ostream& out) {
       optblk_linenum.emplace_back(blk_linenum[i + 1]);
     }
   }
+  // 如果很短，原样保留
+  if (optblk_linenum.empty()) return false;
+
+  std::vector<MachineInstr> out;
+  out.reserve(in.size());
   linenum = 0;
   int optnum = 0;
-  int temp = 0;
-  int head = 0, tail = 0;
-  bool flag = false;
-  in.seekg(ios::beg);
-  if (optblk_linenum.empty()) {
-    // 如果很短，
-    out << in2.str() << std::endl;
-  } else {
-    head = optblk_linenum[optnum];
-    tail = optblk_linenum[optnum + 1];
-    int** blk_array = nullptr;
-    int temp_inst_blk = 0;  // 在指令vector中的数目
-    string comment;
-    while (getline(in2, line1)) {
-      // 第二遍扫描，某一块指令数目>5才会去优化
-      if (line1.starts_with("#") || line1.starts_with(".loc")) {
-        comment += line1 + '\n';
-        continue;
+  int head = optblk_linenum[optnum];
+  int tail = optblk_linenum[optnum + 1];
+  int** blk_array = nullptr;
+  std::vector<MachineInstr> comment;
+  const auto flush = [&](const MachineInstr& inst) {
+    for (auto& i : comment) out.push_back(std::move(i));
+    comment.clear();
+    out.push_back(inst);
+  };
+  for (const auto& inst : in) {
+    // 第二遍扫描，某一块指令数目>5才会去优化
+    if (inst.op_code == MachineOpCode::COMMENT ||
+        (inst.op_code == MachineOpCode::DIRECTIVE &&
+         inst.label.starts_with(".loc"))) {
+      comment.push_back(inst);
+      continue;
+    }
+    if (linenum < head || (linenum == head)) {
+      out.push_back(inst);
+      linenum++;
+    } else if (linenum == (head + 1)) {
+      // 新建一个矩阵 和 vector<指令>
+      int block_size = tail - head - 1;
+      blk_array = new int*[block_size];
+      for (int i = 0; i < block_size; ++i) {
+        blk_array[i] = new int[block_size];
       }
-      if (linenum < head || (linenum == head)) {
-        out << line1 << std::endl;
-        linenum++;
-      } else if (linenum == (head + 1)) {
-        // std::cout<< "新建块" << std::endl;
-        // 新建一个矩阵 和 vector<指令>
-        int block_size = tail - head - 1;
-        blk_array = new int*[block_size];
-        for (int i = 0; i < block_size; ++i) {
-          blk_array[i] = new int[block_size];
+      // 默认初始化为-1
+      for (int i = 0; i < block_size; i++) {
+        for (int j = 0; j < block_size; j++) {
+          blk_array[i][j] = -1;
         }
-        // 默认初始化为-1
-        for (int i = 0; i < block_size; i++) {
-          for (int j = 0; j < block_size; j++) {
-            blk_array[i][j] = -1;
-          }
-        }
-        AsmInst temp_AsmInst = Create_AsmInst(line1);
-        LineBlock.emplace_back(comment + line1);
-        AsmBlock.emplace_back(temp_AsmInst);
-        comment.clear();
-        linenum++;
-      } else if ((linenum > (head + 1) && (linenum < tail))) {
-        AsmInst temp_AsmInst = Create_AsmInst(line1);
-
-        // 计算矩阵
-        int size = AsmBlock.size();
-        for (int i = 0; i < size; i++) {
-          int temp1;
-          // cout << LineBlock[i] << endl;
-          // cout << line1 << endl;
-          // cout << endl;
-          temp1 = Calcu_Correlation(AsmBlock[i], temp_AsmInst);
-          blk_array[size][i] = temp1;
-        }
-        // 加入优化框
-        // std::cout<< "加入优化框" << std::endl;
-        // std::cout<< line1 << std::endl;
-
-        LineBlock.emplace_back(comment + line1);
-        AsmBlock.emplace_back(temp_AsmInst);
-        comment.clear();
-        linenum++;
-      } else if (linenum == tail) {
-        // 当Linenum = tail数目的时候,通过矩阵算出四个的值
-        // 对矩阵/AsmBlock进行销毁处理,然后执行重排函数
-        int nn = tail - head;
-
-        // 判断是否需要进行优化，如果不需要的话，直接就输出了
-        if (IfBlockAllNR(blk_array, (nn - 1))) {
-          // 无关，直接输出
-          // std::cout<< "无关，直接输出" << std::endl;
-
-          for (int i = 0; i < LineBlock.size(); i++) {
-            out << LineBlock[i] << std::endl;
-          }
-
-        } else {
-          // 有关，优化输出,这里遍历那个列表即可
-          // std::cout<< "有关，优化输出" << std::endl;
-
-          Opt_Asm_blk_print(blk_array, LineBlock.size(), LineBlock, out);
-        }
-        for (int i = 0; i < nn - 1; i++) {
-          delete[] blk_array[i];
-        }
-        delete[] blk_array;
-        AsmBlock.clear();
-        LineBlock.clear();
-        // 为了防止溢出
-        if (((optnum + 2) < optblk_linenum.size())) {
-          optnum += 2;
-          head = optblk_linenum[optnum];
-          tail = optblk_linenum[optnum + 1];
+      }
+      AsmBlock.emplace_back(inst);
+      comment.push_back(inst);
+      LineBlock.push_back(std::move(comment));
+      comment.clear();
+      linenum++;
+    } else if ((linenum > (head + 1) && (linenum < tail))) {
+      AsmInst temp_AsmInst(inst);
+
+      // 计算矩阵
+      int size = AsmBlock.size();
+      for (int i = 0; i < size; i++) {
+        blk_array[size][i] = Calcu_Correlation(AsmBlock[i], temp_AsmInst);
+      }
+      // 加入优化框
+      AsmBlock.emplace_back(temp_AsmInst);
+      comment.push_back(inst);
+      LineBlock.push_back(std::move(comment));
+      comment.clear();
+      linenum++;
+    } else if (linenum == tail) {
+      // 当Linenum = tail数目的时候,通过矩阵算出四个的值
+      // 对矩阵/AsmBlock进行销毁处理,然后执行重排函数
+      int nn = tail - head;
+
+      // 判断是否需要进行优化，如果不需要的话，直接就输出了
+      if (IfBlockAllNR(blk_array, (nn - 1))) {
+        // 无关，直接输出
+        for (auto& i : LineBlock) {
+          for (auto& j : i) out.push_back(std::move(j));
         }
-
-        linenum++;
-        out << comment << line1 << std::endl;
-        comment.clear();
-      } else if (linenum > tail) {  // 到最后了，全部输出,最后一块就不优化了
-        out << comment << line1 << std::endl;
-        comment.clear();
-        linenum++;
       } else {
-        assert(false);
+        // 有关，优化输出,这里遍历那个列表即可
+        Opt_Asm_blk_print(blk_array, LineBlock.size(), LineBlock, out);
+      }
+      for (int i = 0; i < nn - 1; i++) {
+        delete[] blk_array[i];
+      }
+      delete[] blk_array;
+      AsmBlock.clear();
+      LineBlock.clear();
+      // 为了防止溢出
+      if (((optnum + 2) < optblk_linenum.size())) {
+        optnum += 2;
+        head = optblk_linenum[optnum];
+        tail = optblk_linenum[optnum + 1];
       }
+
+      linenum++;
+      flush(inst);
+    } else if (linenum > tail) {  // 到最后了，全部输出,最后一块就不优化了
+      flush(inst);
+      linenum++;
+    } else {
+      assert(false);
     }
   }
+  for (auto& i : comment) out.push_back(std::move(i));
+  bool changed = out != in;
+  code.instrs = std::move(out);
+  return changed;
 }
 }  // namespace syc::assembly::passes
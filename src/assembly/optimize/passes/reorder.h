@@ -17,13 +17,13 @@
  */
 #pragma once
 
-#include <istream>
-#include <ostream>
+#include "assembly/machine.h"
 
 namespace syc::assembly::passes {
 // 使用LIS算法对指令进行重排
 // 请参考论文：X. Shi and P. Guo, "A Novel Lightweight Instruction Scheduling
 // Algorithm for Just-in-Time Compiler," 2009 WRI World Congress on Software
 // Engineering, 2009, pp. 73-77, doi: 10.1109/WCSE.2009.39.
-void reorder(std::istream& in, std::ostream& out);
+// 返回是否改变了指令顺序
+bool reorder(MachineCode& code);
 }  // namespace syc::assembly::passes
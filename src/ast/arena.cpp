@@ -0,0 +1,62 @@
+/*
+ * syc, a compiler for SysY
+ * Copyright (C) 2020-2021  nzh63, skywf21
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#include "ast/arena.h"
+
+#include <algorithm>
+#include <cstdint>
+
+namespace syc::ast {
+Arena* arena = nullptr;
+
+Arena::~Arena() { this->clear(); }
+
+void* Arena::allocate(std::size_t size, std::size_t align) {
+  auto p = reinterpret_cast<std::uintptr_t>(this->current);
+  auto aligned = (p + align - 1) & ~(std::uintptr_t)(align - 1);
+  if (this->current == nullptr ||
+      aligned + size > reinterpret_cast<std::uintptr_t>(this->end)) {
+    // 超过块大小的对象单独分配一块
+    std::size_t n = std::max(block_size, size + align);
+    this->blocks.emplace_back(new std::byte[n]);
+    this->block_sizes.push_back(n);
+    this->current = this->blocks.back().get();
+    this->end = this->current + n;
+    p = reinterpret_cast<std::uintptr_t>(this->current);
+    aligned = (p + align - 1) & ~(std::uintptr_t)(align - 1);
+  }
+  this->current += aligned - p + size;
+  return reinterpret_cast<void*>(aligned);
+}
+
+void Arena::clear() {
+  for (auto it = this->destructors.rbegin(); it != this->destructors.rend();
+       it++) {
+    it->destroy(it->object);
+  }
+  this->destructors.clear();
+  this->blocks.clear();
+  this->block_sizes.clear();
+  this->current = this->end = nullptr;
+}
+
+std::size_t Arena::allocated_bytes() const {
+  std::size_t ret = 0;
+  for (auto i : this->block_sizes) ret += i;
+  return ret;
+}
+}  // namespace syc::ast
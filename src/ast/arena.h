@@ -0,0 +1,65 @@
+/*
+ * syc, a compiler for SysY
+ * Copyright (C) 2020-2021  nzh63, skywf21
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#pragma once
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace syc::ast {
+// 单次编译使用的内存池，AST 结点与 token 字符串均从中按块顺序分配，
+// 在 clear() 或析构时一次性释放
+class Arena {
+ public:
+  Arena() = default;
+  Arena(const Arena&) = delete;
+  Arena& operator=(const Arena&) = delete;
+  ~Arena();
+
+  template <typename T, typename... Args>
+  T* make(Args&&... args) {
+    T* object = new (allocate(sizeof(T), alignof(T)))
+        T(std::forward<Args>(args)...);
+    if constexpr (!std::is_trivially_destructible_v<T>) {
+      destructors.push_back(
+          {object, [](void* p) { static_cast<T*>(p)->~T(); }});
+    }
+    return object;
+  }
+  void* allocate(std::size_t size, std::size_t align);
+  void clear();
+  std::size_t allocated_bytes() const;
+
+ private:
+  static constexpr std::size_t block_size = 64 * 1024;
+  struct Destructor {
+    void* object;
+    void (*destroy)(void*);
+  };
+  std::vector<std::unique_ptr<std::byte[]>> blocks;
+  std::vector<std::size_t> block_sizes;
+  std::byte* current = nullptr;
+  std::byte* end = nullptr;
+  std::vector<Destructor> destructors;
+};
+
+// 语法分析期间结点分配所用的内存池
+extern Arena* arena;
+}  // namespace syc::ast
@@ -17,20 +17,27 @@
  */
 #include "ast/generate/generate.h"
 
+#include "ast/source_buffer.h"
+
+struct yy_buffer_state;
+extern yy_buffer_state* yy_scan_buffer(char* base, std::size_t size);
 extern int yyparse();
 extern int yylex_destroy();
 extern void yyset_lineno(int _line_number);
 extern int yycolumn;
-void yyset_in(FILE* _in_str);
 
 namespace syc::ast {
 syc::ast::node::Root* root = nullptr;
-syc::ast::node::Root* generate(FILE* input) {
-  yyset_in(input);
+syc::ast::node::Root* generate(Arena& arena, FILE* input) {
+  syc::ast::arena = &arena;
+  // 词法分析直接在源文件缓冲区上进行，token 文本指向缓冲区
+  SourceBuffer source(input);
+  yy_scan_buffer(source.data(), source.size() + 2);
   yyset_lineno(1);
   yycolumn = 1;
   yyparse();
   yylex_destroy();
+  syc::ast::arena = nullptr;
   return root;
 }
 }  // namespace syc::ast
\ No newline at end of file
@@ -19,9 +19,11 @@
 
 #include <cstdlib>
 
+#include "ast/arena.h"
 #include "ast/node.h"
 
 namespace syc::ast {
 extern syc::ast::node::Root* root;
-syc::ast::node::Root* generate(FILE* input = stdin);
+// 结点分配在 arena 中，其生命周期由调用者管理
+syc::ast::node::Root* generate(Arena& arena, FILE* input = stdin);
 }  // namespace syc::ast
\ No newline at end of file
@@ -0,0 +1,82 @@
+/*
+ * syc, a compiler for SysY
+ * Copyright (C) 2020-2021  nzh63, skywf21
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#include "ast/source_buffer.h"
+
+#if __has_include(<sys/mman.h>) && !defined(__EMSCRIPTEN__)
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define SYC_HAS_MMAP 1
+#endif
+
+namespace syc::ast {
+SourceBuffer::SourceBuffer(FILE* input) {
+  if (!this->map(input)) this->read(input);
+}
+
+SourceBuffer::~SourceBuffer() {
+#ifdef SYC_HAS_MMAP
+  if (this->mapped_length) munmap(this->base, this->mapped_length);
+#endif
+}
+
+bool SourceBuffer::map(FILE* input) {
+#ifdef SYC_HAS_MMAP
+  if (input == nullptr) return false;
+  int fd = fileno(input);
+  struct stat st;
+  if (fd < 0 || fstat(fd, &st) != 0 || !S_ISREG(st.st_mode) ||
+      st.st_size == 0 || ftell(input) != 0) {
+    return false;
+  }
+  std::size_t size = st.st_size;
+  // 先保留 size + 2 字节的匿名映射，再将文件覆盖映射到其开头。
+  // 文件末页超出文件长度的部分与后续匿名页均为 0，即为结尾的两个 '\0'
+  std::size_t page = sysconf(_SC_PAGESIZE);
+  std::size_t total = (size + 2 + page - 1) / page * page;
+  void* region = mmap(nullptr, total, PROT_READ | PROT_WRITE,
+                      MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (region == MAP_FAILED) return false;
+  void* file = mmap(region, size, PROT_READ | PROT_WRITE,
+                    MAP_PRIVATE | MAP_FIXED, fd, 0);
+  if (file == MAP_FAILED) {
+    munmap(region, total);
+    return false;
+  }
+  this->base = static_cast<char*>(region);
+  this->length = size;
+  this->mapped_length = total;
+  return true;
+#else
+  return false;
+#endif
+}
+
+void SourceBuffer::read(FILE* input) {
+  if (input != nullptr) {
+    char buffer[64 * 1024];
+    std::size_t n;
+    while ((n = fread(buffer, 1, sizeof(buffer), input)) > 0) {
+      this->storage.insert(this->storage.end(), buffer, buffer + n);
+    }
+  }
+  this->length = this->storage.size();
+  this->storage.resize(this->length + 2, '\0');
+  this->base = this->storage.data();
+}
+}  // namespace syc::ast
@@ -0,0 +1,57 @@
+/*
+ * syc, a compiler for SysY
+ * Copyright (C) 2020-2021  nzh63, skywf21
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#pragma once
+#include <cstddef>
+#include <cstdio>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace syc::ast {
+// 词法单元的文本，直接指向源文件缓冲区或内存池中的字符串，不做复制。
+// 须为平凡类型以放入 bison 的 %union
+struct TokenText {
+  const char* data;
+  std::size_t size;
+  std::string_view view() const { return {this->data, this->size}; }
+  std::string str() const { return std::string(this->view()); }
+};
+
+// 整个源文件的可写缓冲区，末尾附带两个 '\0' 以供 flex 的 yy_scan_buffer
+// 原地扫描。普通文件以私有映射的方式 mmap，其他输入（如管道）读入内存
+class SourceBuffer {
+ public:
+  explicit SourceBuffer(FILE* input);
+  SourceBuffer(const SourceBuffer&) = delete;
+  SourceBuffer& operator=(const SourceBuffer&) = delete;
+  ~SourceBuffer();
+
+  char* data() { return this->base; }
+  // 不含末尾的两个 '\0'
+  std::size_t size() const { return this->length; }
+
+ private:
+  bool map(FILE* input);
+  void read(FILE* input);
+
+  char* base = nullptr;
+  std::size_t length = 0;
+  std::size_t mapped_length = 0;
+  std::vector<char> storage;
+};
+}  // namespace syc::ast
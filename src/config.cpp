@@ -17,6 +17,10 @@
  */
 #include "config.h"
 
+#include <algorithm>
+#include <cstdlib>
+#include <string_view>
+
 extern int yydebug;
 
 namespace syc::config {
@@ -26,8 +30,15 @@ FILE* input = stdin;
 std::ostream* output = &std::cout;
 bool print_ast = false;
 bool print_ir = false;
+bool print_cfg = false;
 bool print_log = false;
 bool enable_dwarf2 = false;
+bool time_report = false;
+bool neon = false;
+int cache_size = 32768;
+int jobs = 0;
+std::string stats_file;
+std::vector<std::string> passes;
 std::string input_filename = "<stdin>";
 
 void parse_arg(int argc, char** argv) {
@@ -37,8 +48,15 @@ void parse_arg(int argc, char** argv) {
   output = &std::cout;
   print_ast = false;
   print_ir = false;
+  print_cfg = false;
   print_log = false;
   enable_dwarf2 = false;
+  time_report = false;
+  neon = false;
+  cache_size = 32768;
+  jobs = 0;
+  stats_file.clear();
+  passes.clear();
   input_filename = "stdin";
   int s = 0;
   for (int i = 1; i < argc; i++) {
@@ -57,10 +75,34 @@ void parse_arg(int argc, char** argv) {
         print_ast = true;
       else if (std::string("-print_ir") == argv[i])
         print_ir = true;
+      else if (std::string("-print_cfg") == argv[i])
+        print_cfg = true;
       else if (std::string("-print_log") == argv[i])
         print_log = true;
       else if (std::string("-g") == argv[i])
         enable_dwarf2 = true;
+      else if (std::string("-ftime-report") == argv[i])
+        time_report = true;
+      else if (std::string("-mfpu=neon") == argv[i])
+        neon = true;
+      else if (std::string_view(argv[i]).starts_with("-fcache-size="))
+        cache_size =
+            std::atoi(argv[i] + std::string_view("-fcache-size=").size());
+      else if (std::string("-stats") == argv[i])
+        stats_file = "-";
+      else if (std::string_view(argv[i]).starts_with("-stats="))
+        stats_file = argv[i] + std::string_view("-stats=").size();
+      else if (std::string_view(argv[i]).starts_with("-j"))
+        jobs = std::atoi(argv[i] + 2);
+      else if (std::string_view(argv[i]).starts_with("-passes=")) {
+        std::string_view list = argv[i] + std::string_view("-passes=").size();
+        passes.clear();
+        while (!list.empty()) {
+          auto end = std::min(list.find(','), list.size());
+          if (end > 0) passes.emplace_back(list.substr(0, end));
+          list.remove_prefix(std::min(end + 1, list.size()));
+        }
+      }
     } else {
       if (s == 1) {
         if (std::string("-") == argv[i])
@@ -20,13 +20,27 @@
 #include <fstream>
 #include <iostream>
 #include <string>
+#include <vector>
 
 namespace syc::config {
 extern int optimize_level;
 extern bool print_ast;
 extern bool print_ir;
+extern bool print_cfg;
 extern bool print_log;
 extern bool enable_dwarf2;
+extern bool time_report;
+// -mfpu=neon：目标支持 NEON，-O2 时向量化循环
+extern bool neon;
+// -fcache-size= 指定的 L1 数据缓存大小（字节），循环分块据此选择块的大小
+extern int cache_size;
+// 并行编译使用的线程数，0 表示与 CPU 核数相同
+extern int jobs;
+// -stats 输出 JSON 统计的文件，"-" 表示 stderr，空表示不输出
+extern std::string stats_file;
+// -passes= 指定的 pass 名称，按顺序组成流水线，空表示使用 -O 级别的默认流水线。
+// 只在 -O1 及以上生效，-O0 生成的 IR 不满足各 pass 的前提
+extern std::vector<std::string> passes;
 extern FILE* input;
 extern std::ostream* output;
 extern std::string input_filename;
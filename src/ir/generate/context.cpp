@@ -18,6 +18,8 @@
 #include "context.h"
 
 #include <exception>
+#include <stdexcept>
+#include <utility>
 
 namespace syc::ir {
 VarInfo::VarInfo(std::string name, bool is_array, std::vector<int> shape)
@@ -40,48 +42,48 @@ Context::Context() {
 unsigned Context::get_id() { return ++id; }
 
 void Context::insert_symbol(std::string name, VarInfo value) {
-  symbol_table.back().insert({name, value});
+  symbol_table.insert(name, std::move(value));
 }
 void Context::insert_const(std::string name, ConstInfo value) {
-  const_table.back().insert({name, value});
+  const_table.insert(name, std::move(value));
 }
 void Context::insert_const_assign(std::string name, ConstInfo value) {
-  const_assign_table.back().insert({name, value});
+  const_assign_table.insert(name, std::move(value));
 }
 
-VarInfo& Context::find_symbol(std::string name) {
-  for (int i = symbol_table.size() - 1; i >= 0; i--) {
-    auto find = symbol_table[i].find(name);
-    if (find != symbol_table[i].end()) return find->second;
-  }
+const VarInfo& Context::find_symbol(const std::string& name) const {
+  if (auto find = symbol_table.find(name)) return *find;
   throw std::out_of_range("No such symbol:" + name);
 }
 
-ConstInfo& Context::find_const(std::string name) {
-  for (int i = const_table.size() - 1; i >= 0; i--) {
-    auto find = const_table[i].find(name);
-    if (find != const_table[i].end()) return find->second;
-  }
+const ConstInfo& Context::find_const(const std::string& name) const {
+  if (auto find = const_table.find(name)) return *find;
   throw std::out_of_range("No such const:" + name);
 }
-ConstInfo& Context::find_const_assign(std::string name) {
-  for (int i = const_assign_table.size() - 1; i >= 0; i--) {
-    auto find = const_assign_table[i].find(name);
-    if (find != const_assign_table[i].end()) return find->second;
-  }
+const ConstInfo& Context::find_const_assign(const std::string& name) const {
+  if (auto find = const_assign_table.find(name)) return *find;
   throw std::out_of_range("No such const:" + name);
 }
 
+void Context::rename_symbol(const std::string& name, std::string new_name) {
+  int scope = symbol_table.scope_of(name);
+  if (scope == -1) throw std::out_of_range("No such symbol:" + name);
+  VarInfo v = *symbol_table[scope].find(name);
+  if (v.name == new_name) return;
+  v.name = std::move(new_name);
+  symbol_table.assign(scope, name, std::move(v));
+}
+
 void Context::create_scope() {
-  symbol_table.push_back({});
-  const_table.push_back({});
-  const_assign_table.push_back({});
+  symbol_table.push_scope();
+  const_table.push_scope();
+  const_assign_table.push_scope();
 }
 
 void Context::end_scope() {
-  symbol_table.pop_back();
-  const_table.pop_back();
-  const_assign_table.pop_back();
+  symbol_table.pop_scope();
+  const_table.pop_scope();
+  const_assign_table.pop_scope();
 }
 
 bool Context::is_global() {
@@ -19,10 +19,10 @@
 #include <map>
 #include <stack>
 #include <string>
-#include <unordered_map>
 #include <utility>
 #include <vector>
 
+#include "ir/generate/scoped_table.h"
 #include "ir/ir.h"
 
 namespace syc::ir {
@@ -50,20 +50,25 @@ class Context {
   unsigned id = 1;
   unsigned get_id();
 
-  using SymbolTable = std::vector<std::unordered_map<std::string, VarInfo>>;
-  using ConstTable = std::vector<std::unordered_map<std::string, ConstInfo>>;
+  // 复制 Context 时符号表只复制指针，修改时才复制被修改的路径
+  using SymbolTable = ScopedTable<VarInfo>;
+  using ConstTable = ScopedTable<ConstInfo>;
 
-  SymbolTable symbol_table = {{}};
-  ConstTable const_table = {{}};
-  ConstTable const_assign_table = {{}};
+  SymbolTable symbol_table;
+  ConstTable const_table;
+  ConstTable const_assign_table;
 
   void insert_symbol(std::string name, VarInfo value);
   void insert_const(std::string name, ConstInfo value);
   void insert_const_assign(std::string name, ConstInfo value);
 
-  VarInfo& find_symbol(std::string name);
-  ConstInfo& find_const(std::string name);
-  ConstInfo& find_const_assign(std::string name);
+  // 返回的引用在该符号被修改后失效
+  const VarInfo& find_symbol(const std::string& name) const;
+  const ConstInfo& find_const(const std::string& name) const;
+  const ConstInfo& find_const_assign(const std::string& name) const;
+
+  // 修改最内层同名符号对应的变量名
+  void rename_symbol(const std::string& name, std::string new_name);
 
   void create_scope();
   void end_scope();
@@ -71,13 +76,16 @@ class Context {
   bool is_global();
   bool in_loop();
 
+  // break/continue 处的符号表快照，jmp 指向其生成的跳转指令，
+  // 循环体生成完毕后在其前插入 PHI 所需的 MOV
+  struct JumpSnapshot {
+    SymbolTable symbol_table;
+    IRList::iterator jmp;
+  };
+
   std::stack<std::string> loop_label;
-  std::stack<std::vector<SymbolTable>> loop_continue_symbol_snapshot;
-  std::stack<std::vector<SymbolTable>> loop_break_symbol_snapshot;
-  std::stack<std::map<std::pair<int, std::string>, std::string>>
-      loop_continue_phi_move;
-  std::stack<std::map<std::pair<int, std::string>, std::string>>
-      loop_break_phi_move;
+  std::stack<std::vector<JumpSnapshot>> loop_continue_symbol_snapshot;
+  std::stack<std::vector<JumpSnapshot>> loop_break_symbol_snapshot;
   std::stack<std::vector<std::string>> loop_var{};
 };
 }  // namespace syc::ir
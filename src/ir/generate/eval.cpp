@@ -20,6 +20,7 @@
 #include <cassert>
 
 #include "config.h"
+#include "ir/generate/context.h"
 #include "parser.hpp"
 
 // 编译期间求值
@@ -158,12 +159,13 @@ int ast::node::Assignment::_eval(ir::Context& ctx) {
     throw std::runtime_error("only can eval a local var");
   }
   auto val = this->rhs.eval(ctx);
-  auto& v = ctx.find_symbol(this->lhs.name);
+  const auto& v = ctx.find_symbol(this->lhs.name);
   if (v.name[0] != '%' || v.is_array) {
     throw std::runtime_error("only can eval a local var");
   }
-  v.name = "%" + std::to_string(ctx.get_id());
-  ctx.insert_const_assign(v.name, val);
+  auto name = "%" + std::to_string(ctx.get_id());
+  ctx.rename_symbol(this->lhs.name, name);
+  ctx.insert_const_assign(name, val);
   return val;
 }
 
@@ -172,13 +174,14 @@ int ast::node::AfterInc::_eval(ir::Context& ctx) {
     throw std::runtime_error("only can eval a local var");
   }
   auto val = this->lhs.eval(ctx);
-  auto& v = ctx.find_symbol(this->lhs.name);
+  const auto& v = ctx.find_symbol(this->lhs.name);
   if (v.name[0] != '%' || v.is_array) {
     throw std::runtime_error("only can eval a local var");
   }
-  v.name = "%" + std::to_string(ctx.get_id());
+  auto name = "%" + std::to_string(ctx.get_id());
+  ctx.rename_symbol(this->lhs.name, name);
   auto new_val = this->op == PLUS ? val + 1 : val - 1;
-  ctx.insert_const_assign(v.name, new_val);
+  ctx.insert_const_assign(name, new_val);
   return val;
 }
 
@@ -17,6 +17,8 @@
  */
 #include "ir/generate/generate.h"
 
+#include "ir/generate/context.h"
+
 namespace syc::ir {
 IRList generate(syc::ast::node::Root* root) {
   ir::Context ctx;
@@ -17,13 +17,14 @@
  */
 #include <cassert>
 #include <exception>
+#include <map>
+#include <set>
 #include <unordered_set>
 
 #include "ast/node.h"
 #include "config.h"
 #include "ir/generate/context.h"
 #include "ir/ir.h"
-#include "ir/optimize/optimize.h"
 //
 #include "parser.hpp"
 
@@ -262,31 +263,99 @@ void ReturnStatement::_generate_ir(Context& ctx, IRList& ir) {
 }
 
 void ContinueStatement::_generate_ir(Context& ctx, IRList& ir) {
-  ctx.loop_continue_symbol_snapshot.top().push_back(ctx.symbol_table);
-  for (auto& i : ctx.loop_continue_phi_move.top()) {
-    ir.emplace_back(
-        OpCode::MOV, i.second,
-        OpName(
-            ctx.symbol_table[i.first.first].find(i.first.second)->second.name));
-  }
   ir.emplace_back(OpCode::JMP, ".L.LOOP_" + ctx.loop_label.top() + "_CONTINUE");
+  ctx.loop_continue_symbol_snapshot.top().push_back(
+      {ctx.symbol_table, std::prev(ir.end())});
 }
 
 void BreakStatement::_generate_ir(Context& ctx, IRList& ir) {
-  ctx.loop_break_symbol_snapshot.top().push_back(ctx.symbol_table);
-  for (auto& i : ctx.loop_break_phi_move.top()) {
-    ir.emplace_back(
-        OpCode::MOV, i.second,
-        OpName(
-            ctx.symbol_table[i.first.first].find(i.first.second)->second.name));
-  }
   ir.emplace_back(OpCode::JMP, ".L.LOOP_" + ctx.loop_label.top() + "_END");
+  ctx.loop_break_symbol_snapshot.top().push_back(
+      {ctx.symbol_table, std::prev(ir.end())});
 }
 
+namespace {
+// 收集语句中可能被赋值的外部变量名（不含语句内部声明的变量）
+class AssignedVarCollector {
+ public:
+  std::set<std::string> names;
+
+  void collect(BaseNode* node) {
+    if (node == nullptr) return;
+    if (auto n = dynamic_cast<Assignment*>(node)) {
+      assign(n->lhs);
+      collect(&n->rhs);
+    } else if (auto n = dynamic_cast<AfterInc*>(node)) {
+      assign(n->lhs);
+    } else if (auto n = dynamic_cast<ArrayIdentifier*>(node)) {
+      for (auto i : n->shape) collect(i);
+    } else if (auto n = dynamic_cast<ConditionExpression*>(node)) {
+      collect(&n->value);
+    } else if (auto n = dynamic_cast<BinaryExpression*>(node)) {
+      collect(&n->lhs);
+      collect(&n->rhs);
+    } else if (auto n = dynamic_cast<UnaryExpression*>(node)) {
+      collect(&n->rhs);
+    } else if (auto n = dynamic_cast<CommaExpression*>(node)) {
+      for (auto i : n->values) collect(i);
+    } else if (auto n = dynamic_cast<FunctionCall*>(node)) {
+      for (auto i : n->args.args) collect(i);
+    } else if (auto n = dynamic_cast<Block*>(node)) {
+      declared.push_back({});
+      for (auto i : n->statements) collect(i);
+      declared.pop_back();
+    } else if (auto n = dynamic_cast<DeclareStatement*>(node)) {
+      for (auto i : n->list) collect(i);
+    } else if (auto n = dynamic_cast<VarDeclareWithInit*>(node)) {
+      declare(n->name.name);
+      collect(&n->value);
+    } else if (auto n = dynamic_cast<VarDeclare*>(node)) {
+      declare(n->name.name);
+    } else if (auto n = dynamic_cast<ArrayDeclareWithInit*>(node)) {
+      declare(n->name.name.name);
+      collect(&n->value);
+    } else if (auto n = dynamic_cast<ArrayDeclare*>(node)) {
+      declare(n->name.name.name);
+    } else if (auto n = dynamic_cast<ArrayDeclareInitValue*>(node)) {
+      collect(n->value);
+      for (auto i : n->value_list) collect(i);
+    } else if (auto n = dynamic_cast<EvalStatement*>(node)) {
+      collect(&n->value);
+    } else if (auto n = dynamic_cast<ReturnStatement*>(node)) {
+      collect(n->value);
+    } else if (auto n = dynamic_cast<IfElseStatement*>(node)) {
+      collect(&n->cond);
+      collect(&n->thenstmt);
+      collect(&n->elsestmt);
+    } else if (auto n = dynamic_cast<WhileStatement*>(node)) {
+      collect(&n->cond);
+      collect(&n->dostmt);
+    }
+  }
+
+ private:
+  std::vector<std::set<std::string>> declared = {{}};
+
+  void declare(const std::string& name) { declared.back().insert(name); }
+
+  void assign(Identifier& lhs) {
+    if (auto n = dynamic_cast<ArrayIdentifier*>(&lhs)) {
+      collect(n);
+      return;
+    }
+    for (const auto& scope : declared) {
+      if (scope.count(lhs.name)) return;
+    }
+    names.insert(lhs.name);
+  }
+};
+}  // namespace
+
 void WhileStatement::_generate_ir(Context& ctx, IRList& ir) {
   ctx.create_scope();
   ctx.loop_label.push(std::to_string(ctx.get_id()));
   ctx.loop_var.push({});
+  const std::string label = ".L.LOOP_" + ctx.loop_label.top();
 
   // 此处的块与基本快有所不同，见下图
   /*      ┌───────────┐
@@ -307,244 +376,131 @@ void WhileStatement::_generate_ir(Context& ctx, IRList& ir) {
   // 在 `jne END`、`break;`、`continue`前均需要插入 PHI_MOV
 
   // BRFORE
-  Context ctx_before = ctx;
+  // 预先扫描循环中被赋值的变量，为其建立循环变量，循环体只需生成一次
   IRList ir_before;
+  IRList ir_cond;
+  ir_cond.emplace_back(OpCode::LABEL, label + "_BEGIN");
+  AssignedVarCollector collector;
+  collector.collect(&this->cond);
+  collector.collect(&this->dostmt);
+  std::vector<std::pair<int, std::string>> loop_symbols;
+  for (const auto& name : collector.names) {
+    int i = ctx.symbol_table.scope_of(name);
+    if (i == -1) continue;
+    const auto& symbol = *ctx.symbol_table[i].find(name);
+    if (!symbol.is_array && symbol.name[0] == '%') {
+      const std::string new_name = "%" + std::to_string(ctx.get_id());
+      ir_before.emplace_back(OpCode::PHI_MOV, new_name, OpName(symbol.name));
+      ir_before.back().phi_block = ir_cond.begin();
+      ctx.rename_symbol(name, new_name);
+      ctx.loop_var.top().push_back(new_name);
+      loop_symbols.push_back({i, name});
+    }
+  }
 
   // COND
-  Context ctx_cond = ctx_before;
-  IRList ir_cond;
-  ir_cond.emplace_back(OpCode::LABEL,
-                       ".L.LOOP_" + ctx.loop_label.top() + "_BEGIN");
-  auto cond = this->cond.eval_cond_runtime(ctx_cond, ir_cond);
+  auto cond = this->cond.eval_cond_runtime(ctx, ir_cond);
+  Context ctx_before = ctx;
 
   // JMP
   IRList ir_jmp;
-  ir_jmp.emplace_back(cond.else_op, ".L.LOOP_" + ctx.loop_label.top() + "_END");
-
-  // DO (fake)
-  Context ctx_do_fake = ctx_cond;
-  IRList ir_do_fake;
-  ctx_do_fake.loop_continue_symbol_snapshot.push({});
-  ctx_do_fake.loop_break_symbol_snapshot.push({});
-  ctx_do_fake.loop_continue_phi_move.push({});
-  ctx_do_fake.loop_break_phi_move.push({});
-  this->dostmt.generate_ir(ctx_do_fake, ir_do_fake);
-  ctx_do_fake.loop_continue_symbol_snapshot.top().push_back(
-      ctx_do_fake.symbol_table);
+  ir_jmp.emplace_back(cond.else_op, label + "_END");
 
   // DO
-  Context ctx_do = ctx_cond;
   IRList ir_do;
-  ctx_do.loop_continue_symbol_snapshot.push({});
-  ctx_do.loop_break_symbol_snapshot.push({});
-  ctx_do.loop_continue_phi_move.push({});
-  ctx_do.loop_break_phi_move.push({});
-  for (int i = 0; i < ctx_do_fake.symbol_table.size(); i++) {
-    for (auto& symbol : ctx_do_fake.symbol_table[i]) {
-      for (int j = 0;
-           j < ctx_do_fake.loop_continue_symbol_snapshot.top().size(); j++) {
-        if (symbol.second.name !=
-            ctx_do_fake.loop_continue_symbol_snapshot.top()[j][i]
-                .find(symbol.first)
-                ->second.name) {
-          ctx_do.loop_continue_phi_move.top().insert(
-              {{i, symbol.first}, "%" + std::to_string(ctx_do.get_id())});
-          break;
-        }
-      }
+  ir_do.emplace_back(OpCode::LABEL, label + "_DO");
+  ctx.loop_continue_symbol_snapshot.push({});
+  ctx.loop_break_symbol_snapshot.push({});
+  this->dostmt.generate_ir(ctx, ir_do);
+  auto continue_snapshot = std::move(ctx.loop_continue_symbol_snapshot.top());
+  auto break_snapshot = std::move(ctx.loop_break_symbol_snapshot.top());
+  ctx.loop_continue_symbol_snapshot.pop();
+  ctx.loop_break_symbol_snapshot.pop();
+
+  IRList end;
+  end.emplace_back(OpCode::LABEL, label + "_END");
+
+  // continue 与循环体末尾处值不同的变量需在 CONTINUE 处合并，
+  // 快照与当前符号表共享未修改的部分，只需比较发生变化的绑定
+  std::map<std::pair<int, std::string>, std::string> continue_phi_move;
+  for (const auto& snapshot : continue_snapshot) {
+    for (int i = 0; i < ctx.symbol_table.size(); i++) {
+      Context::SymbolTable::Scope::diff(
+          ctx.symbol_table[i], snapshot.symbol_table[i],
+          [&](const std::string& name, const VarInfo* a, const VarInfo* b) {
+            if (a == nullptr || b == nullptr || a->name == b->name) return;
+            if (continue_phi_move.count({i, name})) return;
+            continue_phi_move.insert(
+                {{i, name}, "%" + std::to_string(ctx.get_id())});
+          });
     }
   }
-  for (int i = 0; i < ctx_cond.symbol_table.size(); i++) {
-    for (auto& symbol : ctx_cond.symbol_table[i]) {
-      for (int j = 0; j < ctx_do_fake.loop_break_symbol_snapshot.top().size();
-           j++) {
-        const auto do_name = ctx_do_fake.loop_break_symbol_snapshot.top()[j][i]
-                                 .find(symbol.first)
-                                 ->second.name;
-        if (symbol.second.name != do_name) {
-          ctx_do.loop_break_phi_move.top().insert(
-              {{i, symbol.first}, symbol.second.name});
-          break;
-        }
-      }
+  // break 处的值需写回到 END 处所使用的变量
+  std::map<std::pair<int, std::string>, std::string> break_phi_move;
+  for (const auto& snapshot : break_snapshot) {
+    for (int i = 0; i < ctx_before.symbol_table.size(); i++) {
+      Context::SymbolTable::Scope::diff(
+          ctx_before.symbol_table[i], snapshot.symbol_table[i],
+          [&](const std::string& name, const VarInfo* a, const VarInfo* b) {
+            if (a == nullptr || b == nullptr || a->name == b->name) return;
+            break_phi_move.insert({{i, name}, a->name});
+          });
     }
   }
-  ir_do.emplace_back(OpCode::LABEL, ".L.LOOP_" + ctx.loop_label.top() + "_DO");
-  this->dostmt.generate_ir(ctx_do, ir_do);
-  for (auto& i : ctx_do.loop_continue_phi_move.top()) {
-    ir_do.emplace_back(OpCode::PHI_MOV, i.second,
-                       OpName(ctx_do.symbol_table[i.first.first]
-                                  .find(i.first.second)
-                                  ->second.name));
-  }
-
-  for (auto& i : ctx_do.loop_continue_phi_move.top()) {
-    ctx_do.symbol_table[i.first.first].find(i.first.second)->second.name =
-        i.second;
-  }
+  const auto insert_phi_move =
+      [&](const std::vector<Context::JumpSnapshot>& snapshots,
+          const std::map<std::pair<int, std::string>, std::string>& phi_move) {
+        for (const auto& snapshot : snapshots) {
+          for (const auto& i : phi_move) {
+            const auto& name = snapshot.symbol_table[i.first.first]
+                                   .find(i.first.second)
+                                   ->name;
+            if (name == i.second) continue;
+            auto it = ir_do.insert(snapshot.jmp,
+                                   IR(OpCode::MOV, i.second, OpName(name)));
+            it->line = snapshot.jmp->line;
+            it->column = snapshot.jmp->column;
+          }
+        }
+      };
+  insert_phi_move(continue_snapshot, continue_phi_move);
+  insert_phi_move(break_snapshot, break_phi_move);
 
-  for (auto& i : ctx_do.loop_break_phi_move.top()) {
-    ctx_cond.symbol_table[i.first.first].find(i.first.second)->second.name =
-        i.second;
+  for (auto& i : continue_phi_move) {
+    auto symbol = *ctx.symbol_table[i.first.first].find(i.first.second);
+    ir_do.emplace_back(OpCode::PHI_MOV, i.second, OpName(symbol.name));
+    ir_do.back().phi_block = end.begin();
+    symbol.name = i.second;
+    ctx.symbol_table.assign(i.first.first, i.first.second, std::move(symbol));
   }
 
-  ctx_do.loop_continue_symbol_snapshot.pop();
-  ctx_do.loop_break_symbol_snapshot.pop();
-  ctx_do.loop_continue_phi_move.pop();
-  ctx_do.loop_break_phi_move.pop();
-
   // CONTINUE
-  Context ctx_continue = ctx_do;
   IRList ir_continue;
-  ir_continue.emplace_back(OpCode::LABEL,
-                           ".L.LOOP_" + ctx.loop_label.top() + "_CONTINUE");
-
-  ir_cond.clear();
-  ir_cond.emplace_back(OpCode::LABEL,
-                       ".L.LOOP_" + ctx.loop_label.top() + "_BEGIN");
-
-  for (int i = 0; i < ctx_before.symbol_table.size(); i++) {
-    for (const auto& symbol_before : ctx_before.symbol_table[i]) {
-      const auto& symbo_continue =
-          *ctx_continue.symbol_table[i].find(symbol_before.first);
-      if (symbol_before.second.name != symbo_continue.second.name) {
-        const std::string new_name = "%" + std::to_string(ctx_before.get_id());
-        ir_before.emplace_back(OpCode::PHI_MOV, new_name,
-                               OpName(symbol_before.second.name));
-        ir_before.back().phi_block = ir_cond.begin();
-        ir_continue.emplace_back(OpCode::PHI_MOV, new_name,
-                                 OpName(symbo_continue.second.name));
-        ctx_before.symbol_table[i].find(symbol_before.first)->second.name =
-            new_name;
-        ctx_before.loop_var.top().push_back(new_name);
-      }
-    }
-  }
-  ir_continue.emplace_back(OpCode::JMP,
-                           ".L.LOOP_" + ctx.loop_label.top() + "_BEGIN");
-  ir_continue.emplace_back(OpCode::LABEL,
-                           ".L.LOOP_" + ctx.loop_label.top() + "_END");
-
-  //////////////////////////////////////////////////////////////////////
-
-  // COND real
-  ctx_cond = ctx_before;
-  cond = this->cond.eval_cond_runtime(ctx_cond, ir_cond);
-
-  // JMP real
-  ir_jmp.clear();
-  ir_jmp.emplace_back(cond.else_op, ".L.LOOP_" + ctx.loop_label.top() + "_END");
-
-  // DO (fake) real
-  ctx_do_fake = ctx_cond;
-  ir_do_fake.clear();
-  ctx_do_fake.loop_continue_symbol_snapshot.push({});
-  ctx_do_fake.loop_break_symbol_snapshot.push({});
-  ctx_do_fake.loop_continue_phi_move.push({});
-  ctx_do_fake.loop_break_phi_move.push({});
-  this->dostmt.generate_ir(ctx_do_fake, ir_do_fake);
-  ctx_do_fake.loop_continue_symbol_snapshot.top().push_back(
-      ctx_do_fake.symbol_table);
-
-  // DO real
-  ctx_do = ctx_cond;
-  ir_do.clear();
-  ir_continue.clear();
   ir_continue.emplace_back(OpCode::NOOP);
-  IRList end;
-  end.emplace_back(OpCode::LABEL, ".L.LOOP_" + ctx.loop_label.top() + "_END");
-  ctx_do.loop_continue_symbol_snapshot.push({});
-  ctx_do.loop_break_symbol_snapshot.push({});
-  ctx_do.loop_continue_phi_move.push({});
-  ctx_do.loop_break_phi_move.push({});
-  for (int i = 0; i < ctx_do_fake.symbol_table.size(); i++) {
-    for (auto& symbol : ctx_do_fake.symbol_table[i]) {
-      for (int j = 0;
-           j < ctx_do_fake.loop_continue_symbol_snapshot.top().size(); j++) {
-        if (symbol.second.name !=
-            ctx_do_fake.loop_continue_symbol_snapshot.top()[j][i]
-                .find(symbol.first)
-                ->second.name) {
-          ctx_do.loop_continue_phi_move.top().insert(
-              {{i, symbol.first}, "%" + std::to_string(ctx_do.get_id())});
-          break;
-        }
-      }
+  ir_continue.emplace_back(OpCode::LABEL, label + "_CONTINUE");
+  for (int i = 0; i < loop_symbols.size(); i++) {
+    const auto& loop_var = ctx_before.loop_var.top()[i];
+    const auto& name = ctx.symbol_table[loop_symbols[i].first]
+                           .find(loop_symbols[i].second)
+                           ->name;
+    if (loop_var != name) {
+      ir_continue.emplace_back(OpCode::PHI_MOV, loop_var, OpName(name));
+      ir_continue.back().phi_block = ir_cond.begin();
     }
   }
-  for (int i = 0; i < ctx_cond.symbol_table.size(); i++) {
-    for (auto& symbol : ctx_cond.symbol_table[i]) {
-      for (int j = 0; j < ctx_do_fake.loop_break_symbol_snapshot.top().size();
-           j++) {
-        const auto do_name = ctx_do_fake.loop_break_symbol_snapshot.top()[j][i]
-                                 .find(symbol.first)
-                                 ->second.name;
-        if (symbol.second.name != do_name) {
-          ctx_do.loop_break_phi_move.top().insert(
-              {{i, symbol.first}, symbol.second.name});
-          break;
-        }
-      }
-    }
-  }
-  ir_do.emplace_back(OpCode::LABEL, ".L.LOOP_" + ctx.loop_label.top() + "_DO");
-  this->dostmt.generate_ir(ctx_do, ir_do);
-  for (auto& i : ctx_do.loop_continue_phi_move.top()) {
-    ir_do.emplace_back(OpCode::PHI_MOV, i.second,
-                       OpName(ctx_do.symbol_table[i.first.first]
-                                  .find(i.first.second)
-                                  ->second.name));
-    ir_do.back().phi_block = end.begin();
-  }
-  for (auto& i : ctx_do.loop_continue_phi_move.top()) {
-    ctx_do.symbol_table[i.first.first].find(i.first.second)->second.name =
-        i.second;
-  }
-
-  for (auto& i : ctx_do.loop_break_phi_move.top()) {
-    ctx_cond.symbol_table[i.first.first].find(i.first.second)->second.name =
-        i.second;
-  }
-
-  ctx_do.loop_continue_symbol_snapshot.pop();
-  ctx_do.loop_break_symbol_snapshot.pop();
-  ctx_do.loop_continue_phi_move.pop();
-  ctx_do.loop_break_phi_move.pop();
-
-  // CONTINUE real
-  ctx_continue = ctx_do;
-  ir_continue.emplace_back(OpCode::LABEL,
-                           ".L.LOOP_" + ctx.loop_label.top() + "_CONTINUE");
-  for (int i = 0; i < ctx_before.symbol_table.size(); i++) {
-    for (const auto& symbol_before : ctx_before.symbol_table[i]) {
-      const auto& symbo_continue =
-          *ctx_continue.symbol_table[i].find(symbol_before.first);
-      if (symbol_before.second.name != symbo_continue.second.name) {
-        ir_continue.emplace_back(OpCode::PHI_MOV, symbol_before.second.name,
-                                 OpName(symbo_continue.second.name));
-        ir_continue.back().phi_block = ir_cond.begin();
-      }
-    }
-  }
-  ir_continue.emplace_back(OpCode::JMP,
-                           ".L.LOOP_" + ctx.loop_label.top() + "_BEGIN");
-
-  /////////////////////////////////////////////////////////
-
-  if (config::optimize_level > 0)
-    syc::ir::optimize_loop_ir(ir_before, ir_cond, ir_jmp, ir_do, ir_continue);
+  ir_continue.emplace_back(OpCode::JMP, label + "_BEGIN");
 
   /////////////////////////////////////////////////////////
 
   // 为 continue 块增加假读以延长其生命周期
-  std::unordered_set<std::string> written;
+  std::unordered_set<int> written;
   for (const auto& irs : std::vector<IRList*>{&ir_cond, &ir_jmp, &ir_do}) {
     for (const auto& i : *irs) {
-      if (i.dest.is_var()) written.insert(i.dest.name);
+      if (i.dest.is_var()) written.insert(i.dest.id);
       i.forEachOp(
           [&](OpName op) {
             if (op.is_var()) {
-              if (!written.count(op.name)) {
+              if (!written.count(op.id)) {
                 ir_continue.emplace_back(OpCode::NOOP, OpName(), op);
               }
             }
@@ -555,8 +511,8 @@ void WhileStatement::_generate_ir(Context& ctx, IRList& ir) {
 
   /////////////////////////////////////////////////////////
 
-  ctx = ctx_cond;
-  ctx.id = ctx_continue.id;
+  ctx_before.id = ctx.id;
+  ctx = std::move(ctx_before);
   ir.splice(ir.end(), ir_before);
   ir.splice(ir.end(), ir_cond);
   ir.splice(ir.end(), ir_jmp);
@@ -603,21 +559,26 @@ void IfElseStatement::_generate_ir(Context& ctx, IRList& ir) {
   IRList end;
   end.emplace_back(OpCode::LABEL, ".L.IF_" + id + "_END");
 
+  // 两个分支共享未修改的绑定，只需比较分支中修改过的符号
   for (int i = 0; i < ctx_then.symbol_table.size(); i++) {
-    for (auto& s : ctx_then.symbol_table[i]) {
-      if (s.second.name !=
-          ctx_else.symbol_table[i].find(s.first)->second.name) {
-        auto& v = ctx.find_symbol(s.first);
-        assert(!v.is_array);
-        if (v.name[0] == '%') v.name = "%" + std::to_string(ctx.get_id());
-        ir_then.emplace_back(OpCode::PHI_MOV, v.name, OpName(s.second.name));
-        ir_then.back().phi_block = end.begin();
-        ir_else.emplace_back(
-            OpCode::PHI_MOV, v.name,
-            OpName(ctx_else.symbol_table[i].find(s.first)->second.name));
-        ir_else.back().phi_block = end.begin();
-      }
-    }
+    Context::SymbolTable::Scope::diff(
+        ctx_then.symbol_table[i], ctx_else.symbol_table[i],
+        [&](const std::string& name, const VarInfo* then_v,
+            const VarInfo* else_v) {
+          if (then_v == nullptr || else_v == nullptr ||
+              then_v->name == else_v->name) {
+            return;
+          }
+          assert(!ctx.find_symbol(name).is_array);
+          if (ctx.find_symbol(name).name[0] == '%') {
+            ctx.rename_symbol(name, "%" + std::to_string(ctx.get_id()));
+          }
+          const auto& v = ctx.find_symbol(name);
+          ir_then.emplace_back(OpCode::PHI_MOV, v.name, OpName(then_v->name));
+          ir_then.back().phi_block = end.begin();
+          ir_else.emplace_back(OpCode::PHI_MOV, v.name, OpName(else_v->name));
+          ir_else.back().phi_block = end.begin();
+        });
   }
 
   ir.splice(ir.end(), ir_then);
@@ -627,16 +588,19 @@ void IfElseStatement::_generate_ir(Context& ctx, IRList& ir) {
   ir.splice(ir.end(), end);
 
   if (!ctx.loop_break_symbol_snapshot.empty()) {
+    // ctx_then 与 ctx_else 复制自 ctx，只合并分支中新增的快照
     auto& br = ctx.loop_break_symbol_snapshot.top();
     auto& then_br = ctx_then.loop_break_symbol_snapshot.top();
     auto& else_br = ctx_else.loop_break_symbol_snapshot.top();
-    br.insert(br.end(), then_br.begin(), then_br.end());
-    br.insert(br.end(), else_br.begin(), else_br.end());
+    const auto br_size = br.size();
+    br.insert(br.end(), then_br.begin() + br_size, then_br.end());
+    br.insert(br.end(), else_br.begin() + br_size, else_br.end());
     auto& co = ctx.loop_continue_symbol_snapshot.top();
     auto& then_co = ctx_then.loop_continue_symbol_snapshot.top();
     auto& else_co = ctx_else.loop_continue_symbol_snapshot.top();
-    co.insert(co.end(), then_co.begin(), then_co.end());
-    co.insert(co.end(), else_co.begin(), else_co.end());
+    const auto co_size = co.size();
+    co.insert(co.end(), then_co.begin() + co_size, then_co.end());
+    co.insert(co.end(), else_co.begin() + co_size, else_co.end());
   }
 
   ctx.end_scope();
@@ -648,11 +612,12 @@ void Assignment::_generate_ir(Context& ctx, IRList& ir) {
     dynamic_cast<ArrayIdentifier*>(&this->lhs)->store_runtime(rhs, ctx, ir);
   } else {
     auto rhs = this->rhs.eval_runtime(ctx, ir);
-    auto& v = ctx.find_symbol(this->lhs.name);
+    auto v = ctx.find_symbol(this->lhs.name);
     if (v.is_array) {
       throw std::runtime_error("Can't assign to a array.");
     } else {
-      if (rhs.is_var() && rhs.name[0] == '%' &&
+      if ((rhs.kind == OpName::Kind::Local ||
+           rhs.kind == OpName::Kind::LocalArray) &&
           (v.name[0] == '%' || v.name.substr(0, 4) == "$arg") &&
           v.name[0] != '@') {
         if (ctx.in_loop()) {
@@ -660,16 +625,16 @@ void Assignment::_generate_ir(Context& ctx, IRList& ir) {
           int lhs_level = -1, rhs_level = -1;
           for (const auto& i : ctx.loop_var.top()) {
             if (i == v.name) lhs_is_loop_var = true;
-            if (i == rhs.name) rhs_is_loop_vae = true;
+            if (i == rhs.name()) rhs_is_loop_vae = true;
           }
           if (lhs_is_loop_var && rhs_is_loop_vae) {
             v.name = "%" + std::to_string(ctx.get_id());
             ir.emplace_back(OpCode::MOV, v.name, rhs);
           } else {
-            v.name = rhs.name;
+            v.name = rhs.name();
           }
         } else {
-          v.name = rhs.name;
+          v.name = rhs.name();
         }
       } else if (v.name[0] == '@') {
         ir.emplace_back(OpCode::MOV, v.name, rhs);
@@ -680,6 +645,7 @@ void Assignment::_generate_ir(Context& ctx, IRList& ir) {
           ctx.insert_const_assign(v.name, rhs.value);
         }
       }
+      ctx.rename_symbol(this->lhs.name, v.name);
     }
   }
 }
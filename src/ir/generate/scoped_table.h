@@ -0,0 +1,225 @@
+/*
+ * syc, a compiler for SysY
+ * Copyright (C) 2020-2021  nzh63, skywf21
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#pragma once
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <string>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+namespace syc::ir {
+// 持久化的字符串映射（treap），修改时只复制根到目标结点的路径，
+// 旧版本保持不变，因此复制一个版本只需复制根指针。
+// 结点优先级由键的哈希决定，相同键集合的 treap 形状相同，
+// 比较两个版本时可跳过共享的子树，只访问发生变化的绑定
+template <typename V>
+class PersistentMap {
+ public:
+  const V* find(const std::string& key) const {
+    const Node* t = this->root.get();
+    while (t != nullptr) {
+      if (key == t->entry->first) return &t->entry->second;
+      t = key < t->entry->first ? t->left.get() : t->right.get();
+    }
+    return nullptr;
+  }
+
+  // 键已存在时不覆盖，返回是否插入
+  bool insert(const std::string& key, V value) {
+    if (this->find(key) != nullptr) return false;
+    this->assign(key, std::move(value));
+    return true;
+  }
+
+  void assign(const std::string& key, V value) {
+    auto entry = std::make_shared<const Entry>(key, std::move(value));
+    this->root = assign(this->root, entry, priority_of(key));
+  }
+
+  // 按键的字典序遍历
+  template <typename F>
+  void for_each(F&& callback) const {
+    for_each(this->root, callback);
+  }
+
+  // 按键的字典序对两个版本中绑定不同的键调用
+  // callback(key, const V* a, const V* b)，某一版本中不存在时对应指针为空
+  template <typename F>
+  static void diff(const PersistentMap& a, const PersistentMap& b,
+                   F&& callback) {
+    diff(a.root, b.root, callback);
+  }
+
+ private:
+  using Entry = std::pair<const std::string, V>;
+  struct Node;
+  using NodePtr = std::shared_ptr<const Node>;
+  struct Node {
+    std::shared_ptr<const Entry> entry;
+    std::size_t priority;
+    NodePtr left, right;
+  };
+
+  NodePtr root;
+
+  static std::size_t priority_of(const std::string& key) {
+    return std::hash<std::string>{}(key);
+  }
+  static bool higher(std::size_t priority, const std::string& key,
+                     const Node& t) {
+    return std::tie(priority, key) > std::tie(t.priority, t.entry->first);
+  }
+  static NodePtr make(const std::shared_ptr<const Entry>& entry,
+                      std::size_t priority, NodePtr left, NodePtr right) {
+    return std::make_shared<const Node>(
+        Node{entry, priority, std::move(left), std::move(right)});
+  }
+
+  // 按 key 拆分为小于、等于、大于 key 的三部分
+  static std::tuple<NodePtr, NodePtr, NodePtr> split(const NodePtr& t,
+                                                     const std::string& key) {
+    if (t == nullptr) return {};
+    if (key == t->entry->first) return {t->left, t, t->right};
+    if (key < t->entry->first) {
+      auto [l, m, r] = split(t->left, key);
+      return {l, m, make(t->entry, t->priority, r, t->right)};
+    } else {
+      auto [l, m, r] = split(t->right, key);
+      return {make(t->entry, t->priority, t->left, l), m, r};
+    }
+  }
+
+  static NodePtr assign(const NodePtr& t,
+                        const std::shared_ptr<const Entry>& entry,
+                        std::size_t priority) {
+    const auto& key = entry->first;
+    if (t == nullptr) return make(entry, priority, nullptr, nullptr);
+    if (key == t->entry->first) return make(entry, priority, t->left, t->right);
+    // 已存在的键优先级必低于其祖先，故此处 key 不在 t 中
+    if (higher(priority, key, *t)) {
+      auto [l, m, r] = split(t, key);
+      return make(entry, priority, l, r);
+    }
+    if (key < t->entry->first) {
+      return make(t->entry, t->priority, assign(t->left, entry, priority),
+                  t->right);
+    } else {
+      return make(t->entry, t->priority, t->left,
+                  assign(t->right, entry, priority));
+    }
+  }
+
+  template <typename F>
+  static void for_each(const NodePtr& t, F& callback) {
+    if (t == nullptr) return;
+    for_each(t->left, callback);
+    callback(t->entry->first, t->entry->second);
+    for_each(t->right, callback);
+  }
+
+  template <typename F>
+  static void diff(const NodePtr& a, const NodePtr& b, F& callback) {
+    if (a == b) return;
+    if (a == nullptr || b == nullptr) {
+      const bool left = a != nullptr;
+      auto f = [&](const std::string& key, const V& value) {
+        callback(key, left ? &value : nullptr, left ? nullptr : &value);
+      };
+      for_each(left ? a : b, f);
+      return;
+    }
+    if (a->entry->first == b->entry->first) {
+      diff(a->left, b->left, callback);
+      if (a->entry != b->entry) {
+        callback(a->entry->first, &a->entry->second, &b->entry->second);
+      }
+      diff(a->right, b->right, callback);
+      return;
+    }
+    // 键集合不同导致形状不同，以优先级较高的根拆分另一侧
+    if (higher(a->priority, a->entry->first, *b)) {
+      auto [l, m, r] = split(b, a->entry->first);
+      diff(a->left, l, callback);
+      if (m == nullptr || m->entry != a->entry) {
+        callback(a->entry->first, &a->entry->second,
+                 m == nullptr ? nullptr : &m->entry->second);
+      }
+      diff(a->right, r, callback);
+    } else {
+      auto [l, m, r] = split(a, b->entry->first);
+      diff(l, b->left, callback);
+      if (m == nullptr || m->entry != b->entry) {
+        callback(b->entry->first, m == nullptr ? nullptr : &m->entry->second,
+                 &b->entry->second);
+      }
+      diff(r, b->right, callback);
+    }
+  }
+};
+
+// 分层作用域的符号表，每层为一个 PersistentMap。
+// 作用域数组写时复制，复制整个符号表（如生成快照）只需复制一个指针
+template <typename V>
+class ScopedTable {
+ public:
+  using Scope = PersistentMap<V>;
+
+  ScopedTable() : scopes(std::make_shared<std::vector<Scope>>(1)) {}
+
+  std::size_t size() const { return this->scopes->size(); }
+  const Scope& operator[](std::size_t i) const { return (*this->scopes)[i]; }
+
+  void push_scope() { this->mutable_scopes().emplace_back(); }
+  void pop_scope() { this->mutable_scopes().pop_back(); }
+
+  // 插入到最内层作用域，已存在时不覆盖
+  bool insert(const std::string& key, V value) {
+    if (this->scopes->back().find(key) != nullptr) return false;
+    return this->mutable_scopes().back().insert(key, std::move(value));
+  }
+  void assign(std::size_t scope, const std::string& key, V value) {
+    this->mutable_scopes()[scope].assign(key, std::move(value));
+  }
+
+  // 由内向外查找，返回所在的作用域层数，不存在时返回 -1
+  int scope_of(const std::string& key) const {
+    for (int i = this->size() - 1; i >= 0; i--) {
+      if ((*this->scopes)[i].find(key) != nullptr) return i;
+    }
+    return -1;
+  }
+  const V* find(const std::string& key) const {
+    for (int i = this->size() - 1; i >= 0; i--) {
+      if (auto value = (*this->scopes)[i].find(key)) return value;
+    }
+    return nullptr;
+  }
+
+ private:
+  std::vector<Scope>& mutable_scopes() {
+    if (this->scopes.use_count() > 1) {
+      this->scopes = std::make_shared<std::vector<Scope>>(*this->scopes);
+    }
+    return *this->scopes;
+  }
+
+  std::shared_ptr<std::vector<Scope>> scopes;
+};
+}  // namespace syc::ir
@@ -18,35 +18,84 @@
 #include "ir/ir.h"
 
 #include <cassert>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
 
 #include "ast/node.h"
 
 namespace syc::ir {
-OpName::OpName() : type(OpName::Type::Null) {}
-OpName::OpName(std::string name) : type(OpName::Type::Var), name(name) {}
-OpName::OpName(int value) : type(OpName::Type::Imm), value(value) {}
-bool OpName::is_var() const { return this->type == OpName::Type::Var; }
-bool OpName::is_local_var() const {
-  return this->is_var() &&
-         (this->name.starts_with('%') || this->name.starts_with("$arg"));
+namespace {
+// 名称表可被多个线程同时使用：插入时加锁，条目按块存放且块地址固定，
+// 读取已分配 id 的条目时无需加锁
+class NameTable {
+ public:
+  struct Entry {
+    std::string name;
+    OpName::Kind kind;
+  };
+
+  // id 0 保留给空名称
+  NameTable() : chunks(new std::unique_ptr<Entry[]>[max_chunks]) {
+    this->insert("");
+  }
+  int intern(const std::string& name) {
+    std::lock_guard lock(this->mutex);
+    auto it = this->ids.find(name);
+    if (it != this->ids.end()) return it->second;
+    return this->insert(name);
+  }
+  const Entry& operator[](int id) const {
+    return this->chunks[id >> chunk_bits][id & (chunk_size - 1)];
+  }
+
+ private:
+  static constexpr int chunk_bits = 12;
+  static constexpr int chunk_size = 1 << chunk_bits;
+  static constexpr int max_chunks = 1 << 16;
+  std::unique_ptr<std::unique_ptr<Entry[]>[]> chunks;
+  int count = 0;
+  std::mutex mutex;
+  std::unordered_map<std::string, int> ids;
+
+  int insert(const std::string& name) {
+    int id = this->count++;
+    assert((id >> chunk_bits) < max_chunks);
+    auto& chunk = this->chunks[id >> chunk_bits];
+    if (!chunk) chunk.reset(new Entry[chunk_size]);
+    chunk[id & (chunk_size - 1)] = {name, kind_of_name(name)};
+    this->ids.insert({name, id});
+    return id;
+  }
+  static OpName::Kind kind_of_name(const std::string& name) {
+    if (name.starts_with("%&")) return OpName::Kind::LocalArray;
+    if (name.starts_with('%')) return OpName::Kind::Local;
+    if (name.starts_with("@&")) return OpName::Kind::GlobalArray;
+    if (name.starts_with('@')) return OpName::Kind::Global;
+    if (name.starts_with("$arg")) return OpName::Kind::Arg;
+    return OpName::Kind::Other;
+  }
+};
+NameTable& name_table() {
+  static NameTable table;
+  return table;
 }
-bool OpName::is_global_var() const {
-  return this->is_var() && this->name.starts_with('@');
+}  // namespace
+
+int OpName::intern(const std::string& name) {
+  return name_table().intern(name);
 }
-bool OpName::is_imm() const { return this->type == OpName::Type::Imm; }
-bool OpName::is_null() const { return this->type == OpName::Type::Null; }
+const std::string& OpName::name_of(int id) { return name_table()[id].name; }
+OpName::Kind OpName::kind_of(int id) { return name_table()[id].kind; }
 
-bool OpName::operator==(const OpName& other) const {
-  if (this->type != other.type) return false;
-  if (this->is_var()) {
-    return this->name == other.name;
-  } else if (this->is_imm()) {
-    return this->value == other.value;
-  } else {
-    assert(this->is_null());
-    return true;
-  }
+OpName::OpName() : type(OpName::Type::Null), value(0) {}
+OpName::OpName(const std::string& name)
+    : type(OpName::Type::Var), id(OpName::intern(name)) {
+  this->kind = name_table()[this->id].kind;
 }
+OpName::OpName(int value) : type(OpName::Type::Imm), value(value) {}
+const std::string& OpName::name() const { return OpName::name_of(this->id); }
 
 IR::IR(OpCode op_code, OpName dest, OpName op1, OpName op2, OpName op3,
        std::string label)
@@ -89,26 +138,6 @@ IR::IR(OpCode op_code, std::string label)
       label(label) {
   this->setup_file_postion();
 }
-bool IR::some(decltype(&syc::ir::OpName::is_var) callback,
-              bool include_dest) const {
-  return this->some([callback](OpName op) { return (op.*callback)(); },
-                    include_dest);
-}
-bool IR::some(std::function<bool(const syc::ir::OpName&)> callback,
-              bool include_dest) const {
-  return (include_dest && callback(this->dest)) || callback(this->op1) ||
-         callback(this->op2) || callback(this->op3);
-}
-void IR::forEachOp(std::function<void(const syc::ir::OpName&)> callback,
-                   bool include_dest) const {
-  this->some(
-      [callback](const syc::ir::OpName& op) {
-        callback(op);
-        return false;
-      },
-      include_dest);
-}
-
 void IR::print(std::ostream& out, bool verbose) const {
   switch (this->op_code) {
     case OpCode::MALLOC_IN_STACK:
@@ -238,12 +267,36 @@ void IR::print(std::ostream& out, bool verbose) const {
     case OpCode::INFO:
       out << "INFO" << std::string(16 - std::string("INFO").size(), ' ');
       break;
+    case OpCode::VLOAD:
+      out << "VLOAD" << std::string(16 - std::string("VLOAD").size(), ' ');
+      break;
+    case OpCode::VSTORE:
+      out << "VSTORE" << std::string(16 - std::string("VSTORE").size(), ' ');
+      break;
+    case OpCode::VDUP:
+      out << "VDUP" << std::string(16 - std::string("VDUP").size(), ' ');
+      break;
+    case OpCode::VADD:
+      out << "VADD" << std::string(16 - std::string("VADD").size(), ' ');
+      break;
+    case OpCode::VSUB:
+      out << "VSUB" << std::string(16 - std::string("VSUB").size(), ' ');
+      break;
+    case OpCode::VMUL:
+      out << "VMUL" << std::string(16 - std::string("VMUL").size(), ' ');
+      break;
+    case OpCode::VMLA:
+      out << "VMLA" << std::string(16 - std::string("VMLA").size(), ' ');
+      break;
+    case OpCode::VREDUCE:
+      out << "VREDUCE" << std::string(16 - std::string("VREDUCE").size(), ' ');
+      break;
   }
   this->forEachOp([&out](const OpName& op) {
     if (op.is_imm()) {
       out << op.value << '\t';
     } else if (op.is_var()) {
-      out << op.name << '\t';
+      out << op.name() << '\t';
     } else if (op.is_null()) {
       out << '\t';
     }
@@ -16,35 +16,67 @@
  * along with this program.  If not, see <https://www.gnu.org/licenses/>.
  */
 #pragma once
+#include <cstdint>
 #include <functional>
 #include <iostream>
-#include <list>
 #include <string>
 
-#include "ir/generate/context.h"
+#include "ir/pooled_list.h"
 
 namespace syc::ir {
+// 操作数，变量名被驻留为整数 id，打印名保存在全局名称表中
 class OpName {
- protected:
-  enum Type {
+ public:
+  enum Type : std::uint8_t {
     Var,
     Imm,
     Null,
   };
+  // 变量种类，由名称前缀决定
+  enum class Kind : std::uint8_t {
+    None,
+    Local,        // %
+    LocalArray,   // %&
+    Global,       // @
+    GlobalArray,  // @&
+    Arg,          // $arg
+    Other,
+  };
 
- public:
   Type type;
-  std::string name;
-  int value;
+  Kind kind = Kind::None;
+  union {
+    int id;     // Var
+    int value;  // Imm
+  };
   OpName();
-  OpName(std::string name);
+  OpName(const std::string& name);
   OpName(int value);
-  bool is_var() const;
-  bool is_local_var() const;
-  bool is_global_var() const;
-  bool is_imm() const;
-  bool is_null() const;
-  bool operator==(const OpName& other) const;
+  const std::string& name() const;
+  bool is_var() const { return this->type == Type::Var; }
+  bool is_local_var() const {
+    return this->is_var() &&
+           (this->kind == Kind::Local || this->kind == Kind::LocalArray ||
+            this->kind == Kind::Arg);
+  }
+  bool is_global_var() const {
+    return this->is_var() &&
+           (this->kind == Kind::Global || this->kind == Kind::GlobalArray);
+  }
+  bool is_array() const {
+    return this->kind == Kind::LocalArray || this->kind == Kind::GlobalArray;
+  }
+  bool is_imm() const { return this->type == Type::Imm; }
+  bool is_null() const { return this->type == Type::Null; }
+  bool operator==(const OpName& other) const {
+    return this->type == other.type &&
+           (this->is_null() || this->value == other.value);
+  }
+
+  // 驻留名称并返回其 id
+  static int intern(const std::string& name);
+  static const std::string& name_of(int id);
+  static Kind kind_of(int id);
 };
 enum class OpCode {
   MALLOC_IN_STACK,  // dest = offset(new StackArray(size op1))
@@ -87,14 +119,26 @@ enum class OpCode {
   PHI_MOV,          // PHI
   NOOP,             // no operation
   INFO,             // info for compiler
+  // NEON 向量指令，q(n) 为立即数 n 表示的 128 位寄存器，存放 4 个 int
+  VLOAD,            // q(dest) = op1[op2, op2 + 16)
+  VSTORE,           // op1[op2, op2 + 16) = q(op3)
+  VDUP,             // q(dest) 的每个元素 = op1
+  VADD,             // q(dest) = q(op1) + q(op2)
+  VSUB,             // q(dest) = q(op1) - q(op2)
+  VMUL,             // q(dest) = q(op1) * q(op2)
+  VMLA,             // q(dest) += q(op1) * q(op2)
+  VREDUCE,          // dest = q(op1) 的元素之和
 };
+class IR;
+using IRList = PooledList<IR>;
+
 class IR {
  public:
   int line, column;
   OpCode op_code;
   std::string label;
   OpName op1, op2, op3, dest;
-  std::list<IR>::iterator phi_block;
+  IRList::iterator phi_block;
   IR(OpCode op_code, OpName dest, OpName op1, OpName op2, OpName op3,
      std::string label = "");
   IR(OpCode op_code, OpName dest, OpName op1, OpName op2,
@@ -102,17 +146,30 @@ class IR {
   IR(OpCode op_code, OpName dest, OpName op1, std::string label = "");
   IR(OpCode op_code, OpName dest, std::string label = "");
   IR(OpCode op_code, std::string label = "");
-  bool some(decltype(&syc::ir::OpName::is_var) callback,
-            bool include_dest = true) const;
-  bool some(std::function<bool(const syc::ir::OpName&)> callback,
-            bool include_dest = true) const;
-  void forEachOp(std::function<void(const syc::ir::OpName&)> callback,
-                 bool include_dest = true) const;
+  template <typename F>
+  bool some(F&& callback, bool include_dest = true) const {
+    return (include_dest && std::invoke(callback, this->dest)) ||
+           std::invoke(callback, this->op1) ||
+           std::invoke(callback, this->op2) || std::invoke(callback, this->op3);
+  }
+  template <typename F>
+  void forEachOp(F&& callback, bool include_dest = true) const {
+    if (include_dest) callback(this->dest);
+    callback(this->op1);
+    callback(this->op2);
+    callback(this->op3);
+  }
   void print(std::ostream& out = std::cerr, bool verbose = false) const;
 
  protected:
   void setup_file_postion();
 };
 
-using IRList = std::list<IR>;
 }  // namespace syc::ir
+
+template <>
+struct std::hash<syc::ir::OpName> {
+  std::size_t operator()(const syc::ir::OpName& op) const noexcept {
+    return std::size_t(unsigned(op.value)) * 4 + op.type;
+  }
+};
@@ -0,0 +1,193 @@
+/*
+ * syc, a compiler for SysY
+ * Copyright (C) 2020-2021  nzh63, skywf21
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#include "ir/optimize/analysis/alias.h"
+
+#include <algorithm>
+
+namespace syc::ir::analysis {
+namespace {
+// 仿射形式中最多保留的变量数，超过时把变量本身当作整体
+constexpr std::size_t max_terms = 8;
+
+Affine atom(int var) { return {0, {{var, 1}}}; }
+Affine constant(int value) { return {value, {}}; }
+
+// 在 32 位上回绕运算
+int wrap_add(int a, int b) { return int(unsigned(a) + unsigned(b)); }
+int wrap_mul(int a, int b) { return int(unsigned(a) * unsigned(b)); }
+
+Affine add(const Affine& a, const Affine& b, int scale) {
+  Affine ret = a;
+  ret.constant = wrap_add(ret.constant, wrap_mul(b.constant, scale));
+  for (auto [var, coefficient] : b.terms) {
+    int value = wrap_add(ret.terms[var], wrap_mul(coefficient, scale));
+    if (value == 0)
+      ret.terms.erase(var);
+    else
+      ret.terms[var] = value;
+  }
+  return ret;
+}
+Affine multiply(const Affine& a, int scale) {
+  Affine ret{wrap_mul(a.constant, scale), {}};
+  if (scale == 0) return ret;
+  for (auto [var, coefficient] : a.terms) {
+    int value = wrap_mul(coefficient, scale);
+    if (value != 0) ret.terms[var] = value;
+  }
+  return ret;
+}
+}  // namespace
+
+AliasAnalysis::AliasAnalysis(const Function& function,
+                             const ModRefAnalysis& mod_ref)
+    : mod_ref(mod_ref) {
+  for (auto it = function.begin; it != function.end; it++) {
+    if (it->dest.is_var() && it->dest.kind == OpName::Kind::Local) {
+      if (it->op_code == OpCode::PHI_MOV ||
+          !this->def.insert({it->dest.id, &*it}).second)
+        this->multi_def.insert(it->dest.id);
+    }
+    if (it->op_code == OpCode::NOOP || it->op_code == OpCode::INFO) continue;
+    bool is_access =
+        it->op_code == OpCode::LOAD || it->op_code == OpCode::STORE ||
+        it->op_code == OpCode::VLOAD || it->op_code == OpCode::VSTORE;
+    it->forEachOp(
+        [&](const OpName& op) {
+          if (op.is_var() && op.kind == OpName::Kind::LocalArray &&
+              !(is_access && &op == &it->op1))
+            this->escaped.insert(op.id);
+        },
+        false);
+  }
+  for (auto var : this->multi_def) this->def.erase(var);
+}
+
+MemoryBase AliasAnalysis::base_of(const OpName& base) const {
+  if (!base.is_var()) return {MemoryBase::Unknown};
+  switch (base.kind) {
+    case OpName::Kind::LocalArray:
+      return {MemoryBase::LocalArray, base.id};
+    case OpName::Kind::GlobalArray:
+      return {MemoryBase::GlobalArray, base.id};
+    case OpName::Kind::Arg:
+      return {MemoryBase::Argument, base.id};
+    case OpName::Kind::Local:
+      break;
+    default:
+      return {MemoryBase::Unknown};
+  }
+  auto found = this->base.find(base.id);
+  if (found != this->base.end()) return found->second;
+  // 先记为未知，防止沿 MOV 的环无限递归
+  this->base[base.id] = {MemoryBase::Unknown};
+  MemoryBase ret{MemoryBase::Unknown};
+  auto def = this->def.find(base.id);
+  if (def != this->def.end() && def->second->op_code == OpCode::MOV)
+    ret = this->base_of(def->second->op1);
+  return this->base[base.id] = ret;
+}
+
+Affine AliasAnalysis::offset_of(const OpName& offset) const {
+  if (offset.is_imm()) return constant(offset.value);
+  if (!offset.is_var()) return {};
+  auto found = this->affine.find(offset.id);
+  if (found != this->affine.end()) return found->second;
+  auto def = this->def.find(offset.id);
+  if (offset.kind != OpName::Kind::Local || def == this->def.end())
+    return atom(offset.id);
+  this->affine[offset.id] = atom(offset.id);
+  auto ret = this->compute_offset(*def->second);
+  if (ret.terms.size() > max_terms) ret = atom(offset.id);
+  return this->affine[offset.id] = ret;
+}
+
+Affine AliasAnalysis::compute_offset(const IR& ir) const {
+  auto is_constant = [](const Affine& a) { return a.terms.empty(); };
+  switch (ir.op_code) {
+    case OpCode::MOV:
+      return this->offset_of(ir.op1);
+    case OpCode::ADD:
+      return add(this->offset_of(ir.op1), this->offset_of(ir.op2), 1);
+    case OpCode::SUB:
+      return add(this->offset_of(ir.op1), this->offset_of(ir.op2), -1);
+    case OpCode::IMUL: {
+      auto lhs = this->offset_of(ir.op1), rhs = this->offset_of(ir.op2);
+      if (is_constant(lhs)) return multiply(rhs, lhs.constant);
+      if (is_constant(rhs)) return multiply(lhs, rhs.constant);
+      break;
+    }
+    case OpCode::SAL:
+      if (ir.op2.is_imm() && ir.op2.value >= 0 && ir.op2.value < 32)
+        return multiply(this->offset_of(ir.op1), int(1u << ir.op2.value));
+      break;
+    default:
+      break;
+  }
+  return atom(ir.dest.id);
+}
+
+bool AliasAnalysis::may_alias(const MemoryBase& a, const MemoryBase& b) const {
+  auto is_array = [](const MemoryBase& m) {
+    return m.kind == MemoryBase::LocalArray || m.kind == MemoryBase::GlobalArray;
+  };
+  if (is_array(a) && is_array(b)) return a.kind == b.kind && a.id == b.id;
+  // 未逃逸的栈上数组只能通过数组名访问
+  if (a.kind == MemoryBase::LocalArray) return this->escaped.count(a.id) &&
+                                               b.kind == MemoryBase::Unknown;
+  if (b.kind == MemoryBase::LocalArray) return this->escaped.count(b.id) &&
+                                               a.kind == MemoryBase::Unknown;
+  return true;
+}
+
+AliasResult AliasAnalysis::alias(const MemoryLocation& a,
+                                 const MemoryLocation& b) const {
+  if (!this->may_alias(a.base, b.base)) return AliasResult::NoAlias;
+  bool same_object = a.base.kind == b.base.kind && a.base.id == b.base.id &&
+                     (a.base.kind != MemoryBase::Unknown ||
+                      a.base_var == b.base_var);
+  // 变量部分相同时两个偏移相差常数
+  if (!same_object || a.offset.terms != b.offset.terms)
+    return AliasResult::MayAlias;
+  int diff = wrap_add(a.offset.constant, -b.offset.constant);
+  if (diff == 0 && a.size == b.size) return AliasResult::MustAlias;
+  // 访问都按 4 字节对齐
+  if (diff <= -a.size || diff >= b.size) return AliasResult::NoAlias;
+  return AliasResult::MayAlias;
+}
+
+bool AliasAnalysis::call_may_write(const IR& call,
+                                   const MemoryBase& base) const {
+  auto& callee = this->mod_ref.of(call.label);
+  switch (base.kind) {
+    case MemoryBase::LocalArray:
+      // 栈上数组只能作为实参传给被调函数
+      return this->escaped.count(base.id) && callee.writes_arguments();
+    case MemoryBase::GlobalArray:
+      return callee.may_write(base.id) || callee.writes_arguments();
+    default:
+      // 参数或未知的基址可能指向任意全局数组或调用者的数组
+      return callee.writes_arguments() ||
+             std::any_of(callee.writes.begin(), callee.writes.end(),
+                         [](int id) {
+                           return OpName::kind_of(id) ==
+                                  OpName::Kind::GlobalArray;
+                         });
+  }
+}
+}  // namespace syc::ir::analysis
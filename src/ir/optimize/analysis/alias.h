@@ -0,0 +1,104 @@
+/*
+ * syc, a compiler for SysY
+ * Copyright (C) 2020-2021  nzh63, skywf21
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#pragma once
+#include <map>
+#include <unordered_map>
+#include <unordered_set>
+
+#include "ir/ir.h"
+#include "ir/optimize/analysis/cfg.h"
+#include "ir/optimize/analysis/mod_ref.h"
+
+namespace syc::ir::analysis {
+// LOAD/STORE 基址指向的对象
+struct MemoryBase {
+  enum Kind {
+    LocalArray,   // 本函数栈上的数组 %&，id 为数组名
+    GlobalArray,  // 全局数组 @&，id 为数组名
+    Argument,     // 由参数传入的数组，可能是任意全局数组或调用者的数组
+    Unknown,
+  };
+  Kind kind;
+  int id = 0;
+};
+
+// 偏移的仿射形式：constant + Σ 系数 × 变量，按 32 位回绕运算
+struct Affine {
+  int constant = 0;
+  std::map<int, int> terms;  // 变量 id -> 系数，不含系数为 0 的项
+};
+
+// 一次内存访问 base[offset, offset + size)
+struct MemoryLocation {
+  OpName base_var;
+  MemoryBase base;
+  Affine offset;
+  int size = 4;
+};
+
+enum class AliasResult { NoAlias, MayAlias, MustAlias };
+
+// 函数内 LOAD/STORE 的别名分析。
+// 基址沿 MOV 追溯到数组或参数：不同的数组互不重叠，参数传入的数组不会是本函数的
+// 栈上数组；同一对象上的两次访问比较偏移的仿射形式，相差非零常数时互不重叠。
+// 偏移只沿只赋值一次的局部变量展开，PHI 变量作为整体出现在仿射形式中，
+// 因此只有两次访问之间 PHI 变量没有被重新赋值时比较结果才成立。
+// 调用按被调函数的副作用摘要判断会改写哪些对象
+class AliasAnalysis {
+ public:
+  AliasAnalysis(const Function& function, const ModRefAnalysis& mod_ref);
+
+  MemoryBase base_of(const OpName& base) const;
+  Affine offset_of(const OpName& offset) const;
+  MemoryLocation location_of(const OpName& base, const OpName& offset,
+                             int size = 4) const {
+    return {base, this->base_of(base), this->offset_of(offset), size};
+  }
+  // LOAD/STORE 与向量的 VLOAD/VSTORE 访问的内存
+  MemoryLocation location_of(const IR& access) const {
+    bool vector =
+        access.op_code == OpCode::VLOAD || access.op_code == OpCode::VSTORE;
+    return this->location_of(access.op1, access.op2, vector ? 16 : 4);
+  }
+  // 访问 base1[offset1] 与 base2[offset2] 的关系，访问宽度都是 4 字节
+  AliasResult alias(const MemoryLocation& a, const MemoryLocation& b) const;
+  AliasResult alias(const OpName& base1, const OpName& offset1,
+                    const OpName& base2, const OpName& offset2) const {
+    return this->alias(this->location_of(base1, offset1),
+                       this->location_of(base2, offset2));
+  }
+  // 两个对象是否可能重叠，不看偏移
+  bool may_alias(const MemoryBase& a, const MemoryBase& b) const;
+  // 调用 call 是否可能改写 base 指向的对象
+  bool call_may_write(const IR& call, const MemoryBase& base) const;
+  // 变量是否被重新赋值过，即是 PHI_MOV 的目的变量或有多处定值
+  bool is_multi_def(int var) const { return this->multi_def.count(var); }
+
+ private:
+  const ModRefAnalysis& mod_ref;
+  // 只赋值一次的局部变量的定值
+  std::unordered_map<int, const IR*> def;
+  std::unordered_set<int> multi_def;
+  // 地址被传给调用或参与运算的栈上数组
+  std::unordered_set<int> escaped;
+  mutable std::unordered_map<int, Affine> affine;
+  mutable std::unordered_map<int, MemoryBase> base;
+
+  Affine compute_offset(const IR& ir) const;
+};
+}  // namespace syc::ir::analysis
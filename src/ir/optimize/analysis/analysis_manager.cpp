@@ -0,0 +1,52 @@
+/*
+ * syc, a compiler for SysY
+ * Copyright (C) 2020-2021  nzh63, skywf21
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#include "ir/optimize/analysis/analysis_manager.h"
+
+namespace syc::ir::analysis {
+std::vector<Function>& AnalysisManager::functions() {
+  if (!this->cfg)
+    this->cfg = std::make_unique<std::vector<Function>>(build_cfg(*this->ir));
+  return *this->cfg;
+}
+
+const Liveness& AnalysisManager::liveness(const Function& function) {
+  auto& ret = this->live[&function];
+  if (!ret) ret = std::make_unique<Liveness>(function);
+  return *ret;
+}
+
+const AliasAnalysis& AnalysisManager::alias(const Function& function) {
+  auto& ret = this->aliases[&function];
+  if (!ret) ret = std::make_unique<AliasAnalysis>(function, this->mod_ref());
+  return *ret;
+}
+
+const ModRefAnalysis& AnalysisManager::mod_ref() const {
+  static const ModRefAnalysis empty;
+  return this->summary ? *this->summary : empty;
+}
+
+void AnalysisManager::invalidate(unsigned preserved) {
+  // 活跃变量分析依附于控制流图
+  if (!(preserved & PreserveLiveness) || !(preserved & PreserveCFG))
+    this->live.clear();
+  // 别名分析依赖各变量的定值，任何修改都使其失效
+  if (preserved != PreserveAll) this->aliases.clear();
+  if (!(preserved & PreserveCFG)) this->cfg.reset();
+}
+}  // namespace syc::ir::analysis
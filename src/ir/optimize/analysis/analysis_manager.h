@@ -0,0 +1,65 @@
+/*
+ * syc, a compiler for SysY
+ * Copyright (C) 2020-2021  nzh63, skywf21
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#pragma once
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+#include "ir/ir.h"
+#include "ir/optimize/analysis/alias.h"
+#include "ir/optimize/analysis/cfg.h"
+#include "ir/optimize/analysis/liveness.h"
+#include "ir/optimize/analysis/mod_ref.h"
+
+namespace syc::ir::analysis {
+// pass 执行后仍然有效的分析，按位组合
+enum Preserved : unsigned {
+  PreserveNone = 0,
+  // 没有增删指令或改变控制流，基本块的区间与边保持不变
+  PreserveCFG = 1 << 0,
+  PreserveLiveness = 1 << 1,
+  PreserveAll = PreserveCFG | PreserveLiveness,
+};
+
+// 缓存一段 IR 上的分析结果，按需构建，pass 修改 IR 后由 pass 管理器使其失效。
+// 每段 IR 各有一个实例，不同实例可以在不同线程中使用
+class AnalysisManager {
+ public:
+  // mod_ref 为整个程序的副作用摘要，由 pass 管理器更新，为空时调用都视为未知
+  explicit AnalysisManager(IRList& ir, const ModRefAnalysis* mod_ref = nullptr)
+      : ir(&ir), summary(mod_ref) {}
+
+  // 段中每个函数的控制流图
+  std::vector<Function>& functions();
+  // 函数 function 上的活跃变量分析，function 须来自 functions()
+  const Liveness& liveness(const Function& function);
+  // 函数 function 上的别名分析
+  const AliasAnalysis& alias(const Function& function);
+  const ModRefAnalysis& mod_ref() const;
+
+  // 使 preserved 之外的分析失效
+  void invalidate(unsigned preserved);
+
+ private:
+  IRList* ir;
+  const ModRefAnalysis* summary;
+  std::unique_ptr<std::vector<Function>> cfg;
+  std::unordered_map<const Function*, std::unique_ptr<Liveness>> live;
+  std::unordered_map<const Function*, std::unique_ptr<AliasAnalysis>> aliases;
+};
+}  // namespace syc::ir::analysis
@@ -0,0 +1,326 @@
+/*
+ * syc, a compiler for SysY
+ * Copyright (C) 2020-2021  nzh63, skywf21
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#include "ir/optimize/analysis/cfg.h"
+
+#include <algorithm>
+#include <cassert>
+#include <iterator>
+#include <utility>
+
+namespace syc::ir::analysis {
+namespace {
+bool is_jump(OpCode op) {
+  return op == OpCode::JMP || op == OpCode::JEQ || op == OpCode::JNE ||
+         op == OpCode::JLE || op == OpCode::JLT || op == OpCode::JGE ||
+         op == OpCode::JGT;
+}
+bool is_terminator(OpCode op) { return is_jump(op) || op == OpCode::RET; }
+
+template <typename T>
+void add_unique(std::vector<T*>& list, T* value) {
+  if (std::find(list.begin(), list.end(), value) == list.end())
+    list.push_back(value);
+}
+bool by_id(const BasicBlock* a, const BasicBlock* b) { return a->id < b->id; }
+}  // namespace
+
+const std::string& BasicBlock::label() const {
+  static const std::string empty_label;
+  if (!this->empty() && this->begin->op_code == OpCode::LABEL)
+    return this->begin->label;
+  return empty_label;
+}
+
+bool Loop::contains(const BasicBlock* block) const {
+  return std::binary_search(this->blocks.begin(), this->blocks.end(), block,
+                            by_id);
+}
+bool Loop::contains(const Loop* loop) const {
+  for (; loop != nullptr; loop = loop->parent)
+    if (loop == this) return true;
+  return false;
+}
+
+Function::Function(IRList::iterator begin, IRList::iterator end)
+    : begin(begin), end(end), name(begin->label) {
+  assert(begin->op_code == OpCode::FUNCTION_BEGIN);
+  assert(end->op_code == OpCode::FUNCTION_END);
+  this->build_blocks();
+  this->build_edges();
+  this->compute_rpo();
+  this->compute_dominators();
+  this->compute_dominance_frontiers();
+  this->compute_loops();
+}
+
+BasicBlock* Function::block_of_label(const std::string& label) const {
+  auto it = this->label_to_block.find(label);
+  return it == this->label_to_block.end() ? nullptr : it->second;
+}
+BasicBlock* Function::block_of(const IR& ir) const {
+  auto it = this->ir_to_block.find(&ir);
+  return it == this->ir_to_block.end() ? nullptr : it->second;
+}
+bool Function::dominates(const BasicBlock* a, const BasicBlock* b) const {
+  if (!a->reachable() || !b->reachable()) return false;
+  return this->dom_in[a->id] <= this->dom_in[b->id] &&
+         this->dom_out[b->id] <= this->dom_out[a->id];
+}
+
+// 首条指令、每个 LABEL（连续的 LABEL 合为一块）以及跳转或返回之后的指令
+// 开始新的基本块
+void Function::build_blocks() {
+  auto new_block = [this](IRList::iterator it) {
+    auto block = std::make_unique<BasicBlock>();
+    block->id = this->blocks.size();
+    block->begin = block->end = it;
+    this->blocks.push_back(std::move(block));
+  };
+  new_block(std::next(this->begin));
+  bool only_labels = true;
+  for (auto it = std::next(this->begin); it != this->end; it++) {
+    if (it->op_code == OpCode::LABEL) {
+      if (!only_labels) new_block(it);
+      this->label_to_block[it->label] = this->blocks.back().get();
+    } else {
+      only_labels = false;
+    }
+    this->blocks.back()->end = std::next(it);
+    this->ir_to_block[&*it] = this->blocks.back().get();
+    if (is_terminator(it->op_code) && std::next(it) != this->end) {
+      new_block(std::next(it));
+      only_labels = true;
+    }
+  }
+}
+
+void Function::build_edges() {
+  auto link = [](BasicBlock* from, BasicBlock* to) {
+    add_unique(from->successors, to);
+    add_unique(to->predecessors, from);
+  };
+  for (std::size_t i = 0; i < this->blocks.size(); i++) {
+    auto* block = this->blocks[i].get();
+    auto* next = i + 1 < this->blocks.size() ? this->blocks[i + 1].get()
+                                             : nullptr;
+    if (block->empty()) {
+      if (next) link(block, next);
+      continue;
+    }
+    auto& last = *std::prev(block->end);
+    if (is_jump(last.op_code)) {
+      auto* target = this->block_of_label(last.label);
+      assert(target != nullptr);
+      if (target) link(block, target);
+      if (last.op_code != OpCode::JMP && next) link(block, next);
+    } else if (last.op_code != OpCode::RET && next) {
+      link(block, next);
+    }
+  }
+}
+
+void Function::compute_rpo() {
+  std::vector<BasicBlock*> postorder;
+  std::vector<bool> visited(this->blocks.size());
+  // 迭代 DFS，栈中保存块及下一个要访问的后继
+  std::vector<std::pair<BasicBlock*, std::size_t>> stack;
+  stack.push_back({this->entry(), 0});
+  visited[this->entry()->id] = true;
+  while (!stack.empty()) {
+    auto& [block, index] = stack.back();
+    if (index < block->successors.size()) {
+      auto* succ = block->successors[index++];
+      if (!visited[succ->id]) {
+        visited[succ->id] = true;
+        stack.push_back({succ, 0});
+      }
+    } else {
+      postorder.push_back(block);
+      stack.pop_back();
+    }
+  }
+  this->rpo.assign(postorder.rbegin(), postorder.rend());
+  for (std::size_t i = 0; i < this->rpo.size(); i++)
+    this->rpo[i]->rpo_index = i;
+}
+
+// Cooper, Harvey, Kennedy: A Simple, Fast Dominance Algorithm
+void Function::compute_dominators() {
+  auto* entry = this->entry();
+  entry->idom = entry;
+  auto intersect = [](BasicBlock* a, BasicBlock* b) {
+    while (a != b) {
+      while (a->rpo_index > b->rpo_index) a = a->idom;
+      while (b->rpo_index > a->rpo_index) b = b->idom;
+    }
+    return a;
+  };
+  bool changed = true;
+  while (changed) {
+    changed = false;
+    for (auto* block : this->rpo) {
+      if (block == entry) continue;
+      BasicBlock* new_idom = nullptr;
+      for (auto* pred : block->predecessors) {
+        if (pred->idom == nullptr) continue;
+        new_idom = new_idom ? intersect(pred, new_idom) : pred;
+      }
+      if (block->idom != new_idom) {
+        block->idom = new_idom;
+        changed = true;
+      }
+    }
+  }
+  entry->idom = nullptr;
+  for (auto* block : this->rpo)
+    if (block->idom) block->idom->dom_children.push_back(block);
+
+  // 支配树先序编号
+  this->dom_in.assign(this->blocks.size(), -1);
+  this->dom_out.assign(this->blocks.size(), -1);
+  int counter = 0;
+  std::vector<std::pair<BasicBlock*, std::size_t>> stack;
+  stack.push_back({entry, 0});
+  this->dom_in[entry->id] = counter++;
+  while (!stack.empty()) {
+    auto& [block, index] = stack.back();
+    if (index < block->dom_children.size()) {
+      auto* child = block->dom_children[index++];
+      this->dom_in[child->id] = counter++;
+      stack.push_back({child, 0});
+    } else {
+      this->dom_out[block->id] = counter++;
+      stack.pop_back();
+    }
+  }
+}
+
+void Function::compute_dominance_frontiers() {
+  for (auto* block : this->rpo) {
+    // 入口块另有一条来自函数外的隐含边
+    auto count = block->predecessors.size() + (block == this->entry());
+    if (count < 2) continue;
+    for (auto* pred : block->predecessors) {
+      if (!pred->reachable()) continue;
+      for (auto* runner = pred; runner != block->idom; runner = runner->idom)
+        add_unique(runner->dominance_frontier, block);
+    }
+  }
+}
+
+// 回边 latch -> header 满足 header 支配 latch，同一 header 的回边合为一个循环
+void Function::compute_loops() {
+  for (auto* header : this->rpo) {
+    std::vector<BasicBlock*> latches;
+    for (auto* pred : header->predecessors)
+      if (this->dominates(header, pred)) latches.push_back(pred);
+    if (latches.empty()) continue;
+
+    auto loop = std::make_unique<Loop>();
+    loop->header = header;
+    loop->latches = latches;
+    std::vector<bool> in_loop(this->blocks.size());
+    in_loop[header->id] = true;
+    std::vector<BasicBlock*> worklist;
+    for (auto* latch : latches) {
+      if (!in_loop[latch->id]) {
+        in_loop[latch->id] = true;
+        worklist.push_back(latch);
+      }
+    }
+    while (!worklist.empty()) {
+      auto* block = worklist.back();
+      worklist.pop_back();
+      for (auto* pred : block->predecessors) {
+        if (pred->reachable() && !in_loop[pred->id]) {
+          in_loop[pred->id] = true;
+          worklist.push_back(pred);
+        }
+      }
+    }
+    for (auto& block : this->blocks)
+      if (in_loop[block->id]) loop->blocks.push_back(block.get());
+
+    // header 按逆后序处理，外层循环先于内层循环创建
+    for (auto it = this->loops.rbegin(); it != this->loops.rend(); it++) {
+      if ((*it)->contains(header)) {
+        loop->parent = it->get();
+        loop->depth = loop->parent->depth + 1;
+        loop->parent->children.push_back(loop.get());
+        break;
+      }
+    }
+    if (loop->parent == nullptr) this->top_level_loops.push_back(loop.get());
+    for (auto* block : loop->blocks) block->loop = loop.get();
+    this->loops.push_back(std::move(loop));
+  }
+}
+
+void Function::print(std::ostream& out) const {
+  auto print_list = [&out](const std::vector<BasicBlock*>& list) {
+    out << "{";
+    for (std::size_t i = 0; i < list.size(); i++)
+      out << (i ? " " : "") << list[i]->id;
+    out << "}";
+  };
+  out << "function " << this->name << std::endl;
+  for (auto& block : this->blocks) {
+    out << "  block " << block->id;
+    if (!block->label().empty()) out << " " << block->label();
+    if (!block->reachable()) out << " (unreachable)";
+    out << std::endl << "    preds ";
+    print_list(block->predecessors);
+    out << " succs ";
+    print_list(block->successors);
+    out << " idom ";
+    if (block->idom)
+      out << block->idom->id;
+    else
+      out << "-";
+    out << " df ";
+    print_list(block->dominance_frontier);
+    if (block->loop) out << " loop " << block->loop->header->id;
+    out << std::endl;
+    for (auto it = block->begin; it != block->end; it++) {
+      out << "    ";
+      it->print(out);
+    }
+  }
+  for (auto& loop : this->loops) {
+    out << "  loop " << loop->header->id << " depth " << loop->depth
+        << " latches ";
+    print_list(loop->latches);
+    out << " blocks ";
+    print_list(loop->blocks);
+    out << std::endl;
+  }
+}
+
+std::vector<Function> build_cfg(IRList& ir) {
+  std::vector<Function> ret;
+  IRList::iterator function_begin;
+  for (auto it = ir.begin(); it != ir.end(); it++) {
+    if (it->op_code == OpCode::FUNCTION_BEGIN) {
+      function_begin = it;
+    } else if (it->op_code == OpCode::FUNCTION_END) {
+      ret.emplace_back(function_begin, it);
+    }
+  }
+  return ret;
+}
+}  // namespace syc::ir::analysis
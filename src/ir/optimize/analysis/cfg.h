@@ -0,0 +1,113 @@
+/*
+ * syc, a compiler for SysY
+ * Copyright (C) 2020-2021  nzh63, skywf21
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#pragma once
+#include <memory>
+#include <ostream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "ir/ir.h"
+
+namespace syc::ir::analysis {
+class Loop;
+
+// 基本块，覆盖 IR 区间 [begin, end)
+class BasicBlock {
+ public:
+  int id;  // 在 Function::blocks 中的下标，按源码顺序
+  IRList::iterator begin, end;
+  std::vector<BasicBlock*> predecessors, successors;
+
+  // 逆后序中的位置，不可达的块为 -1
+  int rpo_index = -1;
+  // 直接支配者，入口块与不可达的块为 nullptr
+  BasicBlock* idom = nullptr;
+  std::vector<BasicBlock*> dom_children;
+  std::vector<BasicBlock*> dominance_frontier;
+  // 包含该块的最内层循环
+  Loop* loop = nullptr;
+
+  bool reachable() const { return this->rpo_index >= 0; }
+  bool empty() const { return this->begin == this->end; }
+  // 块的首个 LABEL，没有时返回空串
+  const std::string& label() const;
+};
+
+// 自然循环
+class Loop {
+ public:
+  BasicBlock* header;
+  // 循环内的块（含内层循环），按源码顺序
+  std::vector<BasicBlock*> blocks;
+  // 回边的起点
+  std::vector<BasicBlock*> latches;
+  Loop* parent = nullptr;
+  std::vector<Loop*> children;
+  int depth = 1;
+
+  bool contains(const BasicBlock* block) const;
+  bool contains(const Loop* loop) const;
+};
+
+// 函数的控制流图，在其上计算支配树、支配边界与循环嵌套。
+// 构建后 IR 的控制流（标号与跳转）发生变化时需要重新构建
+class Function {
+ public:
+  // begin 指向 FUNCTION_BEGIN，end 指向对应的 FUNCTION_END
+  Function(IRList::iterator begin, IRList::iterator end);
+  Function(const Function&) = delete;
+  Function& operator=(const Function&) = delete;
+  Function(Function&&) = default;
+  Function& operator=(Function&&) = default;
+
+  IRList::iterator begin, end;
+  std::string name;
+  // 按源码顺序，blocks[0] 为入口块
+  std::vector<std::unique_ptr<BasicBlock>> blocks;
+  // 可达块的逆后序
+  std::vector<BasicBlock*> rpo;
+  // 外层循环在前
+  std::vector<std::unique_ptr<Loop>> loops;
+  std::vector<Loop*> top_level_loops;
+
+  BasicBlock* entry() const { return this->blocks.front().get(); }
+  BasicBlock* block_of_label(const std::string& label) const;
+  BasicBlock* block_of(const IR& ir) const;
+  // a 是否支配 b（包括 a == b），不可达的块不被任何块支配
+  bool dominates(const BasicBlock* a, const BasicBlock* b) const;
+
+  void print(std::ostream& out = std::cerr) const;
+
+ private:
+  std::unordered_map<std::string, BasicBlock*> label_to_block;
+  std::unordered_map<const IR*, BasicBlock*> ir_to_block;
+  // 支配树的先序进入与退出编号，用于 O(1) 判断支配关系
+  std::vector<int> dom_in, dom_out;
+
+  void build_blocks();
+  void build_edges();
+  void compute_rpo();
+  void compute_dominators();
+  void compute_dominance_frontiers();
+  void compute_loops();
+};
+
+// 为 ir 中的每个函数构建控制流图，按源码顺序
+std::vector<Function> build_cfg(IRList& ir);
+}  // namespace syc::ir::analysis
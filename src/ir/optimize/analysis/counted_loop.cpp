@@ -0,0 +1,281 @@
+/*
+ * syc, a compiler for SysY
+ * Copyright (C) 2020-2021  nzh63, skywf21
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#include "ir/optimize/analysis/counted_loop.h"
+
+#include <string>
+
+namespace syc::ir::analysis {
+namespace {
+bool is_cond_jump(OpCode op_code) {
+  return op_code == OpCode::JEQ || op_code == OpCode::JNE ||
+         op_code == OpCode::JLE || op_code == OpCode::JLT ||
+         op_code == OpCode::JGE || op_code == OpCode::JGT;
+}
+bool is_jump(OpCode op_code) {
+  return op_code == OpCode::JMP || is_cond_jump(op_code);
+}
+
+// 条件跳转 op 不跳转时 lhs 与 rhs 满足的关系
+std::optional<Relation> relation_of(OpCode op, bool swapped) {
+  std::optional<Relation> ret;
+  switch (op) {
+    case OpCode::JGE:
+      ret = Relation::LT;
+      break;
+    case OpCode::JGT:
+      ret = Relation::LE;
+      break;
+    case OpCode::JLE:
+      ret = Relation::GT;
+      break;
+    case OpCode::JLT:
+      ret = Relation::GE;
+      break;
+    default:
+      return std::nullopt;
+  }
+  if (swapped) {
+    switch (*ret) {
+      case Relation::LT:
+        return Relation::GT;
+      case Relation::LE:
+        return Relation::GE;
+      case Relation::GT:
+        return Relation::LT;
+      case Relation::GE:
+        return Relation::LE;
+    }
+  }
+  return ret;
+}
+}  // namespace
+
+OpCode exit_jump(Relation relation) {
+  switch (relation) {
+    case Relation::LT:
+      return OpCode::JGE;
+    case Relation::LE:
+      return OpCode::JGT;
+    case Relation::GT:
+      return OpCode::JLE;
+    case Relation::GE:
+      return OpCode::JLT;
+  }
+  return OpCode::JMP;
+}
+bool holds(Relation relation, int lhs, int rhs) {
+  switch (relation) {
+    case Relation::LT:
+      return lhs < rhs;
+    case Relation::LE:
+      return lhs <= rhs;
+    case Relation::GT:
+      return lhs > rhs;
+    case Relation::GE:
+      return lhs >= rhs;
+  }
+  return false;
+}
+
+bool CountedLoop::has_marker(std::string_view marker) const {
+  for (auto it = std::next(this->header); it != this->body; it++) {
+    if (it->op_code == OpCode::INFO && it->label == marker) return true;
+  }
+  return false;
+}
+
+std::optional<int> CountedLoop::initial_value(int var) const {
+  for (auto it = this->preheader->end; it != this->preheader->begin;) {
+    it--;
+    if (!it->dest.is_var() || it->dest.id != var) continue;
+    if ((it->op_code == OpCode::MOV || it->op_code == OpCode::PHI_MOV) &&
+        it->op1.is_imm())
+      return it->op1.value;
+    return std::nullopt;
+  }
+  return std::nullopt;
+}
+
+CountedLoops::CountedLoops(IRList& ir, const Function& function)
+    : ir(ir), function(function) {
+  int position = 0;
+  for (auto it = function.begin; it != function.end; it++)
+    this->position[&*it] = position++;
+}
+
+std::optional<CountedLoop> CountedLoops::analyze(Loop* loop) const {
+  if (loop->latches.size() != 1 || loop->latches.front() != loop->blocks.back())
+    return std::nullopt;
+  CountedLoop ret;
+  ret.loop = loop;
+  auto* header = loop->header;
+  auto* latch = loop->latches.front();
+  ret.header = header->begin;
+  ret.jump = std::prev(latch->end);
+  if (ret.header->op_code != OpCode::LABEL ||
+      ret.jump->op_code != OpCode::JMP ||
+      ret.jump->label != ret.header->label)
+    return std::nullopt;
+
+  // 头部只有比较与条件跳转
+  IRList::iterator cmp = this->ir.end(), branch = this->ir.end();
+  for (auto it = std::next(header->begin); it != header->end; it++) {
+    if (it->op_code == OpCode::NOOP || it->op_code == OpCode::INFO) continue;
+    if (it->op_code == OpCode::CMP && cmp == this->ir.end()) {
+      cmp = it;
+    } else if (is_cond_jump(it->op_code) && cmp != this->ir.end() &&
+               branch == this->ir.end() && std::prev(it) == cmp) {
+      branch = it;
+    } else {
+      return std::nullopt;
+    }
+  }
+  if (branch == this->ir.end() || std::next(branch) != header->end)
+    return std::nullopt;
+  ret.body = header->end;
+
+  BasicBlock* exit = nullptr;
+  for (auto* succ : header->successors) {
+    if (!loop->contains(succ)) exit = succ;
+  }
+  if (!exit) return std::nullopt;
+  ret.exit = exit->begin;
+  while (ret.exit != exit->end && !(ret.exit->op_code == OpCode::LABEL &&
+                                     ret.exit->label == branch->label))
+    ret.exit++;
+  if (ret.exit == exit->end) return std::nullopt;
+
+  // 前置块直接落入头部
+  ret.preheader = nullptr;
+  for (auto* pred : header->predecessors) {
+    if (!pred->reachable() || loop->contains(pred)) continue;
+    if (ret.preheader) return std::nullopt;
+    ret.preheader = pred;
+  }
+  if (!ret.preheader || ret.preheader->empty() ||
+      ret.preheader->end != header->begin ||
+      ret.preheader->successors.size() != 1 ||
+      is_jump(std::prev(ret.preheader->end)->op_code))
+    return std::nullopt;
+
+  // 循环占据 [header, jump] 这段连续的指令，且只从头部退出
+  int first = this->position.at(&*ret.header),
+      last = this->position.at(&*ret.jump);
+  for (auto& block : this->function.blocks) {
+    if (block->empty()) continue;
+    int pos = this->position.at(&*block->begin);
+    bool inside = pos >= first && pos <= last;
+    if (loop->contains(block.get()) != inside &&
+        (inside ? block->reachable() : true))
+      return std::nullopt;
+    if (!loop->contains(block.get()) || block.get() == header) continue;
+    for (auto* succ : block->successors)
+      if (!loop->contains(succ)) return std::nullopt;
+  }
+
+  // 回边上给循环变量赋值的 PHI_MOV
+  ret.tail = ret.jump;
+  while (ret.tail != ret.body) {
+    auto prev = std::prev(ret.tail);
+    if (prev->op_code == OpCode::PHI_MOV && prev->phi_block == ret.header) {
+      ret.phi_moves.insert(ret.phi_moves.begin(), prev);
+    } else if (prev->op_code != OpCode::NOOP &&
+               prev->op_code != OpCode::INFO) {
+      break;
+    }
+    ret.tail = prev;
+  }
+  for (auto it : ret.phi_moves) {
+    if (it->dest.kind != OpName::Kind::Local ||
+        !ret.loop_vars.insert(it->dest.id).second)
+      return std::nullopt;
+  }
+
+  std::unordered_set<std::string> label_names;
+  for (auto it = ret.body; it != ret.tail; it++)
+    if (it->op_code == OpCode::LABEL) label_names.insert(it->label);
+  for (auto it = ret.body; it != ret.tail; it++) {
+    switch (it->op_code) {
+      case OpCode::RET:
+      case OpCode::MALLOC_IN_STACK:
+        return std::nullopt;
+      case OpCode::CALL:
+        ret.has_call = true;
+        break;
+      case OpCode::PHI_MOV:
+        if (it->phi_block == ret.header) return std::nullopt;
+        break;
+      default:
+        if (is_jump(it->op_code) && !label_names.count(it->label))
+          return std::nullopt;
+        break;
+    }
+    if (it->op_code != OpCode::LABEL && it->op_code != OpCode::NOOP &&
+        it->op_code != OpCode::INFO)
+      ret.size++;
+    if (!it->dest.is_var()) continue;
+    if (it->dest.kind != OpName::Kind::Local ||
+        ret.loop_vars.count(it->dest.id))
+      return std::nullopt;
+    ret.body_vars.insert(it->dest.id);
+  }
+  ret.size += ret.phi_moves.size();
+
+  // 归纳变量与循环不变的边界
+  bool swapped = !(cmp->op1.is_var() && ret.loop_vars.count(cmp->op1.id));
+  ret.var = swapped ? cmp->op2 : cmp->op1;
+  ret.bound = swapped ? cmp->op1 : cmp->op2;
+  if (!ret.var.is_var() || !ret.loop_vars.count(ret.var.id))
+    return std::nullopt;
+  if (ret.bound.is_var() &&
+      (ret.bound.kind != OpName::Kind::Local ||
+       ret.loop_vars.count(ret.bound.id) ||
+       ret.body_vars.count(ret.bound.id)))
+    return std::nullopt;
+  auto relation = relation_of(branch->op_code, swapped);
+  if (!relation) return std::nullopt;
+  ret.relation = *relation;
+
+  OpName next;
+  for (auto it : ret.phi_moves) {
+    if (it->dest == ret.var) next = it->op1;
+  }
+  if (!next.is_var() || !ret.body_vars.count(next.id)) return std::nullopt;
+  const IR* def = nullptr;
+  for (auto it = ret.body; it != ret.tail; it++) {
+    if (it->dest == next) {
+      if (def) return std::nullopt;
+      def = &*it;
+    }
+  }
+  if (def->op_code == OpCode::ADD && def->op1 == ret.var && def->op2.is_imm())
+    ret.step = def->op2.value;
+  else if (def->op_code == OpCode::ADD && def->op2 == ret.var &&
+           def->op1.is_imm())
+    ret.step = def->op1.value;
+  else if (def->op_code == OpCode::SUB && def->op1 == ret.var &&
+           def->op2.is_imm() && def->op2.value != INT32_MIN)
+    ret.step = -def->op2.value;
+  else
+    return std::nullopt;
+  bool increasing =
+      ret.relation == Relation::LT || ret.relation == Relation::LE;
+  if (increasing ? ret.step <= 0 : ret.step >= 0) return std::nullopt;
+  return ret;
+}
+}  // namespace syc::ir::analysis
@@ -0,0 +1,72 @@
+/*
+ * syc, a compiler for SysY
+ * Copyright (C) 2020-2021  nzh63, skywf21
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#pragma once
+#include <optional>
+#include <string_view>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "ir/ir.h"
+#include "ir/optimize/analysis/cfg.h"
+
+namespace syc::ir::analysis {
+// 循环继续执行的条件 var rel bound
+enum class Relation { LT, LE, GT, GE };
+
+// var rel bound 不成立时跳出的条件跳转
+OpCode exit_jump(Relation relation);
+bool holds(Relation relation, int lhs, int rhs);
+
+// 形如下图的循环，循环变量只在回边上由 PHI_MOV 赋值，
+// 归纳变量每次迭代增加常数 step，只在头部判断是否退出。body 中可以有内层循环
+//   header:    LABEL; CMP var bound; J<cc> exit
+//   body:      ...
+//   tail:      PHI_MOV 循环变量 ...; JMP header
+struct CountedLoop {
+  Loop* loop;
+  BasicBlock* preheader;
+  IRList::iterator header, body, tail, jump, exit;
+  std::vector<IRList::iterator> phi_moves;
+  // 在回边上被赋值的循环变量，以及只在循环体内被赋值的变量
+  std::unordered_set<int> loop_vars, body_vars;
+  OpName var, bound;
+  int step;
+  Relation relation;
+  int size = 0;
+  bool has_call = false;
+
+  // 头部是否带有 INFO marker，变换过的循环以此标记
+  bool has_marker(std::string_view marker) const;
+  // 进入循环时变量 var 的常数值：前置块中最后一次赋值为常数
+  std::optional<int> initial_value(int var) const;
+};
+
+// 识别函数中的计数循环
+class CountedLoops {
+ public:
+  CountedLoops(IRList& ir, const Function& function);
+
+  std::optional<CountedLoop> analyze(Loop* loop) const;
+
+ private:
+  IRList& ir;
+  const Function& function;
+  std::unordered_map<const IR*, int> position;
+};
+}  // namespace syc::ir::analysis
@@ -0,0 +1,201 @@
+/*
+ * syc, a compiler for SysY
+ * Copyright (C) 2020-2021  nzh63, skywf21
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#include "ir/optimize/analysis/liveness.h"
+
+#include <algorithm>
+#include <iterator>
+
+namespace syc::ir::analysis {
+bool BitVector::merge(const BitVector& other) {
+  bool changed = false;
+  for (std::size_t i = 0; i < this->words.size(); i++) {
+    auto word = this->words[i] | other.words[i];
+    changed |= word != this->words[i];
+    this->words[i] = word;
+  }
+  return changed;
+}
+void BitVector::subtract(const BitVector& other) {
+  for (std::size_t i = 0; i < this->words.size(); i++)
+    this->words[i] &= ~other.words[i];
+}
+
+Liveness::Liveness(const Function& function,
+                   std::function<bool(const OpName&)> filter)
+    : function(function), filter(std::move(filter)) {
+  for (auto it = std::next(function.begin); it != function.end; it++) {
+    it->forEachOp([this](const OpName& op) {
+      if (op.is_var() && this->filter(op) && !this->var_to_index.count(op.id)) {
+        this->var_to_index[op.id] = this->index_to_var.size();
+        this->index_to_var.push_back(op.id);
+      }
+    });
+  }
+
+  auto n = function.blocks.size();
+  auto size = this->index_to_var.size();
+  std::vector<BitVector> gen(n, BitVector(size)), kill(n, BitVector(size));
+  for (auto& block : function.blocks) {
+    auto& g = gen[block->id];
+    auto& k = kill[block->id];
+    for (auto it = block->begin; it != block->end; it++) {
+      this->for_each_use(*it, [&](int i) {
+        if (!k.test(i)) g.set(i);
+      });
+      this->for_each_def(*it, [&](int i) { k.set(i); });
+    }
+  }
+
+  // 逆向问题按逆后序的反序迭代收敛最快，不可达的块放在最后
+  std::vector<BasicBlock*> order(function.rpo.rbegin(), function.rpo.rend());
+  for (auto& block : function.blocks)
+    if (!block->reachable()) order.push_back(block.get());
+
+  this->in.assign(n, BitVector(size));
+  this->out.assign(n, BitVector(size));
+  bool changed = true;
+  while (changed) {
+    changed = false;
+    for (auto* block : order) {
+      auto& out = this->out[block->id];
+      for (auto* succ : block->successors) out.merge(this->in[succ->id]);
+      BitVector in = out;
+      in.subtract(kill[block->id]);
+      in.merge(gen[block->id]);
+      if (!(in == this->in[block->id])) {
+        this->in[block->id] = std::move(in);
+        changed = true;
+      }
+    }
+  }
+}
+
+int Liveness::index_of(int var) const {
+  auto it = this->var_to_index.find(var);
+  return it == this->var_to_index.end() ? -1 : it->second;
+}
+
+int Liveness::pressure(const BasicBlock* block) const {
+  auto live = this->live_out(block);
+  int ret = live.count();
+  for (auto it = block->end; it != block->begin;) {
+    it--;
+    this->for_each_def(*it, [&](int i) { live.reset(i); });
+    this->for_each_use(*it, [&](int i) { live.set(i); });
+    ret = std::max(ret, int(live.count()));
+  }
+  return ret;
+}
+
+void Liveness::for_each_use(const IR& ir,
+                            const std::function<void(int)>& f) const {
+  if (ir.op_code == OpCode::NOOP || ir.op_code == OpCode::INFO ||
+      ir.op_code == OpCode::MALLOC_IN_STACK)
+    return;
+  ir.forEachOp(
+      [&](const OpName& op) {
+        if (op.is_var() && this->filter(op)) f(this->var_to_index.at(op.id));
+      },
+      false);
+}
+void Liveness::for_each_def(const IR& ir,
+                            const std::function<void(int)>& f) const {
+  if (ir.op_code == OpCode::NOOP || ir.op_code == OpCode::INFO ||
+      ir.op_code == OpCode::MALLOC_IN_STACK)
+    return;
+  if (ir.dest.is_var() && this->filter(ir.dest))
+    f(this->var_to_index.at(ir.dest.id));
+}
+
+bool LiveInterval::overlaps(int start, int end) const {
+  auto it = std::lower_bound(
+      this->segments.begin(), this->segments.end(), start,
+      [](const std::pair<int, int>& seg, int t) { return seg.second <= t; });
+  return it != this->segments.end() && it->first < end;
+}
+
+void LiveInterval::add(int start, int end) {
+  auto it = std::lower_bound(
+      this->segments.begin(), this->segments.end(), start,
+      [](const std::pair<int, int>& seg, int t) { return seg.second + 1 < t; });
+  auto last = it;
+  while (last != this->segments.end() && last->first <= end + 1) {
+    start = std::min(start, last->first);
+    end = std::max(end, last->second);
+    last++;
+  }
+  it = this->segments.erase(it, last);
+  this->segments.insert(it, {start, end});
+}
+
+std::unordered_map<int, LiveInterval> build_live_intervals(
+    const Function& function, const Liveness& liveness,
+    const std::unordered_map<IR*, int>& time) {
+  auto& vars = liveness.vars();
+  std::vector<std::vector<std::pair<int, int>>> segments(vars.size());
+  // 块内已知活跃的变量及其区间终点
+  std::vector<int> open_end(vars.size(), -1);
+  std::vector<int> open;
+  auto set_open = [&](int i, int t) {
+    if (open_end[i] == -1) {
+      open_end[i] = t;
+      open.push_back(i);
+    }
+  };
+  for (auto& block : function.blocks) {
+    if (block->empty()) continue;
+    int first = time.at(&*block->begin);
+    int last = time.at(&*std::prev(block->end));
+    liveness.live_out(block.get()).for_each([&](int i) { set_open(i, last); });
+    for (auto it = std::prev(block->end);; it--) {
+      int t = time.at(&*it);
+      liveness.for_each_def(*it, [&](int i) {
+        segments[i].push_back({t, open_end[i] == -1 ? t : open_end[i]});
+        open_end[i] = -1;
+      });
+      liveness.for_each_use(*it, [&](int i) { set_open(i, t); });
+      if (it == block->begin) break;
+    }
+    // 块入口处活跃的变量在首条指令执行前已占用寄存器，区间从前一个编号开始
+    for (int i : open) {
+      if (open_end[i] != -1) {
+        segments[i].push_back({first - 1, open_end[i]});
+        open_end[i] = -1;
+      }
+    }
+    open.clear();
+  }
+
+  std::unordered_map<int, LiveInterval> ret;
+  for (std::size_t i = 0; i < vars.size(); i++) {
+    if (segments[i].empty()) continue;
+    std::sort(segments[i].begin(), segments[i].end());
+    auto& interval = ret[vars[i]];
+    for (auto& [start, end] : segments[i]) {
+      if (!interval.segments.empty() &&
+          start <= interval.segments.back().second + 1) {
+        interval.segments.back().second =
+            std::max(interval.segments.back().second, end);
+      } else {
+        interval.segments.push_back({start, end});
+      }
+    }
+  }
+  return ret;
+}
+}  // namespace syc::ir::analysis
@@ -0,0 +1,115 @@
+/*
+ * syc, a compiler for SysY
+ * Copyright (C) 2020-2021  nzh63, skywf21
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#pragma once
+#include <cstdint>
+#include <functional>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "ir/ir.h"
+#include "ir/optimize/analysis/cfg.h"
+
+namespace syc::ir::analysis {
+// 定长位向量
+class BitVector {
+ public:
+  BitVector() = default;
+  explicit BitVector(std::size_t size) : words((size + 63) / 64) {}
+
+  bool test(std::size_t i) const { return this->words[i / 64] >> (i % 64) & 1; }
+  void set(std::size_t i) { this->words[i / 64] |= std::uint64_t(1) << (i % 64); }
+  void reset(std::size_t i) {
+    this->words[i / 64] &= ~(std::uint64_t(1) << (i % 64));
+  }
+  // 并入 other，返回是否发生变化
+  bool merge(const BitVector& other);
+  void subtract(const BitVector& other);
+  // 置位的个数
+  std::size_t count() const {
+    std::size_t ret = 0;
+    for (auto word : this->words) ret += __builtin_popcountll(word);
+    return ret;
+  }
+  bool operator==(const BitVector& other) const {
+    return this->words == other.words;
+  }
+  template <typename F>
+  void for_each(F&& callback) const {
+    for (std::size_t i = 0; i < this->words.size(); i++)
+      for (auto word = this->words[i]; word != 0; word &= word - 1)
+        callback(i * 64 + __builtin_ctzll(word));
+  }
+
+ private:
+  std::vector<std::uint64_t> words;
+};
+
+// 函数内的活跃变量分析，在 CFG 上迭代求解位向量数据流方程。
+// 只分析 filter 为真的变量；NOOP、INFO 与 MALLOC_IN_STACK 不视为读写
+class Liveness {
+ public:
+  Liveness(const Function& function,
+           std::function<bool(const OpName&)> filter = &OpName::is_local_var);
+
+  // 参与分析的变量 id 与位下标的对应关系
+  const std::vector<int>& vars() const { return this->index_to_var; }
+  int index_of(int var) const;
+
+  const BitVector& live_in(const BasicBlock* block) const {
+    return this->in[block->id];
+  }
+  const BitVector& live_out(const BasicBlock* block) const {
+    return this->out[block->id];
+  }
+
+  // 块内同时活跃的变量数的最大值
+  int pressure(const BasicBlock* block) const;
+
+  // 指令 ir 读取与写入的变量（位下标）
+  void for_each_use(const IR& ir, const std::function<void(int)>& f) const;
+  void for_each_def(const IR& ir, const std::function<void(int)>& f) const;
+
+ private:
+  const Function& function;
+  std::function<bool(const OpName&)> filter;
+  std::vector<int> index_to_var;
+  std::unordered_map<int, int> var_to_index;
+  std::vector<BitVector> in, out;
+};
+
+// 变量在线性指令编号上的活跃区间，由若干不相交的闭区间组成，区间之间为空洞
+class LiveInterval {
+ public:
+  std::vector<std::pair<int, int>> segments;
+
+  int start() const { return this->segments.front().first; }
+  int end() const { return this->segments.back().second; }
+  // 是否在 (start, end) 内活跃，端点相接不算重叠
+  bool overlaps(int start, int end) const;
+  // 加入区间 [start, end]，与已有区间重叠或相接时合并
+  void add(int start, int end);
+};
+
+// 由活跃变量分析求出各变量的活跃区间，time 给出每条指令的线性编号，
+// 同一基本块内的编号须连续递增。同一条指令读取的变量与写入的变量可以共用寄存器，
+// 因此区间从定值处开始、到最后一次读取处结束；定值点即使之后不再使用也计入区间
+std::unordered_map<int, LiveInterval> build_live_intervals(
+    const Function& function, const Liveness& liveness,
+    const std::unordered_map<IR*, int>& time);
+}  // namespace syc::ir::analysis
@@ -0,0 +1,174 @@
+/*
+ * syc, a compiler for SysY
+ * Copyright (C) 2020-2021  nzh63, skywf21
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#include "ir/optimize/analysis/mod_ref.h"
+
+#include "ir/optimize/analysis/alias.h"
+#include "ir/optimize/analysis/analysis_manager.h"
+
+namespace syc::ir::analysis {
+namespace {
+// 库函数的摘要，memset 只由数组初始化生成
+const std::unordered_map<std::string, ModRef>& library() {
+  static const auto ret = [] {
+    ModRef io, get_array, put_array, memset;
+    io.io = true;
+    get_array = put_array = io;
+    get_array.written_arguments = {0};
+    put_array.read_arguments = {1};
+    memset.written_arguments = {0};
+    return std::unordered_map<std::string, ModRef>{
+        {"getint", io},
+        {"getch", io},
+        {"getarray", get_array},
+        {"putint", io},
+        {"putch", io},
+        {"putarray", put_array},
+        {"printf", io},
+        {"_sysy_starttime", io},
+        {"_sysy_stoptime", io},
+        {"memset", memset},
+    };
+  }();
+  return ret;
+}
+
+const ModRef& unknown() {
+  static const auto ret = [] {
+    ModRef ret;
+    ret.io = ret.unknown = true;
+    return ret;
+  }();
+  return ret;
+}
+
+int argument_index(int id) { return std::stoi(OpName::name_of(id).substr(4)); }
+
+// 访问 base 指向的对象，written 表示写
+void access(ModRef& mod_ref, const MemoryBase& base, bool written) {
+  switch (base.kind) {
+    case MemoryBase::LocalArray:
+      break;
+    case MemoryBase::GlobalArray:
+      (written ? mod_ref.writes : mod_ref.reads).insert(base.id);
+      break;
+    case MemoryBase::Argument:
+      (written ? mod_ref.written_arguments : mod_ref.read_arguments)
+          .insert(argument_index(base.id));
+      break;
+    case MemoryBase::Unknown:
+      mod_ref.unknown = true;
+      break;
+  }
+}
+
+// 一处调用，args 为各实参指向的对象
+struct CallSite {
+  std::string callee;
+  std::vector<MemoryBase> args;
+};
+
+// 把调用 site 的副作用合并到调用者的摘要 to 中
+void merge(ModRef& to, const ModRef& callee, const CallSite& site) {
+  to.io |= callee.io;
+  to.unknown |= callee.unknown;
+  to.reads.insert(callee.reads.begin(), callee.reads.end());
+  to.writes.insert(callee.writes.begin(), callee.writes.end());
+  auto argument = [&](int index) {
+    if (index < int(site.args.size())) return site.args[index];
+    return MemoryBase{MemoryBase::Unknown};
+  };
+  for (auto index : callee.read_arguments) access(to, argument(index), false);
+  for (auto index : callee.written_arguments)
+    access(to, argument(index), true);
+}
+}  // namespace
+
+ModRefAnalysis::ModRefAnalysis(const std::vector<IRList>& segments,
+                               std::vector<AnalysisManager>& analyses) {
+  // 各函数自身的读写与其中的调用
+  std::vector<std::pair<std::string, std::vector<CallSite>>> functions;
+  std::unordered_map<std::string, ModRef> local;
+  for (std::size_t i = 0; i < segments.size(); i++) {
+    if (segments[i].empty() ||
+        segments[i].front().op_code != OpCode::FUNCTION_BEGIN)
+      continue;
+    for (auto& function : analyses[i].functions()) {
+      auto& alias = analyses[i].alias(function);
+      auto& mod_ref = local[function.name];
+      std::vector<CallSite> calls;
+      std::vector<MemoryBase> args;
+      for (auto it = function.begin; it != function.end; it++) {
+        if (it->op_code == OpCode::NOOP || it->op_code == OpCode::INFO)
+          continue;
+        if (it->dest.is_var() && it->dest.kind == OpName::Kind::Global)
+          mod_ref.writes.insert(it->dest.id);
+        it->forEachOp(
+            [&](const OpName& op) {
+              if (op.is_var() && op.kind == OpName::Kind::Global)
+                mod_ref.reads.insert(op.id);
+            },
+            false);
+        switch (it->op_code) {
+          case OpCode::LOAD:
+          case OpCode::VLOAD:
+            access(mod_ref, alias.base_of(it->op1), false);
+            break;
+          case OpCode::STORE:
+          case OpCode::VSTORE:
+            access(mod_ref, alias.base_of(it->op1), true);
+            break;
+          case OpCode::SET_ARG:
+            if (int(args.size()) <= it->dest.value)
+              args.resize(it->dest.value + 1, {MemoryBase::Unknown});
+            args[it->dest.value] = alias.base_of(it->op1);
+            break;
+          case OpCode::CALL:
+            calls.push_back({it->label, std::move(args)});
+            args.clear();
+            break;
+          default:
+            break;
+        }
+      }
+      functions.push_back({function.name, std::move(calls)});
+    }
+  }
+  this->summaries = local;
+
+  // 摘要只会增大，迭代到不动点
+  for (bool changed = true; changed;) {
+    changed = false;
+    for (auto& [name, calls] : functions) {
+      auto summary = local[name];
+      for (auto& site : calls) merge(summary, this->of(site.callee), site);
+      auto& old = this->summaries[name];
+      if (summary == old) continue;
+      old = std::move(summary);
+      changed = true;
+    }
+  }
+}
+
+const ModRef& ModRefAnalysis::of(const std::string& function) const {
+  auto it = this->summaries.find(function);
+  if (it != this->summaries.end()) return it->second;
+  auto library_it = library().find(function);
+  if (library_it != library().end()) return library_it->second;
+  return unknown();
+}
+}  // namespace syc::ir::analysis
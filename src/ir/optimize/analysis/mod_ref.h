@@ -0,0 +1,78 @@
+/*
+ * syc, a compiler for SysY
+ * Copyright (C) 2020-2021  nzh63, skywf21
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#pragma once
+#include <set>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "ir/ir.h"
+
+namespace syc::ir::analysis {
+class AnalysisManager;
+
+// 调用一个函数可能产生的副作用
+struct ModRef {
+  // 读写的全局变量与全局数组，按名称 id
+  std::set<int> reads, writes;
+  // 读写其内容的数组参数的序号
+  std::set<int> read_arguments, written_arguments;
+  bool io = false;       // 输入输出
+  bool unknown = false;  // 行为未知，可能读写任意内存
+
+  bool operator==(const ModRef& other) const = default;
+
+  bool may_read(int global) const {
+    return this->unknown || this->reads.count(global);
+  }
+  bool may_write(int global) const {
+    return this->unknown || this->writes.count(global);
+  }
+  bool writes_arguments() const {
+    return this->unknown || !this->written_arguments.empty();
+  }
+  bool writes_memory() const {
+    return this->writes_arguments() || !this->writes.empty();
+  }
+  // 结果不被使用时可以删除
+  bool has_side_effect() const { return this->io || this->writes_memory(); }
+  // 结果只取决于参数的值，可以合并或外提
+  bool is_pure() const {
+    return !this->has_side_effect() && this->reads.empty() &&
+           this->read_arguments.empty();
+  }
+};
+
+// 整个程序上的过程间副作用分析。先求出每个函数自身的读写，
+// 再沿调用把被调函数的摘要合并到调用者直到不动点，允许递归；
+// 作为实参传入的数组按调用处的实参换算成调用者的全局数组或参数。
+// 库函数使用预设的摘要，其余未定义的函数视为可能读写任意内存
+class ModRefAnalysis {
+ public:
+  // 没有任何函数的摘要
+  ModRefAnalysis() = default;
+  ModRefAnalysis(const std::vector<IRList>& segments,
+                 std::vector<AnalysisManager>& analyses);
+
+  // 调用函数 function 的副作用
+  const ModRef& of(const std::string& function) const;
+
+ private:
+  std::unordered_map<std::string, ModRef> summaries;
+};
+}  // namespace syc::ir::analysis
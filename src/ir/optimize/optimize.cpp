@@ -17,30 +17,42 @@
  */
 #include "ir/optimize/optimize.h"
 
+#include <vector>
+
 #include "assembly/generate/context.h"
 #include "config.h"
 #include "ir/ir.h"
+#include "ir/optimize/pass_manager.h"
 #include "ir/optimize/passes.h"
 
 namespace syc::ir {
-void optimize(IRList &ir) {
-  using namespace syc::ir::passes;
-  for (int i = 0; i < 5; i++) {
-    // local_common_subexpression_elimination(ir);
-    local_common_constexpr_function_elimination(ir);
-    optimize_phi_var(ir);
-    dead_code_elimination(ir);
-    unreachable_code_elimination(ir);
+namespace {
+// 流水线迭代轮数的上限
+constexpr int max_iterations = 10;
+
+// 将 ir 按源码顺序拆分为若干段，每个函数单独成段，函数之间的数据段各自成段
+std::vector<IRList> split_functions(IRList &ir) {
+  std::vector<IRList> ret;
+  while (!ir.empty()) {
+    auto end = ir.begin();
+    if (end->op_code == OpCode::FUNCTION_BEGIN) {
+      while (end->op_code != OpCode::FUNCTION_END) end++;
+      end++;
+    } else {
+      while (end != ir.end() && end->op_code != OpCode::FUNCTION_BEGIN) end++;
+    }
+    ret.emplace_back();
+    ret.back().splice(ret.back().end(), ir, ir.begin(), end);
   }
+  return ret;
 }
+}  // namespace
 
-void optimize_loop_ir(IRList &ir_before, IRList &ir_cond, IRList &ir_jmp,
-                      IRList &ir_do, IRList &ir_continue) {
-  using namespace syc::ir::passes;
-  if (config::optimize_level > 0) {
-    while (loop_invariant_code_motion(ir_before, ir_cond, ir_jmp, ir_do,
-                                      ir_continue))
-      ;
-  }
+void optimize(IRList &ir) {
+  // 函数之间互不影响，函数级 pass 在线程池上按函数并行执行
+  auto segments = split_functions(ir);
+  run_pipeline(segments, pipeline(), max_iterations);
+  run_pipeline(segments, late_pipeline(), 1);
+  for (auto &i : segments) ir.splice(ir.end(), i);
 }
 }  // namespace syc::ir
\ No newline at end of file
@@ -20,7 +20,4 @@
 
 namespace syc::ir {
 void optimize(IRList &ir);
-
-void optimize_loop_ir(IRList &ir_before, IRList &ir_cond, IRList &ir_jmp,
-                      IRList &ir_do, IRList &ir_continue);
 }  // namespace syc::ir
@@ -0,0 +1,160 @@
+/*
+ * syc, a compiler for SysY
+ * Copyright (C) 2020-2021  nzh63, skywf21
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#include "ir/optimize/pass_manager.h"
+
+#include <algorithm>
+#include <string>
+
+#include "config.h"
+#include "ir/optimize/passes.h"
+#include "stats.h"
+#include "thread_pool.h"
+
+namespace syc::ir {
+namespace {
+using namespace syc::ir::passes;
+
+bool is_function(const IRList &ir) {
+  return !ir.empty() && ir.front().op_code == OpCode::FUNCTION_BEGIN;
+}
+
+const Pass all_passes[] = {
+    {"inline", nullptr, function_inlining},
+    {"tre",
+     [](IRList &ir, analysis::AnalysisManager &) {
+       return tail_recursion_elimination(ir);
+     }},
+    {"sccp", sparse_conditional_constant_propagation},
+    {"gvn", global_value_numbering, nullptr, analysis::PreserveCFG},
+    {"interchange", loop_interchange},
+    {"licm", loop_invariant_code_motion},
+    {"vectorize", loop_vectorization},
+    {"lsr", loop_strength_reduction},
+    {"unroll", loop_unrolling},
+    {"lccfe",
+     [](IRList &ir, analysis::AnalysisManager &am) {
+       return local_common_constexpr_function_elimination(ir, am.mod_ref());
+     },
+     nullptr, analysis::PreserveCFG},
+    {"phi",
+     [](IRList &ir, analysis::AnalysisManager &) {
+       return optimize_phi_var(ir);
+     }},
+    {"dce",
+     [](IRList &ir, analysis::AnalysisManager &am) {
+       return dead_code_elimination(ir, am.mod_ref());
+     }},
+    {"uce",
+     [](IRList &ir, analysis::AnalysisManager &) {
+       return unreachable_code_elimination(ir);
+     }},
+    {"rotate", loop_rotation},
+};
+
+// 各 -O 级别的默认流水线
+const std::vector<std::string_view> default_pipelines[] = {
+    {},
+    {"tre", "sccp", "gvn", "licm", "dce", "uce"},
+    {"inline", "tre", "sccp", "gvn", "interchange", "licm", "vectorize",
+     "lsr", "unroll", "lccfe", "dce", "uce"},
+};
+
+// 默认流水线收敛后只运行一轮的 pass
+const std::vector<std::string_view> default_late_pipelines[] = {
+    {},
+    {"rotate"},
+    {"rotate"},
+};
+}  // namespace
+
+const Pass *find_pass(std::string_view name) {
+  for (auto &pass : all_passes) {
+    if (pass.name == name) return &pass;
+  }
+  return nullptr;
+}
+
+std::vector<const Pass *> pipeline() {
+  std::vector<const Pass *> ret;
+  if (!config::passes.empty()) {
+    for (auto &name : config::passes) {
+      if (auto *pass = find_pass(name)) ret.push_back(pass);
+    }
+    return ret;
+  }
+  int level = std::clamp(config::optimize_level, 0,
+                         int(std::size(default_pipelines)) - 1);
+  for (auto name : default_pipelines[level]) ret.push_back(find_pass(name));
+  return ret;
+}
+
+std::vector<const Pass *> late_pipeline() {
+  std::vector<const Pass *> ret;
+  if (!config::passes.empty()) return ret;
+  int level = std::clamp(config::optimize_level, 0,
+                         int(std::size(default_late_pipelines)) - 1);
+  for (auto name : default_late_pipelines[level])
+    ret.push_back(find_pass(name));
+  return ret;
+}
+
+void run_pipeline(std::vector<IRList> &segments,
+                  const std::vector<const Pass *> &passes, int max_iterations) {
+  auto count = [&] {
+    std::size_t ret = 0;
+    for (auto &i : segments) ret += i.size();
+    return ret;
+  };
+  analysis::ModRefAnalysis mod_ref;
+  std::vector<analysis::AnalysisManager> analyses;
+  analyses.reserve(segments.size());
+  for (auto &i : segments) analyses.emplace_back(i, &mod_ref);
+
+  std::vector<char> dirty(segments.size());
+  for (std::size_t i = 0; i < segments.size(); i++)
+    dirty[i] = is_function(segments[i]);
+  for (int round = 0; round < max_iterations; round++) {
+    if (std::find(dirty.begin(), dirty.end(), true) == dirty.end()) break;
+    // 优化不会给函数增加副作用，每轮开始时求出的摘要在本轮内保持保守
+    mod_ref = analysis::ModRefAnalysis(segments, analyses);
+    std::vector<char> changed(segments.size());
+    for (auto *pass : passes) {
+      stats::Phase phase(pass->name, count);
+      if (pass->run_module) {
+        std::vector<char> module_changed(segments.size());
+        pass->run_module(segments, analyses, module_changed);
+        for (std::size_t i = 0; i < segments.size(); i++) {
+          if (!module_changed[i]) continue;
+          changed[i] = true;
+          analyses[i].invalidate(pass->preserved);
+        }
+        continue;
+      }
+      parallel_for(segments.size(), [&](std::size_t i) {
+        // 被内联后删除的函数只剩空的段
+        if (!is_function(segments[i]) || (!dirty[i] && !changed[i])) return;
+        if (pass->run_function(segments[i], analyses[i])) {
+          changed[i] = true;
+          analyses[i].invalidate(pass->preserved);
+        }
+      });
+    }
+    dirty = std::move(changed);
+  }
+}
+}  // namespace syc::ir
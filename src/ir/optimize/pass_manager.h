@@ -0,0 +1,53 @@
+/*
+ * syc, a compiler for SysY
+ * Copyright (C) 2020-2021  nzh63, skywf21
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#pragma once
+#include <string_view>
+#include <vector>
+
+#include "ir/ir.h"
+#include "ir/optimize/analysis/analysis_manager.h"
+
+namespace syc::ir {
+// IR 上的 pass，返回是否修改了 IR。
+// 函数级 pass 在每个函数上独立运行，可以并行；模块级 pass 需要看到整个程序
+struct Pass {
+  const char *name;
+  bool (*run_function)(IRList &, analysis::AnalysisManager &) = nullptr;
+  // changed[i] 记录第 i 段是否被修改
+  void (*run_module)(std::vector<IRList> &,
+                     std::vector<analysis::AnalysisManager> &,
+                     std::vector<char> &changed) = nullptr;
+  // 修改 IR 后仍然有效的分析
+  unsigned preserved = analysis::PreserveNone;
+};
+
+// 按名称查找 pass，找不到时返回 nullptr
+const Pass *find_pass(std::string_view name);
+
+// -passes= 指定的 IR pass，未指定时为当前 -O 级别的默认流水线
+std::vector<const Pass *> pipeline();
+
+// 默认流水线收敛后运行一轮的 pass，指定 -passes= 时为空
+std::vector<const Pass *> late_pipeline();
+
+// 反复运行流水线直到一整轮没有 pass 修改 IR，最多 max_iterations 轮。
+// segments 为按函数拆分的 IR，只有函数段会被函数级 pass 处理，
+// 上一轮没有被修改的函数不再运行函数级 pass
+void run_pipeline(std::vector<IRList> &segments,
+                  const std::vector<const Pass *> &passes, int max_iterations);
+}  // namespace syc::ir
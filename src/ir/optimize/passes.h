@@ -18,8 +18,16 @@
 #pragma once
 
 #include "ir/optimize/passes/dead_code_elimination.h"
+#include "ir/optimize/passes/function_inlining.h"
+#include "ir/optimize/passes/global_value_numbering.h"
 #include "ir/optimize/passes/invariant_code_motion.h"
+#include "ir/optimize/passes/loop_interchange.h"
+#include "ir/optimize/passes/loop_rotation.h"
+#include "ir/optimize/passes/loop_unrolling.h"
+#include "ir/optimize/passes/loop_vectorization.h"
 #include "ir/optimize/passes/local_common_constexpr_function_elimination.h"
-#include "ir/optimize/passes/local_common_subexpression_elimination.h"
 #include "ir/optimize/passes/optimize_phi_var.h"
+#include "ir/optimize/passes/sparse_conditional_constant_propagation.h"
+#include "ir/optimize/passes/strength_reduction.h"
+#include "ir/optimize/passes/tail_recursion_elimination.h"
 #include "ir/optimize/passes/unreachable_code_elimination.h"
\ No newline at end of file
@@ -22,7 +22,9 @@
 #include "ir/ir.h"
 
 namespace syc::ir::passes {
-void dead_code_elimination(IRList &ir) {
+bool dead_code_elimination(IRList &ir,
+                           const analysis::ModRefAnalysis &mod_ref) {
+  bool changed = false;
   syc::assembly::Context ctx(&ir, ir.begin());
   for (auto it = ir.begin(); it != ir.end(); it++) {
     ctx.set_ir_timestamp(*it);
@@ -31,12 +33,20 @@ void dead_code_elimination(IRList &ir) {
   for (auto it = std::prev(ir.end()); it != ir.begin(); it--) {
     ctx.set_var_latest_use_timestamp(*it);
     auto cur = ctx.ir_to_time[&*it];
-    if (it->dest.is_var() && it->dest.name[0] == '%' &&
-        it->op_code != OpCode::CALL && it->op_code != OpCode::PHI_MOV) {
-      if (ctx.var_latest_use_timestamp.find(it->dest.name) ==
+    if ((it->dest.kind == OpName::Kind::Local ||
+         it->dest.kind == OpName::Kind::LocalArray) &&
+        it->op_code != OpCode::PHI_MOV &&
+        (it->op_code != OpCode::CALL ||
+         !mod_ref.of(it->label).has_side_effect())) {
+      if (ctx.var_latest_use_timestamp.find(it->dest.id) ==
               ctx.var_latest_use_timestamp.end() ||
-          ctx.var_latest_use_timestamp[it->dest.name] <= cur) {
-        it = ir.erase(it);
+          ctx.var_latest_use_timestamp[it->dest.id] <= cur) {
+        auto first = it;
+        if (it->op_code == OpCode::CALL) {
+          while (std::prev(first)->op_code == OpCode::SET_ARG) first--;
+        }
+        it = ir.erase(first, std::next(it));
+        changed = true;
       }
     }
   }
@@ -44,5 +54,6 @@ void dead_code_elimination(IRList &ir) {
   for (auto it = ir.begin(); it != ir.end(); it++) {
     ctx.set_var_define_timestamp(*it);
   }
+  return changed;
 }
 }  // namespace syc::ir::passes
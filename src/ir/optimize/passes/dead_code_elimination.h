@@ -17,7 +17,9 @@
  */
 #pragma once
 #include "ir/ir.h"
+#include "ir/optimize/analysis/mod_ref.h"
 
 namespace syc::ir::passes {
-void dead_code_elimination(IRList &ir);
+// 删除结果未被使用的指令，没有副作用的函数调用连同其 SET_ARG 一起删除
+bool dead_code_elimination(IRList &ir, const analysis::ModRefAnalysis &mod_ref);
 }  // namespace syc::ir::passes
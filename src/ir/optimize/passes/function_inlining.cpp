@@ -0,0 +1,268 @@
+/*
+ * syc, a compiler for SysY
+ * Copyright (C) 2020-2021  nzh63, skywf21
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#include "ir/optimize/passes/function_inlining.h"
+
+#include <algorithm>
+#include <string>
+#include <unordered_map>
+#include <utility>
+
+#include "ir/optimize/analysis/cfg.h"
+
+namespace syc::ir::passes {
+namespace {
+// 被调函数的指令数不超过该值时内联
+constexpr int inline_threshold = 32;
+// 循环中的调用每深一层阈值增加一倍，最多计入的层数
+constexpr int max_loop_bonus = 3;
+// 整个程序中只有一处调用的函数，内联后原函数可以删除，阈值放宽
+constexpr int single_call_threshold = 256;
+// 调用者内联后的指令数上限
+constexpr int max_caller_size = 4000;
+
+// 内联点的编号，用于给复制出的变量与标号取新名字
+int inline_site = 0;
+
+bool is_function(const IRList &ir) {
+  return !ir.empty() && ir.front().op_code == OpCode::FUNCTION_BEGIN;
+}
+bool is_jump(OpCode op_code) {
+  return op_code == OpCode::JMP || op_code == OpCode::JEQ ||
+         op_code == OpCode::JNE || op_code == OpCode::JLE ||
+         op_code == OpCode::JLT || op_code == OpCode::JGE ||
+         op_code == OpCode::JGT;
+}
+
+// 函数的大小，不计 NOOP、INFO 与 LABEL
+int size_of(const IRList &ir) {
+  int ret = 0;
+  for (auto &i : ir) {
+    if (i.op_code != OpCode::NOOP && i.op_code != OpCode::INFO &&
+        i.op_code != OpCode::LABEL && i.op_code != OpCode::FUNCTION_BEGIN &&
+        i.op_code != OpCode::FUNCTION_END)
+      ret++;
+  }
+  return ret;
+}
+
+// Tarjan 算法求强连通分量，被调者所在的分量先给出
+std::vector<std::vector<int>> strongly_connected_components(
+    const std::vector<std::vector<int>> &graph) {
+  int n = graph.size(), counter = 0;
+  std::vector<int> order(n, -1), low(n), stack;
+  std::vector<bool> on_stack(n);
+  std::vector<std::vector<int>> ret;
+  auto visit = [&](int v) {
+    order[v] = low[v] = counter++;
+    stack.push_back(v);
+    on_stack[v] = true;
+  };
+  for (int root = 0; root < n; root++) {
+    if (order[root] >= 0) continue;
+    std::vector<std::pair<int, std::size_t>> work{{root, 0}};
+    visit(root);
+    while (!work.empty()) {
+      int v = work.back().first;
+      auto &next = work.back().second;
+      if (next < graph[v].size()) {
+        int w = graph[v][next++];
+        if (order[w] < 0) {
+          visit(w);
+          work.push_back({w, 0});
+        } else if (on_stack[w]) {
+          low[v] = std::min(low[v], order[w]);
+        }
+        continue;
+      }
+      work.pop_back();
+      if (!work.empty())
+        low[work.back().first] = std::min(low[work.back().first], low[v]);
+      if (low[v] != order[v]) continue;
+      ret.emplace_back();
+      int w;
+      do {
+        w = stack.back();
+        stack.pop_back();
+        on_stack[w] = false;
+        ret.back().push_back(w);
+      } while (w != v);
+    }
+  }
+  return ret;
+}
+
+// 把 callee 的函数体复制到 call 处替换 SET_ARG 与 CALL。
+// 变量与标号加上内联点的后缀，参数 $argN 直接替换为实参；
+// 多个 RET 时返回值通过 PHI_MOV 在末尾的标号处汇合
+void inline_call(IRList &caller, IRList::iterator call, const IRList &callee) {
+  auto first = call;
+  while (first != caller.begin() &&
+         std::prev(first)->op_code == OpCode::SET_ARG)
+    first--;
+  std::vector<OpName> args(callee.front().op1.value);
+  for (auto it = first; it != call; it++) args[it->dest.value] = it->op1;
+
+  auto suffix = "." + std::to_string(inline_site);
+  auto end_label = ".L.INLINE_" + std::to_string(inline_site) + "_END";
+  inline_site++;
+  std::unordered_map<int, OpName> renamed;
+  auto rename = [&](OpName &op) {
+    if (!op.is_var()) return;
+    if (op.kind == OpName::Kind::Arg) {
+      op = args[std::stoi(op.name().substr(4))];
+      return;
+    }
+    if (op.kind != OpName::Kind::Local && op.kind != OpName::Kind::LocalArray)
+      return;
+    auto [it, inserted] = renamed.insert({op.id, OpName()});
+    if (inserted) it->second = OpName(op.name() + suffix);
+    op = it->second;
+  };
+
+  auto body_begin = std::next(callee.begin());
+  auto last = std::prev(std::prev(callee.end()));
+  auto ret_count = std::count_if(body_begin, std::prev(callee.end()),
+                                 [](const IR &ir) {
+                                   return ir.op_code == OpCode::RET;
+                                 });
+  bool single_exit = ret_count == 1 && last->op_code == OpCode::RET;
+
+  IRList body;
+  std::unordered_map<const IR *, IRList::iterator> labels;
+  std::vector<std::pair<IRList::iterator, const IR *>> phi_moves;
+  std::vector<IRList::iterator> returns;
+  for (auto it = body_begin; it != std::prev(callee.end()); it++) {
+    if (it->op_code == OpCode::RET) {
+      auto value = it->op1.is_null() ? OpName(0) : it->op1;
+      rename(value);
+      if (call->dest.is_var()) {
+        auto op_code = single_exit ? OpCode::MOV : OpCode::PHI_MOV;
+        body.emplace_back(op_code, call->dest, value);
+        returns.push_back(std::prev(body.end()));
+        body.back().line = it->line;
+        body.back().column = it->column;
+      }
+      if (!single_exit && it != last) body.emplace_back(OpCode::JMP, end_label);
+      continue;
+    }
+    auto copy = body.insert(body.end(), *it);
+    for (auto *op : {&copy->dest, &copy->op1, &copy->op2, &copy->op3})
+      rename(*op);
+    if (copy->op_code == OpCode::LABEL || is_jump(copy->op_code))
+      copy->label += suffix;
+    if (copy->op_code == OpCode::LABEL) labels[&*it] = copy;
+    if (copy->op_code == OpCode::PHI_MOV &&
+        it->phi_block != IRList::iterator())
+      phi_moves.push_back({copy, &*it->phi_block});
+  }
+  for (auto [phi_move, label] : phi_moves)
+    phi_move->phi_block = labels.at(label);
+  if (!single_exit) {
+    body.emplace_back(OpCode::LABEL, end_label);
+    for (auto ret : returns) ret->phi_block = std::prev(body.end());
+  }
+
+  caller.splice(first, body);
+  caller.erase(first, std::next(call));
+}
+}  // namespace
+
+void function_inlining(std::vector<IRList> &segments,
+                       std::vector<analysis::AnalysisManager> &analyses,
+                       std::vector<char> &changed) {
+  int n = segments.size();
+  std::unordered_map<std::string, int> index;
+  for (int i = 0; i < n; i++) {
+    if (is_function(segments[i])) index[segments[i].front().label] = i;
+  }
+  // 调用图与各函数被调用的次数
+  std::vector<std::vector<int>> callees(n);
+  std::vector<int> call_count(n), size(n);
+  for (int i = 0; i < n; i++) {
+    size[i] = size_of(segments[i]);
+    for (auto &ir : segments[i]) {
+      if (ir.op_code != OpCode::CALL || !index.count(ir.label)) continue;
+      int callee = index[ir.label];
+      callees[i].push_back(callee);
+      call_count[callee]++;
+    }
+  }
+  std::vector<bool> recursive(n), inlined(n);
+  auto components = strongly_connected_components(callees);
+  for (auto &component : components) {
+    int v = component.front();
+    if (component.size() > 1 ||
+        std::count(callees[v].begin(), callees[v].end(), v))
+      for (auto i : component) recursive[i] = true;
+  }
+
+  // 被调者先处理，内联进来的函数体已经内联过它自己的调用
+  for (auto &component : components) {
+    for (auto caller : component) {
+      if (!is_function(segments[caller])) continue;
+      std::vector<std::pair<IRList::iterator, int>> sites;
+      for (auto &function : analyses[caller].functions()) {
+        for (auto &block : function.blocks) {
+          int depth = block->loop ? block->loop->depth : 0;
+          for (auto it = block->begin; it != block->end; it++) {
+            if (it->op_code == OpCode::CALL && index.count(it->label))
+              sites.push_back({it, std::min(depth, max_loop_bonus)});
+          }
+        }
+      }
+      for (auto [call, depth] : sites) {
+        int callee = index[call->label];
+        if (recursive[callee] || callee == caller ||
+            segments[callee].front().label == "main")
+          continue;
+        int threshold = call_count[callee] == 1
+                            ? single_call_threshold
+                            : inline_threshold << depth;
+        if (size[callee] > threshold ||
+            size[caller] + size[callee] > max_caller_size)
+          continue;
+        int args = 0;
+        for (auto it = call; it != segments[caller].begin() &&
+                             std::prev(it)->op_code == OpCode::SET_ARG;
+             it--)
+          args++;
+        if (args != segments[callee].front().op1.value) continue;
+        inline_call(segments[caller], call, segments[callee]);
+        size[caller] += size[callee];
+        changed[caller] = true;
+        inlined[callee] = true;
+      }
+    }
+  }
+
+  // 所有调用都已内联的函数不再需要
+  std::vector<int> remaining(n);
+  for (auto &segment : segments) {
+    for (auto &ir : segment) {
+      if (ir.op_code == OpCode::CALL && index.count(ir.label))
+        remaining[index[ir.label]]++;
+    }
+  }
+  for (int i = 0; i < n; i++) {
+    if (inlined[i] && !remaining[i]) {
+      segments[i].clear();
+      changed[i] = true;
+    }
+  }
+}
+}  // namespace syc::ir::passes
@@ -0,0 +1,30 @@
+/*
+ * syc, a compiler for SysY
+ * Copyright (C) 2020-2021  nzh63, skywf21
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#pragma once
+#include <vector>
+
+#include "ir/ir.h"
+#include "ir/optimize/analysis/analysis_manager.h"
+
+namespace syc::ir::passes {
+// 把较小的函数内联到调用处，segments 为按函数拆分的整个程序。
+// 自底向上处理调用图，递归函数不内联；所有调用都被内联的函数（main 除外）被删除
+void function_inlining(std::vector<IRList> &segments,
+                       std::vector<analysis::AnalysisManager> &analyses,
+                       std::vector<char> &changed);
+}  // namespace syc::ir::passes
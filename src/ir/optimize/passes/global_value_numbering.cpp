@@ -0,0 +1,503 @@
+/*
+ * syc, a compiler for SysY
+ * Copyright (C) 2020-2021  nzh63, skywf21
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#include "ir/optimize/passes/global_value_numbering.h"
+
+#include <cstddef>
+#include <optional>
+#include <set>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+#include "assembly/generate/context.h"
+#include "config.h"
+#include "ir/ir.h"
+#include "ir/optimize/analysis/alias.h"
+#include "ir/optimize/analysis/analysis_manager.h"
+#include "ir/optimize/analysis/cfg.h"
+#include "ir/optimize/analysis/liveness.h"
+
+namespace syc::ir::passes {
+namespace {
+using analysis::BasicBlock;
+
+bool is_pure_binary(OpCode op_code) {
+  switch (op_code) {
+    case OpCode::ADD:
+    case OpCode::SUB:
+    case OpCode::IMUL:
+    case OpCode::IDIV:
+    case OpCode::MOD:
+    case OpCode::SAL:
+    case OpCode::SAR:
+    case OpCode::AND:
+    case OpCode::OR:
+      return true;
+    default:
+      return false;
+  }
+}
+bool is_commutative(OpCode op_code) {
+  return op_code == OpCode::ADD || op_code == OpCode::IMUL ||
+         op_code == OpCode::AND || op_code == OpCode::OR;
+}
+
+// 表达式由操作码与两个操作数的值编号确定
+struct Expression {
+  OpCode op_code;
+  int lhs, rhs;
+  bool operator==(const Expression &other) const = default;
+};
+struct ExpressionHash {
+  std::size_t operator()(const Expression &e) const noexcept {
+    return (std::size_t(e.op_code) * 31 + unsigned(e.lhs)) * 1000003 +
+           unsigned(e.rhs);
+  }
+};
+
+// 保存表达式值的变量及其定值所在的块
+struct Leader {
+  OpName var;
+  BasicBlock *block;
+};
+
+// 已知内容的内存单元 base[offset]，value 为最近一次读出或写入的值
+struct MemoryEntry {
+  analysis::MemoryLocation location;
+  OpName value;  // 只赋值一次的局部变量或立即数
+  BasicBlock *block;
+};
+
+// 记录的内存单元数的上限，每次写内存都要和所有记录比较
+constexpr std::size_t max_memory_entries = 64;
+
+// 块中会使记录的内存单元失效的指令
+struct BlockEffects {
+  std::vector<const IR *> clobbers;  // STORE 与 CALL
+  std::vector<int> redefined;        // 被重新赋值的 PHI 变量
+};
+
+// 沿支配树先序遍历，用带作用域的哈希表为表达式编号。
+// 除 PHI_MOV 的目的变量外，局部变量只被赋值一次且定值支配所有使用，
+// 因此支配者中算过的表达式可以直接复用；PHI 变量在汇合点取新的编号。
+// LOAD 也按基址与偏移编号，借助别名分析在写内存时只作废可能重叠的单元，
+// 写入的值可以直接转发给之后读同一单元的 LOAD
+class ValueNumbering {
+ public:
+  ValueNumbering(analysis::Function &function,
+                 const analysis::Liveness &liveness,
+                 const analysis::AliasAnalysis &alias)
+      : function(function),
+        liveness(liveness),
+        alias(alias),
+        depth(function.blocks.size()),
+        barrier_depth(function.blocks.size()),
+        pressure(function.blocks.size()),
+        effects(function.blocks.size()) {
+    for (auto it = function.begin; it != function.end; it++) {
+      if (it->op_code == OpCode::PHI_MOV) this->phi_vars.insert(it->dest.id);
+    }
+    this->compute_pressure();
+    this->compute_effects();
+  }
+
+  // 返回是否消除了冗余计算
+  bool run() {
+    // 栈中的块为 nullptr 时表示退出上一个进入的块
+    std::vector<std::pair<BasicBlock *, bool>> stack{{function.entry(), true}};
+    std::vector<Mark> marks;
+    while (!stack.empty()) {
+      auto [block, enter] = stack.back();
+      stack.pop_back();
+      if (!enter) {
+        this->undo(marks.back());
+        marks.pop_back();
+        continue;
+      }
+      marks.push_back({this->table_log.size(), this->phi_log.size(),
+                       this->memory_log.size()});
+      stack.push_back({block, false});
+      this->enter(block);
+      for (auto *child : block->dom_children) stack.push_back({child, true});
+    }
+
+    // 被替换的变量的所有使用都被其定值支配，改为读取 leader
+    for (auto it = function.begin; it != function.end; it++) {
+      for (auto *op : {&it->op1, &it->op2, &it->op3}) {
+        if (op->is_var() && this->replace.count(op->id))
+          *op = this->replace[op->id];
+      }
+    }
+    return this->changed;
+  }
+
+ private:
+  struct Mark {
+    std::size_t table, phi, memory;
+  };
+
+  analysis::Function &function;
+  const analysis::Liveness &liveness;
+  const analysis::AliasAnalysis &alias;
+  std::unordered_set<int> phi_vars;
+  // 块在支配树中的深度，以及最近的汇合点祖先（含自身）的深度
+  std::vector<int> depth, barrier_depth;
+  // 块内同时活跃的变量数的最大值
+  std::vector<int> pressure;
+  // 已因复用而延长到某块的变量
+  std::set<std::pair<int, int>> extended;
+
+  int next_value = 0;
+  std::unordered_map<int, int> imm_value;
+  std::unordered_map<int, int> var_value;
+  std::unordered_map<int, std::pair<int, BasicBlock *>> phi_value;
+  std::unordered_map<Expression, Leader, ExpressionHash> table;
+  std::vector<std::pair<Expression, std::optional<Leader>>> table_log;
+  std::vector<std::pair<int, std::optional<std::pair<int, BasicBlock *>>>>
+      phi_log;
+  std::unordered_map<int, OpName> replace;
+  bool changed = false;
+
+  std::vector<BlockEffects> effects;
+  std::unordered_map<Expression, MemoryEntry, ExpressionHash> memory;
+  std::vector<std::pair<Expression, std::optional<MemoryEntry>>> memory_log;
+
+  void compute_pressure() {
+    for (auto &block : function.blocks)
+      this->pressure[block->id] = this->liveness.pressure(block.get());
+  }
+
+  void compute_effects() {
+    for (auto &block : function.blocks) {
+      auto &effects = this->effects[block->id];
+      for (auto it = block->begin; it != block->end; it++) {
+        if (it->op_code == OpCode::STORE || it->op_code == OpCode::VSTORE ||
+            it->op_code == OpCode::CALL)
+          effects.clobbers.push_back(&*it);
+        if (it->dest.is_var() && this->alias.is_multi_def(it->dest.id))
+          effects.redefined.push_back(it->dest.id);
+      }
+    }
+  }
+
+  void undo(const Mark &mark) {
+    while (this->table_log.size() > mark.table) {
+      auto &[key, old] = this->table_log.back();
+      if (old)
+        this->table.insert_or_assign(key, *old);
+      else
+        this->table.erase(key);
+      this->table_log.pop_back();
+    }
+    while (this->phi_log.size() > mark.phi) {
+      auto &[var, old] = this->phi_log.back();
+      if (old)
+        this->phi_value[var] = *old;
+      else
+        this->phi_value.erase(var);
+      this->phi_log.pop_back();
+    }
+    while (this->memory_log.size() > mark.memory) {
+      auto &[key, old] = this->memory_log.back();
+      if (old)
+        this->memory.insert_or_assign(key, *old);
+      else
+        this->memory.erase(key);
+      this->memory_log.pop_back();
+    }
+  }
+
+  void set_leader(const Expression &key, Leader leader) {
+    auto it = this->table.find(key);
+    if (it == this->table.end()) {
+      this->table_log.push_back({key, std::nullopt});
+      this->table.insert({key, leader});
+    } else {
+      this->table_log.push_back({key, it->second});
+      it->second = leader;
+    }
+  }
+  void set_phi_value(int var, int value, BasicBlock *block) {
+    auto it = this->phi_value.find(var);
+    if (it == this->phi_value.end()) {
+      this->phi_log.push_back({var, std::nullopt});
+      this->phi_value.insert({var, {value, block}});
+    } else {
+      this->phi_log.push_back({var, it->second});
+      it->second = {value, block};
+    }
+  }
+
+  void set_memory(const Expression &key, const MemoryEntry &entry) {
+    auto it = this->memory.find(key);
+    if (it == this->memory.end()) {
+      if (this->memory.size() >= max_memory_entries) return;
+      this->memory_log.push_back({key, std::nullopt});
+      this->memory.insert({key, entry});
+    } else {
+      this->memory_log.push_back({key, it->second});
+      it->second = entry;
+    }
+  }
+  template <typename F>
+  void kill_memory_if(F &&clobbered) {
+    for (auto it = this->memory.begin(); it != this->memory.end();) {
+      if (clobbered(it->second)) {
+        this->memory_log.push_back({it->first, it->second});
+        it = this->memory.erase(it);
+      } else {
+        it++;
+      }
+    }
+  }
+  void kill_memory(const IR &ir) {
+    if (this->memory.empty()) return;
+    if (ir.op_code == OpCode::STORE || ir.op_code == OpCode::VSTORE) {
+      auto location = this->alias.location_of(ir);
+      this->kill_memory_if([&](const MemoryEntry &entry) {
+        return this->alias.alias(entry.location, location) !=
+               analysis::AliasResult::NoAlias;
+      });
+    } else {
+      this->kill_memory_if([&](const MemoryEntry &entry) {
+        return this->alias.call_may_write(ir, entry.location.base);
+      });
+    }
+  }
+  // PHI 变量被重新赋值后，用它表示地址的单元不再是同一个
+  void kill_redefined(int var) {
+    if (this->memory.empty()) return;
+    this->kill_memory_if([&](const MemoryEntry &entry) {
+      return entry.location.base_var.id == var ||
+             entry.location.offset.terms.count(var);
+    });
+  }
+  // 从支配者到汇合点 block 的各条路径上可能改写内存或 PHI 变量，
+  // 把途经块中的这些影响都作用到记录上
+  void kill_memory_on_paths(BasicBlock *block) {
+    std::vector<bool> visited(function.blocks.size());
+    std::vector<BasicBlock *> worklist;
+    visited[block->idom->id] = true;
+    for (auto *pred : block->predecessors) {
+      if (pred->reachable() && !visited[pred->id]) {
+        visited[pred->id] = true;
+        worklist.push_back(pred);
+      }
+    }
+    while (!worklist.empty() && !this->memory.empty()) {
+      auto *b = worklist.back();
+      worklist.pop_back();
+      for (auto var : this->effects[b->id].redefined) this->kill_redefined(var);
+      for (auto *ir : this->effects[b->id].clobbers) this->kill_memory(*ir);
+      for (auto *pred : b->predecessors) {
+        if (pred->reachable() && !visited[pred->id]) {
+          visited[pred->id] = true;
+          worklist.push_back(pred);
+        }
+      }
+    }
+  }
+
+  // 操作数的值编号，全局变量等可能被改写的操作数返回 -1
+  int value_of(const OpName &op, BasicBlock *block) {
+    if (op.is_imm()) {
+      auto [it, inserted] = this->imm_value.insert({op.value, 0});
+      if (inserted) it->second = this->next_value++;
+      return it->second;
+    }
+    if (!op.is_var()) return -1;
+    if (op.kind == OpName::Kind::Local && this->phi_vars.count(op.id)) {
+      auto it = this->phi_value.find(op.id);
+      if (it != this->phi_value.end() &&
+          this->depth[it->second.second->id] >=
+              this->barrier_depth[block->id])
+        return it->second.first;
+      int value = this->next_value++;
+      this->set_phi_value(op.id, value, block);
+      return value;
+    }
+    if (op.kind == OpName::Kind::Local || op.kind == OpName::Kind::LocalArray ||
+        op.kind == OpName::Kind::Arg || op.kind == OpName::Kind::GlobalArray) {
+      auto [it, inserted] = this->var_value.insert({op.id, 0});
+      if (inserted) it->second = this->next_value++;
+      return it->second;
+    }
+    return -1;
+  }
+  void define(const OpName &dest, int value, BasicBlock *block) {
+    if (value < 0) value = this->next_value++;
+    if (this->phi_vars.count(dest.id))
+      this->set_phi_value(dest.id, value, block);
+    else
+      this->var_value[dest.id] = value;
+  }
+
+  // 复用 leader 会把它的生命周期延长到 block，
+  // 途经的块中寄存器已经用满时宁可重新计算
+  bool can_extend(const Leader &leader, BasicBlock *block) {
+    if (leader.block == block) return true;
+    int index = this->liveness.index_of(leader.var.id);
+    if (index < 0) return false;
+    auto is_live = [&](BasicBlock *b, bool live) {
+      return live || this->extended.count({b->id, leader.var.id});
+    };
+    std::vector<BasicBlock *> path;
+    std::vector<bool> visited(function.blocks.size());
+    std::vector<BasicBlock *> worklist{block};
+    visited[block->id] = visited[leader.block->id] = true;
+    while (!worklist.empty()) {
+      auto *b = worklist.back();
+      worklist.pop_back();
+      if (!is_live(b, this->liveness.live_in(b).test(index))) path.push_back(b);
+      for (auto *pred : b->predecessors) {
+        if (pred->reachable() && !visited[pred->id]) {
+          visited[pred->id] = true;
+          worklist.push_back(pred);
+        }
+      }
+    }
+    if (!is_live(leader.block,
+                 this->liveness.live_out(leader.block).test(index)))
+      path.push_back(leader.block);
+    for (auto *b : path) {
+      if (this->pressure[b->id] >= syc::assembly::Context::reg_count)
+        return false;
+    }
+    for (auto *b : path) {
+      this->extended.insert({b->id, leader.var.id});
+      this->pressure[b->id]++;
+    }
+    return true;
+  }
+
+  void enter(BasicBlock *block) {
+    bool barrier = block->predecessors.size() != 1 ||
+                   block->predecessors.front() != block->idom;
+    if (block->idom) {
+      this->depth[block->id] = this->depth[block->idom->id] + 1;
+      this->barrier_depth[block->id] =
+          barrier ? this->depth[block->id]
+                  : this->barrier_depth[block->idom->id];
+    } else {
+      this->depth[block->id] = this->barrier_depth[block->id] = 0;
+    }
+    if (barrier && block->idom && !this->memory.empty())
+      this->kill_memory_on_paths(block);
+
+    for (auto it = block->begin; it != block->end; it++) {
+      if (it->op_code == OpCode::STORE) {
+        this->store(*it, block);
+        continue;
+      }
+      if (it->op_code == OpCode::CALL || it->op_code == OpCode::VSTORE)
+        this->kill_memory(*it);
+      if (it->dest.is_var() && this->alias.is_multi_def(it->dest.id))
+        this->kill_redefined(it->dest.id);
+      if (!it->dest.is_var() || it->dest.kind != OpName::Kind::Local) continue;
+      if (it->op_code == OpCode::LOAD) {
+        this->load(*it, block);
+        continue;
+      }
+      if (it->op_code == OpCode::MOV || it->op_code == OpCode::PHI_MOV) {
+        this->define(it->dest, this->value_of(it->op1, block), block);
+        continue;
+      }
+      if (!is_pure_binary(it->op_code) || it->op1.is_null() ||
+          it->op2.is_null()) {
+        this->define(it->dest, -1, block);
+        continue;
+      }
+      int lhs = this->value_of(it->op1, block);
+      int rhs = this->value_of(it->op2, block);
+      if (lhs < 0 || rhs < 0 || this->phi_vars.count(it->dest.id)) {
+        this->define(it->dest, -1, block);
+        continue;
+      }
+      if (is_commutative(it->op_code) && lhs > rhs) std::swap(lhs, rhs);
+      Expression key{it->op_code, lhs, rhs};
+      auto found = this->table.find(key);
+      if (found != this->table.end() && this->can_extend(found->second, block)) {
+        auto leader = found->second.var;
+        it->op_code = OpCode::MOV;
+        it->op1 = leader;
+        it->op2 = OpName();
+        this->replace[it->dest.id] = leader;
+        this->var_value[it->dest.id] = this->var_value[leader.id];
+        this->changed = true;
+      } else {
+        this->define(it->dest, -1, block);
+        this->set_leader(key, {it->dest, block});
+      }
+    }
+  }
+
+  void store(const IR &ir, BasicBlock *block) {
+    this->kill_memory(ir);
+    int base = this->value_of(ir.op1, block);
+    int offset = this->value_of(ir.op2, block);
+    if (base < 0 || offset < 0) return;
+    if (ir.op3.is_imm() ||
+        (ir.op3.is_var() && ir.op3.kind == OpName::Kind::Local &&
+         !this->alias.is_multi_def(ir.op3.id)))
+      this->set_memory({OpCode::LOAD, base, offset},
+                       {this->alias.location_of(ir.op1, ir.op2), ir.op3, block});
+  }
+
+  void load(IR &ir, BasicBlock *block) {
+    int base = this->value_of(ir.op1, block);
+    int offset = this->value_of(ir.op2, block);
+    if (base < 0 || offset < 0 || this->phi_vars.count(ir.dest.id)) {
+      this->define(ir.dest, -1, block);
+      return;
+    }
+    Expression key{OpCode::LOAD, base, offset};
+    auto found = this->memory.find(key);
+    if (found != this->memory.end()) {
+      auto value = found->second.value;
+      if (value.is_imm() ||
+          this->can_extend({value, found->second.block}, block)) {
+        ir.op_code = OpCode::MOV;
+        ir.op1 = value;
+        ir.op2 = OpName();
+        // 立即数交给常量传播代入，以满足后端对立即数操作数的限制
+        if (value.is_var()) this->replace[ir.dest.id] = value;
+        this->define(ir.dest, this->value_of(value, block), block);
+        this->changed = true;
+        return;
+      }
+    }
+    this->define(ir.dest, -1, block);
+    this->set_memory(key,
+                     {this->alias.location_of(ir.op1, ir.op2), ir.dest, block});
+  }
+};
+}  // namespace
+
+// 基于支配树的全局值编号，消除冗余的算术、地址计算与数组读取
+// 只改写指令而不增删指令，控制流图保持有效
+bool global_value_numbering(IRList &, analysis::AnalysisManager &am) {
+  bool changed = false;
+  for (auto &function : am.functions()) {
+    changed |= ValueNumbering(function, am.liveness(function),
+                              am.alias(function))
+                   .run();
+  }
+  return changed;
+}
+}  // namespace syc::ir::passes
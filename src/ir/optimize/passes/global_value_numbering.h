@@ -17,7 +17,8 @@
  */
 #pragma once
 #include "ir/ir.h"
+#include "ir/optimize/analysis/analysis_manager.h"
 
 namespace syc::ir::passes {
-void local_common_subexpression_elimination(IRList &ir);
+bool global_value_numbering(IRList &ir, analysis::AnalysisManager &am);
 }  // namespace syc::ir::passes
@@ -17,83 +17,262 @@
  */
 #include "ir/optimize/passes/invariant_code_motion.h"
 
-#include <set>
+#include <algorithm>
+#include <optional>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
 
-#include "config.h"
+#include "assembly/generate/context.h"
 #include "ir/ir.h"
+#include "ir/optimize/analysis/alias.h"
+#include "ir/optimize/analysis/cfg.h"
+#include "ir/optimize/analysis/liveness.h"
 
 namespace syc::ir::passes {
-bool loop_invariant_code_motion(IRList &ir_before, IRList &ir_cond,
-                                IRList &ir_jmp, IRList &ir_do,
-                                IRList &ir_continue) {
-  std::set<std::string> never_write_var;
-  bool do_optimize = false;
-  for (auto irs :
-       std::vector<IRList *>({&ir_cond, &ir_jmp, &ir_do, &ir_continue})) {
-    for (auto &ir : *irs) {
-      if (ir.op_code == OpCode::LOAD || ir.op_code == OpCode::CALL) {
-        continue;
+namespace {
+using analysis::BasicBlock;
+using analysis::Loop;
+
+bool is_pure_binary(OpCode op_code) {
+  switch (op_code) {
+    case OpCode::ADD:
+    case OpCode::SUB:
+    case OpCode::IMUL:
+    case OpCode::IDIV:
+    case OpCode::MOD:
+    case OpCode::SAL:
+    case OpCode::SAR:
+    case OpCode::AND:
+    case OpCode::OR:
+      return true;
+    default:
+      return false;
+  }
+}
+
+// 外提的指令放到循环唯一的外部前驱的末尾。
+// 每外提一个值，它在整个循环中都活跃，按循环中每个块的活跃变量数加一估计寄存器压力，
+// 压力达到可分配的寄存器数时停止外提，以免引入溢出。
+// LOAD 与调用要求每次通过头部判断的迭代都会执行：所在块支配各回边与头部以外的
+// 各退出块（break 之后的块不满足），只在循环一次也不执行时才是多余的执行
+class InvariantCodeMotion {
+ public:
+  InvariantCodeMotion(IRList &ir, analysis::Function &function,
+                      const analysis::Liveness &liveness,
+                      const analysis::AliasAnalysis &alias,
+                      const analysis::ModRefAnalysis &mod_ref)
+      : ir(ir),
+        function(function),
+        alias(alias),
+        mod_ref(mod_ref),
+        pressure(function.blocks.size()) {
+    for (auto &block : function.blocks) {
+      this->pressure[block->id] = liveness.pressure(block.get());
+      for (auto it = block->begin; it != block->end; it++) {
+        if (it->dest.is_var())
+          this->def_blocks[it->dest.id].push_back(block.get());
       }
-      ir.forEachOp(
-          [&](OpName op) {
-            if (op.is_var()) {
-              never_write_var.insert(op.name);
-            }
-          },
-          false);
     }
   }
-  bool has_function_call = false;
-  for (auto irs :
-       std::vector<IRList *>({&ir_cond, &ir_jmp, &ir_do, &ir_continue})) {
-    for (auto &ir : *irs) {
-      if (ir.dest.is_var()) {
-        never_write_var.erase(ir.dest.name);
-      }
-      if (ir.op_code == OpCode::CALL) {
-        has_function_call = true;
+
+  // 返回是否外提了指令
+  bool run() {
+    bool changed = false;
+    // 后序遍历循环树，内层循环先外提，提到其前驱中的指令还可以继续外提
+    std::vector<std::pair<Loop *, bool>> stack;
+    for (auto *loop : function.top_level_loops) stack.push_back({loop, false});
+    while (!stack.empty()) {
+      auto [loop, visited] = stack.back();
+      stack.pop_back();
+      if (visited) {
+        changed |= this->hoist(loop);
+        continue;
       }
+      stack.push_back({loop, true});
+      for (auto *child : loop->children) stack.push_back({child, false});
     }
+    return changed;
   }
-  for (auto irs :
-       std::vector<IRList *>({&ir_cond, &ir_jmp, &ir_do, &ir_continue})) {
-    for (auto &ir : *irs) {
-      bool can_optimize = true;
-      if (ir.op_code == OpCode::LOAD || ir.op_code == OpCode::CALL ||
-          ir.op_code == OpCode::PHI_MOV || ir.op_code == OpCode::LABEL ||
-          ir.op_code == OpCode::CMP || ir.op_code == OpCode::MOVEQ ||
-          ir.op_code == OpCode::MOVNE || ir.op_code == OpCode::MOVGT ||
-          ir.op_code == OpCode::MOVGE || ir.op_code == OpCode::MOVLT ||
-          ir.op_code == OpCode::MOVLE || ir.op_code == OpCode::NOOP) {
-        can_optimize = false;
-      }
-      // MOV可以优化但不应优化，这只会延长斑斓的生存周期，使得寄存器分配效果变差
-      if (ir.op_code == OpCode::MOV) {
-        can_optimize = false;
+
+ private:
+  IRList &ir;
+  analysis::Function &function;
+  const analysis::AliasAnalysis &alias;
+  const analysis::ModRefAnalysis &mod_ref;
+  std::vector<int> pressure;
+  std::unordered_map<int, std::vector<BasicBlock *>> def_blocks;
+
+  // 当前循环中的写内存指令，以及外提到本循环之外的变量
+  std::vector<const IR *> stores, calls;
+  std::unordered_set<int> hoisted;
+
+  BasicBlock *preheader(Loop *loop) {
+    BasicBlock *ret = nullptr;
+    for (auto *pred : loop->header->predecessors) {
+      if (!pred->reachable() || loop->contains(pred)) continue;
+      if (ret) return nullptr;
+      ret = pred;
+    }
+    if (!ret || ret->empty() || ret->successors.size() != 1) return nullptr;
+    return ret;
+  }
+
+  bool defined_in(int var, Loop *loop) {
+    auto it = this->def_blocks.find(var);
+    if (it == this->def_blocks.end()) return false;
+    return std::any_of(it->second.begin(), it->second.end(),
+                       [&](BasicBlock *block) { return loop->contains(block); });
+  }
+  bool is_invariant(const OpName &op, Loop *loop) {
+    if (op.is_imm() || op.is_null()) return true;
+    switch (op.kind) {
+      case OpName::Kind::LocalArray:
+      case OpName::Kind::GlobalArray:
+        return true;
+      case OpName::Kind::Global:
+        return !this->defined_in(op.id, loop) &&
+               std::none_of(this->calls.begin(), this->calls.end(),
+                            [&](const IR *call) {
+                              return this->mod_ref.of(call->label)
+                                  .may_write(op.id);
+                            });
+      case OpName::Kind::Local:
+        return this->hoisted.count(op.id) || !this->defined_in(op.id, loop);
+      default:
+        return false;
+    }
+  }
+  bool can_hoist(const IR &ir, Loop *loop, bool every_iteration) {
+    if (!ir.dest.is_var() || ir.dest.kind != OpName::Kind::Local ||
+        this->alias.is_multi_def(ir.dest.id))
+      return false;
+    if (ir.op_code == OpCode::MOV) return this->is_invariant(ir.op1, loop);
+    if (is_pure_binary(ir.op_code))
+      return this->is_invariant(ir.op1, loop) &&
+             this->is_invariant(ir.op2, loop);
+    if (ir.op_code != OpCode::LOAD || !every_iteration ||
+        !this->is_invariant(ir.op1, loop) || !this->is_invariant(ir.op2, loop))
+      return false;
+    for (auto *store : this->stores) {
+      if (this->alias.alias(this->alias.location_of(*store),
+                            this->alias.location_of(ir)) !=
+          analysis::AliasResult::NoAlias)
+        return false;
+    }
+    auto base = this->alias.base_of(ir.op1);
+    for (auto *call : this->calls) {
+      if (this->alias.call_may_write(*call, base)) return false;
+    }
+    return true;
+  }
+  // 纯函数调用连同其前面的 SET_ARG 一起外提，返回第一条 SET_ARG
+  std::optional<IRList::iterator> hoistable_call(IRList::iterator call,
+                                                 BasicBlock *block, Loop *loop,
+                                                 bool every_iteration) {
+    if (!every_iteration || !this->mod_ref.of(call->label).is_pure() ||
+        !call->dest.is_var() || call->dest.kind != OpName::Kind::Local ||
+        this->alias.is_multi_def(call->dest.id))
+      return std::nullopt;
+    auto first = call;
+    while (first != block->begin && std::prev(first)->op_code == OpCode::SET_ARG) {
+      first--;
+      if (!this->is_invariant(first->op1, loop)) return std::nullopt;
+    }
+    return first;
+  }
+
+  bool hoist(Loop *loop) {
+    auto *preheader = this->preheader(loop);
+    if (!preheader) return false;
+    int max_pressure = 0;
+    for (auto *block : loop->blocks)
+      max_pressure = std::max(max_pressure, this->pressure[block->id]);
+
+    this->stores.clear();
+    this->calls.clear();
+    this->hoisted.clear();
+    for (auto *block : loop->blocks) {
+      for (auto it = block->begin; it != block->end; it++) {
+        if (it->op_code == OpCode::STORE || it->op_code == OpCode::VSTORE)
+          this->stores.push_back(&*it);
+        if (it->op_code == OpCode::CALL &&
+            this->mod_ref.of(it->label).writes_memory())
+          this->calls.push_back(&*it);
       }
-      can_optimize &= !ir.some(
-          [&](OpName op) {
-            return op.is_var() &&
-                   never_write_var.find(op.name) == never_write_var.end();
-          },
-          false);
-      if (!ir.dest.is_var()) {
-        can_optimize = false;
+    }
+
+    // 按逆后序访问，外提的指令保持定值在使用之前
+    std::vector<BasicBlock *> blocks;
+    for (auto *block : loop->blocks)
+      if (block->reachable()) blocks.push_back(block);
+    std::sort(blocks.begin(), blocks.end(),
+              [](BasicBlock *a, BasicBlock *b) {
+                return a->rpo_index < b->rpo_index;
+              });
+    // 回边的起点与头部以外的退出块
+    std::vector<BasicBlock *> ends(loop->latches);
+    for (auto *block : loop->blocks) {
+      if (block == loop->header) continue;
+      for (auto *succ : block->successors) {
+        if (!loop->contains(succ)) {
+          ends.push_back(block);
+          break;
+        }
       }
-      if (has_function_call && ir.some(&OpName::is_global_var, false)) {
-        can_optimize = false;
+    }
+    // 外提的指令区间 [first, last]
+    std::vector<std::pair<IRList::iterator, IRList::iterator>> moved;
+    int count = 0;
+    for (auto *block : blocks) {
+      bool every_iteration =
+          std::all_of(ends.begin(), ends.end(), [&](BasicBlock *end) {
+            return function.dominates(block, end);
+          });
+      for (auto it = block->begin; it != block->end; it++) {
+        if (max_pressure + count >= syc::assembly::Context::reg_count) break;
+        if (it->op_code == OpCode::CALL) {
+          auto first = this->hoistable_call(it, block, loop, every_iteration);
+          if (!first) continue;
+          moved.push_back({*first, it});
+        } else if (this->can_hoist(*it, loop, every_iteration)) {
+          moved.push_back({it, it});
+        } else {
+          continue;
+        }
+        this->hoisted.insert(it->dest.id);
+        count++;
       }
-      if (can_optimize) {
-        ir_before.push_back(ir);
-        ir.op_code = OpCode::NOOP;
-        ir.dest = OpName();
-        ir.op1 = OpName();
-        ir.op2 = OpName();
-        ir.op3 = OpName();
-        do_optimize = true;
+    }
+    if (moved.empty()) return false;
+
+    auto pos = preheader->end;
+    if (std::prev(pos)->op_code == OpCode::JMP) pos = std::prev(pos);
+    for (auto [first, last] : moved) {
+      for (auto it = first;; it++) {
+        this->ir.insert(pos, *it);
+        it->op_code = OpCode::NOOP;
+        it->dest = it->op1 = it->op2 = it->op3 = OpName();
+        it->label.clear();
+        if (it == last) break;
       }
+      this->def_blocks[last->dest.id] = {preheader};
     }
+    for (auto *block : loop->blocks) this->pressure[block->id] += count;
+    this->pressure[preheader->id] += count;
+    return true;
+  }
+};
+}  // namespace
+
+bool loop_invariant_code_motion(IRList &ir, analysis::AnalysisManager &am) {
+  bool changed = false;
+  for (auto &function : am.functions()) {
+    if (function.loops.empty()) continue;
+    changed |= InvariantCodeMotion(ir, function, am.liveness(function),
+                                   am.alias(function), am.mod_ref())
+                   .run();
   }
-  return do_optimize;
+  return changed;
 }
 }  // namespace syc::ir::passes
@@ -17,9 +17,10 @@
  */
 #pragma once
 #include "ir/ir.h"
+#include "ir/optimize/analysis/analysis_manager.h"
 
 namespace syc::ir::passes {
-bool loop_invariant_code_motion(IRList &ir_before, IRList &ir_cond,
-                                IRList &ir_jmp, IRList &ir_do,
-                                IRList &ir_continue);
+// 在循环嵌套上由内向外外提循环不变量，包括不会被循环改写的 LOAD、
+// 全局变量的读取与纯函数调用
+bool loop_invariant_code_motion(IRList &ir, analysis::AnalysisManager &am);
 }  // namespace syc::ir::passes
@@ -17,49 +17,20 @@
  */
 #include "ir/optimize/passes/local_common_constexpr_function_elimination.h"
 
-#include <set>
 #include <string>
 #include <unordered_map>
+#include <vector>
 
 #include "assembly/generate/context.h"
 #include "config.h"
 #include "ir/ir.h"
 
 namespace syc::ir::passes {
-namespace {
-bool is_constexpr_function(const IRList &irs, IRList::const_iterator begin,
-                           IRList::const_iterator end) {
-  for (auto it = begin; it != end; it++) {
-    auto &ir = *it;
-    if (ir.some(&OpName::is_global_var)) {
-      return false;
-    }
-    if (ir.op_code == OpCode::INFO && ir.label == "NOT CONSTEXPR") {
-      return false;
-    }
-  }
-  return true;
-}
-
-std::set<std::string> find_constexpr_function(const IRList &irs) {
-  std::set<std::string> ret;
-  IRList::const_iterator function_begin_it;
-  for (auto outter_it = irs.begin(); outter_it != irs.end(); outter_it++) {
-    auto &ir = *outter_it;
-    if (ir.op_code == OpCode::FUNCTION_BEGIN) {
-      function_begin_it = outter_it;
-    } else if (ir.op_code == OpCode::FUNCTION_END) {
-      if (is_constexpr_function(irs, function_begin_it, outter_it)) {
-        ret.insert(function_begin_it->label);
-      }
-    }
-  }
-  return ret;
-}
-void _local_common_constexpr_function_elimination(
-    IRList &ir, const std::set<std::string> &constexpr_function) {
+bool local_common_constexpr_function_elimination(
+    IRList &ir, const analysis::ModRefAnalysis &mod_ref) {
+  bool changed = false;
   typedef std::unordered_map<int, OpName> CallArgs;
-  std::unordered_map<std::string, std::vector<std::pair<CallArgs, std::string>>>
+  std::unordered_map<std::string, std::vector<std::pair<CallArgs, OpName>>>
       calls;
   for (auto it = ir.begin(); it != ir.end(); it++) {
     if (it->op_code == OpCode::LABEL || it->op_code == OpCode::FUNCTION_BEGIN) {
@@ -68,7 +39,7 @@ void _local_common_constexpr_function_elimination(
     if (it->op_code == OpCode::CALL) {
       CallArgs args;
       auto function_name = it->label;
-      if (constexpr_function.find(function_name) == constexpr_function.end()) {
+      if (!mod_ref.of(function_name).is_pure()) {
         continue;
       }
       auto it2 = std::prev(it);
@@ -78,26 +49,14 @@ void _local_common_constexpr_function_elimination(
       }
       bool can_optimize = true;
       for (auto kv : args) {
-        if (kv.second.is_var()) {
-          if (kv.second.name[0] != '%') {
-            can_optimize = false;
-            break;
-          }
-          if (kv.second.name.substr(0, 2) == "%&") {
-            can_optimize = false;
-            break;
-          }
+        if (kv.second.is_var() && kv.second.kind != OpName::Kind::Local) {
+          can_optimize = false;
+          break;
         }
       }
       if (!can_optimize) continue;
       bool has_same_call = false;
-      auto eq = [](const OpName &a, const OpName &b) -> bool {
-        if (a.type != b.type) return false;
-        if (a.is_imm()) return a.value == b.value;
-        if (a.is_var()) return a.name == b.name;
-        return true;
-      };
-      std::string prev_call_result;
+      OpName prev_call_result;
       for (const auto &prev_call : calls[function_name]) {
         bool same = true;
         const auto &prev_call_args = prev_call.first;
@@ -107,7 +66,7 @@ void _local_common_constexpr_function_elimination(
             same = false;
             break;
           }
-          if (!eq(kv.second, prev_call_args.at(kv.first))) {
+          if (!(kv.second == prev_call_args.at(kv.first))) {
             same = false;
             break;
           }
@@ -119,24 +78,21 @@ void _local_common_constexpr_function_elimination(
       }
       if (!has_same_call) {
         if (it->dest.is_var()) {
-          calls[function_name].push_back({args, it->dest.name});
+          calls[function_name].push_back({args, it->dest});
         }
       } else {
         if (it->dest.is_var()) {
           it->op_code = OpCode::MOV;
-          it->op1 = OpName(prev_call_result);
+          it->op1 = prev_call_result;
           it->op2 = OpName();
           it->op3 = OpName();
           it->label.clear();
+          changed = true;
         }
       }
     }
   }
-}
-}  // namespace
-void local_common_constexpr_function_elimination(IRList &ir) {
-  return _local_common_constexpr_function_elimination(
-      ir, find_constexpr_function(ir));
+  return changed;
 }
 
 }  // namespace syc::ir::passes
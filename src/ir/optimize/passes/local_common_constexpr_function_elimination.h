@@ -17,7 +17,10 @@
  */
 #pragma once
 #include "ir/ir.h"
+#include "ir/optimize/analysis/mod_ref.h"
 
 namespace syc::ir::passes {
-void local_common_constexpr_function_elimination(IRList &ir);
+// 合并同一基本块中参数相同的纯函数调用，纯函数由副作用摘要给出
+bool local_common_constexpr_function_elimination(
+    IRList &ir, const analysis::ModRefAnalysis &mod_ref);
 }  // namespace syc::ir::passes
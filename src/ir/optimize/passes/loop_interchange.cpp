@@ -0,0 +1,478 @@
+/*
+ * syc, a compiler for SysY
+ * Copyright (C) 2020-2021  nzh63, skywf21
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#include "ir/optimize/passes/loop_interchange.h"
+
+#include <climits>
+#include <cstdlib>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+#include "config.h"
+#include "ir/optimize/analysis/alias.h"
+#include "ir/optimize/analysis/counted_loop.h"
+#include "ir/optimize/analysis/liveness.h"
+
+namespace syc::ir::passes {
+namespace {
+using analysis::CountedLoop;
+using analysis::exit_jump;
+using analysis::Relation;
+
+constexpr int element_size = 4;
+constexpr int cache_line = 64;
+// 块太小时分块带来的开销超过收益
+constexpr int min_tile = 8;
+// 变换过的循环嵌套在外层头部带有这些标记，不再重复处理
+const char interchanged_marker[] = "INTERCHANGED";
+const char tiled_marker[] = "TILED";
+
+// 一层循环的控制：var 从 init 开始每次增加 step，var rel bound 时继续
+struct Control {
+  OpName var, init, bound;
+  Relation relation;
+  int step;
+
+  // 迭代次数已知时 var 的最大值与最小值之差
+  std::optional<long long> span() const {
+    if (!this->init.is_imm() || !this->bound.is_imm()) return std::nullopt;
+    long long init = this->init.value, last = this->bound.value;
+    if (this->relation == Relation::LT) last--;
+    if (this->relation == Relation::GT) last++;
+    if (this->step > 0 ? last < init : last > init) return 0;
+    return (last - init) / this->step * std::llabs(this->step);
+  }
+};
+
+// 迭代前进时 coefficient * var 的变化方向：步长为负时系数取反
+long long directed(long long coefficient, int step) {
+  return step < 0 ? -coefficient : coefficient;
+}
+
+// 数组的一维，下标每增加 1 地址增加 stride 字节
+struct Dimension {
+  long long stride;
+  analysis::Affine subscript;
+
+  bool operator==(const Dimension &other) const {
+    return this->stride == other.stride &&
+           this->subscript.constant == other.subscript.constant &&
+           this->subscript.terms == other.subscript.terms;
+  }
+};
+
+// 一次数组访问，offset 中内外层归纳变量的系数分别为 outer 与 inner
+struct Access {
+  analysis::MemoryLocation location;
+  bool store;
+  long long outer, inner;
+  // 偏移不是前端生成的形式时为空
+  std::optional<std::vector<Dimension>> dimensions;
+};
+
+// 完美嵌套的两层循环，外层循环体中除内层循环外只有内层归纳变量的初始化
+// 与外层归纳变量的递增：
+//   PHI_MOV i init_i; LABEL outer; CMP i n; J<exit> outer_end
+//   PHI_MOV j init_j; LABEL inner; CMP j m; J<exit> inner_end
+//   body; PHI_MOV j next_j; JMP inner; LABEL inner_end
+//   ADD next_i i step; PHI_MOV i next_i; JMP outer; LABEL outer_end
+// 交换只需改写这些控制指令，循环体不变
+class LoopNest {
+ public:
+  LoopNest(IRList &ir, const analysis::AliasAnalysis &alias,
+           CountedLoop outer, CountedLoop inner)
+      : ir(ir), alias(alias), outer(std::move(outer)), inner(std::move(inner)) {
+    auto &label = this->outer.header->label;
+    this->suffix = "." + (label.starts_with(".L.") ? label.substr(3) : label);
+  }
+
+  // 检查结构与合法性，exit 为外层循环退出处的基本块
+  bool analyze(const analysis::Liveness &liveness,
+               const analysis::BasicBlock *exit);
+  bool run();
+
+ private:
+  IRList &ir;
+  const analysis::AliasAnalysis &alias;
+  CountedLoop outer, inner;
+  std::string suffix;
+  int temps = 0;
+
+  Control outer_control, inner_control;
+  // 需要改写的指令：进入循环前的 PHI_MOV、头部的 CMP 与回边上的 PHI_MOV
+  IRList::iterator outer_init, inner_init, outer_cmp, inner_cmp, outer_latch,
+      inner_latch;
+  std::vector<Access> accesses;
+  // 内层循环体中变量的定值
+  std::unordered_map<int, const IR *> defs;
+
+  OpName temp() {
+    return OpName("%" + this->suffix.substr(1) + ".N" +
+                  std::to_string(this->temps++));
+  }
+  bool invariant(const OpName &op) const {
+    return op.is_imm() ||
+           (op.is_var() && !this->outer.body_vars.count(op.id) &&
+            !this->outer.loop_vars.count(op.id));
+  }
+  bool is_control(OpCode op_code) const {
+    return op_code == OpCode::LABEL || op_code == OpCode::NOOP ||
+           op_code == OpCode::INFO;
+  }
+
+  std::optional<IRList::iterator> find_cmp(const CountedLoop &loop) const {
+    for (auto it = std::next(loop.header); it != loop.body; it++)
+      if (it->op_code == OpCode::CMP) return it;
+    return std::nullopt;
+  }
+  std::optional<Control> control_of(const CountedLoop &loop,
+                                    IRList::iterator init) const {
+    if (!this->invariant(init->op1)) return std::nullopt;
+    return Control{loop.var, init->op1, loop.bound, loop.relation, loop.step};
+  }
+  bool split(const OpName &offset, std::vector<Dimension> &out) const;
+  // 某一维的下标只含一个归纳变量，或两个归纳变量的系数乘以各自步长的符号
+  // 后异号
+  bool separated(const std::vector<Dimension> &dimensions) const;
+  bool legal() const;
+  // 交换后内层循环不再跨行访问的数组访问数，减去变为跨行访问的
+  int interchange_gain() const;
+  // 内层循环每次迭代跨过一个缓存行、外层相邻迭代访问同一缓存行的访问数
+  int strided(bool interchanged) const;
+
+  void set_control(IRList::iterator init, IRList::iterator cmp,
+                   IRList::iterator latch, const Control &control);
+  void tile(const Control &inner, int size);
+};
+
+bool LoopNest::analyze(const analysis::Liveness &liveness,
+                       const analysis::BasicBlock *exit) {
+  auto &outer = this->outer, &inner = this->inner;
+  if (outer.has_call || outer.loop_vars.size() != 1 ||
+      inner.loop_vars.size() != 1)
+    return false;
+
+  // 外层循环体在内层循环前后只有初始化与递增
+  std::optional<IRList::iterator> init;
+  for (auto it = outer.body; it != inner.header; it++) {
+    if (this->is_control(it->op_code)) continue;
+    if (it->op_code != OpCode::PHI_MOV || it->dest != inner.var ||
+        it->phi_block != inner.header || init)
+      return false;
+    init = it;
+  }
+  if (!init) return false;
+  this->inner_init = *init;
+  for (auto it = std::next(inner.jump); it != inner.exit; it++)
+    if (!this->is_control(it->op_code)) return false;
+  auto latch = outer.phi_moves.front();
+  for (auto it = std::next(inner.exit); it != outer.tail; it++) {
+    if (!this->is_control(it->op_code) && it->dest != latch->op1)
+      return false;
+  }
+  this->outer_latch = latch;
+  this->inner_latch = inner.phi_moves.front();
+
+  // 外层的初始化是前置块末尾的 PHI_MOV
+  init.reset();
+  for (auto it = outer.header; !init && it != outer.preheader->begin;) {
+    it--;
+    if (it->op_code == OpCode::PHI_MOV && it->dest == outer.var &&
+        it->phi_block == outer.header)
+      init = it;
+    else if (it->op_code != OpCode::PHI_MOV && !this->is_control(it->op_code))
+      break;
+  }
+  if (!init) return false;
+  this->outer_init = *init;
+
+  auto outer_cmp = this->find_cmp(outer), inner_cmp = this->find_cmp(inner);
+  auto outer_control = this->control_of(outer, this->outer_init);
+  auto inner_control = this->control_of(inner, this->inner_init);
+  if (!outer_cmp || !inner_cmp || !outer_control || !inner_control ||
+      !this->invariant(inner.bound))
+    return false;
+  this->outer_cmp = *outer_cmp;
+  this->inner_cmp = *inner_cmp;
+  this->outer_control = *outer_control;
+  this->inner_control = *inner_control;
+
+  // 交换后归纳变量的终值改变，嵌套中的变量在之后不能被用到
+  auto &live = liveness.live_in(exit);
+  for (auto vars : {&outer.body_vars, &outer.loop_vars}) {
+    for (auto var : *vars) {
+      int index = liveness.index_of(var);
+      if (index >= 0 && live.test(index)) return false;
+    }
+  }
+
+  // 循环体中的值不跨迭代传递，数组访问的偏移是归纳变量的仿射函数
+  std::unordered_set<int> defined;
+  for (auto it = inner.body; it != inner.tail; it++) {
+    bool carried = false;
+    it->forEachOp(
+        [&](const OpName &op) {
+          if (op.is_var() && outer.body_vars.count(op.id) &&
+              op != inner.var && !defined.count(op.id))
+            carried = true;
+        },
+        false);
+    if (carried) return false;
+    if (it->dest.is_var()) {
+      defined.insert(it->dest.id);
+      this->defs[it->dest.id] = &*it;
+    }
+    if (it->op_code != OpCode::LOAD && it->op_code != OpCode::STORE)
+      continue;
+    if (!this->invariant(it->op1)) return false;
+    Access access{this->alias.location_of(*it),
+                  it->op_code == OpCode::STORE, 0, 0, std::nullopt};
+    std::vector<Dimension> dimensions;
+    if (this->split(it->op2, dimensions)) access.dimensions = dimensions;
+    for (auto [var, coefficient] : access.location.offset.terms) {
+      if (var == outer.var.id)
+        access.outer = coefficient;
+      else if (var == inner.var.id)
+        access.inner = coefficient;
+      else if (!this->invariant(OpName(var)))
+        return false;
+    }
+    this->accesses.push_back(access);
+  }
+  return this->legal();
+}
+
+// 按前端生成数组下标的方式把偏移拆成各维：最后一维为 SAL 下标 2，
+// 其余各维依次 ADD 上 IMUL 行大小 下标。与归纳变量无关的部分作为一维
+bool LoopNest::split(const OpName &offset,
+                     std::vector<Dimension> &out) const {
+  if (this->invariant(offset)) {
+    out.push_back({0, this->alias.offset_of(offset)});
+    return true;
+  }
+  auto it = offset.is_var() ? this->defs.find(offset.id) : this->defs.end();
+  if (it == this->defs.end()) return false;
+  auto &def = *it->second;
+  if (def.op_code == OpCode::MOV) return this->split(def.op1, out);
+  if (def.op_code == OpCode::SAL && def.op2.is_imm() && def.op2.value == 2) {
+    out.push_back({element_size, this->alias.offset_of(def.op1)});
+    return true;
+  }
+  if (def.op_code != OpCode::ADD) return false;
+  for (auto [rest, row] : {std::pair{def.op1, def.op2},
+                           std::pair{def.op2, def.op1}}) {
+    auto product = row.is_var() ? this->defs.find(row.id) : this->defs.end();
+    if (product == this->defs.end()) continue;
+    auto &imul = *product->second;
+    if (imul.op_code != OpCode::IMUL ||
+        (!imul.op1.is_imm() && !imul.op2.is_imm()))
+      continue;
+    auto &stride = imul.op1.is_imm() ? imul.op1 : imul.op2;
+    auto &subscript = imul.op1.is_imm() ? imul.op2 : imul.op1;
+    if (!this->split(rest, out)) return false;
+    out.push_back({stride.value, this->alias.offset_of(subscript)});
+    return true;
+  }
+  return false;
+}
+
+bool LoopNest::separated(const std::vector<Dimension> &dimensions) const {
+  for (auto &dimension : dimensions) {
+    auto &terms = dimension.subscript.terms;
+    auto outer = terms.find(this->outer.var.id),
+         inner = terms.find(this->inner.var.id);
+    long long a = outer == terms.end() ? 0 : outer->second;
+    long long b = inner == terms.end() ? 0 : inner->second;
+    a = directed(a, this->outer.step);
+    b = directed(b, this->inner.step);
+    if ((a == 0) != (b == 0) || (a != 0 && (a > 0) != (b > 0))) return true;
+  }
+  return false;
+}
+
+// 交换改变了外层第 p < q 次、内层第 r > s 次的两次迭代的先后。写入的元素只可
+// 能与下标相同的访问重叠。与 C 一样假定各维下标不越界，则两次迭代访问同一元素
+// 时每一维的下标都相等，separated 时不存在这样的两次迭代。否则按整个偏移判断：
+// ci * si * (q - p) = cj * sj * (r - s) 在 ci * si 与 cj * sj 有一个为 0 或
+// 异号时无解，同号时要求迭代范围小到等式不能成立
+bool LoopNest::legal() const {
+  auto outer_span = this->outer_control.span();
+  auto inner_span = this->inner_control.span();
+  for (auto &store : this->accesses) {
+    if (!store.store) continue;
+    for (auto &access : this->accesses) {
+      auto &a = store.location, &b = access.location;
+      if (!this->alias.may_alias(a.base, b.base)) continue;
+      bool same_object = a.base.kind == b.base.kind && a.base.id == b.base.id &&
+                         (a.base.kind != analysis::MemoryBase::Unknown ||
+                          a.base_var == b.base_var);
+      if (!same_object || a.offset.constant != b.offset.constant ||
+          a.offset.terms != b.offset.terms ||
+          store.dimensions != access.dimensions)
+        return false;
+    }
+    if (store.dimensions && this->separated(*store.dimensions)) continue;
+    auto outer = directed(store.outer, this->outer.step),
+         inner = directed(store.inner, this->inner.step);
+    auto ci = std::llabs(outer), cj = std::llabs(inner);
+    if (ci == 0 || cj == 0 || (outer > 0) != (inner > 0)) continue;
+    bool outer_small = outer_span && *outer_span <= INT_MAX &&
+                       ci * *outer_span < cj * std::abs(this->inner.step);
+    bool inner_small = inner_span && *inner_span <= INT_MAX &&
+                       cj * *inner_span < ci * std::abs(this->outer.step);
+    if (!outer_small && !inner_small) return false;
+  }
+  return true;
+}
+
+int LoopNest::interchange_gain() const {
+  int ret = 0;
+  for (auto &access : this->accesses) {
+    auto outer = std::llabs(access.outer), inner = std::llabs(access.inner);
+    if (inner > element_size && outer <= element_size) ret++;
+    if (outer > element_size && inner <= element_size) ret--;
+  }
+  return ret;
+}
+
+int LoopNest::strided(bool interchanged) const {
+  int ret = 0;
+  for (auto &access : this->accesses) {
+    auto outer = std::llabs(access.outer), inner = std::llabs(access.inner);
+    if (interchanged) std::swap(outer, inner);
+    if (inner >= cache_line && outer > 0 && outer < cache_line) ret++;
+  }
+  return ret;
+}
+
+bool LoopNest::run() {
+  bool interchanged = this->interchange_gain() > 0;
+  auto outer = this->outer_control, inner = this->inner_control;
+  if (interchanged) std::swap(outer, inner);
+
+  // 分块后内层循环一块内跨过的各缓存行要在外层的相邻迭代间留在缓存中
+  int size = 0;
+  if (int streams = this->strided(interchanged)) {
+    size = min_tile;
+    while (size * 2 * cache_line * streams <= config::cache_size) size *= 2;
+    if (size * cache_line * streams > config::cache_size) size = 0;
+  }
+  auto span = inner.span();
+  if (inner.relation != Relation::LT || inner.step != 1 ||
+      !inner.init.is_imm() || inner.init.value < 0 || (span && *span < size))
+    size = 0;
+  if (!interchanged && size == 0) return false;
+
+  if (interchanged) {
+    this->set_control(this->outer_init, this->outer_cmp, this->outer_latch,
+                      outer);
+    this->set_control(this->inner_init, this->inner_cmp, this->inner_latch,
+                      inner);
+    this->ir.insert(std::next(this->outer.header),
+                    IR(OpCode::INFO, interchanged_marker));
+  }
+  if (size > 0) this->tile(inner, size);
+  return true;
+}
+
+void LoopNest::set_control(IRList::iterator init, IRList::iterator cmp,
+                           IRList::iterator latch, const Control &control) {
+  init->dest = control.var;
+  init->op1 = control.init;
+  cmp->op1 = control.var;
+  cmp->op2 = control.bound;
+  std::next(cmp)->op_code = exit_jump(control.relation);
+  auto next = this->temp();
+  this->ir.insert(latch, IR(OpCode::ADD, next, control.var, control.step));
+  latch->dest = control.var;
+  latch->op1 = next;
+}
+
+// 把内层循环分为 size 次迭代一块，块的循环放在最外层：
+//   PHI_MOV t init_j; LABEL tile; CMP t m; JGE tile_end
+//   limit = min(t + size, m); PHI_MOV i init_i
+//   外层循环，内层循环从 t 开始，到 limit 为止
+//   PHI_MOV t limit; JMP tile; LABEL tile_end
+// init_j 非负且 j < m，m - t 不会溢出
+void LoopNest::tile(const Control &inner, int size) {
+  auto &header = this->outer.header;
+  auto block = this->temp(), rest = this->temp(), length = this->temp(),
+       limit = this->temp();
+  IRList code;
+  code.emplace_back(OpCode::PHI_MOV, block, inner.init);
+  auto phi = std::prev(code.end());
+  code.emplace_back(OpCode::LABEL, header->label + ".T");
+  auto tile_header = std::prev(code.end());
+  phi->phi_block = tile_header;
+  code.emplace_back(OpCode::INFO, tiled_marker);
+  code.emplace_back(OpCode::CMP, OpName(), block, inner.bound);
+  code.emplace_back(OpCode::JGE, header->label + ".TE");
+  code.emplace_back(OpCode::LABEL, header->label + ".TD");
+  code.emplace_back(OpCode::SUB, rest, inner.bound, block);
+  code.emplace_back(OpCode::CMP, OpName(), rest, size);
+  code.emplace_back(OpCode::MOVGT, length, size, rest);
+  code.emplace_back(OpCode::ADD, limit, block, length);
+  code.splice(code.end(), this->ir, this->outer_init);
+  this->ir.splice(header, code);
+  this->ir.insert(std::next(header), IR(OpCode::INFO, tiled_marker));
+
+  this->inner_init->op1 = block;
+  this->inner_cmp->op1 = inner.var;
+  this->inner_cmp->op2 = limit;
+  std::next(this->inner_cmp)->op_code = OpCode::JGE;
+
+  auto after = std::next(this->outer.exit);
+  this->ir.insert(after, IR(OpCode::PHI_MOV, block, limit))->phi_block =
+      tile_header;
+  this->ir.insert(after, IR(OpCode::JMP, tile_header->label));
+  this->ir.insert(after, IR(OpCode::LABEL, header->label + ".TE"));
+}
+}  // namespace
+
+bool loop_interchange(IRList &ir, analysis::AnalysisManager &am) {
+  bool changed = false;
+  for (auto &function : am.functions()) {
+    if (function.loops.empty()) continue;
+    analysis::CountedLoops analysis(ir, function);
+    auto &alias = am.alias(function);
+    auto &liveness = am.liveness(function);
+    // 先检查所有嵌套再改写，改写会使控制流图失效
+    std::vector<LoopNest> nests;
+    for (auto &loop : function.loops) {
+      // 只处理最内两层：外层恰有一个子循环且它是最内层循环。外层本身可以
+      // 嵌套在其他循环中，如 i/j/k 三重循环的 j/k 两层；更外层之间不交换
+      if (loop->children.size() != 1 ||
+          !loop->children.front()->children.empty())
+        continue;
+      auto outer = analysis.analyze(loop.get());
+      auto inner = analysis.analyze(loop->children.front());
+      if (!outer || !inner || outer->has_marker(interchanged_marker) ||
+          outer->has_marker(tiled_marker))
+        continue;
+      auto *exit = function.block_of(*outer->exit);
+      LoopNest nest(ir, alias, std::move(*outer), std::move(*inner));
+      if (nest.analyze(liveness, exit)) nests.push_back(std::move(nest));
+    }
+    for (auto &nest : nests) changed |= nest.run();
+  }
+  return changed;
+}
+}  // namespace syc::ir::passes
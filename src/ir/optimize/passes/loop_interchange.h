@@ -0,0 +1,26 @@
+/*
+ * syc, a compiler for SysY
+ * Copyright (C) 2020-2021  nzh63, skywf21
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#pragma once
+#include "ir/ir.h"
+#include "ir/optimize/analysis/analysis_manager.h"
+
+namespace syc::ir::passes {
+// 对完美嵌套的两层计数循环，在不改变结果时交换内外层，使内层循环按行连续访问数组；
+// 内层仍跨行访问的，按 -fcache-size 把内层循环分块并移到外层之外
+bool loop_interchange(IRList &ir, analysis::AnalysisManager &am);
+}  // namespace syc::ir::passes
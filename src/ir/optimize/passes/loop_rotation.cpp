@@ -0,0 +1,207 @@
+/*
+ * syc, a compiler for SysY
+ * Copyright (C) 2020-2021  nzh63, skywf21
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#include "ir/optimize/passes/loop_rotation.h"
+
+#include <algorithm>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "ir/optimize/analysis/cfg.h"
+
+namespace syc::ir::passes {
+namespace {
+// 头部判断条件的指令数（不计跳转）超过该值时不旋转，避免复制过多代码
+constexpr int max_test_size = 8;
+// 已旋转的循环在头部带有该标记
+const char rotated_marker[] = "ROTATED";
+
+bool is_cond_jump(OpCode op_code) {
+  return op_code == OpCode::JEQ || op_code == OpCode::JNE ||
+         op_code == OpCode::JLE || op_code == OpCode::JLT ||
+         op_code == OpCode::JGE || op_code == OpCode::JGT;
+}
+bool is_jump(OpCode op_code) {
+  return op_code == OpCode::JMP || is_cond_jump(op_code);
+}
+OpCode invert(OpCode op_code) {
+  switch (op_code) {
+    case OpCode::JEQ:
+      return OpCode::JNE;
+    case OpCode::JNE:
+      return OpCode::JEQ;
+    case OpCode::JLE:
+      return OpCode::JGT;
+    case OpCode::JLT:
+      return OpCode::JGE;
+    case OpCode::JGE:
+      return OpCode::JLT;
+    case OpCode::JGT:
+      return OpCode::JLE;
+    default:
+      return op_code;
+  }
+}
+
+//   LABEL header; test; Jcc exit; body; latch: ...; JMP header; ...; exit:
+// =>
+//   test; Jcc exit; LABEL header; body; latch: ...; test; J!cc header;
+//   JMP exit（exit 紧随其后时省略）
+// 回边处的 test 与原来下一次迭代开头执行的 test 相同，改写不改变语义。
+// test 中定义的临时变量只在 test 内使用，每份副本换用新名字以保持单一定义
+struct Rotation {
+  IRList::iterator first;  // 头部块的第一条指令
+  std::vector<IRList::iterator> test;
+  std::unordered_set<int> temps;  // test 中定义的局部变量
+  IRList::iterator jump;  // 头部块末尾的条件跳转
+  std::vector<IRList::iterator> latches;
+};
+
+std::optional<Rotation> analyze(const analysis::Function &function,
+                                const analysis::Loop &loop) {
+  auto *header = loop.header;
+  if (header->empty()) return std::nullopt;
+  Rotation ret;
+  ret.first = header->begin;
+  ret.jump = std::prev(header->end);
+  if (!is_cond_jump(ret.jump->op_code)) return std::nullopt;
+  auto *exit = function.block_of_label(ret.jump->label);
+  if (exit == nullptr || loop.contains(exit)) return std::nullopt;
+  // 条件不成立时顺序进入循环体
+  auto *body = header->id + 1 < int(function.blocks.size())
+                   ? function.blocks[header->id + 1].get()
+                   : nullptr;
+  if (body == nullptr || !loop.contains(body)) return std::nullopt;
+
+  std::vector<std::string> labels;
+  for (auto it = header->begin; it != ret.jump; it++) {
+    if (it->op_code == OpCode::LABEL) {
+      labels.push_back(it->label);
+    } else if (it->op_code == OpCode::INFO) {
+      if (it->label == rotated_marker) return std::nullopt;
+    } else if (it->op_code != OpCode::NOOP) {
+      if (it->op_code == OpCode::PHI_MOV) return std::nullopt;
+      ret.test.push_back(it);
+    }
+  }
+  if (labels.empty() || int(ret.test.size()) > max_test_size)
+    return std::nullopt;
+
+  for (auto it : ret.test) {
+    if (!it->dest.is_var()) continue;
+    if (it->dest.kind != OpName::Kind::Local || ret.temps.count(it->dest.id))
+      return std::nullopt;
+    ret.temps.insert(it->dest.id);
+  }
+  if (!ret.temps.empty()) {
+    std::unordered_set<const IR *> in_test;
+    for (auto it : ret.test) in_test.insert(&*it);
+    for (auto it = function.begin; it != function.end; it++) {
+      if (in_test.count(&*it)) continue;
+      if (it->some([&](const OpName &op) {
+            return op.is_var() && ret.temps.count(op.id);
+          }))
+        return std::nullopt;
+    }
+  }
+
+  // 循环外只能顺序进入头部，循环内只能由 JMP 跳回头部
+  auto to_header = [&](const IR &ir) {
+    return is_jump(ir.op_code) &&
+           std::find(labels.begin(), labels.end(), ir.label) != labels.end();
+  };
+  for (auto *pred : header->predecessors) {
+    if (pred->empty()) return std::nullopt;
+    auto last = std::prev(pred->end);
+    if (!loop.contains(pred)) {
+      if (to_header(*last)) return std::nullopt;
+      continue;
+    }
+    if (last->op_code != OpCode::JMP || !to_header(*last)) return std::nullopt;
+    ret.latches.push_back(last);
+  }
+  if (ret.latches.empty()) return std::nullopt;
+  return ret;
+}
+
+void rotate(IRList &ir, const Rotation &rotation) {
+  auto &exit = rotation.jump->label;
+  int copies = 0;
+  auto copy_test = [&](IRList::iterator pos) {
+    std::string suffix = ".R" + std::to_string(copies++);
+    std::unordered_map<int, OpName> renamed;
+    auto rename = [&](OpName &op) {
+      if (!op.is_var() || !rotation.temps.count(op.id)) return;
+      auto [it, inserted] = renamed.insert({op.id, OpName()});
+      if (inserted) it->second = OpName(op.name() + suffix);
+      op = it->second;
+    };
+    for (auto it : rotation.test) {
+      auto copy = ir.insert(pos, *it);
+      for (auto *op : {&copy->dest, &copy->op1, &copy->op2, &copy->op3})
+        rename(*op);
+    }
+    return ir.insert(pos, *rotation.jump);
+  };
+
+  copy_test(rotation.first);
+
+  for (auto latch : rotation.latches) {
+    auto back = copy_test(latch);
+    back->op_code = invert(back->op_code);
+    back->label = latch->label;
+    // 退出块紧随其后时顺序执行即可
+    bool falls_to_exit = false;
+    for (auto it = std::next(latch); it != ir.end(); it++) {
+      if (it->op_code == OpCode::LABEL && it->label == exit) {
+        falls_to_exit = true;
+        break;
+      }
+      if (it->op_code != OpCode::LABEL && it->op_code != OpCode::NOOP &&
+          it->op_code != OpCode::INFO)
+        break;
+    }
+    if (falls_to_exit)
+      ir.erase(latch);
+    else
+      latch->label = exit;
+  }
+
+  auto last_label = rotation.first;
+  while (std::next(last_label)->op_code == OpCode::LABEL) last_label++;
+  ir.insert(std::next(last_label), IR(OpCode::INFO, rotated_marker));
+  for (auto it : rotation.test) ir.erase(it);
+  ir.erase(rotation.jump);
+}
+}  // namespace
+
+bool loop_rotation(IRList &ir, analysis::AnalysisManager &am) {
+  std::vector<Rotation> rotations;
+  for (auto &function : am.functions()) {
+    for (auto &loop : function.loops) {
+      if (auto rotation = analyze(function, *loop))
+        rotations.push_back(std::move(*rotation));
+    }
+  }
+  // 各循环的头部与回边互不相同，先分析完再统一改写
+  for (auto &rotation : rotations) rotate(ir, rotation);
+  return !rotations.empty();
+}
+}  // namespace syc::ir::passes
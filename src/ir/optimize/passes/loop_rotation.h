@@ -0,0 +1,27 @@
+/*
+ * syc, a compiler for SysY
+ * Copyright (C) 2020-2021  nzh63, skywf21
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#pragma once
+#include "ir/ir.h"
+#include "ir/optimize/analysis/analysis_manager.h"
+
+namespace syc::ir::passes {
+// 把在头部判断退出的循环改为在进入前判断一次、在回边处判断是否继续，
+// 每次迭代少执行一次无条件跳转。改写后的循环不再符合其他循环优化识别的形式，
+// 只在流水线收敛后运行
+bool loop_rotation(IRList &ir, analysis::AnalysisManager &am);
+}  // namespace syc::ir::passes
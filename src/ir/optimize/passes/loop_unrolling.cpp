@@ -0,0 +1,267 @@
+/*
+ * syc, a compiler for SysY
+ * Copyright (C) 2020-2021  nzh63, skywf21
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#include "ir/optimize/passes/loop_unrolling.h"
+
+#include <algorithm>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+#include "assembly/generate/context.h"
+#include "ir/optimize/analysis/cfg.h"
+#include "ir/optimize/analysis/counted_loop.h"
+#include "ir/optimize/analysis/liveness.h"
+
+namespace syc::ir::passes {
+namespace {
+using analysis::CountedLoop;
+using analysis::exit_jump;
+using analysis::holds;
+
+// 展开后的循环体最多包含的指令数
+constexpr int unroll_budget = 64;
+constexpr int max_unroll_factor = 4;
+// 完全展开后最多包含的指令数
+constexpr int full_unroll_budget = 128;
+// 已展开过的循环在头部带有该标记，不再重复展开
+const char unrolled_marker[] = "UNROLLED";
+// 向量化生成的循环与作为其尾声的原循环不再展开
+const char vectorized_marker[] = "VECTORIZED";
+
+bool is_cond_jump(OpCode op_code) {
+  return op_code == OpCode::JEQ || op_code == OpCode::JNE ||
+         op_code == OpCode::JLE || op_code == OpCode::JLT ||
+         op_code == OpCode::JGE || op_code == OpCode::JGT;
+}
+bool is_jump(OpCode op_code) {
+  return op_code == OpCode::JMP || is_cond_jump(op_code);
+}
+
+class LoopUnrolling {
+ public:
+  LoopUnrolling(IRList &ir, analysis::Function &function,
+                const analysis::Liveness &liveness)
+      : ir(ir), function(function), liveness(liveness) {}
+
+  bool run() {
+    analysis::CountedLoops analysis(this->ir, this->function);
+    std::vector<CountedLoop> loops;
+    for (auto &loop : this->function.loops) {
+      if (!loop->children.empty()) continue;
+      auto counted = analysis.analyze(loop.get());
+      if (counted && !counted->has_marker(unrolled_marker) &&
+          !counted->has_marker(vectorized_marker))
+        loops.push_back(std::move(*counted));
+    }
+    bool changed = false;
+    for (auto &loop : loops) {
+      auto trip = this->trip_count(loop);
+      if (trip && *trip > 0 && *trip * loop.size <= full_unroll_budget)
+        changed |= this->unroll_fully(loop, *trip);
+      else
+        changed |= this->unroll(loop);
+    }
+    return changed;
+  }
+
+ private:
+  IRList &ir;
+  analysis::Function &function;
+  const analysis::Liveness &liveness;
+
+  // 循环内同时活跃的变量数的最大值
+  int pressure(const CountedLoop &loop) {
+    int ret = 0;
+    for (auto *block : loop.loop->blocks)
+      ret = std::max(ret, this->liveness.pressure(block));
+    return ret;
+  }
+
+  std::optional<int> trip_count(const CountedLoop &loop) {
+    auto init = loop.initial_value(loop.var.id);
+    if (!init || !loop.bound.is_imm()) return std::nullopt;
+    int ret = 0;
+    for (long long i = *init; holds(loop.relation, int(i), loop.bound.value);
+         i += loop.step) {
+      if (++ret * loop.size > full_unroll_budget) return std::nullopt;
+      if (i + loop.step < INT32_MIN || i + loop.step > INT32_MAX)
+        return std::nullopt;
+    }
+    return ret;
+  }
+
+  // 复制一次循环体，读取的循环变量替换为 values 中的当前值，
+  // 之后 values 更新为这次迭代结束时的值
+  void copy_body(const CountedLoop &loop, IRList &out,
+                 std::unordered_map<int, OpName> &values,
+                 const std::string &suffix) {
+    std::unordered_map<int, OpName> renamed;
+    auto use = [&](OpName &op) {
+      if (!op.is_var()) return;
+      auto value = values.find(op.id);
+      if (value != values.end()) {
+        op = value->second;
+      } else if (loop.body_vars.count(op.id)) {
+        auto [it, inserted] = renamed.insert({op.id, OpName()});
+        if (inserted) it->second = OpName(op.name() + suffix);
+        op = it->second;
+      }
+    };
+    std::unordered_map<const IR *, IRList::iterator> labels;
+    std::vector<std::pair<IRList::iterator, const IR *>> phi_moves;
+    for (auto it = loop.body; it != loop.tail; it++) {
+      auto copy = out.insert(out.end(), *it);
+      for (auto *op : {&copy->dest, &copy->op1, &copy->op2, &copy->op3})
+        use(*op);
+      if (copy->op_code == OpCode::LABEL || is_jump(copy->op_code))
+        copy->label += suffix;
+      if (copy->op_code == OpCode::LABEL) labels[&*it] = copy;
+      if (copy->op_code == OpCode::PHI_MOV)
+        phi_moves.push_back({copy, &*it->phi_block});
+    }
+    // 汇合于循环体内的 PHI_MOV 指向复制出的标号，其余的（如 continue 处）不变
+    for (auto [phi_move, label] : phi_moves) {
+      auto it = labels.find(label);
+      if (it != labels.end()) phi_move->phi_block = it->second;
+    }
+    // 回边上的赋值按顺序执行
+    for (auto it : loop.phi_moves) {
+      auto value = it->op1;
+      use(value);
+      values[it->dest.id] = value;
+    }
+  }
+
+  // 在 out 末尾给循环变量赋上 values 中的值，phi_block 为汇合处。
+  // 已被赋值的循环变量不能再作为其他变量的值
+  bool assign_loop_vars(const CountedLoop &loop, IRList &out,
+                        const std::unordered_map<int, OpName> &values,
+                        IRList::iterator phi_block) {
+    std::unordered_set<int> assigned;
+    for (auto it : loop.phi_moves) {
+      auto &value = values.at(it->dest.id);
+      if (value.is_var() && assigned.count(value.id)) return false;
+      if (value == it->dest) continue;
+      out.emplace_back(OpCode::PHI_MOV, it->dest, value);
+      out.back().phi_block = phi_block;
+      assigned.insert(it->dest.id);
+    }
+    return true;
+  }
+
+  std::string suffix_of(const CountedLoop &loop) {
+    auto &label = loop.header->label;
+    return "." + (label.starts_with(".L.") ? label.substr(3) : label);
+  }
+
+  // 展开 factor 次的循环放在原循环之前，每次迭代前确认还剩至少 factor 次，
+  // 剩余的迭代由原循环完成。边界为变量时在入口处排除 var + distance 可能
+  // 溢出的情形，循环中不必再多占一个寄存器保存 bound - distance：
+  //   CMP bound max; J<cc> header; CMP var bound; J<exit> header
+  //   LABEL header.U; ADD last var distance; CMP last bound; J<exit> header
+  //   body × factor; PHI_MOV ...; JMP header.U
+  bool unroll(const CountedLoop &loop) {
+    if (loop.has_call) return false;
+    // 展开后相邻的副本会同时活跃，寄存器已不够用时展开只会带来溢出
+    if (this->pressure(loop) >= syc::assembly::Context::reg_count)
+      return false;
+    int factor = max_unroll_factor;
+    while (factor > 1 && factor * loop.size > unroll_budget) factor /= 2;
+    if (factor < 2) return false;
+
+    auto suffix = this->suffix_of(loop);
+    long long distance = (long long)(factor - 1) * loop.step;
+    // 边界为常数时直接比较 var 与 bound - distance，否则要求 bound 不超过 max。
+    // 进入展开的循环时 var 至多为 bound - distance（步长为负时为至少，下同），
+    // 一次迭代后至多为 bound + step，再加 distance 为 bound + factor * step，
+    // 不能溢出
+    long long headroom = (long long)factor * loop.step;
+    long long max = loop.bound.is_imm() ? loop.bound.value - distance
+                    : loop.step > 0     ? INT32_MAX - headroom
+                                        : INT32_MIN - headroom;
+    if (max < INT32_MIN || max > INT32_MAX) return false;
+    IRList code;
+    if (loop.bound.is_var()) {
+      code.emplace_back(OpCode::CMP, OpName(), loop.bound, int(max));
+      code.emplace_back(loop.step > 0 ? OpCode::JGT : OpCode::JLT,
+                        loop.header->label);
+      code.emplace_back(OpCode::CMP, OpName(), loop.var, loop.bound);
+      code.emplace_back(exit_jump(loop.relation), loop.header->label);
+    }
+    code.emplace_back(OpCode::LABEL, loop.header->label + ".U");
+    auto header = std::prev(code.end());
+    code.emplace_back(OpCode::INFO, unrolled_marker);
+    if (loop.bound.is_var()) {
+      OpName last("%" + suffix.substr(1) + ".LAST");
+      code.emplace_back(OpCode::ADD, last, loop.var, int(distance));
+      code.emplace_back(OpCode::CMP, OpName(), last, loop.bound);
+    } else {
+      code.emplace_back(OpCode::CMP, OpName(), loop.var, int(max));
+    }
+    code.emplace_back(exit_jump(loop.relation), loop.header->label);
+
+    std::unordered_map<int, OpName> values;
+    for (int i = 1; i <= factor; i++)
+      this->copy_body(loop, code, values, suffix + ".U" + std::to_string(i));
+    if (!this->assign_loop_vars(loop, code, values, header)) return false;
+    code.emplace_back(OpCode::JMP, header->label);
+
+    this->ir.splice(loop.header, code);
+    this->ir.insert(std::next(loop.header), IR(OpCode::INFO, unrolled_marker));
+    return true;
+  }
+
+  // 把迭代次数为常数 trip 的循环替换为 trip 份循环体
+  bool unroll_fully(const CountedLoop &loop, int trip) {
+    for (auto it = std::next(loop.jump); it != loop.exit; it++) {
+      if (it->op_code != OpCode::NOOP && it->op_code != OpCode::INFO)
+        return false;
+    }
+    auto suffix = this->suffix_of(loop);
+    std::unordered_map<int, OpName> values;
+    for (auto var : loop.loop_vars) {
+      if (auto init = loop.initial_value(var)) values[var] = *init;
+    }
+    IRList code;
+    for (int i = 1; i <= trip; i++)
+      this->copy_body(loop, code, values, suffix + ".F" + std::to_string(i));
+    if (!this->assign_loop_vars(loop, code, values, loop.exit)) return false;
+
+    this->ir.splice(loop.header, code);
+    for (auto it = this->function.begin; it != this->function.end; it++) {
+      if (it->op_code == OpCode::PHI_MOV && it->phi_block == loop.header)
+        it->phi_block = loop.exit;
+    }
+    this->ir.erase(loop.header, loop.exit);
+    return true;
+  }
+};
+}  // namespace
+
+bool loop_unrolling(IRList &ir, analysis::AnalysisManager &am) {
+  bool changed = false;
+  for (auto &function : am.functions()) {
+    if (function.loops.empty()) continue;
+    changed |= LoopUnrolling(ir, function, am.liveness(function)).run();
+  }
+  return changed;
+}
+}  // namespace syc::ir::passes
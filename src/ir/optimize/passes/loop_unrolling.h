@@ -0,0 +1,26 @@
+/*
+ * syc, a compiler for SysY
+ * Copyright (C) 2020-2021  nzh63, skywf21
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#pragma once
+#include "ir/ir.h"
+#include "ir/optimize/analysis/analysis_manager.h"
+
+namespace syc::ir::passes {
+// 展开最内层的计数循环：迭代次数为小常数时完全展开，
+// 否则按循环体大小展开若干次，原循环保留下来执行余下的迭代
+bool loop_unrolling(IRList &ir, analysis::AnalysisManager &am);
+}  // namespace syc::ir::passes
@@ -0,0 +1,666 @@
+/*
+ * syc, a compiler for SysY
+ * Copyright (C) 2020-2021  nzh63, skywf21
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#include "ir/optimize/passes/loop_vectorization.h"
+
+#include <algorithm>
+#include <climits>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "config.h"
+#include "ir/optimize/analysis/alias.h"
+#include "ir/optimize/analysis/counted_loop.h"
+
+namespace syc::ir::passes {
+namespace {
+using analysis::CountedLoop;
+using analysis::exit_jump;
+using analysis::Relation;
+
+// 每个向量的元素个数与元素的字节数
+constexpr int lanes = 4;
+constexpr int element_size = 4;
+// 可以使用的 q 寄存器，q4-q7 由被调用者保存，不使用
+constexpr int vector_regs[] = {15, 14, 13, 12, 11, 10, 9, 8, 3, 2, 1, 0};
+// 向量化生成的循环与作为其尾声的原循环带有该标记，不再重复向量化
+const char vectorized_marker[] = "VECTORIZED";
+// 已展开的循环不再向量化
+const char unrolled_marker[] = "UNROLLED";
+
+bool is_jump(OpCode op_code) {
+  return op_code == OpCode::JMP || op_code == OpCode::JEQ ||
+         op_code == OpCode::JNE || op_code == OpCode::JLE ||
+         op_code == OpCode::JLT || op_code == OpCode::JGE ||
+         op_code == OpCode::JGT;
+}
+
+// 循环体中的值随迭代变化的方式
+struct Shape {
+  enum Kind {
+    Uniform,  // 各次迭代相同
+    Linear,   // scale * 归纳变量 + 循环不变量
+    Vector,   // 其他，向量化后每个元素对应一次迭代
+  };
+  Kind kind;
+  long long scale = 0;
+};
+
+// 回边上的 var = var + value 或 var = var - value，在向量寄存器 reg 中分别累加
+struct Reduction {
+  OpName var;
+  const IR *def;
+  OpName value;
+  int reg = -1;
+};
+
+// 向量化一个计数循环。
+// 循环体中只由归纳变量与循环不变量经加减、乘以常数得到的值按标量计算，
+// 以 4 字节为步长访问的数组元素与由它们算出的值按向量计算，
+// 循环变量除归纳变量外只能是加减的归约。向量循环放在原循环之前：
+//   检查迭代次数与运行时别名，不满足时直接进入原循环
+//   LABEL header.V; ADD last var 3; CMP last bound; J<exit> header.VE
+//   向量化的循环体; ADD next var 4; PHI_MOV var next; JMP header.V
+//   LABEL header.VE; 归约的结果加到循环变量上
+// 原循环完成剩余的迭代
+class Vectorizer {
+ public:
+  Vectorizer(IRList &ir, const analysis::AliasAnalysis &alias,
+             const CountedLoop &loop)
+      : ir(ir), alias(alias), loop(loop), free_regs(std::begin(vector_regs),
+                                                    std::end(vector_regs)) {
+    auto &label = loop.header->label;
+    this->suffix = "." + (label.starts_with(".L.") ? label.substr(3) : label);
+  }
+
+  bool run() {
+    if (!this->analyze()) return false;
+    IRList guard, setup, code;
+    if (!this->generate_guard(guard) || !this->generate_body(setup, code))
+      return false;
+
+    guard.splice(guard.end(), setup);
+    guard.splice(guard.end(), code);
+    this->ir.splice(this->loop.header, guard);
+    this->ir.insert(std::next(this->loop.header),
+                    IR(OpCode::INFO, vectorized_marker));
+    return true;
+  }
+
+ private:
+  IRList &ir;
+  const analysis::AliasAnalysis &alias;
+  const CountedLoop &loop;
+  std::string suffix;
+
+  // 循环体中除 NOOP 与 INFO 外的指令及其中各变量的定值、使用次数
+  std::vector<IRList::iterator> insts;
+  std::unordered_map<int, IRList::iterator> defs;
+  std::unordered_map<int, int> uses;
+  std::unordered_map<int, Shape> shapes;
+  std::vector<Reduction> reductions;
+  // 唯一的一次数组写入
+  std::optional<IRList::iterator> store;
+
+  // 向量 MOV 的目标与来源共用寄存器；只被一次 ADD 使用的向量乘法与之合并为 VMLA
+  std::unordered_map<int, int> same_as;
+  // 合并后的 ADD 与乘法，分别对应另一方在 insts 中的下标
+  std::unordered_map<const IR *, std::size_t> fused, fused_into;
+  // 向量值最后一次被使用的指令下标，及其所在的寄存器
+  std::unordered_map<int, std::size_t> last_use;
+  std::unordered_map<int, int> reg_of;
+  std::unordered_map<OpName, int> broadcast;
+  std::vector<int> free_regs;
+  bool out_of_regs = false;
+
+  std::unordered_map<int, OpName> renamed, cloned;
+  int temps = 0;
+
+  OpName temp() {
+    return OpName("%" + this->suffix.substr(1) + ".VC" +
+                  std::to_string(this->temps++));
+  }
+  std::string label(const std::string &name) {
+    return this->loop.header->label + "." + name;
+  }
+
+  const Reduction *reduction_of(const IR &ir) {
+    for (auto &reduction : this->reductions)
+      if (reduction.def == &ir) return &reduction;
+    return nullptr;
+  }
+  bool invariant(const OpName &op) {
+    return op.is_imm() ||
+           (op.is_var() && !this->loop.body_vars.count(op.id) &&
+            !this->loop.loop_vars.count(op.id));
+  }
+  std::optional<Shape> shape_of(const OpName &op) {
+    if (op.is_imm()) return Shape{Shape::Uniform};
+    if (!op.is_var()) return std::nullopt;
+    if (op == this->loop.var) return Shape{Shape::Linear, 1};
+    auto it = this->shapes.find(op.id);
+    if (it != this->shapes.end()) return it->second;
+    if (!this->invariant(op)) return std::nullopt;
+    return Shape{Shape::Uniform};
+  }
+  bool is_vector(const OpName &op) {
+    auto shape = this->shape_of(op);
+    return shape && shape->kind == Shape::Vector;
+  }
+  int resolve(int var) {
+    auto it = this->same_as.find(var);
+    return it == this->same_as.end() ? var : it->second;
+  }
+
+  std::optional<Shape> arithmetic(const IR &ir) {
+    auto a = this->shape_of(ir.op1), b = this->shape_of(ir.op2);
+    if (!a || !b) return std::nullopt;
+    if (a->kind == Shape::Vector || b->kind == Shape::Vector) {
+      if (a->kind == Shape::Linear || b->kind == Shape::Linear)
+        return std::nullopt;
+      return Shape{Shape::Vector};
+    }
+    if (a->kind == Shape::Uniform && b->kind == Shape::Uniform)
+      return Shape{Shape::Uniform};
+    long long scale;
+    switch (ir.op_code) {
+      case OpCode::ADD:
+        scale = a->scale + b->scale;
+        break;
+      case OpCode::SUB:
+        scale = a->scale - b->scale;
+        break;
+      case OpCode::IMUL:
+        if (ir.op2.is_imm())
+          scale = a->scale * ir.op2.value;
+        else if (ir.op1.is_imm())
+          scale = b->scale * ir.op1.value;
+        else
+          return std::nullopt;
+        break;
+      case OpCode::SAL:
+        if (!ir.op2.is_imm() || ir.op2.value < 0 || ir.op2.value >= 31)
+          return std::nullopt;
+        scale = a->scale * (1ll << ir.op2.value);
+        break;
+      default:
+        return std::nullopt;
+    }
+    if (scale < INT_MIN || scale > INT_MAX) return std::nullopt;
+    return Shape{scale == 0 ? Shape::Uniform : Shape::Linear, scale};
+  }
+  bool is_stream(const OpName &offset) {
+    auto shape = this->shape_of(offset);
+    return shape && shape->kind == Shape::Linear &&
+           shape->scale == element_size;
+  }
+
+  bool analyze() {
+    if (this->loop.has_call || this->loop.step != 1 ||
+        (this->loop.relation != Relation::LT &&
+         this->loop.relation != Relation::LE))
+      return false;
+    // 迭代次数为常数且不足一个向量时不处理
+    auto init = this->loop.initial_value(this->loop.var.id);
+    if (init && this->loop.bound.is_imm() &&
+        (long long)this->loop.bound.value - *init < lanes)
+      return false;
+
+    for (auto it = this->loop.body; it != this->loop.tail; it++) {
+      // 循环体中没有跳转，其中的标号（如 continue 处）不会被用到
+      if (it->op_code == OpCode::NOOP || it->op_code == OpCode::INFO ||
+          it->op_code == OpCode::LABEL)
+        continue;
+      if (it->op_code == OpCode::PHI_MOV || is_jump(it->op_code)) return false;
+      this->insts.push_back(it);
+      if (it->dest.is_var()) this->defs[it->dest.id] = it;
+      it->forEachOp(
+          [&](const OpName &op) {
+            if (op.is_var()) this->uses[op.id]++;
+          },
+          false);
+    }
+
+    for (auto phi : this->loop.phi_moves) {
+      auto &var = phi->dest, &next = phi->op1;
+      if (var == this->loop.var) continue;
+      if (!next.is_var() || !this->defs.count(next.id) ||
+          this->uses[next.id] != 0 || this->uses[var.id] != 1)
+        return false;
+      auto &def = *this->defs.at(next.id);
+      if (def.op_code == OpCode::ADD && def.op1 == var)
+        this->reductions.push_back({var, &def, def.op2});
+      else if (def.op_code == OpCode::ADD && def.op2 == var)
+        this->reductions.push_back({var, &def, def.op1});
+      else if (def.op_code == OpCode::SUB && def.op1 == var)
+        this->reductions.push_back({var, &def, def.op2});
+      else
+        return false;
+    }
+
+    bool has_stream = false;
+    for (auto it : this->insts) {
+      auto &ir = *it;
+      if (auto *reduction = this->reduction_of(ir)) {
+        auto shape = this->shape_of(reduction->value);
+        if (!shape || shape->kind == Shape::Linear) return false;
+        continue;
+      }
+      std::optional<Shape> shape;
+      switch (ir.op_code) {
+        case OpCode::MOV:
+          shape = this->shape_of(ir.op1);
+          if (shape && shape->kind == Shape::Vector)
+            this->same_as[ir.dest.id] = this->resolve(ir.op1.id);
+          break;
+        case OpCode::ADD:
+        case OpCode::SUB:
+        case OpCode::IMUL:
+        case OpCode::SAL:
+          shape = this->arithmetic(ir);
+          break;
+        case OpCode::SAR:
+        case OpCode::AND:
+        case OpCode::OR:
+        case OpCode::IDIV: {
+          // MOD 与除数非常数的 IDIV 由后端调用 __aeabi_idiv(mod)
+          // 实现，会破坏 q 寄存器，与 CALL 一样不能向量化
+          if (ir.op_code == OpCode::IDIV && !ir.op2.is_imm()) return false;
+          auto a = this->shape_of(ir.op1), b = this->shape_of(ir.op2);
+          if (a && b && a->kind == Shape::Uniform &&
+              b->kind == Shape::Uniform)
+            shape = Shape{Shape::Uniform};
+          break;
+        }
+        case OpCode::LOAD:
+          if (!this->invariant(ir.op1)) break;
+          if (this->is_stream(ir.op2)) {
+            shape = Shape{Shape::Vector};
+            has_stream = true;
+          } else if (auto offset = this->shape_of(ir.op2);
+                     offset && offset->kind == Shape::Uniform) {
+            shape = Shape{Shape::Uniform};
+          } else {
+            break;
+          }
+          break;
+        case OpCode::STORE: {
+          auto value = this->shape_of(ir.op3);
+          if (this->store || !this->invariant(ir.op1) ||
+              !this->is_stream(ir.op2) || !value ||
+              value->kind == Shape::Linear)
+            return false;
+          this->store = it;
+          has_stream = true;
+          continue;
+        }
+        default:
+          break;
+      }
+      if (!shape || !ir.dest.is_var()) return false;
+      this->shapes[ir.dest.id] = *shape;
+    }
+    return has_stream;
+  }
+
+  // 在 guard 中按循环体中的计算链求出 op 在第一次迭代时的值
+  std::optional<OpName> clone(const OpName &op, IRList &guard) {
+    if (!op.is_var() || !this->loop.body_vars.count(op.id)) return op;
+    auto found = this->cloned.find(op.id);
+    if (found != this->cloned.end()) return found->second;
+    auto def = this->defs.at(op.id);
+    // 读取内存或除法在循环一次也不执行时可能出错
+    if (def->op_code == OpCode::LOAD || def->op_code == OpCode::IDIV ||
+        def->op_code == OpCode::MOD)
+      return std::nullopt;
+    IR copy = *def;
+    for (auto *operand : {&copy.op1, &copy.op2, &copy.op3}) {
+      auto value = this->clone(*operand, guard);
+      if (!value) return std::nullopt;
+      *operand = *value;
+    }
+    copy.dest = this->temp();
+    guard.push_back(copy);
+    return this->cloned[op.id] = copy.dest;
+  }
+  std::optional<OpName> address_of(const IR &access, IRList &guard) {
+    auto offset = this->clone(access.op2, guard);
+    if (!offset) return std::nullopt;
+    auto ret = this->temp();
+    guard.emplace_back(OpCode::ADD, ret, access.op1, *offset);
+    return ret;
+  }
+
+  // 向量循环一次读入 4 个元素后才写入，原循环中读取的元素若被同一向量中更早的
+  // 迭代写过则不能向量化；读在写之后时相反。地址不能静态比较时在入口处检查
+  bool generate_guard(IRList &guard) {
+    auto &loop = this->loop;
+    if (loop.bound.is_var()) {
+      // 保证 last = var + 3 不会溢出，并排除一次也不执行的情形。
+      // 一次向量迭代后 var 至多为 bound + 1，last 至多为 bound + lanes
+      guard.emplace_back(OpCode::CMP, OpName(), loop.bound, INT_MAX - lanes);
+      guard.emplace_back(OpCode::JGT, loop.header->label);
+      guard.emplace_back(OpCode::CMP, OpName(), loop.var, loop.bound);
+      guard.emplace_back(exit_jump(loop.relation), loop.header->label);
+    } else {
+      long long max = (long long)loop.bound.value - (lanes - 1);
+      if (max < INT_MIN) return false;
+      guard.emplace_back(OpCode::CMP, OpName(), loop.var, int(max));
+      guard.emplace_back(exit_jump(loop.relation), loop.header->label);
+    }
+    if (!this->store) return true;
+
+    auto &store = **this->store;
+    auto store_location = this->alias.location_of(store);
+    std::size_t store_index =
+        std::find(this->insts.begin(), this->insts.end(), *this->store) -
+        this->insts.begin();
+    std::optional<OpName> store_address;
+    int checks = 0;
+    for (std::size_t i = 0; i < this->insts.size(); i++) {
+      auto &load = *this->insts[i];
+      if (load.op_code != OpCode::LOAD) continue;
+      auto location = this->alias.location_of(load);
+      if (!this->alias.may_alias(location.base, store_location.base)) continue;
+      bool stream = this->shapes.at(load.dest.id).kind == Shape::Vector;
+      bool before = i < store_index;
+      bool same_object =
+          location.base.kind == store_location.base.kind &&
+          location.base.id == store_location.base.id &&
+          (location.base.kind != analysis::MemoryBase::Unknown ||
+           location.base_var == store_location.base_var);
+      if (stream && same_object &&
+          location.offset.terms == store_location.offset.terms) {
+        int diff = int(unsigned(location.offset.constant) -
+                       unsigned(store_location.offset.constant));
+        if (before ? diff < 0 && diff > -lanes * element_size
+                   : diff > 0 && diff < lanes * element_size)
+          return false;
+        continue;
+      }
+
+      if (!store_address) store_address = this->address_of(store, guard);
+      auto address = this->address_of(load, guard);
+      if (!store_address || !address) return false;
+      auto diff = this->temp();
+      guard.emplace_back(OpCode::SUB, diff, *address, *store_address);
+      auto ok = this->label("VC" + std::to_string(checks++));
+      if (stream) {
+        // 相差不足一个向量且方向相反时进入原循环
+        guard.emplace_back(OpCode::CMP, OpName(), diff, 0);
+        guard.emplace_back(before ? OpCode::JGE : OpCode::JLE, ok);
+        guard.emplace_back(OpCode::CMP, OpName(), diff,
+                           before ? -lanes * element_size
+                                  : lanes * element_size);
+        guard.emplace_back(before ? OpCode::JGT : OpCode::JLT,
+                           loop.header->label);
+      } else {
+        // 固定的地址落在整个循环写入的区间内时进入原循环，
+        // 区间长度按 32 位计算，数组不超过 2GB
+        auto count = this->temp(), length = this->temp();
+        guard.emplace_back(OpCode::SUB, count, loop.bound, loop.var);
+        if (loop.relation == Relation::LE)
+          guard.emplace_back(OpCode::ADD, count, count, 1);
+        guard.emplace_back(OpCode::SAL, length, count, 2);
+        guard.emplace_back(OpCode::CMP, OpName(), diff, 0);
+        guard.emplace_back(OpCode::JLT, ok);
+        guard.emplace_back(OpCode::CMP, OpName(), diff, length);
+        guard.emplace_back(OpCode::JLT, loop.header->label);
+      }
+      guard.emplace_back(OpCode::LABEL, ok);
+    }
+    return true;
+  }
+
+  int allocate() {
+    if (this->free_regs.empty()) {
+      this->out_of_regs = true;
+      return 0;
+    }
+    int ret = this->free_regs.back();
+    this->free_regs.pop_back();
+    return ret;
+  }
+  void release(int var) {
+    auto it = this->reg_of.find(var);
+    if (it == this->reg_of.end()) return;
+    this->free_regs.push_back(it->second);
+    this->reg_of.erase(it);
+  }
+
+  OpName rename(const OpName &op) {
+    if (!op.is_var() || !this->loop.body_vars.count(op.id)) return op;
+    auto [it, inserted] = this->renamed.insert({op.id, OpName()});
+    if (inserted) it->second = OpName(op.name() + this->suffix + ".V");
+    return it->second;
+  }
+
+  // 向量化后需要放在 q 寄存器中的操作数
+  std::vector<OpName> vector_operands(const IR &ir) {
+    if (auto *reduction = this->reduction_of(ir)) return {reduction->value};
+    if (ir.op_code == OpCode::STORE) return {ir.op3};
+    if (ir.op_code == OpCode::LOAD || !this->is_vector(ir.dest)) return {};
+    if (ir.op_code == OpCode::MOV) return {ir.op1};
+    return {ir.op1, ir.op2};
+  }
+  // 向量操作数所在的寄存器：循环不变量在进入循环前广播一次，
+  // 循环体中的标量在使用前广播到临时寄存器
+  int reg_of_operand(const OpName &op, IRList &code, std::vector<int> &temps) {
+    if (this->is_vector(op)) return this->reg_of.at(this->resolve(op.id));
+    if (this->invariant(op)) return this->broadcast.at(op);
+    int ret = this->allocate();
+    temps.push_back(ret);
+    code.emplace_back(OpCode::VDUP, ret, this->rename(op));
+    return ret;
+  }
+
+  // 找出可以合并为 VMLA 的乘法，并求出各向量值最后一次被使用的位置
+  void plan() {
+    std::unordered_map<int, std::size_t> index;
+    for (std::size_t i = 0; i < this->insts.size(); i++) {
+      auto &ir = *this->insts[i];
+      if (ir.dest.is_var()) index[ir.dest.id] = i;
+      if (ir.op_code != OpCode::ADD ||
+          (!this->is_vector(ir.dest) && !this->reduction_of(ir)))
+        continue;
+      for (auto &op : {ir.op1, ir.op2}) {
+        if (!op.is_var() || !index.count(op.id) || this->uses[op.id] != 1)
+          continue;
+        auto &product = *this->insts[index.at(op.id)];
+        if (product.op_code != OpCode::IMUL || !this->is_vector(op)) continue;
+        this->fused[&ir] = index.at(op.id);
+        this->fused_into[&product] = i;
+        break;
+      }
+    }
+    for (std::size_t i = 0; i < this->insts.size(); i++) {
+      auto &ir = *this->insts[i];
+      auto product = this->fused_into.find(&ir);
+      // 合并的乘法的操作数在 VMLA 处使用
+      auto at = product == this->fused_into.end() ? i : product->second;
+      for (auto &op : this->vector_operands(ir)) {
+        if (!this->is_vector(op)) continue;
+        auto &last = this->last_use[this->resolve(op.id)];
+        last = std::max(last, at);
+      }
+    }
+  }
+
+  bool generate_body(IRList &setup, IRList &code) {
+    auto &loop = this->loop;
+    this->plan();
+    // 累加器与广播的循环不变量在整个循环中占用寄存器，先分配
+    for (auto &reduction : this->reductions) {
+      reduction.reg = this->allocate();
+      setup.emplace_back(OpCode::VDUP, reduction.reg, 0);
+    }
+    for (auto it : this->insts) {
+      for (auto &op : this->vector_operands(*it)) {
+        if (this->is_vector(op) || !this->invariant(op) ||
+            this->broadcast.count(op))
+          continue;
+        this->broadcast[op] = this->allocate();
+        setup.emplace_back(OpCode::VDUP, this->broadcast.at(op), op);
+      }
+    }
+
+    code.emplace_back(OpCode::LABEL, this->label("V"));
+    auto header = std::prev(code.end());
+    code.emplace_back(OpCode::INFO, vectorized_marker);
+    if (loop.bound.is_var()) {
+      auto last = this->temp();
+      code.emplace_back(OpCode::ADD, last, loop.var, lanes - 1);
+      code.emplace_back(OpCode::CMP, OpName(), last, loop.bound);
+    } else {
+      code.emplace_back(OpCode::CMP, OpName(), loop.var,
+                        int((long long)loop.bound.value - (lanes - 1)));
+    }
+    code.emplace_back(exit_jump(loop.relation), this->label("VE"));
+
+    for (std::size_t i = 0; i < this->insts.size(); i++) {
+      auto &ir = *this->insts[i];
+      std::vector<int> temps;
+      auto release_dead = [&](const IR &inst) {
+        for (auto &op : this->vector_operands(inst)) {
+          if (this->is_vector(op) &&
+              this->last_use.at(this->resolve(op.id)) == i)
+            this->release(this->resolve(op.id));
+        }
+        this->free_regs.insert(this->free_regs.end(), temps.begin(),
+                               temps.end());
+        temps.clear();
+      };
+      auto fused = this->fused.find(&ir);
+      const IR *product =
+          fused == this->fused.end() ? nullptr : &*this->insts[fused->second];
+      std::optional<int> dest;
+
+      if (auto *reduction = this->reduction_of(ir)) {
+        if (product) {
+          int a = this->reg_of_operand(product->op1, code, temps);
+          int b = this->reg_of_operand(product->op2, code, temps);
+          code.emplace_back(OpCode::VMLA, reduction->reg, a, b);
+          release_dead(*product);
+        } else {
+          int value = this->reg_of_operand(reduction->value, code, temps);
+          code.emplace_back(
+              ir.op_code == OpCode::ADD ? OpCode::VADD : OpCode::VSUB,
+              reduction->reg, reduction->reg, value);
+        }
+        release_dead(ir);
+      } else if (this->fused_into.count(&ir)) {
+        // 在使用它的 ADD 处生成 VMLA
+      } else if (ir.op_code == OpCode::STORE) {
+        int value = this->reg_of_operand(ir.op3, code, temps);
+        code.emplace_back(OpCode::VSTORE, OpName(), this->rename(ir.op1),
+                          this->rename(ir.op2), value);
+        release_dead(ir);
+      } else if (!this->is_vector(ir.dest)) {
+        IR copy = ir;
+        for (auto *op : {&copy.dest, &copy.op1, &copy.op2, &copy.op3})
+          *op = this->rename(*op);
+        code.push_back(copy);
+      } else if (ir.op_code == OpCode::LOAD) {
+        dest = this->allocate();
+        code.emplace_back(OpCode::VLOAD, *dest, this->rename(ir.op1),
+                          this->rename(ir.op2));
+      } else if (ir.op_code == OpCode::MOV) {
+        // 与来源共用寄存器
+        release_dead(ir);
+      } else if (product) {
+        auto &other = ir.op1 == product->dest ? ir.op2 : ir.op1;
+        int a = this->reg_of_operand(product->op1, code, temps);
+        int b = this->reg_of_operand(product->op2, code, temps);
+        int c = this->reg_of_operand(other, code, temps);
+        auto temp = std::find(temps.begin(), temps.end(), c);
+        if (temp != temps.end()) {
+          temps.erase(temp);
+          dest = c;
+        } else if (this->is_vector(other) &&
+                   this->last_use.at(this->resolve(other.id)) == i) {
+          this->reg_of.erase(this->resolve(other.id));
+          dest = c;
+        }
+        if (dest) {
+          // 另一个加数在此之后不再使用，直接累加到它的寄存器中
+          code.emplace_back(OpCode::VMLA, *dest, a, b);
+          release_dead(*product);
+          release_dead(ir);
+        } else {
+          release_dead(*product);
+          release_dead(ir);
+          dest = this->allocate();
+          code.emplace_back(OpCode::VMUL, *dest, a, b);
+          code.emplace_back(OpCode::VADD, *dest, *dest, c);
+        }
+      } else {
+        int a = this->reg_of_operand(ir.op1, code, temps);
+        int b = this->reg_of_operand(ir.op2, code, temps);
+        release_dead(ir);
+        dest = this->allocate();
+        auto op_code = ir.op_code == OpCode::ADD   ? OpCode::VADD
+                       : ir.op_code == OpCode::SUB ? OpCode::VSUB
+                                                   : OpCode::VMUL;
+        code.emplace_back(op_code, *dest, a, b);
+      }
+      if (dest) {
+        this->reg_of[ir.dest.id] = *dest;
+        if (!this->last_use.count(ir.dest.id)) this->release(ir.dest.id);
+      }
+    }
+    if (this->out_of_regs) return false;
+
+    auto next = this->temp();
+    code.emplace_back(OpCode::ADD, next, loop.var, lanes);
+    code.emplace_back(OpCode::PHI_MOV, loop.var, next);
+    code.back().phi_block = header;
+    code.emplace_back(OpCode::JMP, header->label);
+    code.emplace_back(OpCode::LABEL, this->label("VE"));
+    for (auto &reduction : this->reductions) {
+      auto sum = this->temp(), value = this->temp();
+      code.emplace_back(OpCode::VREDUCE, sum, reduction.reg);
+      code.emplace_back(OpCode::ADD, value, reduction.var, sum);
+      code.emplace_back(OpCode::PHI_MOV, reduction.var, value);
+      code.back().phi_block = loop.header;
+    }
+    return true;
+  }
+};
+}  // namespace
+
+bool loop_vectorization(IRList &ir, analysis::AnalysisManager &am) {
+  if (!config::neon) return false;
+  bool changed = false;
+  for (auto &function : am.functions()) {
+    if (function.loops.empty()) continue;
+    analysis::CountedLoops analysis(ir, function);
+    std::vector<CountedLoop> loops;
+    for (auto &loop : function.loops) {
+      if (!loop->children.empty()) continue;
+      auto counted = analysis.analyze(loop.get());
+      if (counted && !counted->has_marker(vectorized_marker) &&
+          !counted->has_marker(unrolled_marker))
+        loops.push_back(std::move(*counted));
+    }
+    auto &alias = am.alias(function);
+    for (auto &loop : loops) changed |= Vectorizer(ir, alias, loop).run();
+  }
+  return changed;
+}
+}  // namespace syc::ir::passes
@@ -0,0 +1,26 @@
+/*
+ * syc, a compiler for SysY
+ * Copyright (C) 2020-2021  nzh63, skywf21
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#pragma once
+#include "ir/ir.h"
+#include "ir/optimize/analysis/analysis_manager.h"
+
+namespace syc::ir::passes {
+// 用 NEON 指令向量化循环体只有一个基本块、按下标连续访问 int 数组的计数循环，
+// 每次迭代处理 4 个元素，剩余的迭代由原循环完成。只在 -mfpu=neon 时生效
+bool loop_vectorization(IRList &ir, analysis::AnalysisManager &am);
+}  // namespace syc::ir::passes
@@ -17,6 +17,8 @@
  */
 #include "ir/optimize/passes/optimize_phi_var.h"
 
+#include <unordered_map>
+
 #include "assembly/generate/context.h"
 #include "config.h"
 #include "ir/ir.h"
@@ -29,30 +31,29 @@ namespace syc::ir::passes {
 // MOV %43, some_thing  # rename %42 to %43
 // ...
 // PHI_MOV %43, %43
-void optimize_phi_var(IRList &ir) {
-  std::map<std::string, int> use_count;
-  std::map<std::string, std::string> replace_table;
+bool optimize_phi_var(IRList &ir) {
+  std::unordered_map<int, int> use_count;
+  std::unordered_map<int, int> replace_table;
   for (const auto &i : ir) {
     i.forEachOp(
         [&](OpName op) {
           if (op.is_var()) {
-            if (use_count.find(op.name) == use_count.end())
-              use_count[op.name] = 0;
-            use_count[op.name]++;
+            if (use_count.find(op.id) == use_count.end()) use_count[op.id] = 0;
+            use_count[op.id]++;
           }
         },
         false);
   }
   for (auto it = ir.begin(); it != ir.end(); it++) {
     if (it->op_code == OpCode::PHI_MOV) {
-      if (it->op1.is_var() && use_count[it->op1.name] == 1) {
+      if (it->op1.is_var() && use_count[it->op1.id] == 1) {
         int line = 10;
         if (it == ir.begin()) continue;
         auto it2 = it;
         do {
           it2 = std::prev(it2);
-          if (it2->dest.is_var() && it2->dest.name == it->op1.name) {
-            replace_table[it2->dest.name] = it->dest.name;
+          if (it2->dest.is_var() && it2->dest.id == it->op1.id) {
+            replace_table[it2->dest.id] = it->dest.id;
           }
         } while (it2 != ir.begin());
       }
@@ -61,11 +62,13 @@ void optimize_phi_var(IRList &ir) {
   for (auto &i : ir) {
     i.forEachOp([&](OpName op) {
       if (op.is_var()) {
-        if (replace_table.find(op.name) != replace_table.end())
-          op.name = replace_table[op.name];
+        if (replace_table.find(op.id) != replace_table.end())
+          op.id = replace_table[op.id];
       }
     });
   }
+  // forEachOp 传给回调的是操作数的副本，上面的重命名不会写回 IR
+  return false;
 }
 
 }  // namespace syc::ir::passes
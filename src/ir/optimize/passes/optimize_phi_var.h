@@ -26,5 +26,5 @@ namespace syc::ir::passes {
 // =>
 // MOV %43, some_thing  # rename %42 to %43
 // PHI_MOV %43, %43
-void optimize_phi_var(IRList &ir);
+bool optimize_phi_var(IRList &ir);
 }  // namespace syc::ir::passes
@@ -0,0 +1,424 @@
+/*
+ * syc, a compiler for SysY
+ * Copyright (C) 2020-2021  nzh63, skywf21
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#include "ir/optimize/passes/sparse_conditional_constant_propagation.h"
+
+#include <climits>
+#include <cstdint>
+#include <optional>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+#include "config.h"
+#include "ir/ir.h"
+#include "ir/optimize/analysis/analysis_manager.h"
+#include "ir/optimize/analysis/cfg.h"
+
+namespace syc::ir::passes {
+namespace {
+using analysis::BasicBlock;
+
+// 常量格：Top（尚未求值）> 常量 > Bottom（不是常量）
+struct Lattice {
+  enum State : std::uint8_t { Top, Const, Bottom } state = Top;
+  int value = 0;
+
+  static Lattice constant(int value) { return {Const, value}; }
+  static Lattice bottom() { return {Bottom, 0}; }
+  bool is_const() const { return this->state == Const; }
+  bool operator==(const Lattice &other) const {
+    return this->state == other.state &&
+           (this->state != Const || this->value == other.value);
+  }
+};
+Lattice meet(Lattice a, Lattice b) {
+  if (a.state == Lattice::Top) return b;
+  if (b.state == Lattice::Top) return a;
+  if (a == b) return a;
+  return Lattice::bottom();
+}
+
+bool is_cond_jump(OpCode op_code) {
+  return op_code == OpCode::JEQ || op_code == OpCode::JNE ||
+         op_code == OpCode::JLE || op_code == OpCode::JLT ||
+         op_code == OpCode::JGE || op_code == OpCode::JGT;
+}
+bool is_cond_mov(OpCode op_code) {
+  return op_code == OpCode::MOVEQ || op_code == OpCode::MOVNE ||
+         op_code == OpCode::MOVLE || op_code == OpCode::MOVLT ||
+         op_code == OpCode::MOVGE || op_code == OpCode::MOVGT;
+}
+
+// 按 ARM 的语义折叠，除零、溢出的除法与越界的移位不折叠
+std::optional<int> fold(OpCode op_code, int a, int b) {
+  switch (op_code) {
+    case OpCode::ADD:
+      return int(unsigned(a) + unsigned(b));
+    case OpCode::SUB:
+      return int(unsigned(a) - unsigned(b));
+    case OpCode::IMUL:
+      return int(unsigned(a) * unsigned(b));
+    case OpCode::IDIV:
+      if (b == 0 || (a == INT_MIN && b == -1)) return std::nullopt;
+      return a / b;
+    case OpCode::MOD:
+      if (b == 0 || (a == INT_MIN && b == -1)) return std::nullopt;
+      return a % b;
+    case OpCode::SAL:
+      if (b < 0 || b > 31) return std::nullopt;
+      return int(unsigned(a) << b);
+    case OpCode::SAR:
+      if (b < 0 || b > 31) return std::nullopt;
+      return a >> b;
+    case OpCode::AND:
+      return (a & b) != 0;
+    case OpCode::OR:
+      return (a | b) != 0;
+    default:
+      return std::nullopt;
+  }
+}
+// CMP a, b 之后条件是否成立
+bool test_condition(OpCode op_code, int a, int b) {
+  switch (op_code) {
+    case OpCode::JEQ:
+    case OpCode::MOVEQ:
+      return a == b;
+    case OpCode::JNE:
+    case OpCode::MOVNE:
+      return a != b;
+    case OpCode::JLE:
+    case OpCode::MOVLE:
+      return a <= b;
+    case OpCode::JLT:
+    case OpCode::MOVLT:
+      return a < b;
+    case OpCode::JGE:
+    case OpCode::MOVGE:
+      return a >= b;
+    case OpCode::JGT:
+    case OpCode::MOVGT:
+      return a > b;
+    default:
+      return false;
+  }
+}
+
+// 在 CFG 上同时求解常量与可执行的块。
+// 除 PHI_MOV 的目的变量外局部变量只被赋值一次，PHI 变量取所有可执行定值的交汇，
+// 因此以变量为单位的格值在整个函数内成立。变量的格值下降时重新计算使用它的块
+class ConstantPropagation {
+ public:
+  ConstantPropagation(IRList &ir, analysis::Function &function)
+      : ir(ir),
+        function(function),
+        executable(function.blocks.size()),
+        queued(function.blocks.size()) {
+    std::unordered_set<int> defined;
+    for (auto &block : function.blocks) {
+      for (auto it = block->begin; it != block->end; it++) {
+        if (is_local(it->dest)) defined.insert(it->dest.id);
+        for (auto *op : {&it->op1, &it->op2, &it->op3}) {
+          if (!is_local(*op)) continue;
+          auto &users = this->users[op->id];
+          if (users.empty() || users.back() != block.get())
+            users.push_back(block.get());
+        }
+      }
+    }
+    // 未赋值就读取的变量不是常量
+    for (auto &[var, users] : this->users) {
+      if (!defined.count(var)) this->values[var] = Lattice::bottom();
+    }
+  }
+
+  // 返回是否修改了 IR
+  bool run() {
+    this->mark_executable(function.entry());
+    do {
+      while (!this->worklist.empty()) {
+        auto *block = this->worklist.back();
+        this->worklist.pop_back();
+        this->queued[block->id] = false;
+        this->visit(block);
+      }
+    } while (this->lower_undefined_conditions());
+    this->rewrite();
+    return this->changed;
+  }
+
+ private:
+  IRList &ir;
+  analysis::Function &function;
+  std::vector<bool> executable, queued;
+  std::vector<BasicBlock *> worklist;
+  std::unordered_map<int, Lattice> values;
+  std::unordered_map<int, std::vector<BasicBlock *>> users;
+  bool changed = false;
+
+  static bool is_local(const OpName &op) {
+    return op.is_var() && op.kind == OpName::Kind::Local;
+  }
+  Lattice value_of(const OpName &op) const {
+    if (op.is_imm()) return Lattice::constant(op.value);
+    if (!is_local(op)) return Lattice::bottom();
+    auto it = this->values.find(op.id);
+    return it == this->values.end() ? Lattice() : it->second;
+  }
+  BasicBlock *next_block(BasicBlock *block) const {
+    std::size_t id = block->id + 1;
+    return id < function.blocks.size() ? function.blocks[id].get() : nullptr;
+  }
+
+  void push(BasicBlock *block) {
+    if (!this->queued[block->id]) {
+      this->queued[block->id] = true;
+      this->worklist.push_back(block);
+    }
+  }
+  void mark_executable(BasicBlock *block) {
+    if (block && !this->executable[block->id]) {
+      this->executable[block->id] = true;
+      this->push(block);
+    }
+  }
+  void lower(const OpName &var, Lattice value) {
+    auto &cur = this->values[var.id];
+    auto next = meet(cur, value);
+    if (next == cur) return;
+    cur = next;
+    for (auto *block : this->users[var.id]) {
+      if (this->executable[block->id]) this->push(block);
+    }
+  }
+
+  // 条件的格值，常量 1 表示成立
+  static Lattice condition(OpCode op_code, Lattice a, Lattice b) {
+    if (a.state == Lattice::Bottom || b.state == Lattice::Bottom)
+      return Lattice::bottom();
+    if (a.state == Lattice::Top || b.state == Lattice::Top) return Lattice();
+    return Lattice::constant(test_condition(op_code, a.value, b.value));
+  }
+  Lattice evaluate(const IR &ir, std::optional<std::pair<Lattice, Lattice>> flags) {
+    if (ir.op_code == OpCode::MOV || ir.op_code == OpCode::PHI_MOV)
+      return this->value_of(ir.op1);
+    if (is_cond_mov(ir.op_code)) {
+      if (!flags) return Lattice::bottom();
+      auto cond = condition(ir.op_code, flags->first, flags->second);
+      if (cond.state == Lattice::Top) return cond;
+      if (cond.is_const())
+        return this->value_of(cond.value ? ir.op1 : ir.op2);
+      return meet(this->value_of(ir.op1), this->value_of(ir.op2));
+    }
+    auto a = this->value_of(ir.op1), b = this->value_of(ir.op2);
+    if (ir.op1.is_null() || ir.op2.is_null()) return Lattice::bottom();
+    if (a.state == Lattice::Bottom || b.state == Lattice::Bottom)
+      return Lattice::bottom();
+    if (a.state == Lattice::Top || b.state == Lattice::Top) return Lattice();
+    auto result = fold(ir.op_code, a.value, b.value);
+    return result ? Lattice::constant(*result) : Lattice::bottom();
+  }
+
+  void visit(BasicBlock *block) {
+    std::optional<std::pair<Lattice, Lattice>> flags;
+    for (auto it = block->begin; it != block->end; it++) {
+      if (it->op_code == OpCode::CMP) {
+        flags = {this->value_of(it->op1), this->value_of(it->op2)};
+      } else if (is_local(it->dest) && it->op_code != OpCode::NOOP &&
+                 it->op_code != OpCode::INFO) {
+        this->lower(it->dest, this->evaluate(*it, flags));
+      }
+    }
+
+    auto *next = this->next_block(block);
+    if (block->empty()) {
+      this->mark_executable(next);
+      return;
+    }
+    auto &last = *std::prev(block->end);
+    if (last.op_code == OpCode::JMP) {
+      this->mark_executable(function.block_of_label(last.label));
+    } else if (is_cond_jump(last.op_code)) {
+      auto cond = flags ? condition(last.op_code, flags->first, flags->second)
+                        : Lattice::bottom();
+      if (cond.state == Lattice::Top) return;
+      if (cond.state == Lattice::Bottom || cond.value)
+        this->mark_executable(function.block_of_label(last.label));
+      if (cond.state == Lattice::Bottom || !cond.value)
+        this->mark_executable(next);
+    } else if (last.op_code != OpCode::RET) {
+      this->mark_executable(next);
+    }
+  }
+
+  // 收敛后仍未求值的分支条件只可能来自未初始化的变量，按非常量处理
+  bool lower_undefined_conditions() {
+    bool changed = false;
+    for (auto &block : function.blocks) {
+      if (!this->executable[block->id] || block->empty()) continue;
+      auto last = std::prev(block->end);
+      if (!is_cond_jump(last->op_code)) continue;
+      for (auto it = last; it != block->begin;) {
+        it--;
+        if (it->op_code != OpCode::CMP) continue;
+        for (auto *op : {&it->op1, &it->op2}) {
+          if (is_local(*op) && this->value_of(*op).state == Lattice::Top) {
+            this->lower(*op, Lattice::bottom());
+            changed = true;
+          }
+        }
+        break;
+      }
+      if (changed) this->push(block.get());
+    }
+    return changed;
+  }
+
+  // 能否把常量直接写入 ir 的操作数 op
+  static bool can_substitute(const IR &ir, const OpName *op, int value) {
+    switch (ir.op_code) {
+      case OpCode::MALLOC_IN_STACK:
+      case OpCode::NOOP:
+      case OpCode::INFO:
+      case OpCode::MOVEQ:
+      case OpCode::MOVNE:
+      case OpCode::MOVLE:
+      case OpCode::MOVLT:
+      case OpCode::MOVGE:
+      case OpCode::MOVGT:
+        return false;
+      case OpCode::IDIV:
+        // 按常量除数展开时要求除数不为 0 且可以取反
+        return op != &ir.op2 || (value != 0 && value != INT_MIN);
+      default:
+        return true;
+    }
+  }
+
+  void rewrite() {
+    // 不可执行的块只保留标号（PHI_MOV 的 phi_block 可能指向它们）、NOOP 与 INFO
+    for (auto &block : function.blocks) {
+      auto end = block->end;
+      if (!this->executable[block->id]) {
+        for (auto it = block->begin; it != end;) {
+          if (it->op_code == OpCode::LABEL || it->op_code == OpCode::NOOP ||
+              it->op_code == OpCode::INFO) {
+            it++;
+          } else {
+            it = ir.erase(it);
+            this->changed = true;
+          }
+        }
+        continue;
+      }
+
+      std::optional<IRList::iterator> cmp;
+      bool cmp_used = false;
+      std::optional<std::pair<Lattice, Lattice>> flags;
+      auto drop_unused_cmp = [&] {
+        if (cmp && !cmp_used) {
+          ir.erase(*cmp);
+          this->changed = true;
+        }
+      };
+      for (auto it = block->begin; it != end;) {
+        for (auto *op : {&it->op1, &it->op2, &it->op3}) {
+          auto value = this->value_of(*op);
+          if (is_local(*op) && value.is_const() &&
+              can_substitute(*it, op, value.value)) {
+            *op = OpName(value.value);
+            this->changed = true;
+          }
+        }
+        if (it->op_code == OpCode::CMP) {
+          drop_unused_cmp();
+          cmp = it;
+          cmp_used = false;
+          flags = {this->value_of(it->op1), this->value_of(it->op2)};
+        } else if (is_local(it->dest) && this->value_of(it->dest).is_const()) {
+          OpName value(this->value_of(it->dest).value);
+          if (it->op_code != OpCode::PHI_MOV &&
+              (it->op_code != OpCode::MOV || !(it->op1 == value))) {
+            it->op_code = OpCode::MOV;
+            it->op1 = value;
+            it->op2 = it->op3 = OpName();
+            this->changed = true;
+          }
+        } else if (is_cond_mov(it->op_code)) {
+          cmp_used = true;
+        } else if (is_cond_jump(it->op_code)) {
+          auto cond = flags ? condition(it->op_code, flags->first,
+                                        flags->second)
+                            : Lattice::bottom();
+          if (cond.is_const() && cond.value) {
+            it->op_code = OpCode::JMP;
+            this->changed = true;
+          } else if (cond.is_const()) {
+            it = ir.erase(it);
+            this->changed = true;
+            continue;
+          } else {
+            cmp_used = true;
+          }
+        }
+        it++;
+      }
+      // 生成 IR 时标志位总在 CMP 所在的块内被消费
+      drop_unused_cmp();
+    }
+
+    // 删除已全部替换为常量的变量的定值，并清理引用已删除变量的 NOOP
+    std::unordered_set<int> used, defined;
+    for (auto it = std::next(function.begin); it != function.end; it++) {
+      if (it->op_code == OpCode::NOOP) continue;
+      for (auto *op : {&it->op1, &it->op2, &it->op3})
+        if (op->is_var()) used.insert(op->id);
+    }
+    for (auto it = std::next(function.begin); it != function.end;) {
+      if (is_local(it->dest) && !used.count(it->dest.id) &&
+          this->value_of(it->dest).is_const() &&
+          (it->op_code == OpCode::MOV || it->op_code == OpCode::PHI_MOV)) {
+        it = ir.erase(it);
+        this->changed = true;
+        continue;
+      }
+      if (it->dest.is_var()) defined.insert(it->dest.id);
+      it++;
+    }
+    for (auto it = std::next(function.begin); it != function.end; it++) {
+      if (it->op_code == OpCode::NOOP && is_local(it->op1) &&
+          !defined.count(it->op1.id)) {
+        it->op1 = OpName();
+        this->changed = true;
+      }
+    }
+  }
+};
+}  // namespace
+
+// 稀疏条件常量传播：折叠常量、确定常量条件的跳转并删除不可执行的分支
+bool sparse_conditional_constant_propagation(IRList &ir,
+                                             analysis::AnalysisManager &am) {
+  bool changed = false;
+  for (auto &function : am.functions()) {
+    changed |= ConstantPropagation(ir, function).run();
+  }
+  return changed;
+}
+}  // namespace syc::ir::passes
@@ -0,0 +1,326 @@
+/*
+ * syc, a compiler for SysY
+ * Copyright (C) 2020-2021  nzh63, skywf21
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#include "ir/optimize/passes/strength_reduction.h"
+
+#include <algorithm>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "ir/optimize/analysis/cfg.h"
+
+namespace syc::ir::passes {
+namespace {
+using analysis::BasicBlock;
+using analysis::Loop;
+
+// 值 = scale * iv + 循环不变量，iv 为 0 时是循环不变量（id 0 保留给空名称）。
+// 按 32 位回绕计算，与指令的语义一致
+struct Linear {
+  int iv;
+  unsigned scale;
+};
+
+// 对每个循环，回边上形如 PHI_MOV i i.next、i.next = i ± c 的变量 i 是基本归纳变量。
+// 循环中只由基本归纳变量、常数与循环不变量经 ADD、SUB、MOV、乘以常数的 IMUL、
+// 左移常数位的 SAL 得到的值是 i 的线性函数；其中系数不为 0、1 且被其他指令使用的值 v
+// 替换为新的归纳变量 v.SR：初值由前置块中复制的计算链求出，回边上加上 scale * c。
+// 原来的计算链在 v 被替换后不再使用，留给死代码消除
+class StrengthReduction {
+ public:
+  StrengthReduction(IRList &ir, analysis::Function &function)
+      : ir(ir), function(function) {
+    int position = 0;
+    for (auto it = function.begin; it != function.end; it++) {
+      this->position[&*it] = position++;
+      if (it->dest.is_var()) this->defs[it->dest.id].push_back(it);
+      it->forEachOp(
+          [&](const OpName &op) {
+            if (op.is_var()) this->uses[op.id].push_back(it);
+          },
+          false);
+    }
+  }
+
+  // 只处理最内层循环：外层循环中的新归纳变量在整个内层循环中都活跃，
+  // 省下的指令却只在外层迭代时执行
+  bool run() {
+    bool changed = false;
+    for (auto &loop : this->function.loops) {
+      if (loop->children.empty()) changed |= this->reduce(loop.get());
+    }
+    return changed;
+  }
+
+ private:
+  IRList &ir;
+  analysis::Function &function;
+  std::unordered_map<const IR *, int> position;
+  std::unordered_map<int, std::vector<IRList::iterator>> defs, uses;
+
+  // 当前循环的基本归纳变量及其步长、回边上赋给它们的值，以及循环中各值的线性表示
+  Loop *loop = nullptr;
+  std::unordered_map<int, unsigned> steps;
+  std::unordered_set<int> nexts;
+  std::unordered_map<int, Linear> linear;
+
+  BasicBlock *preheader(Loop *loop) {
+    BasicBlock *ret = nullptr;
+    for (auto *pred : loop->header->predecessors) {
+      if (!pred->reachable() || loop->contains(pred)) continue;
+      if (ret) return nullptr;
+      ret = pred;
+    }
+    if (!ret || ret->empty() || ret->successors.size() != 1) return nullptr;
+    return ret;
+  }
+
+  bool in_loop(IRList::iterator it) {
+    auto *block = this->function.block_of(*it);
+    return block && this->loop->contains(block);
+  }
+  int defs_in_loop(int var) {
+    auto it = this->defs.find(var);
+    if (it == this->defs.end()) return 0;
+    return std::count_if(it->second.begin(), it->second.end(),
+                         [&](IRList::iterator def) {
+                           return this->in_loop(def);
+                         });
+  }
+  bool single_def(int var) {
+    auto it = this->defs.find(var);
+    return it != this->defs.end() && it->second.size() == 1;
+  }
+  bool dominates(IRList::iterator def, IRList::iterator use) {
+    auto *a = this->function.block_of(*def);
+    auto *b = this->function.block_of(*use);
+    if (a != b) return this->function.dominates(a, b);
+    return this->position.at(&*def) < this->position.at(&*use);
+  }
+
+  // 回边上的 PHI_MOV iv next 中 next = iv ± c 时返回步长
+  std::optional<unsigned> step_of(const IR &phi) {
+    auto &iv = phi.dest, &next = phi.op1;
+    if (iv.kind != OpName::Kind::Local || !next.is_var() ||
+        next.kind != OpName::Kind::Local || this->defs_in_loop(iv.id) != 1 ||
+        !this->single_def(next.id))
+      return std::nullopt;
+    auto def = this->defs.at(next.id).front();
+    if (!this->in_loop(def)) return std::nullopt;
+    if (def->op_code == OpCode::ADD && def->op1 == iv && def->op2.is_imm())
+      return unsigned(def->op2.value);
+    if (def->op_code == OpCode::ADD && def->op2 == iv && def->op1.is_imm())
+      return unsigned(def->op1.value);
+    if (def->op_code == OpCode::SUB && def->op1 == iv && def->op2.is_imm())
+      return -unsigned(def->op2.value);
+    return std::nullopt;
+  }
+
+  std::optional<Linear> operand(const OpName &op) {
+    if (op.is_imm()) return Linear{0, 0};
+    if (!op.is_var() || op.kind != OpName::Kind::Local) return std::nullopt;
+    if (this->steps.count(op.id)) return Linear{op.id, 1};
+    auto it = this->linear.find(op.id);
+    if (it != this->linear.end()) return it->second;
+    if (this->defs_in_loop(op.id) == 0) return Linear{0, 0};
+    return std::nullopt;
+  }
+  std::optional<Linear> linear_of(const IR &ir) {
+    if (ir.dest.kind != OpName::Kind::Local || !this->single_def(ir.dest.id))
+      return std::nullopt;
+    auto a = this->operand(ir.op1), b = this->operand(ir.op2);
+    bool invariant = a && b && a->iv == 0 && b->iv == 0;
+    switch (ir.op_code) {
+      case OpCode::MOV:
+        return a;
+      case OpCode::ADD:
+      case OpCode::SUB:
+        if (!a || !b || (a->iv != 0 && b->iv != 0 && a->iv != b->iv))
+          return std::nullopt;
+        return Linear{a->iv != 0 ? a->iv : b->iv,
+                      ir.op_code == OpCode::ADD ? a->scale + b->scale
+                                                : a->scale - b->scale};
+      case OpCode::IMUL:
+        if (invariant) return Linear{0, 0};
+        if (a && ir.op2.is_imm())
+          return Linear{a->iv, a->scale * unsigned(ir.op2.value)};
+        if (b && ir.op1.is_imm())
+          return Linear{b->iv, b->scale * unsigned(ir.op1.value)};
+        return std::nullopt;
+      case OpCode::SAL:
+        if (invariant) return Linear{0, 0};
+        if (a && ir.op2.is_imm() && ir.op2.value >= 0 && ir.op2.value < 32)
+          return Linear{a->iv, a->scale << ir.op2.value};
+        return std::nullopt;
+      case OpCode::SAR:
+      case OpCode::AND:
+      case OpCode::OR:
+        if (invariant) return Linear{0, 0};
+        return std::nullopt;
+      default:
+        return std::nullopt;
+    }
+  }
+
+  // 值是否值得替换：有线性计算之外的使用，且所有使用都在定值之后；
+  // 替换后每次迭代多一条 ADD，计算链中除归纳变量的递增外至少要有两条指令
+  bool profitable(IRList::iterator def) {
+    bool used = false;
+    for (auto use : this->uses[def->dest.id]) {
+      if (!this->in_loop(use)) continue;
+      if (!this->dominates(def, use)) return false;
+      if (use->op_code != OpCode::NOOP &&
+          !(use->dest.is_var() && this->linear.count(use->dest.id)))
+        used = true;
+    }
+    if (!used) return false;
+    std::unordered_set<int> visited;
+    std::vector<IRList::iterator> chain;
+    this->collect(def->dest.id, visited, chain);
+    return std::count_if(chain.begin(), chain.end(), [&](IRList::iterator it) {
+             return !this->nexts.count(it->dest.id);
+           }) >= 2;
+  }
+
+  bool reduce(Loop *loop) {
+    auto header = loop->header->begin;
+    if (header->op_code != OpCode::LABEL || loop->latches.size() != 1)
+      return false;
+    auto *latch = loop->latches.front();
+    if (latch->empty()) return false;
+    auto jump = std::prev(latch->end);
+    if (jump->op_code != OpCode::JMP || jump->label != header->label)
+      return false;
+    auto *preheader = this->preheader(loop);
+    if (!preheader) return false;
+
+    this->loop = loop;
+    this->steps.clear();
+    this->nexts.clear();
+    this->linear.clear();
+    auto phi_begin = jump;
+    while (phi_begin != latch->begin &&
+           std::prev(phi_begin)->op_code == OpCode::PHI_MOV)
+      phi_begin--;
+    for (auto it = phi_begin; it != jump; it++) {
+      if (it->phi_block != header) continue;
+      if (auto step = this->step_of(*it)) {
+        this->steps[it->dest.id] = *step;
+        this->nexts.insert(it->op1.id);
+      }
+    }
+    if (this->steps.empty()) return false;
+
+    // 按逆后序访问，操作数的线性表示先于使用求出
+    std::vector<BasicBlock *> blocks;
+    for (auto *block : loop->blocks)
+      if (block->reachable()) blocks.push_back(block);
+    std::sort(blocks.begin(), blocks.end(),
+              [](BasicBlock *a, BasicBlock *b) {
+                return a->rpo_index < b->rpo_index;
+              });
+    std::vector<IRList::iterator> candidates;
+    for (auto *block : blocks) {
+      for (auto it = block->begin; it != block->end; it++) {
+        if (!it->dest.is_var()) continue;
+        if (auto value = this->linear_of(*it)) {
+          this->linear[it->dest.id] = *value;
+          if (value->iv != 0 && value->scale > 1) candidates.push_back(it);
+        }
+      }
+    }
+    bool changed = false;
+    for (auto def : candidates) {
+      if (!this->profitable(def)) continue;
+      this->replace(def, preheader, header, phi_begin, jump);
+      changed = true;
+    }
+    return changed;
+  }
+
+  // 收集 var 的计算链中在循环内定值的指令
+  void collect(int var, std::unordered_set<int> &visited,
+               std::vector<IRList::iterator> &chain) {
+    if (!this->linear.count(var) || !visited.insert(var).second) return;
+    auto def = this->defs.at(var).front();
+    def->forEachOp(
+        [&](const OpName &op) {
+          if (op.is_var()) this->collect(op.id, visited, chain);
+        },
+        false);
+    chain.push_back(def);
+  }
+
+  void replace(IRList::iterator def, BasicBlock *preheader,
+               IRList::iterator header, IRList::iterator phi_begin,
+               IRList::iterator jump) {
+    auto name = def->dest.name();
+    auto value = this->linear.at(def->dest.id);
+    OpName iv(name + ".SR"), next(name + ".SR.NEXT");
+
+    // 在前置块末尾按原来的计算链求出初值
+    std::unordered_set<int> visited;
+    std::vector<IRList::iterator> chain;
+    this->collect(def->dest.id, visited, chain);
+    auto pos = preheader->end;
+    if (std::prev(pos)->op_code == OpCode::JMP) pos = std::prev(pos);
+    std::unordered_map<int, OpName> renamed;
+    for (auto it : chain) {
+      IR copy = *it;
+      for (auto *op : {&copy.op1, &copy.op2, &copy.op3}) {
+        if (op->is_var() && renamed.count(op->id)) *op = renamed.at(op->id);
+      }
+      copy.dest = OpName(name + ".SR." + std::to_string(renamed.size()));
+      renamed.insert({it->dest.id, copy.dest});
+      this->ir.insert(pos, copy);
+    }
+    IR init(OpCode::PHI_MOV, iv, renamed.at(def->dest.id));
+    init.phi_block = header;
+    this->ir.insert(pos, init);
+
+    // 回边上递增
+    this->ir.insert(phi_begin, IR(OpCode::ADD, next, iv,
+                                  int(value.scale * this->steps.at(value.iv))));
+    IR phi(OpCode::PHI_MOV, iv, next);
+    phi.phi_block = header;
+    this->ir.insert(jump, phi);
+
+    for (auto use : this->uses[def->dest.id]) {
+      if (!this->in_loop(use)) continue;
+      for (auto *op : {&use->op1, &use->op2, &use->op3}) {
+        if (*op == def->dest) *op = iv;
+      }
+    }
+    def->op_code = OpCode::MOV;
+    def->op1 = iv;
+    def->op2 = def->op3 = OpName();
+  }
+};
+}  // namespace
+
+bool loop_strength_reduction(IRList &ir, analysis::AnalysisManager &am) {
+  bool changed = false;
+  for (auto &function : am.functions()) {
+    if (function.loops.empty()) continue;
+    changed |= StrengthReduction(ir, function).run();
+  }
+  return changed;
+}
+}  // namespace syc::ir::passes
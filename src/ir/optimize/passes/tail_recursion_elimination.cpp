@@ -0,0 +1,252 @@
+/*
+ * syc, a compiler for SysY
+ * Copyright (C) 2020-2021  nzh63, skywf21
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#include "ir/optimize/passes/tail_recursion_elimination.h"
+
+#include <algorithm>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace syc::ir::passes {
+namespace {
+// 改写过的函数在循环开头带有该标记，不再重复改写
+const char tail_recursion_marker[] = "TAIL_RECURSION";
+
+// 尾部的自递归调用：SET_ARG...; CALL %r f; [ADD/IMUL %s %r x;] RET
+struct TailCall {
+  IRList::iterator first, call, ret;
+  // 调用结果与 operand 做的运算，NOOP 表示直接返回调用结果
+  OpCode op = OpCode::NOOP;
+  OpName operand;
+};
+
+int argument_index(const OpName &op) { return std::stoi(op.name().substr(4)); }
+
+class TailRecursion {
+ public:
+  explicit TailRecursion(IRList &ir)
+      : ir(ir),
+        name(ir.front().label),
+        arg_count(ir.front().op1.value),
+        varying(arg_count) {}
+
+  bool run() {
+    if (!this->analyze()) return false;
+    this->rewrite();
+    return true;
+  }
+
+ private:
+  IRList &ir;
+  std::string name;
+  int arg_count;
+  std::unordered_map<int, int> use_count, def_count;
+  // 唯一定义为 MOV var $argN 的变量 -> N
+  std::unordered_map<int, int> copy_of;
+  std::vector<TailCall> calls;
+  // 各参数是否在某个调用点被传入了不同的值
+  std::vector<bool> varying;
+  // 累加变量的运算，NOOP 表示不需要累加变量
+  OpCode accumulate = OpCode::NOOP;
+  int temps = 0;
+
+  OpName temp() {
+    return OpName("%" + this->name + ".TR" + std::to_string(this->temps++));
+  }
+
+  bool analyze();
+  std::optional<TailCall> match(IRList::iterator call);
+  bool passes_through(const OpName &arg, int index);
+  void rewrite();
+};
+
+bool TailRecursion::analyze() {
+  for (auto &i : this->ir) {
+    // 栈上数组的地址可能作为实参传给下一层，循环中会被覆盖
+    if (i.op_code == OpCode::MALLOC_IN_STACK) return false;
+    if (i.op_code == OpCode::INFO && i.label == tail_recursion_marker)
+      return false;
+    i.forEachOp(
+        [&](const OpName &op) {
+          if (op.is_var()) this->use_count[op.id]++;
+        },
+        false);
+    if (!i.dest.is_var()) continue;
+    this->def_count[i.dest.id]++;
+    if (i.op_code == OpCode::MOV && i.op1.is_var() &&
+        i.op1.kind == OpName::Kind::Arg)
+      this->copy_of[i.dest.id] = argument_index(i.op1);
+  }
+
+  for (auto it = this->ir.begin(); it != this->ir.end(); it++) {
+    if (it->op_code != OpCode::CALL || it->label != this->name) continue;
+    auto call = this->match(it);
+    if (!call) continue;
+    if (this->accumulate == OpCode::NOOP) this->accumulate = call->op;
+    // 一个函数只用一种运算累加
+    if (call->op != OpCode::NOOP && call->op != this->accumulate) continue;
+    this->calls.push_back(*call);
+  }
+  if (this->calls.empty()) return false;
+
+  for (auto &call : this->calls) {
+    for (auto it = call.first; it != call.call; it++) {
+      if (!this->passes_through(it->op1, it->dest.value))
+        this->varying[it->dest.value] = true;
+    }
+  }
+  return true;
+}
+
+std::optional<TailCall> TailRecursion::match(IRList::iterator call) {
+  TailCall ret;
+  ret.call = call;
+  ret.first = call;
+  std::vector<bool> set(this->arg_count);
+  while (ret.first != this->ir.begin() &&
+         std::prev(ret.first)->op_code == OpCode::SET_ARG) {
+    ret.first--;
+    int index = ret.first->dest.value;
+    if (index < 0 || index >= this->arg_count || set[index])
+      return std::nullopt;
+    set[index] = true;
+  }
+  for (bool i : set) {
+    if (!i) return std::nullopt;
+  }
+
+  auto &result = call->dest;
+  auto next = std::next(call);
+  if (next->op_code == OpCode::RET) {
+    if (!next->op1.is_null() && !(result.is_var() && next->op1 == result))
+      return std::nullopt;
+    ret.ret = next;
+    return ret;
+  }
+  // return x + f(...)：调用结果只在这里使用一次
+  if ((next->op_code != OpCode::ADD && next->op_code != OpCode::IMUL) ||
+      !result.is_var() || this->use_count[result.id] != 1 ||
+      (next->op1 == result) == (next->op2 == result))
+    return std::nullopt;
+  auto ret_it = std::next(next);
+  if (ret_it->op_code != OpCode::RET || !(ret_it->op1 == next->dest) ||
+      this->use_count[next->dest.id] != 1)
+    return std::nullopt;
+  ret.ret = ret_it;
+  ret.op = next->op_code;
+  ret.operand = next->op1 == result ? next->op2 : next->op1;
+  return ret;
+}
+
+// 实参就是本层的第 index 个参数，该参数在循环中不变
+bool TailRecursion::passes_through(const OpName &arg, int index) {
+  if (!arg.is_var()) return false;
+  if (arg.kind == OpName::Kind::Arg) return argument_index(arg) == index;
+  auto it = this->copy_of.find(arg.id);
+  return it != this->copy_of.end() && it->second == index &&
+         this->def_count[arg.id] == 1;
+}
+
+// FUNCTION_BEGIN
+//   PHI_MOV p $argN（不变的参数为 MOV p $argN）; PHI_MOV acc 0/1
+//   LABEL begin; INFO TAIL_RECURSION; 原函数体，$argN 换为 p，RET v 换为 RET acc op v
+//   尾调用点：PHI_MOV p 实参; PHI_MOV acc acc op x; JMP begin
+// FUNCTION_END
+// 寄存器分配按线性时间处理 $argN，循环中不能直接使用
+void TailRecursion::rewrite() {
+  std::vector<OpName> params(this->arg_count);
+  for (auto &i : params) i = this->temp();
+  OpName acc;
+  OpName identity(this->accumulate == OpCode::ADD ? 0 : 1);
+  if (this->accumulate != OpCode::NOOP) acc = this->temp();
+
+  // 尾调用点中的实参也一并替换，读到的是本层的参数
+  for (auto &i : this->ir) {
+    for (auto *op : {&i.op1, &i.op2, &i.op3}) {
+      if (op->is_var() && op->kind == OpName::Kind::Arg &&
+          argument_index(*op) < this->arg_count)
+        *op = params[argument_index(*op)];
+    }
+  }
+
+  IRList entry;
+  entry.emplace_back(OpCode::LABEL, ".L.TR_" + this->name + "_BEGIN");
+  auto begin = entry.begin();
+  entry.emplace_back(OpCode::INFO, tail_recursion_marker);
+  auto is_param = [&](const OpName &op) {
+    return op.is_var() && (op == acc || std::find(params.begin(), params.end(),
+                                                  op) != params.end());
+  };
+  for (auto &call : this->calls) {
+    // PHI_MOV 依次执行，读本层参数的实参先复制出来
+    std::vector<std::pair<OpName, OpName>> moves;
+    for (auto it = call.first; it != call.call; it++) {
+      int index = it->dest.value;
+      if (!this->varying[index]) continue;
+      auto value = it->op1;
+      if (is_param(value)) {
+        value = this->temp();
+        this->ir.insert(call.first, IR(OpCode::MOV, value, it->op1));
+      }
+      moves.push_back({params[index], value});
+    }
+    if (call.op != OpCode::NOOP) {
+      auto value = this->temp();
+      this->ir.insert(call.first, IR(call.op, value, acc, call.operand));
+      moves.push_back({acc, value});
+    }
+    for (auto &[dest, value] : moves) {
+      this->ir.insert(call.first, IR(OpCode::PHI_MOV, dest, value))
+          ->phi_block = begin;
+    }
+    this->ir.insert(call.first, IR(OpCode::JMP, begin->label));
+    this->ir.erase(call.first, std::next(call.ret));
+  }
+
+  if (this->accumulate != OpCode::NOOP) {
+    for (auto it = this->ir.begin(); it != this->ir.end(); it++) {
+      if (it->op_code != OpCode::RET || it->op1.is_null()) continue;
+      if (it->op1 == identity) {
+        it->op1 = acc;
+        continue;
+      }
+      auto value = this->temp();
+      this->ir.insert(it, IR(this->accumulate, value, acc, it->op1));
+      it->op1 = value;
+    }
+  }
+
+  for (int i = 0; i < this->arg_count; i++) {
+    OpName arg("$arg" + std::to_string(i));
+    if (this->varying[i])
+      entry.insert(begin, IR(OpCode::PHI_MOV, params[i], arg))->phi_block =
+          begin;
+    else
+      entry.insert(begin, IR(OpCode::MOV, params[i], arg));
+  }
+  if (this->accumulate != OpCode::NOOP)
+    entry.insert(begin, IR(OpCode::PHI_MOV, acc, identity))->phi_block = begin;
+  this->ir.splice(std::next(this->ir.begin()), entry);
+}
+}  // namespace
+
+bool tail_recursion_elimination(IRList &ir) {
+  return TailRecursion(ir).run();
+}
+}  // namespace syc::ir::passes
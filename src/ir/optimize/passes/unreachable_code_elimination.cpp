@@ -21,21 +21,25 @@
 #include "ir/ir.h"
 
 namespace syc::ir::passes {
-void unreachable_code_elimination(IRList &ir) {
+bool unreachable_code_elimination(IRList &ir) {
+  bool changed = false;
   for (auto it = ir.begin(); it != ir.end(); it++) {
     if (it->op_code == OpCode::RET || it->op_code == OpCode::JMP) {
       for (auto next = std::next(it); next != ir.end();) {
         if (next->op_code != OpCode::LABEL &&
             next->op_code != OpCode::FUNCTION_END) {
-          if (next->op_code != OpCode::NOOP && next->op_code != OpCode::INFO)
+          if (next->op_code != OpCode::NOOP && next->op_code != OpCode::INFO) {
             next = ir.erase(next);
-          else
+            changed = true;
+          } else {
             next++;
+          }
         } else {
           break;
         }
       }
     }
   }
+  return changed;
 }
 }  // namespace syc::ir::passes
@@ -19,5 +19,5 @@
 #include "ir/ir.h"
 
 namespace syc::ir::passes {
-void unreachable_code_elimination(IRList &ir);
+bool unreachable_code_elimination(IRList &ir);
 }  // namespace syc::ir::passes
@@ -0,0 +1,289 @@
+/*
+ * syc, a compiler for SysY
+ * Copyright (C) 2020-2021  nzh63, skywf21
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#pragma once
+#include <cstddef>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace syc::ir {
+namespace detail {
+struct ListNodeBase {
+  ListNodeBase* prev;
+  ListNodeBase* next;
+};
+
+template <typename T>
+struct ListNode : ListNodeBase {
+  T value;
+  template <typename... Args>
+  ListNode(Args&&... args) : value(std::forward<Args>(args)...) {}
+};
+
+// 结点内存块的全局存储，块在程序结束前不会释放，因此结点可以在线程间转移
+template <typename T>
+class ListNodeChunks {
+ public:
+  struct Storage {
+    alignas(ListNode<T>) std::byte data[sizeof(ListNode<T>)];
+  };
+  static constexpr std::size_t chunk_size = 512;
+
+  static ListNodeChunks& get() {
+    static ListNodeChunks chunks;
+    return chunks;
+  }
+  Storage* allocate() {
+    std::lock_guard lock(this->mutex);
+    this->chunks.emplace_back(new Storage[chunk_size]);
+    return this->chunks.back().get();
+  }
+
+ private:
+  std::mutex mutex;
+  std::vector<std::unique_ptr<Storage[]>> chunks;
+};
+
+// 同一类型的所有链表共享的结点池，每个线程一个，分配与释放无需加锁。
+// 结点按块连续分配，释放后进入当前线程的空闲链表复用。
+// 结点在链表间 splice 时无需重新分配
+template <typename T>
+class ListNodePool {
+ public:
+  static ListNodePool& get() {
+    thread_local ListNodePool pool;
+    return pool;
+  }
+
+  void* allocate() {
+    if (this->free_list != nullptr) {
+      auto* node = this->free_list;
+      this->free_list = node->next;
+      return node;
+    }
+    if (this->chunk_left == 0) {
+      this->chunk_next = ListNodeChunks<T>::get().allocate();
+      this->chunk_left = ListNodeChunks<T>::chunk_size;
+    }
+    this->chunk_left--;
+    return this->chunk_next++;
+  }
+
+  void deallocate(void* p) {
+    this->free_list = new (p) ListNodeBase{nullptr, this->free_list};
+  }
+
+ private:
+  typename ListNodeChunks<T>::Storage* chunk_next = nullptr;
+  std::size_t chunk_left = 0;
+  ListNodeBase* free_list = nullptr;
+};
+}  // namespace detail
+
+template <typename T, bool Const>
+class PooledListIterator {
+ public:
+  using iterator_category = std::bidirectional_iterator_tag;
+  using value_type = T;
+  using difference_type = std::ptrdiff_t;
+  using pointer = std::conditional_t<Const, const T*, T*>;
+  using reference = std::conditional_t<Const, const T&, T&>;
+
+  PooledListIterator() = default;
+  explicit PooledListIterator(detail::ListNodeBase* node) : node(node) {}
+  template <bool C = Const, typename = std::enable_if_t<C>>
+  PooledListIterator(const PooledListIterator<T, false>& other)
+      : node(other.node) {}
+
+  reference operator*() const {
+    return static_cast<detail::ListNode<T>*>(this->node)->value;
+  }
+  pointer operator->() const { return &**this; }
+  PooledListIterator& operator++() {
+    this->node = this->node->next;
+    return *this;
+  }
+  PooledListIterator operator++(int) {
+    auto ret = *this;
+    this->node = this->node->next;
+    return ret;
+  }
+  PooledListIterator& operator--() {
+    this->node = this->node->prev;
+    return *this;
+  }
+  PooledListIterator operator--(int) {
+    auto ret = *this;
+    this->node = this->node->prev;
+    return ret;
+  }
+  bool operator==(const PooledListIterator& other) const {
+    return this->node == other.node;
+  }
+
+  detail::ListNodeBase* node = nullptr;
+};
+
+// 与 std::list 接口一致的双向链表，结点来自 ListNodePool。
+// 迭代器在插入、splice 以及删除其他元素后保持有效，可作为指令句柄长期保存
+template <typename T>
+class PooledList {
+ public:
+  using value_type = T;
+  using size_type = std::size_t;
+  using difference_type = std::ptrdiff_t;
+  using reference = T&;
+  using const_reference = const T&;
+  using iterator = PooledListIterator<T, false>;
+  using const_iterator = PooledListIterator<T, true>;
+
+  PooledList() { this->head.prev = this->head.next = &this->head; }
+  PooledList(const PooledList& other) : PooledList() {
+    for (const auto& i : other) this->push_back(i);
+  }
+  PooledList(PooledList&& other) noexcept : PooledList() {
+    this->splice(this->end(), other);
+  }
+  PooledList& operator=(const PooledList& other) {
+    if (this != &other) {
+      this->clear();
+      for (const auto& i : other) this->push_back(i);
+    }
+    return *this;
+  }
+  PooledList& operator=(PooledList&& other) noexcept {
+    if (this != &other) {
+      this->clear();
+      this->splice(this->end(), other);
+    }
+    return *this;
+  }
+  ~PooledList() { this->clear(); }
+
+  iterator begin() { return iterator(this->head.next); }
+  iterator end() { return iterator(&this->head); }
+  const_iterator begin() const { return const_iterator(this->head.next); }
+  const_iterator end() const {
+    return const_iterator(const_cast<detail::ListNodeBase*>(&this->head));
+  }
+  const_iterator cbegin() const { return this->begin(); }
+  const_iterator cend() const { return this->end(); }
+
+  bool empty() const { return this->count == 0; }
+  size_type size() const { return this->count; }
+  T& front() { return *this->begin(); }
+  const T& front() const { return *this->begin(); }
+  T& back() { return *std::prev(this->end()); }
+  const T& back() const { return *std::prev(this->end()); }
+
+  template <typename... Args>
+  iterator emplace(const_iterator pos, Args&&... args) {
+    auto& pool = detail::ListNodePool<T>::get();
+    void* p = pool.allocate();
+    detail::ListNode<T>* node;
+    try {
+      node = new (p) detail::ListNode<T>(std::forward<Args>(args)...);
+    } catch (...) {
+      pool.deallocate(p);
+      throw;
+    }
+    link(pos.node, node, node);
+    this->count++;
+    return iterator(node);
+  }
+  iterator insert(const_iterator pos, const T& value) {
+    return this->emplace(pos, value);
+  }
+  iterator insert(const_iterator pos, T&& value) {
+    return this->emplace(pos, std::move(value));
+  }
+  template <typename... Args>
+  T& emplace_back(Args&&... args) {
+    return *this->emplace(this->end(), std::forward<Args>(args)...);
+  }
+  void push_back(const T& value) { this->emplace(this->end(), value); }
+  void push_back(T&& value) { this->emplace(this->end(), std::move(value)); }
+  void pop_back() { this->erase(std::prev(this->end())); }
+
+  iterator erase(const_iterator pos) {
+    auto* node = pos.node;
+    auto* next = node->next;
+    unlink(node, node);
+    this->count--;
+    static_cast<detail::ListNode<T>*>(node)->~ListNode();
+    detail::ListNodePool<T>::get().deallocate(node);
+    return iterator(next);
+  }
+  iterator erase(const_iterator first, const_iterator last) {
+    while (first != last) first = this->erase(first);
+    return iterator(last.node);
+  }
+  void clear() { this->erase(this->begin(), this->end()); }
+
+  void splice(const_iterator pos, PooledList& other) {
+    if (other.empty()) return;
+    auto* first = other.head.next;
+    auto* last = other.head.prev;
+    unlink(first, last);
+    link(pos.node, first, last);
+    this->count += other.count;
+    other.count = 0;
+  }
+  void splice(const_iterator pos, PooledList&& other) {
+    this->splice(pos, other);
+  }
+  void splice(const_iterator pos, PooledList& other, const_iterator it) {
+    if (pos.node == it.node || pos.node == it.node->next) return;
+    unlink(it.node, it.node);
+    link(pos.node, it.node, it.node);
+    other.count--;
+    this->count++;
+  }
+  void splice(const_iterator pos, PooledList& other, const_iterator first,
+              const_iterator last) {
+    if (first == last) return;
+    size_type n = this == &other ? 0 : std::distance(first, last);
+    auto* back = last.node->prev;
+    unlink(first.node, back);
+    link(pos.node, first.node, back);
+    other.count -= n;
+    this->count += n;
+  }
+
+ private:
+  detail::ListNodeBase head;
+  size_type count = 0;
+
+  // 将 [first, last] 插入到 pos 之前
+  static void link(detail::ListNodeBase* pos, detail::ListNodeBase* first,
+                   detail::ListNodeBase* last) {
+    first->prev = pos->prev;
+    last->next = pos;
+    pos->prev->next = first;
+    pos->prev = last;
+  }
+  static void unlink(detail::ListNodeBase* first, detail::ListNodeBase* last) {
+    first->prev->next = last->next;
+    last->next->prev = first->prev;
+  }
+};
+}  // namespace syc::ir
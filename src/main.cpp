@@ -16,40 +16,72 @@
  * along with this program.  If not, see <https://www.gnu.org/licenses/>.
  */
 #include <iostream>
-#include <sstream>
+#include <vector>
 
 #include "assembly/generate/generate.h"
 #include "assembly/optimize/optimize.h"
 #include "ast/generate/generate.h"
 #include "config.h"
 #include "ir/generate/generate.h"
+#include "ir/optimize/analysis/cfg.h"
 #include "ir/optimize/optimize.h"
+#include "ir/optimize/pass_manager.h"
+#include "stats.h"
 
 int main(int argc, char** argv) {
   using namespace syc;
   config::parse_arg(argc, argv);
+  for (auto& name : config::passes) {
+    if (!ir::find_pass(name) && !assembly::is_pass(name)) {
+      std::cerr << "syc: error: unknown pass '" << name << "'" << std::endl;
+      return 1;
+    }
+  }
 
-  auto* root = syc::ast::generate(config::input);
+  ast::Arena ast_arena;
+  ast::node::Root* root;
+  {
+    stats::Phase phase("parse");
+    root = syc::ast::generate(ast_arena, config::input);
+  }
   if (config::print_ast) root->print();
 
-  auto ir = syc::ir::generate(root);
-  if (config::optimize_level > 0) {
+  ir::IRList ir;
+  {
+    stats::Phase phase("ir.generate", [&] { return ir.size(); });
+    ir = syc::ir::generate(root);
+    ast_arena.clear();
+  }
+  // 给出 -passes= 时即使 -O0 也运行指定的 pass
+  bool optimize = config::optimize_level > 0 || !config::passes.empty();
+  if (optimize) {
+    stats::Phase phase("ir.optimize", [&] { return ir.size(); });
     syc::ir::optimize(ir);
   }
   if (config::print_ir)
     for (auto& i : ir) i.print(std::cerr, true);
+  if (config::print_cfg)
+    for (auto& f : ir::analysis::build_cfg(ir)) f.print(std::cerr);
 
-  std::stringstream buffer;
-  if (config::print_log) {
-    syc::assembly::generate(ir, buffer, buffer);
-  } else {
-    syc::assembly::generate(ir, buffer);
+  std::vector<syc::assembly::MachineCode> code;
+  auto count = [&] {
+    std::size_t ret = 0;
+    for (auto& i : code) ret += i.instrs.size();
+    return ret;
+  };
+  {
+    stats::Phase phase("asm.generate", count);
+    syc::assembly::generate(ir, code);
+  }
+  if (optimize) {
+    stats::Phase phase("asm.optimize", count);
+    syc::assembly::optimize(code);
   }
-  if (config::optimize_level > 0) {
-    syc::assembly::optimize(buffer, *config::output);
-  } else {
-    *config::output << buffer.str();
+  {
+    stats::Phase phase("emit");
+    for (auto& i : code) i.print(*config::output);
   }
 
   if (config::output != &std::cout) delete config::output;
+  stats::report();
 };
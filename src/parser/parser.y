@@ -18,6 +18,7 @@
 %{
 #include <iostream>
 #include <cstdlib>
+#include "ast/arena.h"
 #include "ast/generate/generate.h"
 #include "ast/node.h"
 #include "config.h"
@@ -35,6 +36,8 @@ void yyerror(const char *s) {
     if (!yydebug) std::exit(1);
 }
 #define YYERROR_VERBOSE true
+// 所有结点均分配在本次编译的内存池中，随内存池统一释放
+#define NEW(type) syc::ast::arena->make<syc::ast::node::type>
 #ifdef YYDEBUG
 #undef YYDEBUG
 #endif
@@ -66,6 +69,10 @@ void yyerror(const char *s) {
         })(_yyres, _yystr)
 %}
 
+%code requires {
+#include "ast/source_buffer.h"
+}
+
 %locations
 %union {
     int token;
@@ -85,10 +92,10 @@ void yyerror(const char *s) {
     syc::ast::node::Assignment* assignmentstmt;
     syc::ast::node::IfElseStatement* ifelsestmt;
     syc::ast::node::ConditionExpression* condexp;
-    std::string *string;
+    syc::ast::TokenText text;
 }
 
-%token <string> INTEGER_VALUE "integer" IDENTIFIER "identifier"
+%token <text> INTEGER_VALUE "integer" IDENTIFIER "identifier"
 %token <token> IF "‘if’" ELSE "‘else’" WHILE "‘while’" FOR "‘for’"
 %token <token> BREAK "‘break’" CONTINUE "‘continue’" RETURN "‘return’"
 %token <token> CONST "‘const’" INT "‘int’" VOID "‘void’"
@@ -128,8 +135,8 @@ void yyerror(const char *s) {
 
 CompUnit: CompUnit Decl { $$->body.push_back($<declare>2); }
         | CompUnit FuncDef { $$->body.push_back($<fundef>2); }
-        | Decl { root = new syc::ast::node::Root(); $$ = root; $$->body.push_back($<declare>1); }
-        | FuncDef { root = new syc::ast::node::Root(); $$ = root; $$->body.push_back($<fundef>1); }
+        | Decl { root = NEW(Root)(); $$ = root; $$->body.push_back($<declare>1); }
+        | FuncDef { root = NEW(Root)(); $$ = root; $$->body.push_back($<fundef>1); }
         ;
 
 Decl: ConstDeclStmt
@@ -140,13 +147,13 @@ BType: INT;
 
 ConstDeclStmt: ConstDecl SEMI { $$ = $1; };
 
-ConstDecl: CONST BType ConstDef { $$ = new syc::ast::node::DeclareStatement($2); $$->list.push_back($3); }
+ConstDecl: CONST BType ConstDef { $$ = NEW(DeclareStatement)($2); $$->list.push_back($3); }
          | ConstDecl COMMA ConstDef { $$->list.push_back($3); }
          ;
 
 VarDeclStmt: VarDecl SEMI { $$ = $1; };
 
-VarDecl: BType Def { $$ = new syc::ast::node::DeclareStatement($1); $$->list.push_back($2); }
+VarDecl: BType Def { $$ = NEW(DeclareStatement)($1); $$->list.push_back($2); }
        | VarDecl COMMA Def { $$->list.push_back($3); }
        ;
 
@@ -154,55 +161,53 @@ Def: DefOne
    | DefArray
    ;
 
-DefOne: ident ASSIGN AddExp { $$ = new syc::ast::node::VarDeclareWithInit(*$1, *$3); }
-      | ident { $$ = new syc::ast::node::VarDeclare(*$1); }
+DefOne: ident ASSIGN AddExp { $$ = NEW(VarDeclareWithInit)(*$1, *$3); }
+      | ident { $$ = NEW(VarDeclare)(*$1); }
       ;
 
-DefArray: DefArrayName ASSIGN InitValArray { $$ = new syc::ast::node::ArrayDeclareWithInit(*$1, *$3); }
-        | DefArrayName { $$ = new syc::ast::node::ArrayDeclare(*$1); }
+DefArray: DefArrayName ASSIGN InitValArray { $$ = NEW(ArrayDeclareWithInit)(*$1, *$3); }
+        | DefArrayName { $$ = NEW(ArrayDeclare)(*$1); }
         ;
 
 ConstDef: ConstDefOne
         | ConstDefArray
         ;
 
-ConstDefOne: ident ASSIGN AddExp { $$ = new syc::ast::node::VarDeclareWithInit(*$1, *$3, true); }
+ConstDefOne: ident ASSIGN AddExp { $$ = NEW(VarDeclareWithInit)(*$1, *$3, true); }
            ;
 
-ConstDefArray: DefArrayName ASSIGN InitValArray { $$ = new syc::ast::node::ArrayDeclareWithInit(*$1, *$3, true); }
+ConstDefArray: DefArrayName ASSIGN InitValArray { $$ = NEW(ArrayDeclareWithInit)(*$1, *$3, true); }
              ;
 
 DefArrayName: DefArrayName LSQUARE Exp RSQUARE { $$ = $1; $$->shape.push_back($3); }
-            | ident LSQUARE Exp RSQUARE { $$ = new syc::ast::node::ArrayIdentifier(*$1); $$->shape.push_back($3); }
+            | ident LSQUARE Exp RSQUARE { $$ = NEW(ArrayIdentifier)(*$1); $$->shape.push_back($3); }
             ;
 
 InitValArray: LBRACE InitValArrayInner RBRACE { $$ = $2; }
-            | LBRACE RBRACE { $$ = new syc::ast::node::ArrayDeclareInitValue(false, nullptr); }
+            | LBRACE RBRACE { $$ = NEW(ArrayDeclareInitValue)(false, nullptr); }
             ;
 
 InitValArrayInner: InitValArrayInner COMMA InitValArray { $$ = $1; $$->value_list.push_back($3); }
-                 | InitValArrayInner COMMA AddExp { $$ = $1; $$->value_list.push_back(new syc::ast::node::ArrayDeclareInitValue(true, $3)); }
-                 | InitValArray { $$ = new syc::ast::node::ArrayDeclareInitValue(false, nullptr); $$->value_list.push_back($1); }
-                 | AddExp { $$ = new syc::ast::node::ArrayDeclareInitValue(false, nullptr); $$->value_list.push_back(new syc::ast::node::ArrayDeclareInitValue(true, $1)); }
+                 | InitValArrayInner COMMA AddExp { $$ = $1; $$->value_list.push_back(NEW(ArrayDeclareInitValue)(true, $3)); }
+                 | InitValArray { $$ = NEW(ArrayDeclareInitValue)(false, nullptr); $$->value_list.push_back($1); }
+                 | AddExp { $$ = NEW(ArrayDeclareInitValue)(false, nullptr); $$->value_list.push_back(NEW(ArrayDeclareInitValue)(true, $1)); }
                  | AddExp COMMA InitValArray  {
-                       $$ = new syc::ast::node::ArrayDeclareInitValue(false, nullptr);
-                       $$->value_list.push_back(new syc::ast::node::ArrayDeclareInitValue(true, $1));
+                       $$ = NEW(ArrayDeclareInitValue)(false, nullptr);
+                       $$->value_list.push_back(NEW(ArrayDeclareInitValue)(true, $1));
                        $$->value_list.push_back($3);
                   }
                  | CommaExpr {
-                       $$ = new syc::ast::node::ArrayDeclareInitValue(false, nullptr);
+                       $$ = NEW(ArrayDeclareInitValue)(false, nullptr);
                        for (auto i : dynamic_cast<syc::ast::node::CommaExpression*>($1)->values) {
-                             $$->value_list.push_back(new syc::ast::node::ArrayDeclareInitValue(true, i));
+                             $$->value_list.push_back(NEW(ArrayDeclareInitValue)(true, i));
                        }
-                       delete $1;
                  }
                  | CommaExpr COMMA InitValArray {
-                       $$ = new syc::ast::node::ArrayDeclareInitValue(false, nullptr);
+                       $$ = NEW(ArrayDeclareInitValue)(false, nullptr);
                        for (auto i : dynamic_cast<syc::ast::node::CommaExpression*>($1)->values) {
-                             $$->value_list.push_back(new syc::ast::node::ArrayDeclareInitValue(true, i));
+                             $$->value_list.push_back(NEW(ArrayDeclareInitValue)(true, i));
                        }
                        $$->value_list.push_back($3);
-                       delete $1;
                  }
                  ;
 
@@ -211,7 +216,7 @@ Exp: AddExp
    ;
 
 CommaExpr: AddExp COMMA AddExp {
-               auto n = new syc::ast::node::CommaExpression();
+               auto n = NEW(CommaExpression)();
                n->values.push_back($1);
                n->values.push_back($3);
                $$ = n;
@@ -222,39 +227,39 @@ CommaExpr: AddExp COMMA AddExp {
             }
          ;
 
-LOrExp: LAndExp OR LAndExp { $$ = new syc::ast::node::BinaryExpression(*$1, $2, *$3); }
-      | LOrExp OR LAndExp { $$ = new syc::ast::node::BinaryExpression(*$1, $2, *$3); }
+LOrExp: LAndExp OR LAndExp { $$ = NEW(BinaryExpression)(*$1, $2, *$3); }
+      | LOrExp OR LAndExp { $$ = NEW(BinaryExpression)(*$1, $2, *$3); }
       | LAndExp
       ;
 
-LAndExp: LAndExp AND EqExp  { $$ = new syc::ast::node::BinaryExpression(*$1, $2, *$3); }
+LAndExp: LAndExp AND EqExp  { $$ = NEW(BinaryExpression)(*$1, $2, *$3); }
        | EqExp
        ;
 
-EqExp: RelExp EQ RelExp  { $$ = new syc::ast::node::BinaryExpression(*$1, $2, *$3); }
-     | RelExp NE RelExp  { $$ = new syc::ast::node::BinaryExpression(*$1, $2, *$3); }
+EqExp: RelExp EQ RelExp  { $$ = NEW(BinaryExpression)(*$1, $2, *$3); }
+     | RelExp NE RelExp  { $$ = NEW(BinaryExpression)(*$1, $2, *$3); }
      | RelExp
      ;
 
 RelExp: AddExp
-      | RelExp RelOp AddExp  { $$ = new syc::ast::node::BinaryExpression(*$1, $2, *$3); }
+      | RelExp RelOp AddExp  { $$ = NEW(BinaryExpression)(*$1, $2, *$3); }
       ;
 
-AddExp: AddExp AddOp MulExp  { $$ = new syc::ast::node::BinaryExpression(*$1, $2, *$3); }
+AddExp: AddExp AddOp MulExp  { $$ = NEW(BinaryExpression)(*$1, $2, *$3); }
       | MulExp
       ;
 
-MulExp: MulExp MulOp UnaryExp  { $$ = new syc::ast::node::BinaryExpression(*$1, $2, *$3); }
+MulExp: MulExp MulOp UnaryExp  { $$ = NEW(BinaryExpression)(*$1, $2, *$3); }
       | UnaryExp
       ;
 
-UnaryExp: UnaryOp UnaryExp  { $$ = new syc::ast::node::UnaryExpression($1, *$2); }
+UnaryExp: UnaryOp UnaryExp  { $$ = NEW(UnaryExpression)($1, *$2); }
         | FunctionCall
         | PrimaryExp
         ;
 
-FunctionCall: ident LPAREN FuncRParams RPAREN { $$ = new syc::ast::node::FunctionCall(*$1, *$3); };
-            | ident LPAREN RPAREN { $$ = new syc::ast::node::FunctionCall(*$1, *(new syc::ast::node::FunctionCallArgList())); }
+FunctionCall: ident LPAREN FuncRParams RPAREN { $$ = NEW(FunctionCall)(*$1, *$3); };
+            | ident LPAREN RPAREN { $$ = NEW(FunctionCall)(*$1, *(NEW(FunctionCallArgList)())); }
             ;
 
 PrimaryExp: LVal
@@ -263,7 +268,7 @@ PrimaryExp: LVal
           | AssignStmtWithoutSemi
           ;
 
-ArrayItem: LVal LSQUARE Exp RSQUARE { $$ = new syc::ast::node::ArrayIdentifier(*$1); $$->shape.push_back($3);}
+ArrayItem: LVal LSQUARE Exp RSQUARE { $$ = NEW(ArrayIdentifier)(*$1); $$->shape.push_back($3);}
          | ArrayItem LSQUARE Exp RSQUARE { $$ = $1; $$->shape.push_back($3);}
          ;
 
@@ -271,15 +276,15 @@ LVal: ArrayItem
     | ident
     ;
 
-FuncDef: BType ident LPAREN FuncFParams RPAREN Block { $$ = new syc::ast::node::FunctionDefine($1, *$2, *$4, *$6); }
-       | BType ident LPAREN RPAREN Block { $$ = new syc::ast::node::FunctionDefine($1, *$2, *(new syc::ast::node::FunctionDefineArgList()), *$5); }
-       | VOID ident LPAREN FuncFParams RPAREN Block { $$ = new syc::ast::node::FunctionDefine($1, *$2, *$4, *$6); }
-       | VOID ident LPAREN RPAREN Block { $$ = new syc::ast::node::FunctionDefine($1, *$2, *(new syc::ast::node::FunctionDefineArgList()), *$5); }
+FuncDef: BType ident LPAREN FuncFParams RPAREN Block { $$ = NEW(FunctionDefine)($1, *$2, *$4, *$6); }
+       | BType ident LPAREN RPAREN Block { $$ = NEW(FunctionDefine)($1, *$2, *(NEW(FunctionDefineArgList)()), *$5); }
+       | VOID ident LPAREN FuncFParams RPAREN Block { $$ = NEW(FunctionDefine)($1, *$2, *$4, *$6); }
+       | VOID ident LPAREN RPAREN Block { $$ = NEW(FunctionDefine)($1, *$2, *(NEW(FunctionDefineArgList)()), *$5); }
        ;
 
 
 FuncFParams: FuncFParams COMMA FuncFParam { $$->list.push_back($3); }
-           | FuncFParam {{ $$ = new syc::ast::node::FunctionDefineArgList(); $$->list.push_back($1); }}
+           | FuncFParam {{ $$ = NEW(FunctionDefineArgList)(); $$->list.push_back($1); }}
            ;
 
 FuncFParam: FuncFParamOne
@@ -287,26 +292,25 @@ FuncFParam: FuncFParamOne
           ;
 
 FuncRParams: FuncRParams COMMA AddExp { $$ = $1; $$->args.push_back($3); }
-           | AddExp { $$ = new syc::ast::node::FunctionCallArgList(); $$->args.push_back($1); }
+           | AddExp { $$ = NEW(FunctionCallArgList)(); $$->args.push_back($1); }
            ;
 
-FuncFParamOne: BType ident { $$ = new syc::ast::node::FunctionDefineArg($1, *$2); };
+FuncFParamOne: BType ident { $$ = NEW(FunctionDefineArg)($1, *$2); };
 
 FuncFParamArray: FuncFParamOne LSQUARE RSQUARE {
-                        $$ = new syc::ast::node::FunctionDefineArg(
+                        $$ = NEW(FunctionDefineArg)(
                               $1->type,
-                              *new syc::ast::node::ArrayIdentifier(*(new syc::ast::node::ArrayIdentifier($1->name))));
-                        ((syc::ast::node::ArrayIdentifier*)&($$->name))->shape.push_back(new syc::ast::node::Number(1));
-                        delete $1;
+                              *NEW(ArrayIdentifier)(*(NEW(ArrayIdentifier)($1->name))));
+                        ((syc::ast::node::ArrayIdentifier*)&($$->name))->shape.push_back(NEW(Number)(1));
                   }
                | FuncFParamArray LSQUARE Exp RSQUARE { $$ = $1; ((syc::ast::node::ArrayIdentifier*)&($$->name))->shape.push_back($3);; }
                ;
 
-Block: LBRACE RBRACE { $$ = new syc::ast::node::Block(); }
+Block: LBRACE RBRACE { $$ = NEW(Block)(); }
      | LBRACE BlockItems RBRACE { $$ = $2; }
      ;
 
-BlockItems: BlockItem { $$ = new syc::ast::node::Block(); $$->statements.push_back($1); }
+BlockItems: BlockItem { $$ = NEW(Block)(); $$->statements.push_back($1); }
           | BlockItems BlockItem { $$ = $1; $$->statements.push_back($2); }
           ;
 
@@ -322,63 +326,63 @@ Stmt: Block
     | ForStmt
     | BreakStmt
     | ContinueStmt
-    | Exp SEMI { $$ = new  syc::ast::node::EvalStatement(*$1); }
-    | SEMI { $$ = new syc::ast::node::VoidStatement(); }
+    | Exp SEMI { $$ = NEW(EvalStatement)(*$1); }
+    | SEMI { $$ = NEW(VoidStatement)(); }
     ;
 
 AssignStmt: AssignStmtWithoutSemi SEMI { $$ = $1; }
 
-AssignStmtWithoutSemi: LVal ASSIGN AddExp { $$ = new syc::ast::node::Assignment(*$1, *$3); }
-                     | PLUSPLUS LVal { $$ = new syc::ast::node::Assignment(*$2, *new syc::ast::node::BinaryExpression(*$2, PLUS, *new syc::ast::node::Number(1))); }
-                     | MINUSMINUS LVal { $$ = new syc::ast::node::Assignment(*$2, *new syc::ast::node::BinaryExpression(*$2, MINUS, *new syc::ast::node::Number(1))); }
-                     | LVal PLUSPLUS { $$ = new syc::ast::node::AfterInc(*$1, PLUS); }
-                     | LVal MINUSMINUS { $$ = new syc::ast::node::AfterInc(*$1, MINUS); }
+AssignStmtWithoutSemi: LVal ASSIGN AddExp { $$ = NEW(Assignment)(*$1, *$3); }
+                     | PLUSPLUS LVal { $$ = NEW(Assignment)(*$2, *NEW(BinaryExpression)(*$2, PLUS, *NEW(Number)(1))); }
+                     | MINUSMINUS LVal { $$ = NEW(Assignment)(*$2, *NEW(BinaryExpression)(*$2, MINUS, *NEW(Number)(1))); }
+                     | LVal PLUSPLUS { $$ = NEW(AfterInc)(*$1, PLUS); }
+                     | LVal MINUSMINUS { $$ = NEW(AfterInc)(*$1, MINUS); }
                      ;
 
-IfStmt: IF LPAREN Cond RPAREN Stmt { $$ = new syc::ast::node::IfElseStatement(*$3, *$5, *new syc::ast::node::VoidStatement()); }
-      | IF LPAREN Cond RPAREN Stmt ELSE Stmt { $$ = new syc::ast::node::IfElseStatement(*$3, *$5, *$7); }
+IfStmt: IF LPAREN Cond RPAREN Stmt { $$ = NEW(IfElseStatement)(*$3, *$5, *NEW(VoidStatement)()); }
+      | IF LPAREN Cond RPAREN Stmt ELSE Stmt { $$ = NEW(IfElseStatement)(*$3, *$5, *$7); }
       ;
 
-ReturnStmt: RETURN Exp SEMI { $$ = new syc::ast::node::ReturnStatement($2); }
-          | RETURN SEMI { $$ = new syc::ast::node::ReturnStatement(); }
+ReturnStmt: RETURN Exp SEMI { $$ = NEW(ReturnStatement)($2); }
+          | RETURN SEMI { $$ = NEW(ReturnStatement)(); }
           ;
 
-WhileStmt: WHILE LPAREN Cond RPAREN Stmt { $$ = new syc::ast::node::WhileStatement(*$3, *$5);};
+WhileStmt: WHILE LPAREN Cond RPAREN Stmt { $$ = NEW(WhileStatement)(*$3, *$5);};
 
 ForStmt: FOR LPAREN BlockItem Cond SEMI Exp RPAREN Stmt {
-                  auto b = new syc::ast::node::Block();
-                  auto do_block = new syc::ast::node::Block();
+                  auto b = NEW(Block)();
+                  auto do_block = NEW(Block)();
                   do_block->statements.push_back($8);
-                  do_block->statements.push_back(new syc::ast::node::EvalStatement(*$6));
+                  do_block->statements.push_back(NEW(EvalStatement)(*$6));
                   b->statements.push_back($3);
-                  b->statements.push_back(new syc::ast::node::WhileStatement(*$4, *do_block));
+                  b->statements.push_back(NEW(WhileStatement)(*$4, *do_block));
                   $$ = b;
             }
        | FOR LPAREN BlockItem Cond SEMI AssignStmtWithoutSemi RPAREN Stmt {
-                  auto b = new syc::ast::node::Block();
-                  auto do_block = new syc::ast::node::Block();
+                  auto b = NEW(Block)();
+                  auto do_block = NEW(Block)();
                   do_block->statements.push_back($8);
                   do_block->statements.push_back($6);
                   b->statements.push_back($3);
-                  b->statements.push_back(new syc::ast::node::WhileStatement(*$4, *do_block));
+                  b->statements.push_back(NEW(WhileStatement)(*$4, *do_block));
                   $$ = b;
             }
        | FOR LPAREN BlockItem Cond SEMI RPAREN Stmt {
-                  auto b = new syc::ast::node::Block();
+                  auto b = NEW(Block)();
                   auto do_block = $7;
                   b->statements.push_back($3);
-                  b->statements.push_back(new syc::ast::node::WhileStatement(*$4, *do_block));
+                  b->statements.push_back(NEW(WhileStatement)(*$4, *do_block));
                   $$ = b;
             }
        ;
 
-BreakStmt: BREAK SEMI { $$ = new syc::ast::node::BreakStatement(); };
+BreakStmt: BREAK SEMI { $$ = NEW(BreakStatement)(); };
 
-ContinueStmt: CONTINUE SEMI { $$ = new syc::ast::node::ContinueStatement(); };
+ContinueStmt: CONTINUE SEMI { $$ = NEW(ContinueStatement)(); };
 
 Cond: LOrExp;
 
-Number: INTEGER_VALUE { $$ = new syc::ast::node::Number(*$1); };
+Number: INTEGER_VALUE { $$ = NEW(Number)($1.str()); };
 
 AddOp: PLUS
      | MINUS
@@ -400,5 +404,5 @@ RelOp: GT
      | LE
      ;
 
-ident: IDENTIFIER { $$ = new syc::ast::node::Identifier(*$1); }
+ident: IDENTIFIER { $$ = NEW(Identifier)($1.str()); }
 	 ;
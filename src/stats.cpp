@@ -0,0 +1,188 @@
+/*
+ * syc, a compiler for SysY
+ * Copyright (C) 2020-2021  nzh63, skywf21
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#include "stats.h"
+
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <new>
+#include <vector>
+
+#include "config.h"
+
+namespace {
+std::atomic<unsigned long long> allocations{0};
+}
+
+// 替换全局 operator new 以统计分配次数。数组与 nothrow 版本也显式转发到这里，
+// 否则 sanitizer 等自带分配器的运行时会与这里的 free 不匹配
+void* operator new(std::size_t size) {
+  allocations.fetch_add(1, std::memory_order_relaxed);
+  if (size == 0) size = 1;
+  while (true) {
+    if (void* p = std::malloc(size)) return p;
+    auto handler = std::get_new_handler();
+    if (!handler) throw std::bad_alloc();
+    handler();
+  }
+}
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete(void* p, std::size_t) noexcept { std::free(p); }
+void* operator new[](std::size_t size) { return ::operator new(size); }
+void operator delete[](void* p) noexcept { ::operator delete(p); }
+void operator delete[](void* p, std::size_t) noexcept { ::operator delete(p); }
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept {
+  try {
+    return ::operator new(size);
+  } catch (...) {
+    return nullptr;
+  }
+}
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept {
+  return ::operator new(size, std::nothrow);
+}
+void operator delete(void* p, const std::nothrow_t&) noexcept {
+  ::operator delete(p);
+}
+void operator delete[](void* p, const std::nothrow_t&) noexcept {
+  ::operator delete(p);
+}
+
+namespace syc::stats {
+namespace {
+struct Record {
+  std::string name;
+  int depth;
+  double ms;
+  long long size_before, size_after;  // -1 表示不统计
+  unsigned long long allocs;
+};
+std::vector<Record> records;
+int current_depth = 0;
+
+std::string json_escape(const std::string& s) {
+  std::string ret;
+  for (char c : s) {
+    if (c == '"' || c == '\\') {
+      ret += '\\';
+      ret += c;
+    } else if (static_cast<unsigned char>(c) < 0x20) {
+      char buf[8];
+      std::snprintf(buf, sizeof(buf), "\\u%04x", c);
+      ret += buf;
+    } else {
+      ret += c;
+    }
+  }
+  return ret;
+}
+double total_ms() {
+  double total = 0;
+  for (auto& r : records)
+    if (r.depth == 0) total += r.ms;
+  return total;
+}
+}  // namespace
+
+bool enabled() { return config::time_report || !config::stats_file.empty(); }
+
+unsigned long long allocation_count() {
+  return allocations.load(std::memory_order_relaxed);
+}
+
+Phase::Phase(std::string name, std::function<std::size_t()> count)
+    : active(enabled()), count(std::move(count)) {
+  if (!this->active) return;
+  this->depth = current_depth++;
+  this->size_before = this->count ? this->count() : -1;
+  this->allocs_before = allocation_count();
+  // 先占位，保证父阶段排在子阶段之前
+  records.push_back({std::move(name), this->depth, 0, -1, -1, 0});
+  this->index = records.size() - 1;
+  this->start = std::chrono::steady_clock::now();
+}
+Phase::~Phase() {
+  if (!this->active) return;
+  auto end = std::chrono::steady_clock::now();
+  auto& r = records[this->index];
+  r.ms = std::chrono::duration<double, std::milli>(end - this->start).count();
+  r.allocs = allocation_count() - this->allocs_before;
+  r.size_before = this->size_before;
+  r.size_after = this->count ? this->count() : -1;
+  current_depth--;
+}
+
+void print_table(std::ostream& out) {
+  double total = total_ms();
+  out << "===== syc compile-time report: " << config::input_filename
+      << " (-O" << config::optimize_level << ") =====\n";
+  out << std::setw(12) << "wall(ms)" << std::setw(8) << "%" << std::setw(10)
+      << "insts" << std::setw(10) << "->" << std::setw(12) << "allocs"
+      << "  name\n";
+  for (auto& r : records) {
+    out << std::fixed << std::setprecision(3) << std::setw(12) << r.ms
+        << std::setprecision(1) << std::setw(8)
+        << (total > 0 ? r.ms / total * 100 : 0);
+    if (r.size_before >= 0) {
+      out << std::setw(10) << r.size_before << std::setw(10) << r.size_after;
+    } else {
+      out << std::setw(10) << "-" << std::setw(10) << "-";
+    }
+    out << std::setw(12) << r.allocs << "  " << std::string(r.depth * 2, ' ')
+        << r.name << "\n";
+  }
+  out << std::setprecision(3) << std::setw(12) << total
+      << std::setprecision(1) << std::setw(8) << 100.0 << std::setw(10) << "" << std::setw(10) << "" << std::setw(12)
+      << allocation_count() << "  total\n";
+  out << std::defaultfloat;
+}
+
+void print_json(std::ostream& out) {
+  out << "{\n";
+  out << "  \"file\": \"" << json_escape(config::input_filename) << "\",\n";
+  out << "  \"opt_level\": " << config::optimize_level << ",\n";
+  out << std::fixed << std::setprecision(3);
+  out << "  \"total_ms\": " << total_ms() << ",\n";
+  out << "  \"total_allocs\": " << allocation_count() << ",\n";
+  out << "  \"phases\": [";
+  for (std::size_t i = 0; i < records.size(); i++) {
+    auto& r = records[i];
+    out << (i ? ",\n" : "\n") << "    {\"name\": \"" << json_escape(r.name)
+        << "\", \"depth\": " << r.depth << ", \"ms\": " << r.ms;
+    if (r.size_before >= 0) {
+      out << ", \"insts_before\": " << r.size_before
+          << ", \"insts_after\": " << r.size_after;
+    }
+    out << ", \"allocs\": " << r.allocs << "}";
+  }
+  out << (records.empty() ? "]\n" : "\n  ]\n") << "}\n";
+  out << std::defaultfloat;
+}
+
+void report() {
+  if (config::time_report) print_table(std::cerr);
+  if (config::stats_file == "-") {
+    print_json(std::cerr);
+  } else if (!config::stats_file.empty()) {
+    std::ofstream out(config::stats_file);
+    print_json(out);
+  }
+}
+}  // namespace syc::stats
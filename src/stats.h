@@ -0,0 +1,56 @@
+/*
+ * syc, a compiler for SysY
+ * Copyright (C) 2020-2021  nzh63, skywf21
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#pragma once
+#include <chrono>
+#include <cstddef>
+#include <functional>
+#include <ostream>
+#include <string>
+
+namespace syc::stats {
+// 编译统计：记录每个阶段与每次 pass 调用的耗时、指令数与堆分配次数。
+// 由 -ftime-report（表格）或 -stats[=file]（JSON）开启，未开启时不做任何记录
+bool enabled();
+
+// 作用域计时器，析构时生成一条记录。嵌套的 Phase 在报告中缩进显示
+class Phase {
+ public:
+  // count 用于在开始与结束时统计指令数，可为空
+  Phase(std::string name, std::function<std::size_t()> count = {});
+  Phase(const Phase&) = delete;
+  Phase& operator=(const Phase&) = delete;
+  ~Phase();
+
+ private:
+  bool active;
+  std::function<std::size_t()> count;
+  int depth;
+  std::size_t index;
+  long long size_before;
+  unsigned long long allocs_before;
+  std::chrono::steady_clock::time_point start;
+};
+
+// 自程序启动以来 operator new 的调用次数
+unsigned long long allocation_count();
+
+void print_table(std::ostream& out);
+void print_json(std::ostream& out);
+// 按 config 输出报告
+void report();
+}  // namespace syc::stats
@@ -0,0 +1,139 @@
+/*
+ * syc, a compiler for SysY
+ * Copyright (C) 2020-2021  nzh63, skywf21
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#include "thread_pool.h"
+
+#include <system_error>
+
+#include "config.h"
+
+namespace syc {
+ThreadPool::ThreadPool(unsigned thread_count) {
+  if (thread_count == 0) thread_count = 1;
+  for (unsigned i = 0; i < thread_count; i++)
+    this->queues.emplace_back(std::make_unique<Queue>());
+  try {
+    for (unsigned i = 0; i + 1 < thread_count; i++)
+      this->threads.emplace_back(&ThreadPool::worker, this, i);
+  } catch (const std::system_error&) {
+    // 无法创建线程时退化为已创建的线程数
+    this->queues.resize(this->threads.size() + 1);
+  }
+}
+
+ThreadPool::~ThreadPool() {
+  {
+    std::lock_guard lock(this->mutex);
+    this->stopping = true;
+  }
+  this->wake.notify_all();
+  for (auto& thread : this->threads) thread.join();
+}
+
+ThreadPool& ThreadPool::get() {
+#if defined(__EMSCRIPTEN__) && !defined(__EMSCRIPTEN_PTHREADS__)
+  static ThreadPool pool(1);
+#else
+  static ThreadPool pool(config::jobs > 0
+                             ? config::jobs
+                             : std::thread::hardware_concurrency());
+#endif
+  return pool;
+}
+
+void ThreadPool::run(std::size_t n,
+                     const std::function<void(std::size_t)>& f) {
+  if (n == 0) return;
+  if (this->threads.empty() || n == 1) {
+    for (std::size_t i = 0; i < n; i++) f(i);
+    return;
+  }
+  {
+    std::lock_guard lock(this->mutex);
+    this->job = &f;
+    this->error = nullptr;
+    this->remaining = n;
+    this->generation++;
+  }
+  for (std::size_t i = 0; i < n; i++) {
+    auto& queue = *this->queues[i * this->queues.size() / n];
+    std::lock_guard lock(queue.mutex);
+    queue.tasks.push_back(i);
+  }
+  this->wake.notify_all();
+  this->execute(this->queues.size() - 1);
+  {
+    std::unique_lock lock(this->mutex);
+    this->done.wait(lock, [this] { return this->remaining == 0; });
+    this->job = nullptr;
+  }
+  if (this->error) std::rethrow_exception(this->error);
+}
+
+void ThreadPool::worker(unsigned id) {
+  std::size_t seen = 0;
+  while (true) {
+    {
+      std::unique_lock lock(this->mutex);
+      this->wake.wait(lock, [&] {
+        return this->stopping || this->generation != seen;
+      });
+      if (this->stopping) return;
+      seen = this->generation;
+    }
+    this->execute(id);
+  }
+}
+
+void ThreadPool::execute(unsigned id) {
+  std::size_t task;
+  while (this->next_task(id, task)) {
+    try {
+      (*this->job)(task);
+    } catch (...) {
+      std::lock_guard lock(this->mutex);
+      if (!this->error) this->error = std::current_exception();
+    }
+    if (this->remaining.fetch_sub(1) == 1) {
+      std::lock_guard lock(this->mutex);
+      this->done.notify_all();
+    }
+  }
+}
+
+bool ThreadPool::next_task(unsigned id, std::size_t& task) {
+  {
+    auto& queue = *this->queues[id];
+    std::lock_guard lock(queue.mutex);
+    if (!queue.tasks.empty()) {
+      task = queue.tasks.front();
+      queue.tasks.pop_front();
+      return true;
+    }
+  }
+  for (unsigned i = 1; i < this->queues.size(); i++) {
+    auto& queue = *this->queues[(id + i) % this->queues.size()];
+    std::lock_guard lock(queue.mutex);
+    if (!queue.tasks.empty()) {
+      task = queue.tasks.back();
+      queue.tasks.pop_back();
+      return true;
+    }
+  }
+  return false;
+}
+}  // namespace syc
@@ -0,0 +1,76 @@
+/*
+ * syc, a compiler for SysY
+ * Copyright (C) 2020-2021  nzh63, skywf21
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace syc {
+// 工作窃取线程池。任务按下标连续分块放入各线程的队列，线程优先从自己队列的头部
+// 取任务，队列为空时从其他线程队列的尾部窃取。调用 run 的线程也参与执行
+class ThreadPool {
+ public:
+  // thread_count 为包括调用线程在内的线程数
+  explicit ThreadPool(unsigned thread_count);
+  ThreadPool(const ThreadPool&) = delete;
+  ThreadPool& operator=(const ThreadPool&) = delete;
+  ~ThreadPool();
+
+  unsigned size() const { return this->queues.size(); }
+
+  // 并行执行 f(0), ..., f(n - 1)，全部完成后返回。
+  // 任务抛出的第一个异常在此处重新抛出
+  void run(std::size_t n, const std::function<void(std::size_t)>& f);
+
+  // 按 config::jobs 创建的全局线程池
+  static ThreadPool& get();
+
+ private:
+  struct Queue {
+    std::mutex mutex;
+    std::deque<std::size_t> tasks;
+  };
+  std::vector<std::unique_ptr<Queue>> queues;
+  std::vector<std::thread> threads;
+
+  std::mutex mutex;
+  std::condition_variable wake, done;
+  const std::function<void(std::size_t)>* job = nullptr;
+  std::size_t generation = 0;
+  std::atomic<std::size_t> remaining = 0;
+  std::exception_ptr error;
+  bool stopping = false;
+
+  void worker(unsigned id);
+  void execute(unsigned id);
+  bool next_task(unsigned id, std::size_t& task);
+};
+
+// 在全局线程池上并行执行 f(0), ..., f(n - 1)
+inline void parallel_for(std::size_t n,
+                         const std::function<void(std::size_t)>& f) {
+  ThreadPool::get().run(n, f);
+}
+}  // namespace syc
@@ -0,0 +1,86 @@
+const path = require("path");
+const fs = require('fs');
+const os = require('os');
+const child_process = require("child_process");
+const GENERATORS = require('./gen_stress');
+
+const EXE_PATH = process.env.SYC || path.join(__dirname, '../build/syc');
+const TMP_DIR = fs.mkdtempSync(path.join(os.tmpdir(), 'syc-bench-'));
+const OPT = process.env.OPT || '-O2';
+const REPEAT = parseInt(process.env.REPEAT) || 3;
+// 每类程序的规模，依次翻倍以观察增长曲线
+const SIZES = {
+    loop_nest: [2, 4, 8, 16],
+    functions: [250, 500, 1000, 2000],
+    array_init: [2500, 5000, 10000, 20000],
+    straight_line: [1000, 2000, 4000, 8000],
+};
+// 规模翻倍时耗时增长超过该指数视为超线性
+const SUPER_LINEAR = 1.5;
+const TIMEOUT = 60000;
+
+process.on('SIGINT', () => {
+    process.exit();
+});
+process.on('exit', () => {
+    fs.rmdirSync(TMP_DIR, { recursive: true });
+});
+
+// 编译 REPEAT 次，每个阶段取最短耗时
+function compile(file) {
+    const statsFile = file.replace(/\.sy$/, '.json');
+    let best = null;
+    for (let i = 0; i < REPEAT; i++) {
+        child_process.execFileSync(EXE_PATH, [file, OPT, `-stats=${statsFile}`, '-o', file.replace(/\.sy$/, '.s')], { timeout: TIMEOUT });
+        const stats = JSON.parse(fs.readFileSync(statsFile, { encoding: 'utf8' }));
+        const phases = {};
+        for (const phase of stats.phases) {
+            if (phase.depth !== 0) continue;
+            phases[phase.name] = (phases[phase.name] || 0) + phase.ms;
+        }
+        phases.total = stats.total_ms;
+        if (best === null) {
+            best = phases;
+        } else {
+            for (const name in phases) best[name] = Math.min(best[name], phases[name]);
+        }
+    }
+    return best;
+}
+
+const PHASES = ['parse', 'ir.generate', 'ir.optimize', 'asm.generate', 'asm.optimize', 'emit', 'total'];
+const col = (s, w = 13) => String(s).padStart(w);
+
+let superLinear = 0, failCount = 0;
+console.log(`${'program'.padEnd(24)}${PHASES.map(i => col(i)).join('')}${col('exponent', 10)}`);
+for (const kind in SIZES) {
+    let last = null;
+    for (const size of SIZES[kind]) {
+        const file = path.join(TMP_DIR, `${kind}_${size}.sy`);
+        fs.writeFileSync(file, GENERATORS[kind](size));
+        let phases;
+        try {
+            phases = compile(file);
+        } catch (e) {
+            failCount++;
+            console.log(`${`${kind} ${size}`.padEnd(24)}\x1B[31mfailed: ${e.signal || e.status || e.message}\x1B[0m`);
+            break;
+        }
+        let exponent = '';
+        if (last !== null && last.phases.total > 0) {
+            const e = Math.log(phases.total / last.phases.total) / Math.log(size / last.size);
+            exponent = e.toFixed(2);
+            if (e > SUPER_LINEAR) {
+                superLinear++;
+                exponent = `\x1B[31m${exponent}\x1B[0m`.padStart(19);
+            }
+        }
+        console.log(`${`${kind} ${size}`.padEnd(24)}${PHASES.map(i => col((phases[i] || 0).toFixed(2))).join('')}${col(exponent, 10)}`);
+        last = { size, phases };
+    }
+}
+console.log();
+console.log(`times in ms (${OPT}, best of ${REPEAT}); exponent = log(t2/t1) / log(n2/n1) of total time`);
+if (superLinear > 0) console.log(`    \x1B[31m${superLinear} super-linear step(s)\x1B[0m`);
+if (failCount > 0) console.log(`    \x1B[31m${failCount} fail\x1B[0m`);
+process.exit(failCount == 0 ? 0 : 1);
@@ -0,0 +1,65 @@
+// 生成用于测试编译器吞吐量的 SysY 压力程序
+// 用法: node gen_stress.js <kind> <size>
+const GENERATORS = {
+    // 深度为 size 的 while 循环嵌套
+    loop_nest(size) {
+        let src = 'int main() {\n    int s = getint();\n';
+        for (let i = 0; i < size; i++) {
+            src += `${'    '.repeat(i + 1)}int i${i} = 0;\n`;
+            src += `${'    '.repeat(i + 1)}while (i${i} < 2) {\n`;
+        }
+        const indent = '    '.repeat(size + 1);
+        src += `${indent}s = s + ${Array.from({ length: size }, (_, i) => `i${i}`).join(' + ') || '1'};\n`;
+        for (let i = size - 1; i >= 0; i--) {
+            src += `${'    '.repeat(i + 2)}i${i} = i${i} + 1;\n`;
+            src += `${'    '.repeat(i + 1)}}\n`;
+        }
+        src += '    putint(s);\n    return 0;\n}\n';
+        return src;
+    },
+    // size 个相互调用的函数
+    functions(size) {
+        let src = 'int f0(int a) {\n    return a + 1;\n}\n';
+        for (let i = 1; i < size; i++) {
+            src += `int f${i}(int a) {\n`;
+            src += `    if (a > ${i}) return f${i - 1}(a - 1);\n`;
+            src += `    return a * ${i} + f${i - 1}(a);\n}\n`;
+        }
+        src += `int main() {\n    putint(f${size - 1}(getint()));\n    return 0;\n}\n`;
+        return src;
+    },
+    // 含 size 个元素初始化列表的全局与局部数组
+    array_init(size) {
+        const values = Array.from({ length: size }, (_, i) => (i * 7919) % 1000).join(', ');
+        let src = `int g[${size}] = {${values}};\n`;
+        src += 'int main() {\n';
+        src += `    int l[${size}] = {${values}};\n`;
+        src += `    int i = getint() % ${size};\n`;
+        src += '    putint(g[i] + l[i]);\n    return 0;\n}\n';
+        return src;
+    },
+    // size 条语句组成的单个基本块
+    straight_line(size) {
+        const vars = ['a', 'b', 'c', 'd'];
+        let src = 'int main() {\n';
+        for (const v of vars) src += `    int ${v} = getint();\n`;
+        for (let i = 0; i < size; i++) {
+            const d = vars[i % 4], x = vars[(i + 1) % 4], y = vars[(i + 2) % 4];
+            const op = ['+', '-', '*', '+'][i % 4];
+            src += `    ${d} = ${x} ${op} ${y} + ${i % 13};\n`;
+        }
+        src += `    putint(${vars.join(' + ')});\n    return 0;\n}\n`;
+        return src;
+    },
+};
+
+module.exports = GENERATORS;
+
+if (require.main === module) {
+    const [kind, size] = process.argv.slice(2);
+    if (!GENERATORS[kind] || !(parseInt(size) > 0)) {
+        console.error(`usage: node gen_stress.js <${Object.keys(GENERATORS).join('|')}> <size>`);
+        process.exit(1);
+    }
+    process.stdout.write(GENERATORS[kind](parseInt(size)));
+}
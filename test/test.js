@@ -9,7 +9,7 @@ const TEST_PATH = path.join(__dirname, './functional_test');
 const TMP_DIR = fs.mkdtempSync(path.join(os.tmpdir(), 'syc-test-'));
 const ASM_TMP_FILE = path.join(TMP_DIR, '${name}.s');
 const EXE_TMP_FILE = path.join(TMP_DIR, '${name}.out');
-const OPT = ['-O0', '-O0 -g', '-O2', '-O2 -g'];
+const OPT = ['-O0', '-O0 -g', '-O2', '-O2 -g', '-O2 -mfpu=neon'];
 const WORKS = 8;
 
 let passCount = 0, failCount = 0;